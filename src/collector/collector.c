@@ -35,7 +35,10 @@
 #include <ctype.h>
 #include <errno.h>
 #include <netinet/in.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdarg.h>
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -57,25 +60,115 @@
 #include "util.h"
 
 /* local variables */
-static uint32_t exporter_sysid = 0;
+static _Atomic uint32_t exporter_sysid = 0;
 static char *DynamicSourcesDir = NULL;
 
+// hash table IP -> FlowSource of IP specific sources
+static FlowSource_t **sourceHash = NULL;
+static uint32_t sourceHashSize = 0;
+static uint32_t sourceHashCount = 0;
+
+/*
+ * asynchronous file rotation
+ * RotateFlowFiles() switches each flow source to a new file and queues the old file
+ * to the finisher thread, which drains, closes, renames and books it.
+ * Launcher messages are queued in the same order, and are therefore sent
+ * after all files of a cycle are finished.
+ */
+typedef struct finishJob_s {
+    struct finishJob_s *next;
+    // file to finish - NULL for a launcher message
+    nffile_t *nffile;
+    char *tmpName;
+    char fileName[MAXPATHLEN];
+    bookkeeper_t *bookkeeper;
+    uint32_t bad_packets;
+    // launcher message
+    int pfd;
+    char fmt[32];
+    char subdir[256];
+    char *datadir;
+    // common
+    time_t t_start;
+    char Ident[IDENTLEN];
+} finishJob_t;
+
+static struct finisher_s {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    pthread_t tid;
+    finishJob_t *head;
+    finishJob_t *tail;
+    int running;
+    int done;
+} finisher = {.mutex = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER};
+
+static _Atomic int launcherError = 0;
+
 /* local prototypes */
 static uint32_t AssignExporterID(void);
 
+static int InsertFlowSource(FlowSource_t *fs);
+
+static void FinishFile(finishJob_t *job);
+
+static void *finisherThread(void *arg);
+
+static int StartFinisher(void);
+
 #include "nffile_inline.c"
 
 /* local functions */
 static uint32_t AssignExporterID(void) {
-    if (exporter_sysid >= 0xFFFF) {
+    uint32_t sysid = atomic_fetch_add(&exporter_sysid, 1) + 1;
+    if (sysid > 0xFFFF) {
         LogError("Too many exporters (id > 65535). Flow records collected but without reference to exporter");
         return 0;
     }
 
-    return ++exporter_sysid;
+    return sysid;
 
 }  // End of AssignExporterID
 
+static inline uint32_t IPHash(ip_addr_t *ip, uint64_t key) {
+    uint64_t hash = ip->V6[0] ^ ip->V6[1] ^ key;
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return (uint32_t)hash;
+}  // End of IPHash
+
+// insert IP specific flow source into the source hash table
+static int InsertFlowSource(FlowSource_t *fs) {
+    // keep load factor below 0.5
+    if ((2 * (sourceHashCount + 1)) > sourceHashSize) {
+        uint32_t newSize = sourceHashSize ? 2 * sourceHashSize : 64;
+        FlowSource_t **newHash = calloc(newSize, sizeof(FlowSource_t *));
+        if (!newHash) {
+            LogError("calloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+            return 0;
+        }
+        for (uint32_t i = 0; i < sourceHashSize; i++) {
+            FlowSource_t *source = sourceHash[i];
+            if (!source) continue;
+            uint32_t index = IPHash(&source->ip, 0) & (newSize - 1);
+            while (newHash[index]) index = (index + 1) & (newSize - 1);
+            newHash[index] = source;
+        }
+        free(sourceHash);
+        sourceHash = newHash;
+        sourceHashSize = newSize;
+    }
+
+    uint32_t index = IPHash(&fs->ip, 0) & (sourceHashSize - 1);
+    while (sourceHash[index]) index = (index + 1) & (sourceHashSize - 1);
+    sourceHash[index] = fs;
+    sourceHashCount++;
+
+    return 1;
+
+}  // End of InsertFlowSource
+
 /* global functions */
 
 int SetDynamicSourcesDir(FlowSource_t **FlowSource, char *dir) {
@@ -133,6 +226,7 @@ int AddFlowSource(FlowSource_t **FlowSource, char *ident, char *ip, char *flowpa
         LogError("malloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
         return 0;
     }
+    pthread_mutex_init(&(*source)->mutex, NULL);
 
     if (ip == NULL) {
         (*source)->any_source = 1;
@@ -165,6 +259,7 @@ int AddFlowSource(FlowSource_t **FlowSource, char *ident, char *ip, char *flowpa
                 return 0;
                 break;
         }
+        if (!InsertFlowSource(*source)) return 0;
     }
     // fill in ident
     if (strlen(ident) >= IDENTLEN) {
@@ -263,6 +358,7 @@ FlowSource_t *AddDynamicSource(FlowSource_t **FlowSource, struct sockaddr_storag
     (*source)->any_source = 0;
     (*source)->exporter_data = NULL;
     (*FlowSource)->exporter_count = 0;
+    pthread_mutex_init(&(*source)->mutex, NULL);
 
     switch (ss->ss_family) {
         case PF_INET: {
@@ -351,11 +447,202 @@ FlowSource_t *AddDynamicSource(FlowSource_t **FlowSource, struct sockaddr_storag
     }
     (*source)->current = strdup(path);
 
+    if (!InsertFlowSource(*source)) {
+        free(*source);
+        *source = NULL;
+        return NULL;
+    }
+
     LogInfo("Dynamically add source ident: %s in directory: %s", ident, path);
     return *source;
 
 }  // End of AddDynamicSource
 
+// lookup the IP specific flow source of ip
+FlowSource_t *LookupFlowSource(ip_addr_t *ip) {
+    if (sourceHashCount == 0) return NULL;
+
+    uint32_t index = IPHash(ip, 0) & (sourceHashSize - 1);
+    FlowSource_t *fs;
+    while ((fs = sourceHash[index]) != NULL) {
+        if (fs->ip.V6[0] == ip->V6[0] && fs->ip.V6[1] == ip->V6[1]) return fs;
+        index = (index + 1) & (sourceHashSize - 1);
+    }
+
+    return NULL;
+
+}  // End of LookupFlowSource
+
+// lookup exporter version/id of the current sender of fs
+exporter_t *LookupExporter(FlowSource_t *fs, uint32_t version, uint32_t id) {
+    if (fs->exporterHashCount == 0) return NULL;
+
+    uint32_t mask = fs->exporterHashSize - 1;
+    uint32_t index = IPHash(&fs->ip, ((uint64_t)version << 32) | id) & mask;
+    exporter_t *e;
+    while ((e = fs->exporterHash[index]) != NULL) {
+        if (e->info.id == id && e->info.version == version && e->info.ip.V6[0] == fs->ip.V6[0] && e->info.ip.V6[1] == fs->ip.V6[1]) return e;
+        index = (index + 1) & mask;
+    }
+
+    return NULL;
+
+}  // End of LookupExporter
+
+// insert a new exporter into the exporter hash table of fs
+int InsertExporter(FlowSource_t *fs, exporter_t *exporter) {
+    // keep load factor below 0.5
+    if ((2 * (fs->exporterHashCount + 1)) > fs->exporterHashSize) {
+        uint32_t newSize = fs->exporterHashSize ? 2 * fs->exporterHashSize : 16;
+        exporter_t **newHash = calloc(newSize, sizeof(exporter_t *));
+        if (!newHash) {
+            LogError("calloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+            return 0;
+        }
+        for (uint32_t i = 0; i < fs->exporterHashSize; i++) {
+            exporter_t *e = fs->exporterHash[i];
+            if (!e) continue;
+            uint32_t index = IPHash(&e->info.ip, ((uint64_t)e->info.version << 32) | e->info.id) & (newSize - 1);
+            while (newHash[index]) index = (index + 1) & (newSize - 1);
+            newHash[index] = e;
+        }
+        free(fs->exporterHash);
+        fs->exporterHash = newHash;
+        fs->exporterHashSize = newSize;
+    }
+
+    uint32_t mask = fs->exporterHashSize - 1;
+    uint32_t index = IPHash(&exporter->info.ip, ((uint64_t)exporter->info.version << 32) | exporter->info.id) & mask;
+    while (fs->exporterHash[index]) index = (index + 1) & mask;
+    fs->exporterHash[index] = exporter;
+    fs->exporterHashCount++;
+
+    return 1;
+
+}  // End of InsertExporter
+
+// close, rename and book a rotated file
+static void FinishFile(finishJob_t *job) {
+    nffile_t *nffile = job->nffile;
+
+    // Close file
+    CloseUpdateFile(nffile);
+
+    // if rename fails, we are in big trouble, as we need to get rid of the old .current
+    // file otherwise, we will loose flows and can not continue collecting new flows
+    if (RenameAppend(job->tmpName, job->fileName) < 0) {
+        LogError("Ident: %s, Can't rename dump file: %s", job->Ident, strerror(errno));
+
+        // we do not update the books here, as the file failed to rename properly
+        // otherwise the books may be wrong
+    } else {
+        struct stat fstat;
+
+        // Update books
+        stat(job->fileName, &fstat);
+        UpdateBooks(job->bookkeeper, job->t_start, 512 * fstat.st_blocks);
+    }
+
+    // log stats
+    uint64_t poolHits, poolMisses;
+    unsigned blocksPeak;
+    ReportBlockPool(&poolHits, &poolMisses, &blocksPeak);
+    LogInfo("Ident: '%s' Flows: %llu, Packets: %llu, Bytes: %llu, Sequence Errors: %u, Bad Packets: %u, Blocks: %u, Peak: %u, Pool hits: %llu, misses: %llu",
+            job->Ident, (unsigned long long)nffile->stat_record->numflows, (unsigned long long)nffile->stat_record->numpackets,
+            (unsigned long long)nffile->stat_record->numbytes, nffile->stat_record->sequence_failure, job->bad_packets, ReportBlocks(), blocksPeak,
+            (unsigned long long)poolHits, (unsigned long long)poolMisses);
+
+    DisposeFile(nffile);
+    free(job->tmpName);
+    free(job);
+
+}  // End of FinishFile
+
+static void *finisherThread(void *arg) {
+    while (1) {
+        pthread_mutex_lock(&finisher.mutex);
+        while (finisher.head == NULL && !finisher.done) pthread_cond_wait(&finisher.cond, &finisher.mutex);
+        finishJob_t *job = finisher.head;
+        if (job == NULL) {
+            // done and all jobs finished
+            pthread_mutex_unlock(&finisher.mutex);
+            break;
+        }
+        finisher.head = job->next;
+        if (finisher.head == NULL) finisher.tail = NULL;
+        pthread_mutex_unlock(&finisher.mutex);
+
+        if (job->nffile) {
+            FinishFile(job);
+        } else {
+            // launcher message - skip after errors
+            if (atomic_load(&launcherError) == 0) {
+                if (SendLauncherMessage(job->pfd, job->t_start, job->subdir[0] ? job->subdir : NULL, job->fmt, job->datadir, job->Ident) < 0) {
+                    atomic_store(&launcherError, 1);
+                } else {
+                    LogVerbose("Send launcher message");
+                }
+            }
+            free(job);
+        }
+    }
+
+    dbg_printf("Finisher thread done\n");
+    pthread_exit(NULL);
+
+}  // End of finisherThread
+
+// start the finisher thread, if not yet running
+static int StartFinisher(void) {
+    if (finisher.running) return 1;
+
+    sigset_t signalSet, saveSet;
+    sigfillset(&signalSet);
+    pthread_sigmask(SIG_SETMASK, &signalSet, &saveSet);
+
+    finisher.done = 0;
+    int err = pthread_create(&finisher.tid, NULL, finisherThread, NULL);
+    pthread_sigmask(SIG_SETMASK, &saveSet, NULL);
+    if (err) {
+        LogError("pthread_create() error in %s line %d: %s", __FILE__, __LINE__, strerror(err));
+        return 0;
+    }
+    finisher.running = 1;
+
+    return 1;
+
+}  // End of StartFinisher
+
+static void QueueFinishJob(finishJob_t *job) {
+    job->next = NULL;
+    pthread_mutex_lock(&finisher.mutex);
+    if (finisher.tail)
+        finisher.tail->next = job;
+    else
+        finisher.head = job;
+    finisher.tail = job;
+    pthread_cond_signal(&finisher.cond);
+    pthread_mutex_unlock(&finisher.mutex);
+
+}  // End of QueueFinishJob
+
+// finish all queued files and launcher messages and terminate the finisher thread
+void StopFinisher(void) {
+    if (!finisher.running) return;
+
+    pthread_mutex_lock(&finisher.mutex);
+    finisher.done = 1;
+    pthread_cond_signal(&finisher.cond);
+    pthread_mutex_unlock(&finisher.mutex);
+
+    int err = pthread_join(finisher.tid, NULL);
+    if (err) {
+        LogError("pthread_join() error in %s line %d: %s", __FILE__, __LINE__, strerror(err));
+    }
+    finisher.running = 0;
+
+}  // End of StopFinisher
+
 int RotateFlowFiles(time_t t_start, char *time_extension, FlowSource_t *fs, int done) {
     // periodic file rotation
     struct tm *now = localtime(&t_start);
@@ -373,25 +660,43 @@ int RotateFlowFiles(time_t t_start, char *time_extension, FlowSource_t *fs, int
         }
     }
 
-    // for each flow source update the stats, close the file and re-initialize the new file
+    // the last rotation is done synchronously after all pending files are finished
+    int async = 0;
+    if (done) {
+        StopFinisher();
+    } else {
+        async = StartFinisher();
+    }
+
+    // for each flow source update the stats, hand over the file to the finisher and re-initialize the new file
     while (fs) {
-        char nfcapd_filename[MAXPATHLEN];
         char error[255];
         nffile_t *nffile = fs->nffile;
 
+        // the new file inherits the settings of the current file, which is handed over to the finisher
+        int creator = nffile->file_header->creator;
+        int compress = FILE_COMPRESSION(nffile) | (nffile->compression_level << 16);
+        int encryption = FILE_ENCRYPTION(nffile);
+
+        finishJob_t *job = calloc(1, sizeof(finishJob_t));
+        if (!job) {
+            LogError("calloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+            return 0;
+        }
+
         // prepare filename
         if (subdir) {
             if (SetupSubDir(fs->datadir, subdir, error, 255)) {
-                snprintf(nfcapd_filename, MAXPATHLEN - 1, "%s/%s/nfcapd.%s", fs->datadir, subdir, fmt);
+                snprintf(job->fileName, MAXPATHLEN - 1, "%s/%s/nfcapd.%s", fs->datadir, subdir, fmt);
             } else {
                 LogError("Ident: %s, Failed to create sub hier directories: %s", fs->Ident, error);
                 // skip subdir - put flows directly into current directory
-                snprintf(nfcapd_filename, MAXPATHLEN - 1, "%s/nfcapd.%s", fs->datadir, fmt);
+                snprintf(job->fileName, MAXPATHLEN - 1, "%s/nfcapd.%s", fs->datadir, fmt);
             }
         } else {
-            snprintf(nfcapd_filename, MAXPATHLEN - 1, "%s/nfcapd.%s", fs->datadir, fmt);
+            snprintf(job->fileName, MAXPATHLEN - 1, "%s/nfcapd.%s", fs->datadir, fmt);
         }
-        nfcapd_filename[MAXPATHLEN - 1] = '\0';
+        job->fileName[MAXPATHLEN - 1] = '\0';
 
         // update stat record
         // if no flows were collected, fs->msecLast is still 0
@@ -407,28 +712,25 @@ int RotateFlowFiles(time_t t_start, char *time_extension, FlowSource_t *fs, int
         FlushExporterStats(fs);
         // Flush open datablock
         fs->dataBlock = WriteBlock(fs->nffile, fs->dataBlock);
-        // Close file
-        CloseUpdateFile(nffile);
 
-        // if rename fails, we are in big trouble, as we need to get rid of the old .current
-        // file otherwise, we will loose flows and can not continue collecting new flows
-        if (RenameAppend(fs->current, nfcapd_filename) < 0) {
-            LogError("Ident: %s, Can't rename dump file: %s", fs->Ident, strerror(errno));
-
-            // we do not update the books here, as the file failed to rename properly
-            // otherwise the books may be wrong
+        job->nffile = nffile;
+        job->bookkeeper = fs->bookkeeper;
+        job->bad_packets = fs->bad_packets;
+        job->t_start = t_start;
+        snprintf(job->Ident, IDENTLEN, "%s", fs->Ident);
+
+        // move the current file out of the way, while the finisher drains and closes it
+        char tmpName[MAXPATHLEN];
+        snprintf(tmpName, MAXPATHLEN - 1, "%s.%lld", fs->current, (long long)t_start);
+        tmpName[MAXPATHLEN - 1] = '\0';
+        if (async && rename(fs->current, tmpName) == 0) {
+            job->tmpName = strdup(tmpName);
+            QueueFinishJob(job);
         } else {
-            struct stat fstat;
-
-            // Update books
-            stat(nfcapd_filename, &fstat);
-            UpdateBooks(fs->bookkeeper, t_start, 512 * fstat.st_blocks);
+            job->tmpName = strdup(fs->current);
+            FinishFile(job);
         }
-
-        // log stats
-        LogInfo("Ident: '%s' Flows: %llu, Packets: %llu, Bytes: %llu, Sequence Errors: %u, Bad Packets: %u, Blocks: %u", fs->Ident,
-                (unsigned long long)nffile->stat_record->numflows, (unsigned long long)nffile->stat_record->numpackets,
-                (unsigned long long)nffile->stat_record->numbytes, nffile->stat_record->sequence_failure, fs->bad_packets, ReportBlocks());
+        fs->nffile = NULL;
 
         // reset stats
         fs->bad_packets = 0;
@@ -436,7 +738,7 @@ int RotateFlowFiles(time_t t_start, char *time_extension, FlowSource_t *fs, int
         fs->msecLast = 0;
 
         if (!done) {
-            fs->nffile = OpenNewFile(fs->current, fs->nffile, CREATOR_NFCAPD, INHERIT, INHERIT);
+            fs->nffile = OpenNewFile(fs->current, NULL, creator, compress, encryption);
             if (!fs->nffile) {
                 LogError("killed due to fatal error: ident: %s", fs->Ident);
                 return 0;
@@ -457,6 +759,9 @@ int RotateFlowFiles(time_t t_start, char *time_extension, FlowSource_t *fs, int
 }  // End of RotateFlowFiles
 
 int TriggerLauncher(time_t t_start, char *time_extension, int pfd, FlowSource_t *fs) {
+    // a launcher message failed in the finisher
+    if (atomic_load(&launcherError)) return 0;
+
     struct tm *now = localtime(&t_start);
     char fmt[32];
     strftime(fmt, sizeof(fmt), time_extension, now);
@@ -475,8 +780,22 @@ int TriggerLauncher(time_t t_start, char *time_extension, int pfd, FlowSource_t
     // for each flow source update the stats, close the file and re-initialize the new file
     while (fs) {
         // trigger launcher if required
-        // Send launcher message
-        if (SendLauncherMessage(pfd, t_start, subdir, fmt, fs->datadir, fs->Ident) < 0) {
+        if (finisher.running) {
+            // files of this cycle are still finished by the finisher - queue the message behind them
+            finishJob_t *job = calloc(1, sizeof(finishJob_t));
+            if (!job) {
+                LogError("calloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+                return 0;
+            }
+            job->pfd = pfd;
+            job->t_start = t_start;
+            snprintf(job->fmt, sizeof(job->fmt), "%s", fmt);
+            if (subdir) snprintf(job->subdir, sizeof(job->subdir), "%s", subdir);
+            job->datadir = fs->datadir;
+            snprintf(job->Ident, IDENTLEN, "%s", fs->Ident);
+            QueueFinishJob(job);
+        } else if (SendLauncherMessage(pfd, t_start, subdir, fmt, fs->datadir, fs->Ident) < 0) {
+            // Send launcher message
             return 0;
         } else {
             LogVerbose("Send launcher message");
@@ -635,21 +954,20 @@ int ScanExtension(char *extensionList) {
 
 }  // End of ScanExtension
 
-char *GetExporterIP(FlowSource_t *fs) {
-#define IP_STRING_LEN 40
-    static char ipstr[IP_STRING_LEN];
+char *GetExporterIP(FlowSource_t *fs, char *ipstr, size_t len) {
     ipstr[0] = '\0';
 
     if (fs->sa_family == AF_INET) {
         uint32_t _ip = htonl(fs->ip.V4);
-        inet_ntop(AF_INET, &_ip, ipstr, sizeof(ipstr));
+        inet_ntop(AF_INET, &_ip, ipstr, len);
     } else if (fs->sa_family == AF_INET6) {
         uint64_t _ip[2];
         _ip[0] = htonll(fs->ip.V6[0]);
         _ip[1] = htonll(fs->ip.V6[1]);
-        inet_ntop(AF_INET6, &_ip, ipstr, sizeof(ipstr));
+        inet_ntop(AF_INET6, &_ip, ipstr, len);
     } else {
-        strncpy(ipstr, "<unknown>", IP_STRING_LEN);
+        strncpy(ipstr, "<unknown>", len);
+        ipstr[len - 1] = '\0';
     }
 
     return ipstr;
@@ -33,6 +33,7 @@
 #define _COLLECTOR_H 1
 
 #include <netinet/in.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <sys/socket.h>
 #include <sys/types.h>
@@ -94,8 +95,16 @@ typedef struct FlowSource_s {
     // Any exporter specific data
     exporter_t *exporter_data;
     uint32_t exporter_count;
+
+    // hash table of exporter_data
+    exporter_t **exporterHash;
+    uint32_t exporterHashSize;
+    uint32_t exporterHashCount;
     struct timeval received;
 
+    // serializes packet processing of multiple receivers
+    pthread_mutex_t mutex;
+
 } FlowSource_t;
 
 /* input buffer size, to read data from the network */
@@ -120,10 +129,18 @@ int SetDynamicSourcesDir(FlowSource_t **FlowSource, char *dir);
 
 FlowSource_t *AddDynamicSource(FlowSource_t **FlowSource, struct sockaddr_storage *ss);
 
+FlowSource_t *LookupFlowSource(ip_addr_t *ip);
+
+exporter_t *LookupExporter(FlowSource_t *fs, uint32_t version, uint32_t id);
+
+int InsertExporter(FlowSource_t *fs, exporter_t *exporter);
+
 int RotateFlowFiles(time_t t_start, char *time_extension, FlowSource_t *fs, int done);
 
 int TriggerLauncher(time_t t_start, char *time_extension, int pfd, FlowSource_t *fs);
 
+void StopFinisher(void);
+
 void FlushStdRecords(FlowSource_t *fs);
 
 void FlushExporterStats(FlowSource_t *fs);
@@ -132,6 +149,6 @@ int FlushInfoExporter(FlowSource_t *fs, exporter_info_record_t *exporter);
 
 int ScanExtension(char *extensionList);
 
-char *GetExporterIP(FlowSource_t *fs);
+char *GetExporterIP(FlowSource_t *fs, char *ipstr, size_t len);
 
 #endif  //_COLLECTOR_H
@@ -29,7 +29,9 @@
  *
  */
 
-static inline FlowSource_t *GetFlowSource(struct sockaddr_storage *ss) {
+// lookup the flow source for sender ss. The flow source is not modified
+// ip and port of the sender are returned in ipAddr and portNum
+static inline FlowSource_t *FindFlowSource(struct sockaddr_storage *ss, ip_addr_t *ipAddr, in_port_t *portNum) {
     FlowSource_t *fs;
     void *ptr;
     ip_addr_t ip;
@@ -44,6 +46,9 @@ static inline FlowSource_t *GetFlowSource(struct sockaddr_storage *ss) {
     } u;
     u.ss = ss;
 
+    memset((void *)ipAddr, 0, sizeof(ip_addr_t));
+    *portNum = 0;
+
     switch (ss->ss_family) {
         case PF_INET: {
 #ifdef HAVE_STRUCT_SOCKADDR_STORAGE_SS_LEN
@@ -92,23 +97,14 @@ static inline FlowSource_t *GetFlowSource(struct sockaddr_storage *ss) {
     printf("Flow Source IP: %s\n", as);
 #endif
 
-    fs = FlowSource;
-    while (fs) {
-        if (ip.V6[0] == fs->ip.V6[0] && ip.V6[1] == fs->ip.V6[1]) {
-            fs->port = port;
-            return fs;
-        }
-
-        // if we match any source, store the current IP address - works as faster cache next time
-        // and identifies the current source by IP
-        if (fs->any_source) {
-            fs->ip = ip;
-            fs->port = port;
-            fs->sa_family = ss->ss_family;
-            return fs;
-        }
-        fs = fs->next;
-    }
+    *ipAddr = ip;
+    *portNum = port;
+
+    // IP specific sources are hashed, an any IP source is the only source
+    fs = LookupFlowSource(&ip);
+    if (fs) return fs;
+
+    if (FlowSource && FlowSource->any_source) return FlowSource;
 
     if (ptr) {
         inet_ntop(ss->ss_family, ptr, as, 100);
@@ -120,4 +116,28 @@ static inline FlowSource_t *GetFlowSource(struct sockaddr_storage *ss) {
 
     return NULL;
 
+}  // End of FindFlowSource
+
+// set the current sender of flow source fs
+static inline void SetFlowSourceSender(FlowSource_t *fs, struct sockaddr_storage *ss, ip_addr_t ip, in_port_t port) {
+    fs->port = port;
+
+    // if we match any source, store the current IP address - works as faster cache next time
+    // and identifies the current source by IP
+    if (fs->any_source) {
+        fs->ip = ip;
+        fs->sa_family = ss->ss_family;
+    }
+
+}  // End of SetFlowSourceSender
+
+static inline FlowSource_t *GetFlowSource(struct sockaddr_storage *ss) {
+    ip_addr_t ip;
+    in_port_t port;
+
+    FlowSource_t *fs = FindFlowSource(ss, &ip, &port);
+    if (fs) SetFlowSourceSender(fs, ss, ip, port);
+
+    return fs;
+
 }  // End of GetFlowSource
@@ -59,7 +59,7 @@ static int joinGroup(int sockfd, int loopBack, int mcastTTL, struct sockaddr_sto
 
 /* function definitions */
 
-int Unicast_receive_socket(const char *bindhost, const char *listenport, int family, int sockbuflen) {
+int Unicast_receive_socket(const char *bindhost, const char *listenport, int family, int sockbuflen, int reusePort) {
     struct addrinfo hints, *res, *ressave;
     socklen_t optlen;
     int error, p, sockfd;
@@ -107,6 +107,24 @@ int Unicast_receive_socket(const char *bindhost, const char *listenport, int fam
         if (!(sockfd < 0)) {
             // socket call was successful
 
+            // multiple receivers share the same port
+            if (reusePort) {
+#ifdef SO_REUSEPORT
+                int on = 1;
+                if (setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) < 0) {
+                    LogError("setsockopt(SO_REUSEPORT) error: %s", strerror(errno));
+                    close(sockfd);
+                    freeaddrinfo(ressave);
+                    return -1;
+                }
+#else
+                LogError("SO_REUSEPORT not supported on this system");
+                close(sockfd);
+                freeaddrinfo(ressave);
+                return -1;
+#endif
+            }
+
             if (bind(sockfd, res->ai_addr, res->ai_addrlen) == 0) {
                 if (res->ai_family == AF_INET) LogInfo("Bound to IPv4 host/IP: %s, Port: %s", bindhost == NULL ? "any" : bindhost, listenport);
                 if (res->ai_family == AF_INET6) LogInfo("Bound to IPv6 host/IP: %s, Port: %s", bindhost == NULL ? "any" : bindhost, listenport);
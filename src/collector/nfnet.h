@@ -49,7 +49,7 @@
 
 /* Function prototypes */
 
-int Unicast_receive_socket(const char *bindhost, const char *listenport, int family, int sockbuflen);
+int Unicast_receive_socket(const char *bindhost, const char *listenport, int family, int sockbuflen, int reusePort);
 
 int Multicast_receive_socket(const char *hostname, const char *listenport, int family, int sockbuflen);
 
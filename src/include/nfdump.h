@@ -100,6 +100,9 @@ typedef struct recordHandle_s {
     uint32_t numElements;
     // local slack space
     uint32_t localStack[2];
+    // extension slots set by the last mapping
+    uint32_t numMapped;
+    uint8_t mapped[MAXEXTENSIONS];
 } recordHandle_t;
 
 typedef struct stat_record_s {
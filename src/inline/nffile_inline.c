@@ -31,17 +31,42 @@
 
 #include <inttypes.h>
 
+static inline void ClearRecordHandle(recordHandle_t *handle);
+
 static inline int MapRecordHandle(recordHandle_t *handle, recordHeaderV3_t *recordHeaderV3, uint64_t flowCount);
 
+static inline void MapRecordOffsets(recordHandle_t *handle, recordHeaderV3_t *recordHeaderV3, uint64_t flowCount, const uint16_t *offsets,
+                                    uint32_t numOffsets);
+
 static inline dataBlock_t *AppendToBuffer(nffile_t *nffile, dataBlock_t *dataBlock, void *record, size_t required);
 
-static inline int MapRecordHandle(recordHandle_t *handle, recordHeaderV3_t *recordHeaderV3, uint64_t flowCount) {
+/*
+ * reset a handle of a previous mapping. Only the extension slots set by the last mapping
+ * and the slots set by preprocessors are cleared. A handle must be zero initialized before
+ * its first mapping.
+ */
+static inline void ClearRecordHandle(recordHandle_t *handle) {
     if (handle->extensionList[SSLindex]) free(handle->extensionList[SSLindex]);
     if (handle->extensionList[JA3index]) free(handle->extensionList[JA3index]);
     if (handle->extensionList[JA4index]) free(handle->extensionList[JA4index]);
+    handle->extensionList[SSLindex] = NULL;
+    handle->extensionList[JA3index] = NULL;
+    handle->extensionList[JA4index] = NULL;
 
-    memset((void *)handle, 0, sizeof(recordHandle_t));
+    for (int i = 0; i < handle->numMapped; i++) handle->extensionList[handle->mapped[i]] = NULL;
+    handle->numMapped = 0;
+    // the AS preprocessors map a missing AS extension to the local slack space
+    handle->extensionList[EXasRoutingID] = NULL;
+    memset((void *)handle->geo, 0, sizeof(handle->geo));
+    handle->localStack[0] = handle->localStack[1] = 0;
+
+}  // End of ClearRecordHandle
+
+static inline int MapRecordHandle(recordHandle_t *handle, recordHeaderV3_t *recordHeaderV3, uint64_t flowCount) {
+    ClearRecordHandle(handle);
     handle->recordHeaderV3 = recordHeaderV3;
+    handle->flowCount = flowCount;
+    handle->numElements = 0;
 
     void *eor = (void *)recordHeaderV3 + recordHeaderV3->size;
 
@@ -57,6 +82,7 @@ static inline int MapRecordHandle(recordHandle_t *handle, recordHeaderV3_t *reco
             return 0;
         }
         if (elementHeader->type < MAXEXTENSIONS) {
+            if (handle->extensionList[elementHeader->type] == NULL) handle->mapped[handle->numMapped++] = elementHeader->type;
             handle->extensionList[elementHeader->type] = (void *)elementHeader + sizeof(elementHeader_t);
         } else {
             LogInfo("Mapping record: %" PRIu64 " - Skip unknown extension %d Type: %u, Length: %u", flowCount, i, elementHeader->type,
@@ -67,7 +93,6 @@ static inline int MapRecordHandle(recordHandle_t *handle, recordHeaderV3_t *reco
     }
     handle->extensionList[EXnull] = (void *)recordHeaderV3;
     handle->extensionList[EXlocal] = (void *)handle;
-    handle->flowCount = flowCount;
     handle->numElements = recordHeaderV3->numElements;
 
     EXgenericFlow_t *genericFlow = (EXgenericFlow_t *)handle->extensionList[EXgenericFlowID];
@@ -83,6 +108,27 @@ static inline int MapRecordHandle(recordHandle_t *handle, recordHeaderV3_t *reco
     return 1;
 }
 
+/*
+ * map a record from the extension offsets of a previous MapRecordHandle() of the same record:
+ * numOffsets pairs of extension type and offset from the record header
+ */
+static inline void MapRecordOffsets(recordHandle_t *handle, recordHeaderV3_t *recordHeaderV3, uint64_t flowCount, const uint16_t *offsets,
+                                    uint32_t numOffsets) {
+    ClearRecordHandle(handle);
+    handle->recordHeaderV3 = recordHeaderV3;
+    for (int i = 0; i < numOffsets; i++) {
+        uint16_t type = offsets[2 * i];
+        handle->mapped[i] = type;
+        handle->extensionList[type] = (void *)recordHeaderV3 + offsets[2 * i + 1];
+    }
+    handle->numMapped = numOffsets;
+    handle->extensionList[EXnull] = (void *)recordHeaderV3;
+    handle->extensionList[EXlocal] = (void *)handle;
+    handle->flowCount = flowCount;
+    handle->numElements = recordHeaderV3->numElements;
+
+}  // End of MapRecordOffsets
+
 static inline dataBlock_t *AppendToBuffer(nffile_t *nffile, dataBlock_t *dataBlock, void *record, size_t required) {
     if (!IsAvailable(dataBlock, required)) {
         // flush block - get an empty one
@@ -38,14 +38,21 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/uio.h>
 #include <unistd.h>
 
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define FILTER_SIMD 1
+#include <immintrin.h>
+#endif
+
 #include "filter.h"
 #include "ja3/ja3.h"
 #include "ja4/ja4.h"
+#include "lpm.h"
 #include "maxmind/maxmind.h"
 #include "sgregex.h"
 #include "tor/tor.h"
@@ -87,12 +94,16 @@ typedef struct filterElement {
 
 typedef struct FilterEngine_s {
     filterElement_t *filter;
+    uint32_t numNodes;
     uint32_t StartNode;
     uint16_t Extended;
     int hasGeoDB;
     const char *ident;
     char *label;
     int (*filterFunction)(const struct FilterEngine_s *, recordHandle_t *);
+    // nodes in evaluation order for batch evaluation, NULL if not batch capable
+    uint32_t *batchOrder;
+    uint32_t batchNodes;
 } FilterEngine_t;
 
 static filterElement_t *FilterTree = NULL;
@@ -146,26 +157,6 @@ static struct preprocess_s {
 
 // static const int a[20] = {1, 2, 3, [8] = 10, 11, 12};
 
-// 128bit compare for IPv6
-static int IPNodeCMP(struct IPListNode *e1, struct IPListNode *e2) {
-    uint64_t ip_e1[2], ip_e2[2];
-    ip_e1[0] = e1->ip[0] & e2->mask[0];
-    ip_e1[1] = e1->ip[1] & e2->mask[1];
-
-    ip_e2[0] = e2->ip[0] & e1->mask[0];
-    ip_e2[1] = e2->ip[1] & e1->mask[1];
-
-    if (ip_e1[0] == ip_e2[0]) {
-        if (ip_e1[1] == ip_e2[1])
-            return 0;
-        else
-            return (ip_e1[1] < ip_e2[1] ? -1 : 1);
-    } else {
-        return (ip_e1[0] < ip_e2[0] ? -1 : 1);
-    }
-
-}  // End of IPNodeCMP
-
 // 64bit uint64_t compare
 static int U64NodeCMP(struct U64ListNode *e1, struct U64ListNode *e2) {
     if (e1->value == e2->value)
@@ -175,9 +166,6 @@ static int U64NodeCMP(struct U64ListNode *e1, struct U64ListNode *e2) {
 
 }  // End of Uint64NodeCMP
 
-// Insert the IP RB tree code here
-RB_GENERATE(IPtree, IPListNode, entry, IPNodeCMP);
-
 // Insert the uint64_t RB tree code here
 RB_GENERATE(U64tree, U64ListNode, entry, U64NodeCMP);
 
@@ -469,6 +457,9 @@ uint32_t NewElement(uint32_t extID, uint32_t offset, uint32_t length, uint64_t v
     };
     FilterTree[n].blocklist[0] = n;
 
+    // each element holds a reference of a shared IP list
+    if (comp == CMP_IPLIST && data.dataPtr) LPMRef((ipLPM_t *)data.dataPtr);
+
     if (comp > 0 || function > 0 || extID >= MAXEXTENSIONS) Extended = 1;
     NumBlocks++;
     return n;
@@ -523,12 +514,101 @@ uint32_t Connect_AND(uint32_t b1, uint32_t b2) {
 
 } /* End of Connect_AND */
 
+/*
+ * Element may be folded into an IP list: plain IP list or IPv4 net element,
+ * which is not inverted and continues OnFalse only
+ */
+static int FoldableElement(const filterElement_t *element) {
+    if (element->invert || element->OnTrue || element->function) return 0;
+    if (element->comp == CMP_IPLIST) return element->data.dataPtr != NULL;
+    if (element->comp == CMP_NET && element->length == 4) {
+        // contiguous netmask and no host bits in value
+        uint32_t hostMask = ~(uint32_t)element->data.dataVal;
+        return (hostMask & (hostMask + 1)) == 0 && (element->value & hostMask) == 0;
+    }
+    return 0;
+
+}  // End of FoldableElement
+
+// insert net element or merge IP list element 'src' into IP list of element 'dst'
+static int FoldElement(filterElement_t *dst, filterElement_t *src) {
+    if (dst->comp == CMP_NET) {
+        // convert net element into an IP list
+        ipLPM_t *lpm = NewLPM();
+        uint64_t ip[2] = {0, dst->value};
+        if (!lpm || !LPMInsert(lpm, PF_INET, ip, __builtin_popcount((uint32_t)dst->data.dataVal))) return 0;
+        dst->comp = CMP_IPLIST;
+        dst->value = 0;
+        dst->data.dataPtr = lpm;
+    } else {
+        // IP list may be shared with other elements
+        dst->data.dataPtr = LPMPrivate((ipLPM_t *)dst->data.dataPtr);
+        if (!dst->data.dataPtr) return 0;
+    }
+
+    if (src->comp == CMP_NET) {
+        uint64_t ip[2] = {0, src->value};
+        if (!LPMInsert((ipLPM_t *)dst->data.dataPtr, PF_INET, ip, __builtin_popcount((uint32_t)src->data.dataVal))) return 0;
+    } else {
+        if (!LPMMerge((ipLPM_t *)dst->data.dataPtr, (ipLPM_t *)src->data.dataPtr)) return 0;
+        DisposeLPM((ipLPM_t *)src->data.dataPtr);
+        src->data.dataPtr = NULL;
+    }
+    return 1;
+
+}  // End of FoldElement
+
+/*
+ * Fold OR chains of IP list and net elements: if both blocks are plain OR chains
+ * of such elements, merge the elements of b2 into the elements of b1, which test the same field.
+ * Returns 1 if b2 got folded into b1
+ */
+static int FoldIPlists(uint32_t b1, uint32_t b2) {
+    for (int i = 0; i < FilterTree[b1].numblocks; i++)
+        if (!FoldableElement(&FilterTree[FilterTree[b1].blocklist[i]])) return 0;
+
+    uint32_t numblocks = FilterTree[b2].numblocks;
+    uint32_t target[numblocks];
+    for (int i = 0; i < numblocks; i++) {
+        filterElement_t *src = &FilterTree[FilterTree[b2].blocklist[i]];
+        if (!FoldableElement(src)) return 0;
+        target[i] = 0;
+        for (int j = 0; j < FilterTree[b1].numblocks; j++) {
+            filterElement_t *dst = &FilterTree[FilterTree[b1].blocklist[j]];
+            if (dst->extID == src->extID && dst->offset == src->offset && dst->length == src->length) {
+                target[i] = FilterTree[b1].blocklist[j];
+                break;
+            }
+        }
+        if (target[i] == 0) return 0;
+    }
+
+    for (int i = 0; i < numblocks; i++) {
+        if (!FoldElement(&FilterTree[target[i]], &FilterTree[FilterTree[b2].blocklist[i]])) {
+            LogError("Memory allocation error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+            exit(255);
+        }
+    }
+    dbg_printf("Folded block %u into block %u\n", b2, b1);
+
+    /* cleanup folded node 'b2' */
+    FilterTree[b2].numblocks = 0;
+    free(FilterTree[b2].blocklist);
+    FilterTree[b2].blocklist = NULL;
+
+    return 1;
+
+}  // End of FoldIPlists
+
 /*
  * Connects the two blocks b1 and b2 ( OR ) and returns index of superblock
  */
 uint32_t Connect_OR(uint32_t b1, uint32_t b2) {
     uint32_t a, b, i, j;
 
+    // multiple IP lists and nets of the same field become a single IP list
+    if (FoldIPlists(b1, b2)) return b1;
+
     // do not optimise block 'any' if appended as lastelement
     // for all prepending blocks to be evaluated.
     if ((FilterTree[b2].data.dataVal == -1) || (FilterTree[b1].numblocks <= FilterTree[b2].numblocks)) {
@@ -632,26 +712,70 @@ int FilterRecord(const void *engine, recordHandle_t *handle) {
     return filterEngine->filterFunction(filterEngine, handle);
 }  // End of FilterRecord
 
+// evaluate a fast filter element - plain value compare
+static inline int EvaluateFastElement(const filterElement_t *element, recordHandle_t *handle) {
+    void *inPtr = handle->extensionList[element->extID];
+    if (inPtr == NULL) return 0;
+    inPtr += element->offset;
+
+    uint64_t inVal = 0;
+    dbg_assert(element->length <= 8);
+    switch (element->length) {
+        case 0:
+            break;
+        case 1:
+            inVal = *((uint8_t *)inPtr);
+            break;
+        case 2:
+            inVal = *((uint16_t *)inPtr);
+            break;
+        case 4:
+            inVal = *((uint32_t *)inPtr);
+            break;
+        case 8:
+            inVal = *((uint64_t *)inPtr);
+            break;
+        default:
+            memcpy((void *)&inVal, inPtr, element->length);
+    }
+
+    // printf("Value: %.16llx, : %.16llx\n", (long long unsigned)inVal, element->value);
+    return inVal == element->value;
+
+}  // End of EvaluateFastElement
+
 static int RunFilterFast(const FilterEngine_t *engine, recordHandle_t *handle) {
     uint32_t index = engine->StartNode;
     int invert = 0;
     int evaluate = 0;
     while (index) {
-        size_t offset = engine->filter[index].offset;
-        uint32_t extID = engine->filter[index].extID;
         invert = engine->filter[index].invert;
+        evaluate = EvaluateFastElement(&engine->filter[index], handle);
+        index = evaluate ? engine->filter[index].OnTrue : engine->filter[index].OnFalse;
+    }
+    return invert ? !evaluate : evaluate;
 
-        void *inPtr = handle->extensionList[extID];
-        if (inPtr == NULL) {
-            evaluate = 0;
-            index = engine->filter[index].OnFalse;
-            continue;
-        }
-        inPtr += offset;
+}  // End of RunFilter
 
-        uint64_t inVal = 0;
-        dbg_assert(engine->filter[index].length <= 8);
-        switch (engine->filter[index].length) {
+// evaluate an extended filter element - functions, preprocessing and all comparators
+static inline int EvaluateElement(const filterElement_t *element, const char *ident, int hasGeoDB, recordHandle_t *handle) {
+    uint32_t extID = element->extID;
+    data_t data = element->data;
+    uint32_t length = element->length;
+
+    void *inPtr = handle->extensionList[extID];
+    if (inPtr == NULL) {
+        if (preprocess_map[extID].function == NULL) return 0;
+        inPtr = preprocess_map[extID].function(length, data, handle);
+        if (inPtr == NULL) return 0;
+    }
+    inPtr += element->offset;
+
+    uint64_t inVal = 0;
+    if (element->function != NULL) {
+        inVal = element->function(inPtr, length, data, handle);
+    } else {
+        switch (length) {
             case 0:
                 break;
             case 1:
@@ -665,169 +789,869 @@ static int RunFilterFast(const FilterEngine_t *engine, recordHandle_t *handle) {
                 break;
             case 8:
                 inVal = *((uint64_t *)inPtr);
+            case 3:
+            case 5:
+            case 7:
+                memcpy((void *)&inVal, inPtr, length);
                 break;
-            default:
-                memcpy((void *)&inVal, inPtr, engine->filter[index].length);
         }
+    }
 
-        // printf("Value: %.16llx, : %.16llx\n", (long long unsigned)inVal, engine->filter[index].value);
-        evaluate = inVal == engine->filter[index].value;
-        index = evaluate ? engine->filter[index].OnTrue : engine->filter[index].OnFalse;
+    int evaluate = 0;
+    switch (element->comp) {
+        case CMP_EQ:
+            evaluate = inVal == element->value;
+            break;
+        case CMP_GT:
+            evaluate = inVal > element->value;
+            break;
+        case CMP_LT:
+            evaluate = inVal < element->value;
+            break;
+        case CMP_GE:
+            evaluate = inVal >= element->value;
+            break;
+        case CMP_LE:
+            evaluate = inVal <= element->value;
+            break;
+        case CMP_FLAGS: {
+            evaluate = (inVal & element->value) == element->value;
+        } break;
+        case CMP_IDENT: {
+            char *str = (char *)data.dataPtr;
+            evaluate = str != NULL && (strcmp(ident, str) == 0 ? 1 : 0);
+        } break;
+        case CMP_STRING: {
+            char *str = (char *)data.dataPtr;
+            evaluate = str != NULL && (strcmp(inPtr, str) == 0 ? 1 : 0);
+        } break;
+        case CMP_SUBSTRING: {
+            char *str = (char *)data.dataPtr;
+            evaluate = str != NULL && (strstr(inPtr, str) != NULL ? 1 : 0);
+        } break;
+        case CMP_BINARY: {
+            void *dataPtr = data.dataPtr;
+            evaluate = dataPtr != NULL && memcmp(inPtr, dataPtr, length) == 0;
+        } break;
+        case CMP_NET: {
+            uint64_t mask = data.dataVal;
+            evaluate = (inVal & mask) == element->value;
+        } break;
+        case CMP_IPLIST: {
+            if (length == 4) {
+                evaluate = LPMLookupV4((ipLPM_t *)data.dataPtr, (uint32_t)inVal);
+            } else if (length == 16) {
+                evaluate = LPMLookupV6((ipLPM_t *)data.dataPtr, (uint64_t *)inPtr);
+            } else {
+                evaluate = 0;
+            }
+        } break;
+        case CMP_U64LIST: {
+            struct U64ListNode find = {.value = inVal};
+            evaluate = RB_FIND(U64tree, data.dataPtr, &find) != NULL;
+        } break;
+        case CMP_PAYLOAD: {
+            char *payload = (char *)(handle->extensionList[extID]);
+            char *string = (char *)data.dataPtr;
+            uint32_t len = ExtensionLength(payload);
+            evaluate = 0;
+            if (string != NULL) {
+                // find any string str in payload data inPtr, even beyond '\0' bytes
+                int m = 0;
+                for (int i = 0; i < len; i++) {
+                    if (payload[i] == string[m]) {
+                        m++;
+                        if (string[m] == '\0') {
+                            evaluate = 1;
+                            break;
+                        }
+                    } else {
+                        m = 0;
+                    }
+                }
+            }
+        } break;
+        case CMP_REGEX: {
+            srx_Context *program = (srx_Context *)data.dataPtr;
+            char *payload = (char *)(handle->extensionList[extID]);
+            uint32_t len = ExtensionLength(payload);
+
+            evaluate = program != NULL && srx_MatchExt(program, payload, len, 0);
+        } break;
+        case CMP_GEO: {
+            char *geoChar = (char *)inPtr;
+            if (hasGeoDB && geoChar[0] == '\0') inVal = geoLookup(geoChar, data.dataVal, handle);
+            evaluate = inVal == element->value;
+        } break;
     }
-    return invert ? !evaluate : evaluate;
 
-}  // End of RunFilter
+    return evaluate;
+
+}  // End of EvaluateElement
 
 static int RunExtendedFilter(const FilterEngine_t *engine, recordHandle_t *handle) {
     uint32_t index = engine->StartNode;
     int evaluate = 0;
     int invert = 0;
     while (index) {
-        uint32_t extID = engine->filter[index].extID;
-        size_t offset = engine->filter[index].offset;
         invert = engine->filter[index].invert;
+        evaluate = EvaluateElement(&engine->filter[index], engine->ident, engine->hasGeoDB, handle);
+        index = evaluate ? engine->filter[index].OnTrue : engine->filter[index].OnFalse;
+    }
+    return invert ? !evaluate : evaluate;
+}  // End of RunFilter
 
-        void *inPtr = handle->extensionList[extID];
-        if (inPtr == NULL) {
-            if (preprocess_map[extID].function == NULL) {
-                evaluate = 0;
-                index = engine->filter[index].OnFalse;
-                continue;
-            }
-            data_t data = engine->filter[index].data;
-            uint32_t length = engine->filter[index].length;
-            inPtr = preprocess_map[extID].function(length, data, handle);
-            if (inPtr == NULL) {
-                evaluate = 0;
-                index = engine->filter[index].OnFalse;
-                continue;
+// node can be evaluated column wise: plain value compare of a mapped extension
+static int BatchElement(const filterElement_t *element) {
+    if (element->function != NULL || element->extID >= MAXLISTSIZE || preprocess_map[element->extID].function != NULL) return 0;
+    switch (element->comp) {
+        case CMP_EQ:
+        case CMP_GT:
+        case CMP_LT:
+        case CMP_GE:
+        case CMP_LE:
+        case CMP_FLAGS:
+        case CMP_NET:
+            return element->length == 0 || element->length == 1 || element->length == 2 || element->length == 4 || element->length == 8;
+        case CMP_IPLIST:
+            return element->length == 4;
+        default:
+            return 0;
+    }
+}  // End of BatchElement
+
+// depth first post order of all nodes reachable from index
+static int BatchOrder(const filterElement_t *filter, uint32_t index, uint8_t *visited, uint32_t *order, uint32_t *numNodes) {
+    if (index == 0 || visited[index]) return 1;
+    visited[index] = 1;
+    if (!BatchElement(&filter[index])) return 0;
+    if (!BatchOrder(filter, filter[index].OnTrue, visited, order, numNodes)) return 0;
+    if (!BatchOrder(filter, filter[index].OnFalse, visited, order, numNodes)) return 0;
+    order[(*numNodes)++] = index;
+    return 1;
+}  // End of BatchOrder
+
+/*
+ * compile the batch program of an engine: all reachable nodes in topological order,
+ * so a node is evaluated after all its predecessors.
+ */
+static void CompileBatch(FilterEngine_t *engine) {
+    engine->batchOrder = NULL;
+    engine->batchNodes = 0;
+
+    uint8_t *visited = calloc(engine->numNodes, sizeof(uint8_t));
+    uint32_t *order = malloc(engine->numNodes * sizeof(uint32_t));
+    if (!visited || !order) {
+        LogError("malloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+        free(visited);
+        free(order);
+        return;
+    }
+
+    uint32_t numNodes = 0;
+    if (!BatchOrder(engine->filter, engine->StartNode, visited, order, &numNodes)) {
+        free(visited);
+        free(order);
+        return;
+    }
+    free(visited);
+
+    // reverse post order
+    for (int i = 0; i < (numNodes >> 1); i++) {
+        uint32_t tmp = order[i];
+        order[i] = order[numNodes - 1 - i];
+        order[numNodes - 1 - i] = tmp;
+    }
+    engine->batchOrder = order;
+    engine->batchNodes = numNodes;
+
+}  // End of CompileBatch
+
+// batch kernels: compare (inVal & mask) == value, inVal > value or inVal < value
+enum { KERNEL_EQ = 0, KERNEL_GT, KERNEL_LT };
+
+typedef uint64_t (*compareKernel_t)(uint32_t op, uint64_t value, uint64_t mask, const uint64_t *column, uint32_t numRecords);
+typedef uint64_t (*gatherKernel_t)(uint32_t extID, uint32_t offset, uint32_t length, recordHandle_t *handles, uint32_t numRecords,
+                                   uint64_t *column);
+
+#define GATHER(type)                                                                   \
+    for (int i = first; i < numRecords; i++) {                                         \
+        const uint8_t *inPtr = (const uint8_t *)handles[i].extensionList[extID];       \
+        present |= (uint64_t)(inPtr != NULL) << i;                                     \
+        column[i] = inPtr ? (uint64_t)(*((const type *)(inPtr + offset))) : 0;         \
+    }
+
+// load the values of records first .. numRecords - 1, returns the bit mask of records with the extension
+static uint64_t GatherScalar(uint32_t extID, uint32_t offset, uint32_t length, recordHandle_t *handles, uint32_t first, uint32_t numRecords,
+                             uint64_t *column) {
+    uint64_t present = 0;
+    switch (length) {
+        case 0:
+            for (int i = first; i < numRecords; i++) {
+                present |= (uint64_t)(handles[i].extensionList[extID] != NULL) << i;
+                column[i] = 0;
             }
-        }
-        inPtr += offset;
+            break;
+        case 1:
+            GATHER(uint8_t);
+            break;
+        case 2:
+            GATHER(uint16_t);
+            break;
+        case 4:
+            GATHER(uint32_t);
+            break;
+        case 8:
+            GATHER(uint64_t);
+            break;
+    }
+    return present;
+}  // End of GatherScalar
+
+static uint64_t GatherColumnScalar(uint32_t extID, uint32_t offset, uint32_t length, recordHandle_t *handles, uint32_t numRecords,
+                                   uint64_t *column) {
+    return GatherScalar(extID, offset, length, handles, 0, numRecords, column);
+}  // End of GatherColumnScalar
+
+#define COMPARE(expr)                                                                  \
+    for (int i = first; i < numRecords; i++) {                                         \
+        uint64_t inVal = column[i];                                                    \
+        match |= (uint64_t)(expr) << i;                                                \
+    }
+
+// compare the values of records first .. numRecords - 1, returns the bit mask of matching records
+static uint64_t CompareScalar(uint32_t op, uint64_t value, uint64_t mask, const uint64_t *column, uint32_t first, uint32_t numRecords) {
+    uint64_t match = 0;
+    switch (op) {
+        case KERNEL_EQ:
+            COMPARE((inVal & mask) == value);
+            break;
+        case KERNEL_GT:
+            COMPARE(inVal > value);
+            break;
+        case KERNEL_LT:
+            COMPARE(inVal < value);
+            break;
+    }
+    return match;
+}  // End of CompareScalar
+
+static uint64_t CompareColumnScalar(uint32_t op, uint64_t value, uint64_t mask, const uint64_t *column, uint32_t numRecords) {
+    return CompareScalar(op, value, mask, column, 0, numRecords);
+}  // End of CompareColumnScalar
 
-        data_t data = engine->filter[index].data;
-        uint32_t length = engine->filter[index].length;
-        uint64_t inVal = 0;
-        if (engine->filter[index].function != NULL) {
-            inVal = engine->filter[index].function(inPtr, length, data, handle);
+#ifdef FILTER_SIMD
+/*
+ * x86 kernels, selected at runtime. There are no unsigned 64bit compares,
+ * so values are compared signed with the sign bit flipped.
+ */
+#define SIMDCOMPARE(lanes, vtype, load, movemask, expr)                                \
+    for (; i + lanes <= numRecords; i += lanes) {                                      \
+        vtype inVal = load((const vtype *)(column + i));                               \
+        match |= (uint64_t)movemask(expr) << i;                                        \
+    }
+
+__attribute__((target("avx2"))) static uint64_t CompareColumnAVX2(uint32_t op, uint64_t value, uint64_t mask, const uint64_t *column,
+                                                                   uint32_t numRecords) {
+    const __m256i sign = _mm256_set1_epi64x((long long)0x8000000000000000ULL);
+    const __m256i vValue = _mm256_set1_epi64x((long long)value);
+    const __m256i vMask = _mm256_set1_epi64x((long long)mask);
+    const __m256i sValue = _mm256_xor_si256(vValue, sign);
+#define AVX2MASK(r) _mm256_movemask_pd(_mm256_castsi256_pd(r))
+
+    uint64_t match = 0;
+    uint32_t i = 0;
+    switch (op) {
+        case KERNEL_EQ:
+            SIMDCOMPARE(4, __m256i, _mm256_loadu_si256, AVX2MASK, _mm256_cmpeq_epi64(_mm256_and_si256(inVal, vMask), vValue));
+            break;
+        case KERNEL_GT:
+            SIMDCOMPARE(4, __m256i, _mm256_loadu_si256, AVX2MASK, _mm256_cmpgt_epi64(_mm256_xor_si256(inVal, sign), sValue));
+            break;
+        case KERNEL_LT:
+            SIMDCOMPARE(4, __m256i, _mm256_loadu_si256, AVX2MASK, _mm256_cmpgt_epi64(sValue, _mm256_xor_si256(inVal, sign)));
+            break;
+    }
+    return match | CompareScalar(op, value, mask, column, i, numRecords);
+}  // End of CompareColumnAVX2
+
+__attribute__((target("sse4.2"))) static uint64_t CompareColumnSSE42(uint32_t op, uint64_t value, uint64_t mask, const uint64_t *column,
+                                                                      uint32_t numRecords) {
+    const __m128i sign = _mm_set1_epi64x((long long)0x8000000000000000ULL);
+    const __m128i vValue = _mm_set1_epi64x((long long)value);
+    const __m128i vMask = _mm_set1_epi64x((long long)mask);
+    const __m128i sValue = _mm_xor_si128(vValue, sign);
+#define SSEMASK(r) _mm_movemask_pd(_mm_castsi128_pd(r))
+
+    uint64_t match = 0;
+    uint32_t i = 0;
+    switch (op) {
+        case KERNEL_EQ:
+            SIMDCOMPARE(2, __m128i, _mm_loadu_si128, SSEMASK, _mm_cmpeq_epi64(_mm_and_si128(inVal, vMask), vValue));
+            break;
+        case KERNEL_GT:
+            SIMDCOMPARE(2, __m128i, _mm_loadu_si128, SSEMASK, _mm_cmpgt_epi64(_mm_xor_si128(inVal, sign), sValue));
+            break;
+        case KERNEL_LT:
+            SIMDCOMPARE(2, __m128i, _mm_loadu_si128, SSEMASK, _mm_cmpgt_epi64(sValue, _mm_xor_si128(inVal, sign)));
+            break;
+    }
+    return match | CompareScalar(op, value, mask, column, i, numRecords);
+}  // End of CompareColumnSSE42
+
+// gather 4 and 8 byte values: first the extension pointers of 4 handles, then the values of all non NULL pointers
+__attribute__((target("avx2"))) static uint64_t GatherColumnAVX2(uint32_t extID, uint32_t offset, uint32_t length, recordHandle_t *handles,
+                                                                  uint32_t numRecords, uint64_t *column) {
+    if (length != 4 && length != 8) return GatherScalar(extID, offset, length, handles, 0, numRecords, column);
+
+    const long long stride = sizeof(recordHandle_t);
+    const long long *base = (const long long *)&handles[0].extensionList[extID];
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i vOffset = _mm256_set1_epi64x(offset);
+    const __m256i vStep = _mm256_set1_epi64x(4 * stride);
+    // the low 32bit of each 64bit lane, for the mask of 32bit gathers
+    const __m256i lowLanes = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+    __m256i vIndex = _mm256_setr_epi64x(0, stride, 2 * stride, 3 * stride);
+
+    uint64_t present = 0;
+    uint32_t i = 0;
+    for (; i + 4 <= numRecords; i += 4) {
+        __m256i ptr = _mm256_i64gather_epi64(base, vIndex, 1);
+        __m256i valid = _mm256_xor_si256(_mm256_cmpeq_epi64(ptr, zero), _mm256_cmpeq_epi64(zero, zero));
+        present |= (uint64_t)_mm256_movemask_pd(_mm256_castsi256_pd(valid)) << i;
+        __m256i addr = _mm256_add_epi64(ptr, vOffset);
+        __m256i val;
+        if (length == 8) {
+            val = _mm256_mask_i64gather_epi64(zero, (const long long *)NULL, addr, valid, 1);
         } else {
-            switch (length) {
-                case 0:
-                    break;
-                case 1:
-                    inVal = *((uint8_t *)inPtr);
-                    break;
-                case 2:
-                    inVal = *((uint16_t *)inPtr);
-                    break;
-                case 4:
-                    inVal = *((uint32_t *)inPtr);
-                    break;
-                case 8:
-                    inVal = *((uint64_t *)inPtr);
-                case 3:
-                case 5:
-                case 7:
-                    memcpy((void *)&inVal, inPtr, length);
-                    break;
-            }
+            __m128i valid32 = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(valid, lowLanes));
+            val = _mm256_cvtepu32_epi64(_mm256_mask_i64gather_epi32(_mm_setzero_si128(), (const int *)NULL, addr, valid32, 1));
         }
+        _mm256_storeu_si256((__m256i *)(column + i), val);
+        vIndex = _mm256_add_epi64(vIndex, vStep);
+    }
+    return present | GatherScalar(extID, offset, length, handles, i, numRecords, column);
+}  // End of GatherColumnAVX2
+#endif
+
+static compareKernel_t compareKernel = CompareColumnScalar;
+static gatherKernel_t gatherKernel = GatherColumnScalar;
+
+// select the batch kernels for this CPU
+static void SelectKernels(void) {
+#ifdef FILTER_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        compareKernel = CompareColumnAVX2;
+        gatherKernel = GatherColumnAVX2;
+    } else if (__builtin_cpu_supports("sse4.2")) {
+        compareKernel = CompareColumnSSE42;
+    }
+#endif
+}  // End of SelectKernels
+
+// load the values of element into column, returns the bit mask of records with the extension
+static inline uint64_t GatherColumn(const filterElement_t *element, recordHandle_t *handles, uint32_t numRecords, uint64_t *column) {
+    return gatherKernel(element->extID, element->offset, element->length, handles, numRecords, column);
+}  // End of GatherColumn
+
+// compare a column of values, returns the bit mask of matching records
+static inline uint64_t CompareColumn(const filterElement_t *element, const uint64_t *column, uint32_t numRecords) {
+    uint64_t value = element->value;
+    uint64_t all = numRecords == 64 ? ~0ULL : (1ULL << numRecords) - 1;
+    switch (element->comp) {
+        case CMP_EQ:
+            return compareKernel(KERNEL_EQ, value, ~0ULL, column, numRecords);
+        case CMP_GT:
+            return compareKernel(KERNEL_GT, value, 0, column, numRecords);
+        case CMP_LT:
+            return compareKernel(KERNEL_LT, value, 0, column, numRecords);
+        case CMP_GE:
+            return ~compareKernel(KERNEL_LT, value, 0, column, numRecords) & all;
+        case CMP_LE:
+            return ~compareKernel(KERNEL_GT, value, 0, column, numRecords) & all;
+        case CMP_FLAGS:
+            return compareKernel(KERNEL_EQ, value, value, column, numRecords);
+        case CMP_NET:
+            return compareKernel(KERNEL_EQ, value, element->data.dataVal, column, numRecords);
+        case CMP_IPLIST: {
+            const ipLPM_t *lpm = (const ipLPM_t *)element->data.dataPtr;
+            uint64_t match = 0;
+            for (int i = 0; i < numRecords; i++) match |= (uint64_t)LPMLookupV4(lpm, (uint32_t)column[i]) << i;
+            return match;
+        }
+        default:
+            return 0;
+    }
+}  // End of CompareColumn
 
-        switch (engine->filter[index].comp) {
-            case CMP_EQ:
-                evaluate = inVal == engine->filter[index].value;
-                break;
-            case CMP_GT:
-                evaluate = inVal > engine->filter[index].value;
-                break;
-            case CMP_LT:
-                evaluate = inVal < engine->filter[index].value;
-                break;
-            case CMP_GE:
-                evaluate = inVal >= engine->filter[index].value;
-                break;
-            case CMP_LE:
-                evaluate = inVal <= engine->filter[index].value;
+/*
+ * filter a batch of up to FILTERBATCHSIZE mapped records. Only records with their bit set
+ * in active are evaluated. Returns the bit mask of all matching records.
+ * Batch capable engines evaluate each node across all records, which reach this node,
+ * and propagate the records as bit masks along the OnTrue/OnFalse edges.
+ */
+uint64_t FilterRecordBatch(const void *engine, recordHandle_t *handles, uint32_t numRecords, uint64_t active) {
+    const FilterEngine_t *filterEngine = (const FilterEngine_t *)engine;
+    dbg_assert(numRecords <= FILTERBATCHSIZE);
+
+    uint64_t passed = 0;
+    if (filterEngine->batchOrder == NULL) {
+        // evaluate record by record
+        while (active) {
+            int i = __builtin_ctzll(active);
+            active &= active - 1;
+            if (filterEngine->filterFunction(filterEngine, &handles[i])) passed |= 1ULL << i;
+        }
+        return passed;
+    }
+
+    const filterElement_t *filter = filterEngine->filter;
+    uint64_t reach[filterEngine->numNodes];
+    for (int i = 0; i < filterEngine->batchNodes; i++) reach[filterEngine->batchOrder[i]] = 0;
+    reach[filterEngine->StartNode] = active;
+
+    uint64_t column[FILTERBATCHSIZE];
+    for (int i = 0; i < filterEngine->batchNodes; i++) {
+        uint32_t index = filterEngine->batchOrder[i];
+        uint64_t records = reach[index];
+        if (records == 0) continue;
+
+        const filterElement_t *element = &filter[index];
+        uint64_t present = GatherColumn(element, handles, numRecords, column);
+        uint64_t onTrue = records & present & CompareColumn(element, column, numRecords);
+        uint64_t onFalse = records & ~onTrue;
+
+        // end of path: result is evaluate, inverted for inverted nodes
+        if (element->OnTrue)
+            reach[element->OnTrue] |= onTrue;
+        else if (!element->invert)
+            passed |= onTrue;
+        if (element->OnFalse)
+            reach[element->OnFalse] |= onFalse;
+        else if (element->invert)
+            passed |= onFalse;
+    }
+
+    return passed;
+
+}  // End of FilterRecordBatch
+
+// load the values of a node from a byte plane column for the records first .. first + numRecords - 1 of a column view.
+// Returns the bit mask of records with a known result, present returns the records with the extension
+static uint64_t GatherView(const filterElement_t *element, columnView_t *columnView, uint32_t first, uint32_t numRecords, uint32_t *base,
+                           uint64_t *present, uint64_t *column) {
+    *present = 0;
+    int c = element->extID < MAXEXTENSIONS ? columnView->columnMap[element->extID] : -1;
+    if (c < 0) return 0;
+    blockColumn_t *blockColumn = &columnView->columns[c];
+    if (blockColumn->elementSize == 0 || (element->offset + element->length) > blockColumn->elementSize) return 0;
+    const uint8_t *data = LoadColumn(columnView, c);
+    if (data == NULL) return 0;
+
+    // MapRecordHandle() sets a missing msecFirst of NSEL/NAT records
+    int eventTime = element->extID == EXgenericFlowID && element->offset == OFFmsecFirst;
+
+    uint64_t known = 0;
+    uint32_t index = base[c];
+    uint32_t numElements = blockColumn->numElements;
+    for (int i = 0; i < numRecords; i++) {
+        column[i] = 0;
+        if ((columnView->records[first + i] & (1U << c)) == 0) {
+            // no extension - the node is false as for a mapped record
+            known |= 1ULL << i;
+            continue;
+        }
+        uint8_t value[8] = {0};
+        const uint8_t *in = data + element->offset * numElements + index;
+        for (int b = 0; b < element->length; b++) value[b] = in[b * numElements];
+        switch (element->length) {
+            case 1:
+                column[i] = value[0];
                 break;
-            case CMP_FLAGS: {
-                evaluate = (inVal & engine->filter[index].value) == engine->filter[index].value;
-            } break;
-            case CMP_IDENT: {
-                char *str = (char *)data.dataPtr;
-                evaluate = str != NULL && (strcmp(engine->ident, str) == 0 ? 1 : 0);
-            } break;
-            case CMP_STRING: {
-                char *str = (char *)data.dataPtr;
-                evaluate = str != NULL && (strcmp(inPtr, str) == 0 ? 1 : 0);
-            } break;
-            case CMP_SUBSTRING: {
-                char *str = (char *)data.dataPtr;
-                evaluate = str != NULL && (strstr(inPtr, str) != NULL ? 1 : 0);
+            case 2: {
+                uint16_t v;
+                memcpy(&v, value, sizeof(v));
+                column[i] = v;
             } break;
-            case CMP_BINARY: {
-                void *dataPtr = data.dataPtr;
-                evaluate = dataPtr != NULL && memcmp(inPtr, dataPtr, length) == 0;
+            case 4: {
+                uint32_t v;
+                memcpy(&v, value, sizeof(v));
+                column[i] = v;
             } break;
-            case CMP_NET: {
-                uint64_t mask = data.dataVal;
-                evaluate = (inVal & mask) == engine->filter[index].value;
-            } break;
-            case CMP_IPLIST: {
-                if (length == 4) {
-                    struct IPListNode find = {.ip[0] = 0, .ip[1] = inVal, .mask[0] = 0xffffffffffffffffLL, .mask[1] = 0xffffffffffffffffLL};
-                    evaluate = RB_FIND(IPtree, data.dataPtr, &find) != NULL;
-                } else if (length == 16) {
-                    struct IPListNode find = {.ip[0] = *((uint64_t *)inPtr),
-                                              .ip[1] = *((uint64_t *)(inPtr + 8)),
-                                              .mask[0] = 0xffffffffffffffffLL,
-                                              .mask[1] = 0xffffffffffffffffLL};
-                    evaluate = RB_FIND(IPtree, data.dataPtr, &find) != NULL;
-                } else {
-                    evaluate = 0;
-                }
-            } break;
-            case CMP_U64LIST: {
-                struct U64ListNode find = {.value = inVal};
-                evaluate = RB_FIND(U64tree, data.dataPtr, &find) != NULL;
-            } break;
-            case CMP_PAYLOAD: {
-                char *payload = (char *)(handle->extensionList[extID]);
-                char *string = (char *)engine->filter[index].data.dataPtr;
-                uint32_t len = ExtensionLength(payload);
-                evaluate = 0;
-                if (string != NULL) {
-                    // find any string str in payload data inPtr, even beyond '\0' bytes
-                    int m = 0;
-                    for (int i = 0; i < len; i++) {
-                        if (payload[i] == string[m]) {
-                            m++;
-                            if (string[m] == '\0') {
-                                evaluate = 1;
-                                break;
-                            }
-                        } else {
-                            m = 0;
-                        }
-                    }
-                }
+            case 8: {
+                uint64_t v;
+                memcpy(&v, value, sizeof(v));
+                column[i] = v;
             } break;
-            case CMP_REGEX: {
-                srx_Context *program = (srx_Context *)data.dataPtr;
-                char *payload = (char *)(handle->extensionList[extID]);
-                uint32_t len = ExtensionLength(payload);
+        }
+        *present |= 1ULL << i;
+        if (!eventTime || column[i] != 0) known |= 1ULL << i;
+        index++;
+    }
+    return known;
 
-                evaluate = program != NULL && srx_MatchExt(program, payload, len, 0);
-            } break;
-            case CMP_GEO: {
-                char *geoChar = (char *)inPtr;
-                if (engine->hasGeoDB && geoChar[0] == '\0') inVal = geoLookup(geoChar, data.dataVal, handle);
-                evaluate = inVal == engine->filter[index].value;
-            } break;
+}  // End of GatherView
+
+/*
+ * filter the records of a columnar block on its columns, before the records are restored.
+ * Nodes of extensions stored in byte plane columns are evaluated as in FilterRecordBatch().
+ * The result of all other nodes is unknown - the records follow both edges. Sets select[i]
+ * for each V3 record, which may match and for all other records.
+ * Returns the number of selected V3 records
+ */
+uint32_t FilterColumns(const void *engine, columnView_t *columnView, uint8_t *select) {
+    const FilterEngine_t *filterEngine = (const FilterEngine_t *)engine;
+    uint32_t numRecords = columnView->numRecords;
+
+    uint32_t numSelected = 0;
+    if (filterEngine->batchOrder == NULL || filterEngine->StartNode == 0) {
+        // no column wise evaluation - all records may match
+        for (int i = 0; i < numRecords; i++) {
+            select[i] = 1;
+            if (columnView->records[i] & VIEW_V3RECORD) numSelected++;
         }
-        index = evaluate ? engine->filter[index].OnTrue : engine->filter[index].OnFalse;
+        return numSelected;
+    }
+
+    const filterElement_t *filter = filterEngine->filter;
+    uint64_t reach[filterEngine->numNodes];
+    uint64_t column[FILTERBATCHSIZE];
+    // index of the first element of each column in the current batch
+    uint32_t base[MAXCOLUMNS] = {0};
+    for (uint32_t first = 0; first < numRecords; first += FILTERBATCHSIZE) {
+        uint32_t batchSize = (numRecords - first) < FILTERBATCHSIZE ? (numRecords - first) : FILTERBATCHSIZE;
+        uint64_t active = 0;
+        for (int i = 0; i < batchSize; i++) {
+            if (columnView->records[first + i] & VIEW_V3RECORD) active |= 1ULL << i;
+        }
+
+        for (int i = 0; i < filterEngine->batchNodes; i++) reach[filterEngine->batchOrder[i]] = 0;
+        reach[filterEngine->StartNode] = active;
+
+        uint64_t passed = 0;
+        for (int i = 0; i < filterEngine->batchNodes; i++) {
+            uint32_t index = filterEngine->batchOrder[i];
+            uint64_t records = reach[index];
+            if (records == 0) continue;
+
+            const filterElement_t *element = &filter[index];
+            uint64_t present;
+            uint64_t known = GatherView(element, columnView, first, batchSize, base, &present, column);
+            uint64_t match = present & CompareColumn(element, column, batchSize);
+            uint64_t unknown = records & ~known;
+            uint64_t onTrue = (records & known & match) | unknown;
+            uint64_t onFalse = (records & known & ~match) | unknown;
+
+            // end of path: result is evaluate, inverted for inverted nodes
+            if (element->OnTrue)
+                reach[element->OnTrue] |= onTrue;
+            else if (!element->invert)
+                passed |= onTrue;
+            if (element->OnFalse)
+                reach[element->OnFalse] |= onFalse;
+            else if (element->invert)
+                passed |= onFalse;
+        }
+
+        for (int i = 0; i < batchSize; i++) {
+            uint32_t elements = columnView->records[first + i];
+            if ((elements & VIEW_V3RECORD) == 0) {
+                select[first + i] = 1;
+                continue;
+            }
+            select[first + i] = (passed >> i) & 1;
+            numSelected += select[first + i];
+            for (int c = 0; c < columnView->numColumns; c++) base[c] += (elements >> c) & 1;
+        }
+    }
+
+    return numSelected;
+
+}  // End of FilterColumns
+
+/*
+ * evaluate a filter node against a block summary
+ * returns a bit mask of the possible results of the node for the records
+ * in the block: bit 0: false, bit 1: true
+ */
+static int EvaluateBlockNode(const filterElement_t *node, const blockIndex_t *blockIndex) {
+    if (node->comp != CMP_EQ || node->function != NULL) return 3;
+
+    int found = 1;
+    switch (node->extID) {
+        case EXgenericFlowID:
+            if (node->offset != OFFproto || node->length != SIZEproto) return 3;
+            found = node->value < 256 && (blockIndex->proto[node->value >> 6] & (1ULL << (node->value & 0x3F))) != 0;
+            break;
+        case EXipv4FlowID:
+            if ((node->offset != OFFsrc4Addr && node->offset != OFFdst4Addr) || node->length != SIZEsrc4Addr) return 3;
+            found = BloomTest(blockIndex->bloom, node->value);
+            break;
+        case EXipv6FlowID:
+            // IPv6 addresses are compared in two 64bit halves
+            if (node->length != sizeof(uint64_t)) return 3;
+            if (node->offset != OFFsrc6Addr && node->offset != (OFFsrc6Addr + sizeof(uint64_t)) && node->offset != OFFdst6Addr &&
+                node->offset != (OFFdst6Addr + sizeof(uint64_t)))
+                return 3;
+            found = BloomTest(blockIndex->bloom, node->value);
+            break;
+        default:
+            return 3;
+    }
+
+    // if the value is not in the block, the node is false for all records
+    return found ? 3 : 1;
+
+}  // End of EvaluateBlockNode
+
+/*
+ * check if any record of a data block may match the filter, using the block summary
+ * of the block index. Returns 0, if no record can match, otherwise 1
+ */
+int FilterBlock(const void *engine, const blockIndex_t *blockIndex) {
+    const FilterEngine_t *filterEngine = (const FilterEngine_t *)engine;
+    if (filterEngine->StartNode == 0) return 1;
+
+    // walk all paths of the filter tree reachable with the block summary
+    uint8_t *visited = calloc(filterEngine->numNodes, sizeof(uint8_t));
+    uint32_t *stack = malloc(2 * filterEngine->numNodes * sizeof(uint32_t));
+    if (!visited || !stack) {
+        LogError("malloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+        if (visited) free(visited);
+        if (stack) free(stack);
+        return 1;
+    }
+
+    int match = 0;
+    uint32_t numStack = 0;
+    stack[numStack++] = filterEngine->StartNode;
+    while (numStack && !match) {
+        uint32_t index = stack[--numStack];
+        if (visited[index]) continue;
+        visited[index] = 1;
+
+        const filterElement_t *node = &filterEngine->filter[index];
+        int results = EvaluateBlockNode(node, blockIndex);
+        for (int evaluate = 0; evaluate < 2; evaluate++) {
+            if ((results & (1 << evaluate)) == 0) continue;
+            uint32_t next = evaluate ? node->OnTrue : node->OnFalse;
+            if (next == 0) {
+                // end of filter - result of the last node
+                if (node->invert ? !evaluate : evaluate) match = 1;
+            } else if (!visited[next]) {
+                stack[numStack++] = next;
+            }
+        }
+    }
+
+    free(visited);
+    free(stack);
+    return match;
+
+}  // End of FilterBlock
+
+/*
+ * multi filter engine
+ * The filter elements of all engines are compiled into a common table of unique
+ * predicates. Each engine keeps its own tree of nodes, which only references the
+ * predicates. While processing a record, a predicate is evaluated at most once and
+ * its result is reused by all engines sharing it. The result for a record is a
+ * bitmap of the matching engines.
+ */
+typedef struct predicate_s {
+    const filterElement_t *element;  // first element with this predicate
+    uint32_t extended;               // evaluate as extended element
+    uint32_t hash;
+    uint32_t generation;  // record generation of cached result
+    uint32_t result;      // cached result
+} predicate_t;
+
+typedef struct multiNode_s {
+    uint32_t predicate;
+    uint32_t OnTrue, OnFalse;
+    uint32_t invert;
+} multiNode_t;
+
+typedef struct multiTree_s {
+    multiNode_t *nodes;
+    uint32_t StartNode;
+} multiTree_t;
+
+typedef struct MultiFilterEngine_s {
+    uint32_t numTrees;
+    multiTree_t *trees;
+    uint32_t numPredicates;
+    predicate_t *predicates;
+    uint32_t generation;
+    int hasGeoDB;
+    const char *ident;
+} MultiFilterEngine_t;
+
+// element compare by string for string comparators - otherwise by value
+static inline int StringData(comparator_t comp) { return comp == CMP_IDENT || comp == CMP_STRING || comp == CMP_SUBSTRING || comp == CMP_PAYLOAD; }
+
+static uint32_t PredicateHash(const filterElement_t *element, uint32_t extended) {
+    uint64_t hash = ((uint64_t)element->extID << 32) | ((uint64_t)element->offset << 8) | element->length;
+    hash = (hash ^ element->value) * 0x9E3779B97F4A7C15ULL;
+    hash = (hash ^ ((uint64_t)element->comp << 1 | extended)) * 0x9E3779B97F4A7C15ULL;
+    hash ^= (uint64_t)(pointer_addr_t)element->function;
+    if (StringData(element->comp)) {
+        const char *str = (const char *)element->data.dataPtr;
+        while (str && *str) hash = (hash ^ (uint8_t)*str++) * 0x100000001B3ULL;
+    } else {
+        hash ^= (uint64_t)element->data.dataVal;
+    }
+    hash *= 0x9E3779B97F4A7C15ULL;
+    return (uint32_t)(hash >> 32);
+
+}  // End of PredicateHash
+
+static int PredicateEqual(const predicate_t *predicate, const filterElement_t *element, uint32_t extended) {
+    const filterElement_t *e = predicate->element;
+    if (predicate->extended != extended || e->extID != element->extID || e->offset != element->offset || e->length != element->length ||
+        e->value != element->value || e->comp != element->comp || e->function != element->function)
+        return 0;
+
+    if (StringData(element->comp)) {
+        const char *s1 = (const char *)e->data.dataPtr;
+        const char *s2 = (const char *)element->data.dataPtr;
+        if (s1 == NULL || s2 == NULL) return s1 == s2;
+        return strcmp(s1, s2) == 0;
+    }
+    // lists, regex and binary data compare by reference
+    return e->data.dataVal == element->data.dataVal;
+
+}  // End of PredicateEqual
+
+void *CompileMultiFilter(void **engines, uint32_t numEngines) {
+    MultiFilterEngine_t *multiEngine = calloc(1, sizeof(MultiFilterEngine_t));
+    if (!multiEngine) {
+        LogError("calloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+        return NULL;
+    }
+    multiEngine->ident = "none";
+    multiEngine->numTrees = numEngines;
+    multiEngine->trees = calloc(numEngines ? numEngines : 1, sizeof(multiTree_t));
+
+    uint32_t numElements = 0;
+    for (int i = 0; i < numEngines; i++) numElements += ((FilterEngine_t *)engines[i])->numNodes;
+
+    // hash table of predicate indices - 0 is empty
+    uint32_t hashSize = 64;
+    while (hashSize < (2 * numElements)) hashSize <<= 1;
+    uint32_t *predicateHash = calloc(hashSize, sizeof(uint32_t));
+    multiEngine->predicates = calloc(numElements + 1, sizeof(predicate_t));
+    if (!multiEngine->trees || !predicateHash || !multiEngine->predicates) {
+        LogError("calloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+        if (predicateHash) free(predicateHash);
+        DisposeMultiFilter(multiEngine);
+        return NULL;
     }
-    return invert ? !evaluate : evaluate;
-}  // End of RunFilter
+
+    // predicate 0 is unused
+    uint32_t numPredicates = 1;
+    for (int i = 0; i < numEngines; i++) {
+        const FilterEngine_t *engine = (const FilterEngine_t *)engines[i];
+        multiTree_t *tree = &multiEngine->trees[i];
+        tree->StartNode = engine->StartNode;
+        tree->nodes = calloc(engine->numNodes, sizeof(multiNode_t));
+        if (!tree->nodes) {
+            LogError("calloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+            free(predicateHash);
+            DisposeMultiFilter(multiEngine);
+            return NULL;
+        }
+
+        for (int index = 1; index < engine->numNodes; index++) {
+            const filterElement_t *element = &engine->filter[index];
+            // elements of extended engines, which evaluate identical as fast elements, get shared with fast engines
+            uint32_t extended = engine->Extended && !(element->comp == CMP_EQ && element->function == NULL &&
+                                                      preprocess_map[element->extID].function == NULL &&
+                                                      (element->length <= 2 || element->length == 4 || element->length == 8));
+            uint32_t hash = PredicateHash(element, extended);
+            uint32_t slot = hash & (hashSize - 1);
+            while (predicateHash[slot]) {
+                predicate_t *predicate = &multiEngine->predicates[predicateHash[slot]];
+                if (predicate->hash == hash && PredicateEqual(predicate, element, extended)) break;
+                slot = (slot + 1) & (hashSize - 1);
+            }
+            if (predicateHash[slot] == 0) {
+                multiEngine->predicates[numPredicates] = (predicate_t){.element = element, .extended = extended, .hash = hash};
+                predicateHash[slot] = numPredicates++;
+            }
+
+            tree->nodes[index] = (multiNode_t){
+                .predicate = predicateHash[slot],
+                .OnTrue = element->OnTrue,
+                .OnFalse = element->OnFalse,
+                .invert = element->invert,
+            };
+        }
+    }
+    free(predicateHash);
+    multiEngine->numPredicates = numPredicates;
+
+    LogVerbose("Multi filter: %u filters, %u elements, %u shared predicates", numEngines, numElements - numEngines, numPredicates - 1);
+    return (void *)multiEngine;
+
+}  // End of CompileMultiFilter
+
+void MultiFilterSetParam(void *engine, const char *ident, const int hasGeoDB) {
+    MultiFilterEngine_t *multiEngine = (MultiFilterEngine_t *)engine;
+    multiEngine->hasGeoDB = hasGeoDB;
+    multiEngine->ident = ident ? ident : "none";
+}  // End of MultiFilterSetParam
+
+/*
+ * filter a record by all engines of the multi filter
+ * bit i of matchMap is set, if engine i matches the record
+ */
+void MultiFilterRecord(void *engine, recordHandle_t *handle, uint64_t *matchMap) {
+    MultiFilterEngine_t *multiEngine = (MultiFilterEngine_t *)engine;
+
+    // new generation invalidates all cached predicate results
+    uint32_t generation = ++multiEngine->generation;
+    if (generation == 0) {
+        for (int i = 0; i < multiEngine->numPredicates; i++) multiEngine->predicates[i].generation = 0;
+        generation = multiEngine->generation = 1;
+    }
+
+    memset((void *)matchMap, 0, MULTIFILTERWORDS(multiEngine->numTrees) * sizeof(uint64_t));
+    for (int i = 0; i < multiEngine->numTrees; i++) {
+        const multiTree_t *tree = &multiEngine->trees[i];
+        uint32_t index = tree->StartNode;
+        int evaluate = 0;
+        int invert = 0;
+        while (index) {
+            const multiNode_t *node = &tree->nodes[index];
+            predicate_t *predicate = &multiEngine->predicates[node->predicate];
+            if (predicate->generation != generation) {
+                predicate->result = predicate->extended ? EvaluateElement(predicate->element, multiEngine->ident, multiEngine->hasGeoDB, handle)
+                                                        : EvaluateFastElement(predicate->element, handle);
+                predicate->generation = generation;
+            }
+            evaluate = predicate->result;
+            invert = node->invert;
+            index = evaluate ? node->OnTrue : node->OnFalse;
+        }
+        if (invert ? !evaluate : evaluate) matchMap[i >> 6] |= 1ULL << (i & 0x3F);
+    }
+
+}  // End of MultiFilterRecord
+
+void DisposeMultiFilter(void *engine) {
+    MultiFilterEngine_t *multiEngine = (MultiFilterEngine_t *)engine;
+    if (!multiEngine) return;
+
+    if (multiEngine->trees) {
+        for (int i = 0; i < multiEngine->numTrees; i++) free(multiEngine->trees[i].nodes);
+        free(multiEngine->trees);
+    }
+    free(multiEngine->predicates);
+    free(multiEngine);
+
+}  // End of DisposeMultiFilter
 
 char *ReadFilter(char *filename) {
     struct stat stat_buff;
@@ -868,6 +1692,14 @@ void *CompileFilter(char *FilterSyntax) {
     }
     lex_cleanup();
 
+    // build the lookup tables of all IP lists
+    for (int i = 1; i < NumBlocks; i++) {
+        if (FilterTree[i].comp == CMP_IPLIST && FilterTree[i].data.dataPtr && !LPMCompile((ipLPM_t *)FilterTree[i].data.dataPtr)) {
+            LogError("Failed to compile IP list");
+            return NULL;
+        }
+    }
+
     FilterEngine_t *engine = malloc(sizeof(FilterEngine_t));
     if (!engine) {
         LogError("Memory allocation error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
@@ -876,6 +1708,7 @@ void *CompileFilter(char *FilterSyntax) {
 
     *engine = (FilterEngine_t){
         .label = NULL,
+        .numNodes = NumBlocks,
         .StartNode = StartNode,
         .Extended = Extended,
         .filter = FilterTree,
@@ -883,6 +1716,8 @@ void *CompileFilter(char *FilterSyntax) {
         .filterFunction = Extended ? RunExtendedFilter : RunFilterFast,
     };
     FilterTree = NULL;
+    SelectKernels();
+    CompileBatch(engine);
 
     dbg_printf("Engine: %s\n", engine->Extended ? "extended" : "fast");
 
@@ -921,11 +1756,7 @@ void DumpEngine(void *arg) {
         }
         if (engine->filter[i].data.dataPtr) {
             if (engine->filter[i].comp == CMP_IPLIST) {
-                struct IPListNode *node;
-                RB_FOREACH(node, IPtree, engine->filter[i].data.dataPtr) {
-                    printf("value: %.16" PRIx64 " %.16" PRIx64 " mask: %.16" PRIx64 " %.16" PRIx64 "\n", node->ip[0], node->ip[1], node->mask[0],
-                           node->mask[1]);
-                }
+                LPMDump((ipLPM_t *)engine->filter[i].data.dataPtr);
             } else if (engine->filter[i].comp == CMP_U64LIST) {
                 struct U64ListNode *node;
                 RB_FOREACH(node, U64tree, engine->filter[i].data.dataPtr) { printf("%.16llx \n", (unsigned long long)node->value); }
@@ -34,7 +34,9 @@
 #include <stdint.h>
 #include <stdio.h>
 
+#include "columnblock.h"
 #include "nfdump.h"
+#include "nffileV2.h"
 #include "nfxV3.h"
 #include "rbtree.h"
 
@@ -114,14 +116,6 @@ typedef enum {
 
 #define FULLMASK FFFFFFFFFFFFFFFFLL
 
-/* Definition of the IP list node */
-struct IPListNode {
-    RB_ENTRY(IPListNode)
-    entry;
-    uint64_t ip[2];
-    uint64_t mask[2];
-};
-
 /* Definition of the uint64_t list node */
 struct U64ListNode {
     RB_ENTRY(U64ListNode)
@@ -134,15 +128,10 @@ typedef union data_u {
     int64_t dataVal;
 } data_t;
 
-/* IP tree type */
-typedef RB_HEAD(IPtree, IPListNode) IPlist_t;
-
 /* uint64_t tree type */
 typedef RB_HEAD(U64tree, U64ListNode) U64List_t;
 
 // Insert the RB prototypes here
-RB_PROTOTYPE(IPtree, IPListNode, entry, IPNodeCMP);
-
 RB_PROTOTYPE(U64tree, U64ListNode, entry, U64NodeCMP);
 
 int yylex(void);
@@ -167,6 +156,26 @@ void FilterSetParam(void *engine, const char *ident, const int hasGeoDB);
 
 int FilterRecord(const void *engine, recordHandle_t *handle);
 
+// max number of records evaluated by FilterRecordBatch()
+#define FILTERBATCHSIZE 64
+
+uint64_t FilterRecordBatch(const void *engine, recordHandle_t *handles, uint32_t numRecords, uint64_t active);
+
+uint32_t FilterColumns(const void *engine, columnView_t *columnView, uint8_t *select);
+
+int FilterBlock(const void *engine, const blockIndex_t *blockIndex);
+
+// number of uint64_t words for a match bitmap of n engines
+#define MULTIFILTERWORDS(n) (((n) + 63) >> 6)
+
+void *CompileMultiFilter(void **engines, uint32_t numEngines);
+
+void MultiFilterSetParam(void *engine, const char *ident, const int hasGeoDB);
+
+void MultiFilterRecord(void *engine, recordHandle_t *handle, uint64_t *matchMap);
+
+void DisposeMultiFilter(void *engine);
+
 void DumpEngine(void *arg);
 
 void lex_init(char *buf);
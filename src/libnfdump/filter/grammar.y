@@ -45,6 +45,7 @@
 #include <arpa/inet.h>
 
 #include "filter.h"
+#include "lpm.h"
 #include "userio.h"
 #include "nfxV3.h"
 #include "ipconv.h"
@@ -1788,74 +1789,6 @@ static int AddIPlist(direction_t direction, void *IPlist) {
 	return ret;
 } // AddIPlist
 
-static struct IPListNode *mkNode(ipStack_t ipStack, int64_t prefix) {
-
-	struct IPListNode *node = malloc(sizeof(struct IPListNode));
-	if (node == NULL) {
-		yyprintf("malloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
-		return NULL;
-	}
-
-	node->ip[0] = ipStack.ipaddr[0];
-	node->ip[1] = ipStack.ipaddr[1];
-	node->mask[0] = 0xffffffffffffffffLL;
-	node->mask[1] = 0xffffffffffffffffLL;
-
-	if ( prefix > 0 ) {
-		if (ipStack.af == PF_INET) {
-		// IPv4 
-			if (prefix >32 ) {
-				yyprintf("Prefix %" PRIu64 " out of range for IPv4 address", prefix);
-				return NULL;
-			}
-			node->mask[0] = 0;
-			node->mask[1] = 0xffffffffffffffffLL << (32 - prefix);
-		} else {
-			// IPv6
-			if (prefix >128 ) {
-				yyprintf("Prefix %" PRIu64 " out of range for IPv6 address", prefix);
-				return NULL;
-			}
-			if ( prefix > 64 ) {
-				node->mask[0] = 0xffffffffffffffffLL;
-				node->mask[1] = 0xffffffffffffffffLL << (128 - prefix);
-			} else {
-				node->mask[0] = 0xffffffffffffffffLL << (64 - prefix);
-				node->mask[1] = 0;
-			}
-		}
-	}
-	return node;
-}
-
-static void *NewIplist(char *IPstr, int prefix) {
-	IPlist_t *root = malloc(sizeof(IPlist_t));
-	if (root == NULL) {
-		yyprintf("malloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
-		return NULL;
-	}
-	RB_INIT(root);
-
-	int numIP = parseIP(IPstr, ipStack, ALLOW_LOOKUP);
-	if ( numIP <= 0 ) {
-		yyprintf("Can not parse/resolve %s to an IP address", IPstr);
-		free(root);
-		return NULL;
-	}
-		
-	for (int i=0; i<numIP; i++ ) {
-	  struct IPListNode *node = mkNode(ipStack[i], prefix);
-		if ( node ) {
-			RB_INSERT(IPtree, root, node);
-		} else {
-			free(root);
-			return NULL;
-		}
-	}
-
-	return root;
-} // End of NewIPlist
-
 static int InsertIPlist(void *IPlist, char *IPstr, int64_t prefix) {
 	int numIP = parseIP(IPstr, ipStack, ALLOW_LOOKUP);
 	if ( numIP <= 0 ) {
@@ -1865,16 +1798,34 @@ static int InsertIPlist(void *IPlist, char *IPstr, int64_t prefix) {
 	}
 
 	for (int i=0; i<numIP; i++ ) {
-		struct IPListNode *node = mkNode(ipStack[i], prefix);
-		if ( node ) {
-			RB_INSERT(IPtree, (IPlist_t *)IPlist, node);
-		} else {
+		int maxPrefix = ipStack[i].af == PF_INET ? 32 : 128;
+		if ( prefix > maxPrefix ) {
+			yyprintf("Prefix %" PRIi64 " out of range for %s address", prefix, ipStack[i].af == PF_INET ? "IPv4" : "IPv6");
+			return 0;
+		}
+		if ( !LPMInsert((ipLPM_t *)IPlist, ipStack[i].af, ipStack[i].ipaddr, (int)prefix) ) {
+			yyprintf("Failed to insert %s into IP list", IPstr);
 			return 0;
 		}
 	}
 	return 1;
 } // End of InsertIPlist
 
+static void *NewIplist(char *IPstr, int prefix) {
+	ipLPM_t *IPlist = NewLPM();
+	if (IPlist == NULL) {
+		yyprintf("malloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+		return NULL;
+	}
+
+	if ( InsertIPlist(IPlist, IPstr, prefix) == 0 ) {
+		DisposeLPM(IPlist);
+		return NULL;
+	}
+
+	return IPlist;
+} // End of NewIPlist
+
 static void *NewU64list(uint64_t num) {
 	U64List_t *root = malloc(sizeof(U64List_t));
 	if (root == NULL) {
@@ -0,0 +1,388 @@
+/*
+ *  Copyright (c) 2024, Peter Haag
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *   * Neither the name of the author nor the names of its contributors may be
+ *     used to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "lpm.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+
+#include "util.h"
+
+/*
+ * Compressed multibit trie with a stride of 6 bits. Each node holds two 64bit maps:
+ * matchMap marks the chunks covered by a prefix, childMap the chunks with a child
+ * node. The children of a node are stored consecutively, the index of a child is
+ * the number of child bits below its chunk. Prefixes covered by a shorter prefix
+ * are removed before compiling, as only containment is needed, not the longest match.
+ * Large sets use a direct indexed table for the first 16 bits.
+ * IPv4 addresses are stored in the upper 32 bits of the 128bit key.
+ */
+
+#define STRIDE 6
+#define TOPBITS 16
+#define TOPMATCH 0xFFFFFFFF
+// use the direct indexed top table from this number of prefixes
+#define TOPTHRESHOLD 1024
+
+typedef struct lpmPrefix_s {
+    uint64_t ip[2];
+    uint32_t len;
+} lpmPrefix_t;
+
+typedef struct lpmNode_s {
+    uint64_t matchMap;
+    uint64_t childMap;
+    uint32_t childBase;
+} lpmNode_t;
+
+typedef struct lpmTable_s {
+    // prefixes while collecting
+    lpmPrefix_t *prefix;
+    uint32_t numPrefixes;
+    uint32_t maxPrefixes;
+
+    // compiled trie
+    int matchAll;
+    uint32_t *top;
+    lpmNode_t *node;
+    uint32_t numNodes;
+    uint32_t maxNodes;
+} lpmTable_t;
+
+struct ipLPM_s {
+    uint32_t refCount;
+    int compiled;
+    lpmTable_t v4;
+    lpmTable_t v6;
+};
+
+// 6 bit chunk of a 128bit key at bit position depth
+static inline uint32_t Chunk(const uint64_t ip[2], uint32_t depth) {
+    if (depth <= 58) return (ip[0] >> (58 - depth)) & 0x3F;
+    if (depth >= 64) return depth <= 122 ? (ip[1] >> (122 - depth)) & 0x3F : (ip[1] << (depth - 122)) & 0x3F;
+    return ((ip[0] << (depth - 58)) | (ip[1] >> (122 - depth))) & 0x3F;
+}  // End of Chunk
+
+static inline void PrefixMask(uint32_t len, uint64_t mask[2]) {
+    if (len == 0) {
+        mask[0] = mask[1] = 0;
+    } else if (len <= 64) {
+        mask[0] = 0xffffffffffffffffULL << (64 - len);
+        mask[1] = 0;
+    } else {
+        mask[0] = 0xffffffffffffffffULL;
+        mask[1] = 0xffffffffffffffffULL << (128 - len);
+    }
+}  // End of PrefixMask
+
+static inline void PrefixEnd(const lpmPrefix_t *prefix, uint64_t end[2]) {
+    uint64_t mask[2];
+    PrefixMask(prefix->len, mask);
+    end[0] = prefix->ip[0] | ~mask[0];
+    end[1] = prefix->ip[1] | ~mask[1];
+}  // End of PrefixEnd
+
+static int PrefixCMP(const void *p1, const void *p2) {
+    const lpmPrefix_t *a = (const lpmPrefix_t *)p1;
+    const lpmPrefix_t *b = (const lpmPrefix_t *)p2;
+    if (a->ip[0] != b->ip[0]) return a->ip[0] < b->ip[0] ? -1 : 1;
+    if (a->ip[1] != b->ip[1]) return a->ip[1] < b->ip[1] ? -1 : 1;
+    if (a->len != b->len) return a->len < b->len ? -1 : 1;
+    return 0;
+}  // End of PrefixCMP
+
+ipLPM_t *NewLPM(void) {
+    ipLPM_t *lpm = calloc(1, sizeof(ipLPM_t));
+    if (!lpm) {
+        LogError("calloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+        return NULL;
+    }
+    return lpm;
+}  // End of NewLPM
+
+// an element referencing the prefix set
+void LPMRef(ipLPM_t *lpm) { lpm->refCount++; }
+
+static void FreeTable(lpmTable_t *table) {
+    free(table->prefix);
+    free(table->top);
+    free(table->node);
+    memset((void *)table, 0, sizeof(lpmTable_t));
+}  // End of FreeTable
+
+// release a reference and free the prefix set with the last reference
+void DisposeLPM(ipLPM_t *lpm) {
+    if (!lpm) return;
+    if (lpm->refCount > 1) {
+        lpm->refCount--;
+        return;
+    }
+    FreeTable(&lpm->v4);
+    FreeTable(&lpm->v6);
+    free(lpm);
+}  // End of DisposeLPM
+
+static int AddPrefix(lpmTable_t *table, const uint64_t ip[2], uint32_t len) {
+    if (table->numPrefixes == table->maxPrefixes) {
+        uint32_t maxPrefixes = table->maxPrefixes ? 2 * table->maxPrefixes : 16;
+        lpmPrefix_t *prefix = realloc(table->prefix, maxPrefixes * sizeof(lpmPrefix_t));
+        if (!prefix) {
+            LogError("realloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+            return 0;
+        }
+        table->prefix = prefix;
+        table->maxPrefixes = maxPrefixes;
+    }
+
+    // store prefix masked
+    uint64_t mask[2];
+    PrefixMask(len, mask);
+    table->prefix[table->numPrefixes++] = (lpmPrefix_t){.ip[0] = ip[0] & mask[0], .ip[1] = ip[1] & mask[1], .len = len};
+    return 1;
+
+}  // End of AddPrefix
+
+/*
+ * insert an address with prefix length into the set. prefix < 0 inserts a host address
+ * IPv4 addresses are expected in ip[1] as returned by parseIP()
+ */
+int LPMInsert(ipLPM_t *lpm, int af, const uint64_t ip[2], int prefix) {
+    if (af == PF_INET) {
+        if (prefix > 32) return 0;
+        uint64_t key[2] = {ip[1] << 32, 0};
+        return AddPrefix(&lpm->v4, key, prefix < 0 ? 32 : prefix);
+    } else {
+        if (prefix > 128) return 0;
+        return AddPrefix(&lpm->v6, ip, prefix < 0 ? 128 : prefix);
+    }
+}  // End of LPMInsert
+
+static int MergeTable(lpmTable_t *table, const lpmTable_t *other) {
+    for (int i = 0; i < other->numPrefixes; i++) {
+        if (!AddPrefix(table, other->prefix[i].ip, other->prefix[i].len)) return 0;
+    }
+    return 1;
+}  // End of MergeTable
+
+// add all prefixes of other to lpm
+int LPMMerge(ipLPM_t *lpm, const ipLPM_t *other) { return MergeTable(&lpm->v4, &other->v4) && MergeTable(&lpm->v6, &other->v6); }
+
+// return a prefix set owned by the caller only - copy a shared set
+ipLPM_t *LPMPrivate(ipLPM_t *lpm) {
+    if (lpm->refCount <= 1) return lpm;
+
+    ipLPM_t *copy = NewLPM();
+    if (!copy) return NULL;
+    if (!LPMMerge(copy, lpm)) {
+        DisposeLPM(copy);
+        return NULL;
+    }
+    copy->refCount = 1;
+    lpm->refCount--;
+    return copy;
+
+}  // End of LPMPrivate
+
+static uint32_t NewNodes(lpmTable_t *table, uint32_t num) {
+    if ((table->numNodes + num) > table->maxNodes) {
+        uint32_t maxNodes = table->maxNodes ? table->maxNodes : 64;
+        while ((table->numNodes + num) > maxNodes) maxNodes *= 2;
+        lpmNode_t *node = realloc(table->node, maxNodes * sizeof(lpmNode_t));
+        if (!node) {
+            LogError("realloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+            return 0;
+        }
+        table->node = node;
+        table->maxNodes = maxNodes;
+    }
+    uint32_t index = table->numNodes;
+    memset((void *)&table->node[index], 0, num * sizeof(lpmNode_t));
+    table->numNodes += num;
+    return index;
+
+}  // End of NewNodes
+
+// build node index for the prefixes first .. last-1, which share the first depth bits
+static int BuildNode(lpmTable_t *table, uint32_t index, uint32_t first, uint32_t last, uint32_t depth) {
+    uint64_t matchMap = 0;
+    uint64_t childMap = 0;
+    for (uint32_t i = first; i < last; i++) {
+        lpmPrefix_t *prefix = &table->prefix[i];
+        uint32_t chunk = Chunk(prefix->ip, depth);
+        if (prefix->len <= (depth + STRIDE)) {
+            // prefix covers a range of chunks
+            uint64_t end[2];
+            PrefixEnd(prefix, end);
+            uint32_t endChunk = Chunk(end, depth);
+            for (uint32_t c = chunk; c <= endChunk; c++) matchMap |= 1ULL << c;
+        } else {
+            childMap |= 1ULL << chunk;
+        }
+    }
+
+    uint32_t childBase = 0;
+    if (childMap) {
+        childBase = NewNodes(table, __builtin_popcountll(childMap));
+        if (childBase == 0) return 0;
+    }
+    table->node[index] = (lpmNode_t){.matchMap = matchMap, .childMap = childMap, .childBase = childBase};
+
+    // build children - prefixes of a child are consecutive
+    uint32_t i = first;
+    while (i < last) {
+        lpmPrefix_t *prefix = &table->prefix[i];
+        if (prefix->len <= (depth + STRIDE)) {
+            i++;
+            continue;
+        }
+        uint32_t chunk = Chunk(prefix->ip, depth);
+        uint32_t j = i + 1;
+        while (j < last && Chunk(table->prefix[j].ip, depth) == chunk) j++;
+        uint32_t child = childBase + __builtin_popcountll(childMap & ((1ULL << chunk) - 1));
+        if (!BuildNode(table, child, i, j, depth + STRIDE)) return 0;
+        i = j;
+    }
+
+    return 1;
+
+}  // End of BuildNode
+
+static int CompileTable(lpmTable_t *table) {
+    if (table->numPrefixes == 0) return 1;
+
+    // sort and remove prefixes covered by a shorter prefix
+    qsort(table->prefix, table->numPrefixes, sizeof(lpmPrefix_t), PrefixCMP);
+    uint32_t numPrefixes = 0;
+    uint64_t lastEnd[2] = {0, 0};
+    for (uint32_t i = 0; i < table->numPrefixes; i++) {
+        lpmPrefix_t *prefix = &table->prefix[i];
+        if (numPrefixes && (prefix->ip[0] < lastEnd[0] || (prefix->ip[0] == lastEnd[0] && prefix->ip[1] <= lastEnd[1]))) continue;
+        if (prefix->len == 0) table->matchAll = 1;
+        table->prefix[numPrefixes++] = *prefix;
+        PrefixEnd(prefix, lastEnd);
+    }
+    table->numPrefixes = numPrefixes;
+    if (table->matchAll) return 1;
+
+    // node 0 is unused
+    table->numNodes = 1;
+    if (numPrefixes < TOPTHRESHOLD) {
+        // root node at index 1
+        if (NewNodes(table, 1) == 0) return 0;
+        return BuildNode(table, 1, 0, numPrefixes, 0);
+    }
+
+    table->top = calloc(1 << TOPBITS, sizeof(uint32_t));
+    if (!table->top) {
+        LogError("calloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+        return 0;
+    }
+    uint32_t i = 0;
+    while (i < numPrefixes) {
+        lpmPrefix_t *prefix = &table->prefix[i];
+        uint32_t slot = prefix->ip[0] >> (64 - TOPBITS);
+        if (prefix->len <= TOPBITS) {
+            uint64_t end[2];
+            PrefixEnd(prefix, end);
+            uint32_t endSlot = end[0] >> (64 - TOPBITS);
+            for (uint32_t s = slot; s <= endSlot; s++) table->top[s] = TOPMATCH;
+            i++;
+            continue;
+        }
+        uint32_t j = i + 1;
+        while (j < numPrefixes && (table->prefix[j].ip[0] >> (64 - TOPBITS)) == slot) j++;
+        uint32_t index = NewNodes(table, 1);
+        if (index == 0 || !BuildNode(table, index, i, j, TOPBITS)) return 0;
+        table->top[slot] = index;
+        i = j;
+    }
+
+    return 1;
+
+}  // End of CompileTable
+
+// compile the collected prefixes for lookups
+int LPMCompile(ipLPM_t *lpm) {
+    if (lpm->compiled) return 1;
+    lpm->compiled = 1;
+    return CompileTable(&lpm->v4) && CompileTable(&lpm->v6);
+}  // End of LPMCompile
+
+static inline int LookupTable(const lpmTable_t *table, const uint64_t ip[2]) {
+    if (table->matchAll) return 1;
+
+    uint32_t index = 1;
+    uint32_t depth = 0;
+    if (table->top) {
+        index = table->top[ip[0] >> (64 - TOPBITS)];
+        if (index == TOPMATCH) return 1;
+        depth = TOPBITS;
+    } else if (table->numNodes <= 1) {
+        return 0;
+    }
+
+    while (index) {
+        const lpmNode_t *node = &table->node[index];
+        uint64_t bit = 1ULL << Chunk(ip, depth);
+        if (node->matchMap & bit) return 1;
+        if ((node->childMap & bit) == 0) return 0;
+        index = node->childBase + __builtin_popcountll(node->childMap & (bit - 1));
+        depth += STRIDE;
+    }
+    return 0;
+
+}  // End of LookupTable
+
+int LPMLookupV4(const ipLPM_t *lpm, uint32_t ip) {
+    uint64_t key[2] = {(uint64_t)ip << 32, 0};
+    return LookupTable(&lpm->v4, key);
+}  // End of LPMLookupV4
+
+int LPMLookupV6(const ipLPM_t *lpm, const uint64_t ip[2]) { return LookupTable(&lpm->v6, ip); }
+
+void LPMDump(const ipLPM_t *lpm) {
+    for (int i = 0; i < lpm->v4.numPrefixes; i++) {
+        const lpmPrefix_t *prefix = &lpm->v4.prefix[i];
+        uint32_t ip = prefix->ip[0] >> 32;
+        printf("%u.%u.%u.%u/%u\n", ip >> 24, (ip >> 16) & 0xFF, (ip >> 8) & 0xFF, ip & 0xFF, prefix->len);
+    }
+    for (int i = 0; i < lpm->v6.numPrefixes; i++) {
+        const lpmPrefix_t *prefix = &lpm->v6.prefix[i];
+        printf("%.16" PRIx64 " %.16" PRIx64 "/%u\n", prefix->ip[0], prefix->ip[1], prefix->len);
+    }
+    printf("IPv4 prefixes: %u, nodes: %u, IPv6 prefixes: %u, nodes: %u\n", lpm->v4.numPrefixes, lpm->v4.numNodes, lpm->v6.numPrefixes,
+           lpm->v6.numNodes);
+}  // End of LPMDump
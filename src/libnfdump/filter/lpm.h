@@ -0,0 +1,65 @@
+/*
+ *  Copyright (c) 2024, Peter Haag
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *   * Neither the name of the author nor the names of its contributors may be
+ *     used to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _LPM_H
+#define _LPM_H 1
+
+#include <stdint.h>
+#include <sys/types.h>
+
+/*
+ * IP prefix set for IP list and network filters
+ * Prefixes are collected while parsing the filter and compiled into a compressed
+ * multibit trie per address family. A lookup answers, if any prefix of the set
+ * contains the address.
+ */
+typedef struct ipLPM_s ipLPM_t;
+
+ipLPM_t *NewLPM(void);
+
+void LPMRef(ipLPM_t *lpm);
+
+void DisposeLPM(ipLPM_t *lpm);
+
+int LPMInsert(ipLPM_t *lpm, int af, const uint64_t ip[2], int prefix);
+
+ipLPM_t *LPMPrivate(ipLPM_t *lpm);
+
+int LPMMerge(ipLPM_t *lpm, const ipLPM_t *other);
+
+int LPMCompile(ipLPM_t *lpm);
+
+int LPMLookupV4(const ipLPM_t *lpm, uint32_t ip);
+
+int LPMLookupV6(const ipLPM_t *lpm, const uint64_t ip[2]);
+
+void LPMDump(const ipLPM_t *lpm);
+
+#endif  //_LPM_H
@@ -0,0 +1,542 @@
+/*
+ *  Copyright (c) 2024, Peter Haag
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *   * Neither the name of the author nor the names of its contributors may be
+ *     used to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*
+ * Columnar data block - DATA_BLOCK_TYPE_5
+ * ColumnBlock() moves the payload of the common extensions of all V3 records of a
+ * type 3 block into one column per extension. Columns of equal sized elements are stored
+ * byte plane by byte plane, which groups the same field bytes of all records and lets
+ * the block compression do its best. CompressColumns() compresses the row stream and
+ * each column separately.
+ * A column view gives access to single columns of a type 5 block, which are uncompressed
+ * on demand. RestoreRecords() rebuilds the type 3 block with all or selected records.
+ */
+
+#include "columnblock.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "id.h"
+#include "nfdump.h"
+#include "nffile.h"
+#include "nfxV3.h"
+#include "util.h"
+
+// extensions stored in columns
+static const uint16_t columnExtensions[] = {EXgenericFlowID, EXipv4FlowID, EXipv6FlowID, EXflowMiscID, EXcntFlowID, EXasRoutingID};
+#define NUMCOLUMNS (int)(sizeof(columnExtensions) / sizeof(uint16_t))
+
+typedef struct column_s {
+    uint8_t *data;         // column data
+    uint32_t size;         // size of column data
+    uint32_t elementSize;  // payload size of all elements, 0 if sizes differ
+    uint32_t numElements;  // number of elements
+    uint32_t index;        // current element
+    uint32_t offset;       // current offset, if elements are not stored in byte planes
+} column_t;
+
+static inline int ColumnIndex(uint16_t extID) {
+    for (int i = 0; i < NUMCOLUMNS; i++) {
+        if (columnExtensions[i] == extID) return i;
+    }
+    return -1;
+}  // End of ColumnIndex
+
+// check the element structure of a V3 record and sum up the payload of the column extensions
+// returns the number of payload bytes moved into columns or -1 for a corrupt record or
+// a record with a column extension twice
+static int ScanRecord(recordHeaderV3_t *recordHeader, column_t *columns) {
+    if (recordHeader->size < sizeof(recordHeaderV3_t)) return -1;
+
+    void *recordEnd = (void *)recordHeader + recordHeader->size;
+    elementHeader_t *elementHeader = (elementHeader_t *)((void *)recordHeader + sizeof(recordHeaderV3_t));
+    int moved = 0;
+    uint32_t found = 0;
+    for (int i = 0; i < recordHeader->numElements; i++) {
+        if (((void *)elementHeader + sizeof(elementHeader_t)) > recordEnd || elementHeader->length < sizeof(elementHeader_t) ||
+            ((void *)elementHeader + elementHeader->length) > recordEnd)
+            return -1;
+
+        int c = ColumnIndex(elementHeader->type);
+        if (c >= 0) {
+            if (found & (1U << c)) return -1;
+            found |= 1U << c;
+            column_t *column = &columns[c];
+            uint32_t payload = elementHeader->length - sizeof(elementHeader_t);
+            if (column->numElements == 0) {
+                column->elementSize = payload;
+            } else if (column->elementSize != payload) {
+                column->elementSize = 0;
+            }
+            column->numElements++;
+            column->size += payload;
+            moved += payload;
+        }
+        elementHeader = (elementHeader_t *)((void *)elementHeader + elementHeader->length);
+    }
+
+    return moved;
+
+}  // End of ScanRecord
+
+// convert a type 3 block into a columnar type 5 block.
+// returns NULL, if the block can not be converted - the row block is not modified
+dataBlock_t *ColumnBlock(dataBlock_t *rowBlock) {
+    if (rowBlock->type != DATA_BLOCK_TYPE_3) return NULL;
+
+    // pass 1 - check the records and size the row stream and columns
+    column_t columns[NUMCOLUMNS] = {0};
+    uint32_t rowSize = 0;
+    void *p = GetCursor(rowBlock);
+    void *end = p + rowBlock->size;
+    for (uint32_t i = 0; i < rowBlock->NumRecords; i++) {
+        recordHeader_t *recordHeader = (recordHeader_t *)p;
+        if ((p + sizeof(recordHeader_t)) > end || recordHeader->size < sizeof(recordHeader_t) || (p + recordHeader->size) > end) return NULL;
+
+        int moved = 0;
+        if (recordHeader->type == V3Record) {
+            moved = ScanRecord((recordHeaderV3_t *)recordHeader, columns);
+            if (moved < 0) return NULL;
+        }
+        rowSize += recordHeader->size - moved;
+        p += recordHeader->size;
+    }
+
+    int numColumns = 0;
+    uint32_t columnSize = 0;
+    for (int c = 0; c < NUMCOLUMNS; c++) {
+        if (columns[c].numElements) numColumns++;
+        columnSize += columns[c].size;
+    }
+    if (numColumns == 0) return NULL;
+
+    size_t layoutSize = sizeof(columnLayout_t) + numColumns * sizeof(columnHeader_t);
+    if ((layoutSize + rowSize + columnSize) > (BUFFSIZE - sizeof(dataBlock_t))) return NULL;
+
+    dataBlock_t *columnBlock = NewDataBlock();
+    if (!columnBlock) return NULL;
+
+    // block layout and column headers
+    columnLayout_t *columnLayout = (columnLayout_t *)GetCursor(columnBlock);
+    columnLayout->rowSize = rowSize;
+    columnLayout->rowStored = rowSize;
+    columnLayout->numColumns = numColumns;
+    columnLayout->fill = 0;
+
+    columnHeader_t *columnHeader = (columnHeader_t *)((void *)columnLayout + sizeof(columnLayout_t));
+    uint8_t *rows = (uint8_t *)columnLayout + layoutSize;
+    uint8_t *data = rows + rowSize;
+    for (int c = 0; c < NUMCOLUMNS; c++) {
+        column_t *column = &columns[c];
+        if (column->numElements == 0) continue;
+        columnHeader->extID = columnExtensions[c];
+        columnHeader->elementSize = column->elementSize;
+        columnHeader->size = column->size;
+        columnHeader->stored = column->size;
+        columnHeader++;
+        column->data = data;
+        data += column->size;
+    }
+
+    // pass 2 - fill row stream and columns
+    p = GetCursor(rowBlock);
+    for (uint32_t i = 0; i < rowBlock->NumRecords; i++) {
+        recordHeader_t *recordHeader = (recordHeader_t *)p;
+        p += recordHeader->size;
+        if (recordHeader->type != V3Record) {
+            memcpy(rows, (void *)recordHeader, recordHeader->size);
+            rows += recordHeader->size;
+            continue;
+        }
+
+        recordHeaderV3_t *recordHeaderV3 = (recordHeaderV3_t *)recordHeader;
+        memcpy(rows, (void *)recordHeaderV3, sizeof(recordHeaderV3_t));
+        rows += sizeof(recordHeaderV3_t);
+
+        uint8_t *element = (uint8_t *)recordHeaderV3 + sizeof(recordHeaderV3_t);
+        for (int j = 0; j < recordHeaderV3->numElements; j++) {
+            elementHeader_t *elementHeader = (elementHeader_t *)element;
+            int c = ColumnIndex(elementHeader->type);
+            if (c < 0) {
+                memcpy(rows, element, elementHeader->length);
+                rows += elementHeader->length;
+            } else {
+                column_t *column = &columns[c];
+                uint32_t payload = elementHeader->length - sizeof(elementHeader_t);
+                memcpy(rows, element, sizeof(elementHeader_t));
+                rows += sizeof(elementHeader_t);
+                uint8_t *in = element + sizeof(elementHeader_t);
+                if (column->elementSize) {
+                    uint8_t *out = column->data + column->index;
+                    for (uint32_t b = 0; b < payload; b++) out[b * column->numElements] = in[b];
+                } else {
+                    memcpy(column->data + column->offset, in, payload);
+                    column->offset += payload;
+                }
+                column->index++;
+            }
+            element += elementHeader->length;
+        }
+
+        // any data behind the elements
+        size_t trailing = p - (void *)element;
+        memcpy(rows, element, trailing);
+        rows += trailing;
+    }
+
+    columnBlock->type = DATA_BLOCK_TYPE_5;
+    columnBlock->flags = rowBlock->flags;
+    columnBlock->NumRecords = rowBlock->NumRecords;
+    columnBlock->size = layoutSize + rowSize + columnSize;
+
+    return columnBlock;
+
+}  // End of ColumnBlock
+
+// compress the row stream and each column of a type 5 block separately. Sections, which
+// do not shrink, are stored uncompressed. Returns the compressed block or NULL on error
+dataBlock_t *CompressColumns(dataBlock_t *columnBlock, int compression, int level) {
+    columnLayout_t *columnLayout = (columnLayout_t *)GetCursor(columnBlock);
+    size_t layoutSize = sizeof(columnLayout_t) + columnLayout->numColumns * sizeof(columnHeader_t);
+
+    dataBlock_t *outBlock = NewDataBlock();
+    if (!outBlock) return NULL;
+    *outBlock = *columnBlock;
+    memcpy(GetCursor(outBlock), (void *)columnLayout, layoutSize);
+
+    columnLayout_t *outLayout = (columnLayout_t *)GetCursor(outBlock);
+    columnHeader_t *columnHeader = (columnHeader_t *)((void *)outLayout + sizeof(columnLayout_t));
+    uint8_t *in = (uint8_t *)columnLayout + layoutSize;
+    uint8_t *out = (uint8_t *)outLayout + layoutSize;
+    uint8_t *outEnd = (uint8_t *)GetCursor(outBlock) + (BUFFSIZE - sizeof(dataBlock_t));
+
+    // section 0 is the row stream, followed by the columns
+    for (int i = 0; i <= outLayout->numColumns; i++) {
+        uint32_t *stored = i == 0 ? &outLayout->rowStored : &columnHeader[i - 1].stored;
+        uint32_t size = i == 0 ? outLayout->rowSize : columnHeader[i - 1].size;
+        int compressed = size ? CompressBuffer(compression, level, in, size, out, outEnd - out) : 0;
+        if (compressed < 0 || (uint32_t)compressed >= size) {
+            // store the section as it is
+            if ((out + size) > outEnd) {
+                FreeDataBlock(outBlock);
+                return NULL;
+            }
+            memcpy(out, in, size);
+            compressed = size;
+        }
+        *stored = compressed;
+        in += size;
+        out += compressed;
+    }
+    outBlock->size = out - (uint8_t *)GetCursor(outBlock);
+
+    return outBlock;
+
+}  // End of CompressColumns
+
+// uncompress a section of a column view. Returns 0 on error
+static int LoadSection(columnView_t *columnView, blockColumn_t *section) {
+    if (section->data) return 1;
+    if (section->stored == section->size) {
+        section->data = section->block;
+        return 1;
+    }
+
+    section->buffer = NewDataBlock();
+    if (!section->buffer) return 0;
+    int size = UncompressBuffer(columnView->compression, section->block, section->stored, GetCursor(section->buffer),
+                                BUFFSIZE - sizeof(dataBlock_t));
+    if (size < 0 || (uint32_t)size != section->size) {
+        LogError("LoadSection() corrupt columnar data block section");
+        return 0;
+    }
+    section->data = GetCursor(section->buffer);
+    return 1;
+
+}  // End of LoadSection
+
+// uncompress the column with index column of a column view. Returns NULL on error
+const uint8_t *LoadColumn(columnView_t *columnView, uint32_t column) {
+    if (column >= columnView->numColumns || !LoadSection(columnView, &columnView->columns[column])) return NULL;
+    return columnView->columns[column].data;
+}  // End of LoadColumn
+
+// check the records of the row stream and set the column bits of each record. Returns 0 for corrupt data
+static int ScanRows(columnView_t *columnView) {
+    uint8_t *rows = columnView->rows.data;
+    uint8_t *rowsEnd = rows + columnView->rows.size;
+    uint32_t columnSize[MAXCOLUMNS] = {0};
+    for (uint32_t i = 0; i < columnView->numRecords; i++) {
+        if ((rows + sizeof(recordHeader_t)) > rowsEnd) return 0;
+        recordHeader_t *recordHeader = (recordHeader_t *)rows;
+        if (recordHeader->size < sizeof(recordHeader_t)) return 0;
+
+        if (recordHeader->type != V3Record) {
+            if ((rows + recordHeader->size) > rowsEnd) return 0;
+            columnView->records[i] = 0;
+            rows += recordHeader->size;
+            continue;
+        }
+
+        recordHeaderV3_t *recordHeaderV3 = (recordHeaderV3_t *)rows;
+        if (recordHeaderV3->size < sizeof(recordHeaderV3_t) || (rows + sizeof(recordHeaderV3_t)) > rowsEnd) return 0;
+        uint32_t recordSize = sizeof(recordHeaderV3_t);
+        uint32_t elements = VIEW_V3RECORD;
+        rows += sizeof(recordHeaderV3_t);
+        for (int j = 0; j < recordHeaderV3->numElements; j++) {
+            if ((rows + sizeof(elementHeader_t)) > rowsEnd) return 0;
+            elementHeader_t *elementHeader = (elementHeader_t *)rows;
+            if (elementHeader->length < sizeof(elementHeader_t)) return 0;
+            recordSize += elementHeader->length;
+
+            int c = elementHeader->type < MAXEXTENSIONS ? columnView->columnMap[elementHeader->type] : -1;
+            if (c < 0) {
+                rows += elementHeader->length;
+                continue;
+            }
+
+            blockColumn_t *column = &columnView->columns[c];
+            uint32_t payload = elementHeader->length - sizeof(elementHeader_t);
+            if ((elements & (1U << c)) || (column->elementSize && payload != column->elementSize)) return 0;
+            elements |= 1U << c;
+            column->numElements++;
+            columnSize[c] += payload;
+            rows += sizeof(elementHeader_t);
+        }
+        if (rows > rowsEnd || recordSize > recordHeaderV3->size) return 0;
+
+        // any data behind the elements
+        rows += recordHeaderV3->size - recordSize;
+        columnView->records[i] = elements;
+    }
+    if (rows != rowsEnd) return 0;
+
+    // all column elements must be used
+    for (int c = 0; c < columnView->numColumns; c++) {
+        if (columnSize[c] != columnView->columns[c].size) return 0;
+    }
+    return 1;
+
+}  // End of ScanRows
+
+// open a column view of a type 5 block. The row stream is uncompressed, the columns
+// are uncompressed by LoadColumn(). Returns NULL for a corrupt block
+columnView_t *OpenColumnView(dataBlock_t *columnBlock) {
+    columnLayout_t *columnLayout = (columnLayout_t *)GetCursor(columnBlock);
+    size_t layoutSize = sizeof(columnLayout_t) + columnLayout->numColumns * sizeof(columnHeader_t);
+    if (columnBlock->size < sizeof(columnLayout_t) || columnLayout->numColumns > MAXCOLUMNS || layoutSize > columnBlock->size) {
+        LogError("OpenColumnView() corrupt columnar data block layout");
+        return NULL;
+    }
+
+    columnView_t *columnView = calloc(1, sizeof(columnView_t));
+    if (!columnView) {
+        LogError("malloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+        return NULL;
+    }
+    columnView->columnBlock = columnBlock;
+    columnView->compression = BLOCK_CODEC(columnBlock);
+    for (int i = 0; i < MAXEXTENSIONS; i++) columnView->columnMap[i] = -1;
+
+    // the stored sections follow the column headers
+    uint8_t *block = (uint8_t *)columnLayout + layoutSize;
+    size_t blockSize = layoutSize + columnLayout->rowStored;
+    columnView->rows = (blockColumn_t){.size = columnLayout->rowSize, .stored = columnLayout->rowStored, .block = block};
+    block += columnLayout->rowStored;
+
+    int ok = columnLayout->rowStored <= columnLayout->rowSize;
+    columnHeader_t *columnHeader = (columnHeader_t *)((void *)columnLayout + sizeof(columnLayout_t));
+    for (int c = 0; ok && c < columnLayout->numColumns; c++, columnHeader++) {
+        if (columnHeader->extID >= MAXEXTENSIONS || columnView->columnMap[columnHeader->extID] >= 0 ||
+            columnHeader->stored > columnHeader->size || (columnHeader->elementSize && (columnHeader->size % columnHeader->elementSize) != 0)) {
+            ok = 0;
+            break;
+        }
+        columnView->columnMap[columnHeader->extID] = c;
+        columnView->columns[c] = (blockColumn_t){.extID = columnHeader->extID,
+                                                 .elementSize = columnHeader->elementSize,
+                                                 .size = columnHeader->size,
+                                                 .stored = columnHeader->stored,
+                                                 .block = block};
+        blockSize += columnHeader->stored;
+        block += columnHeader->stored;
+    }
+    columnView->numColumns = columnLayout->numColumns;
+    if (!ok || blockSize != columnBlock->size) {
+        LogError("OpenColumnView() corrupt columnar data block column");
+        CloseColumnView(columnView);
+        return NULL;
+    }
+
+    // each record needs at least a record header in the uncompressed row stream
+    if (!LoadSection(columnView, &columnView->rows) || columnBlock->NumRecords > (columnView->rows.size / sizeof(recordHeader_t))) {
+        LogError("OpenColumnView() corrupt columnar data block records");
+        CloseColumnView(columnView);
+        return NULL;
+    }
+
+    columnView->records = malloc(columnBlock->NumRecords * sizeof(uint32_t));
+    if (!columnView->records) {
+        LogError("malloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+        CloseColumnView(columnView);
+        return NULL;
+    }
+    columnView->numRecords = columnBlock->NumRecords;
+    if (!ScanRows(columnView)) {
+        LogError("OpenColumnView() corrupt columnar data block records");
+        CloseColumnView(columnView);
+        return NULL;
+    }
+
+    return columnView;
+
+}  // End of OpenColumnView
+
+void CloseColumnView(columnView_t *columnView) {
+    if (!columnView) return;
+    FreeDataBlock(columnView->rows.buffer);
+    for (int c = 0; c < columnView->numColumns; c++) FreeDataBlock(columnView->columns[c].buffer);
+    free(columnView->records);
+    free(columnView);
+}  // End of CloseColumnView
+
+/*
+ * rebuild the type 3 block of a column view. If select is not NULL, only V3 records with
+ * select[i] set are restored, all other V3 records are replaced by a SkippedRecordType
+ * record, so all records keep their position in the block. Returns NULL on error
+ */
+dataBlock_t *RestoreRecords(columnView_t *columnView, const uint8_t *select) {
+    // load the columns of the restored records
+    uint32_t usedColumns = 0;
+    for (uint32_t i = 0; i < columnView->numRecords; i++) {
+        if (select == NULL || select[i]) usedColumns |= columnView->records[i];
+    }
+    for (int c = 0; c < columnView->numColumns; c++) {
+        if ((usedColumns & (1U << c)) && !LoadColumn(columnView, c)) return NULL;
+    }
+
+    dataBlock_t *rowBlock = NewDataBlock();
+    if (!rowBlock) return NULL;
+
+    // ScanRows() checked the row stream and the columns - only the output needs checking
+    uint32_t index[MAXCOLUMNS] = {0};
+    uint32_t offset[MAXCOLUMNS] = {0};
+    uint8_t *rows = columnView->rows.data;
+    uint8_t *out = (uint8_t *)GetCursor(rowBlock);
+    uint8_t *outEnd = out + (BUFFSIZE - sizeof(dataBlock_t));
+    for (uint32_t i = 0; i < columnView->numRecords; i++) {
+        recordHeader_t *recordHeader = (recordHeader_t *)rows;
+        int restore = select == NULL || select[i] || recordHeader->type != V3Record;
+        if ((out + (restore ? recordHeader->size : sizeof(recordHeader_t))) > outEnd) {
+            FreeDataBlock(rowBlock);
+            return NULL;
+        }
+
+        if (recordHeader->type != V3Record) {
+            memcpy(out, rows, recordHeader->size);
+            out += recordHeader->size;
+            rows += recordHeader->size;
+            continue;
+        }
+
+        // rebuild the record at out, size is the current size of the rebuilt record
+        recordHeaderV3_t *recordHeaderV3 = (recordHeaderV3_t *)rows;
+        if (restore) memcpy(out, rows, sizeof(recordHeaderV3_t));
+        uint32_t size = sizeof(recordHeaderV3_t);
+        rows += sizeof(recordHeaderV3_t);
+        for (int j = 0; j < recordHeaderV3->numElements; j++) {
+            elementHeader_t *elementHeader = (elementHeader_t *)rows;
+            uint32_t length = elementHeader->length;
+            int c = elementHeader->type < MAXEXTENSIONS ? columnView->columnMap[elementHeader->type] : -1;
+            if (c < 0) {
+                if (restore) memcpy(out + size, rows, length);
+                size += length;
+                rows += length;
+                continue;
+            }
+
+            blockColumn_t *column = &columnView->columns[c];
+            uint32_t payload = length - sizeof(elementHeader_t);
+            if (restore) {
+                memcpy(out + size, rows, sizeof(elementHeader_t));
+                uint8_t *element = out + size + sizeof(elementHeader_t);
+                if (column->elementSize) {
+                    uint8_t *in = column->data + index[c];
+                    for (uint32_t b = 0; b < payload; b++) element[b] = in[b * column->numElements];
+                } else {
+                    memcpy(element, column->data + offset[c], payload);
+                }
+            }
+            index[c]++;
+            offset[c] += payload;
+            size += length;
+            rows += sizeof(elementHeader_t);
+        }
+
+        // any data behind the elements
+        size_t trailing = recordHeaderV3->size - size;
+        if (restore) memcpy(out + size, rows, trailing);
+        rows += trailing;
+
+        if (restore) {
+            out += recordHeaderV3->size;
+        } else {
+            // a placeholder keeps the position of the record
+            recordHeader_t *skipped = (recordHeader_t *)out;
+            skipped->type = SkippedRecordType;
+            skipped->size = sizeof(recordHeader_t);
+            out += sizeof(recordHeader_t);
+        }
+    }
+
+    rowBlock->type = DATA_BLOCK_TYPE_3;
+    rowBlock->flags = columnView->columnBlock->flags;
+    ClearBlockCodec(rowBlock);
+    rowBlock->NumRecords = columnView->numRecords;
+    rowBlock->size = out - (uint8_t *)GetCursor(rowBlock);
+
+    return rowBlock;
+
+}  // End of RestoreRecords
+
+// restore the type 3 block of a columnar type 5 block. Returns NULL for a corrupt block
+dataBlock_t *RowBlock(dataBlock_t *columnBlock) {
+    columnView_t *columnView = OpenColumnView(columnBlock);
+    if (!columnView) return NULL;
+
+    dataBlock_t *rowBlock = RestoreRecords(columnView, NULL);
+    CloseColumnView(columnView);
+    return rowBlock;
+
+}  // End of RowBlock
@@ -0,0 +1,78 @@
+/*
+ *  Copyright (c) 2024, Peter Haag
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *   * Neither the name of the author nor the names of its contributors may be
+ *     used to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _COLUMNBLOCK_H
+#define _COLUMNBLOCK_H 1
+
+#include <stdint.h>
+
+#include "nffileV2.h"
+#include "nfxV3.h"
+
+// row stream or column of a columnar block
+typedef struct blockColumn_s {
+    uint16_t extID;        // extension stored in this column
+    uint16_t elementSize;  // payload size of all elements, 0 if sizes differ - no byte planes
+    uint32_t numElements;  // number of elements
+    uint32_t size;         // uncompressed size
+    uint32_t stored;       // stored size in the block
+    uint8_t *block;        // stored data in the block
+    uint8_t *data;         // uncompressed data, NULL until loaded
+    dataBlock_t *buffer;   // buffer of the uncompressed data, if stored compressed
+} blockColumn_t;
+
+// view of a type 5 block. Columns are uncompressed on demand by LoadColumn()
+typedef struct columnView_s {
+    dataBlock_t *columnBlock;  // viewed type 5 block
+    int compression;           // codec of the row stream and the columns
+    uint32_t numRecords;       // number of records
+    uint32_t *records;         // per record: VIEW_V3RECORD and bit c set, if the record has an element in column c
+#define VIEW_V3RECORD 0x80000000
+    blockColumn_t rows;        // row stream
+    uint32_t numColumns;       // number of columns
+    blockColumn_t columns[MAXCOLUMNS];
+    int8_t columnMap[MAXEXTENSIONS];  // column of an extension, -1 if not stored in a column
+} columnView_t;
+
+dataBlock_t *ColumnBlock(dataBlock_t *rowBlock);
+
+dataBlock_t *CompressColumns(dataBlock_t *columnBlock, int compression, int level);
+
+columnView_t *OpenColumnView(dataBlock_t *columnBlock);
+
+const uint8_t *LoadColumn(columnView_t *columnView, uint32_t column);
+
+dataBlock_t *RestoreRecords(columnView_t *columnView, const uint8_t *select);
+
+void CloseColumnView(columnView_t *columnView);
+
+dataBlock_t *RowBlock(dataBlock_t *columnBlock);
+
+#endif
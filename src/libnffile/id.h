@@ -62,6 +62,9 @@
 
 #define MaxRecordID 15
 
+// placeholder of a record of a columnar block, which was not restored - memory only
+#define SkippedRecordType 16
+
 // array record types
 // maxmind
 #define LocalInfoElementID 1
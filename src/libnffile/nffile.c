@@ -42,6 +42,7 @@
 #endif
 
 #ifdef HAVE_ZSTD
+#include <zdict.h>
 #include <zstd.h>
 #endif
 
@@ -62,6 +63,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/param.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
@@ -76,7 +78,9 @@
 #include "lz4hc.h"
 #endif
 #include "barrier.h"
+#include "columnblock.h"
 #include "minilzo.h"
+#include "nfconf.h"
 #include "nfdump.h"
 #include "nffileV2.h"
 #include "util.h"
@@ -98,6 +102,30 @@ static const char *nf_creator[MAX_CREATOR] = {"unknown", "nfcapd",    "nfpcapd",
 
 static unsigned NumWorkers = DEFAULTWORKERS;
 
+// ZSTD dictionary of a file
+#define MAXCDICTLEVEL 22  // ZSTD_maxCLevel() - higher levels load the dictionary for each block
+typedef struct zstdDict_s {
+    void *dict;         // dictionary content
+    uint32_t size;      // size of the dictionary
+    uint32_t received;  // bytes received from appendix records while reading
+#ifdef HAVE_ZSTD
+    pthread_mutex_t cdictMutex;            // protects cdict
+    ZSTD_CDict *cdict[MAXCDICTLEVEL + 1];  // prepared dictionaries for compression by level
+    ZSTD_DDict *ddict;                     // prepared dictionary for decompression
+#endif
+} zstdDict_t;
+
+#ifdef HAVE_ZSTD
+// dictionary for new ZSTD compressed files - configured by zstd.dict
+static void *confDict = NULL;
+static size_t confDictSize = 0;
+
+// compression contexts are reused per thread and freed on thread exit
+static pthread_once_t zstdKeyOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t zstdCCtxKey;
+static pthread_key_t zstdDCtxKey;
+#endif
+
 /* function prototypes */
 static int LZO_initialize(void);
 
@@ -117,15 +145,23 @@ static int Uncompress_Block_LZ4(dataBlock_t *in_block, dataBlock_t *out_block, s
 
 static int Compress_Block_BZ2(dataBlock_t *in_block, dataBlock_t *out_block, size_t block_size);
 
-static int Compress_Block_ZSTD(dataBlock_t *in_block, dataBlock_t *out_block, size_t block_size, int level);
+static int Compress_Block_ZSTD(dataBlock_t *in_block, dataBlock_t *out_block, size_t block_size, int level, zstdDict_t *zstdDict);
+
+static int Uncompress_Block_ZSTD(dataBlock_t *in_block, dataBlock_t *out_block, size_t block_size, zstdDict_t *zstdDict);
 
-static int Uncompress_Block_ZSTD(dataBlock_t *in_block, dataBlock_t *out_block, size_t block_size);
+static void FreeZstdDict(zstdDict_t *zstdDict);
 
 static int Uncompress_Block_BZ2(dataBlock_t *in_block, dataBlock_t *out_block, size_t block_size);
 
 static dataBlock_t *nfread(nffile_t *nffile);
 
-static int nfwrite(nffile_t *nffile, dataBlock_t *block_header);
+static dataBlock_t *nfreadRaw(nffile_t *nffile, fileMap_t **fileMap);
+
+static dataBlock_t *nfuncompress(nffile_t *nffile, dataBlock_t *buff, fileMap_t *fileMap);
+
+static int nfwrite(nffile_t *nffile, dataBlock_t *block_header, blockIndex_t *blockIndex);
+
+static int LaunchWriters(nffile_t *nffile, unsigned numWriters);
 
 static int ReadAppendix(nffile_t *nffile);
 
@@ -133,6 +169,8 @@ static int WriteAppendix(nffile_t *nffile);
 
 static int SignalTerminate(nffile_t *nffile);
 
+static int LaunchParallelReader(nffile_t *nffile, unsigned numUncompressors);
+
 static void FlushFile(nffile_t *nffile);
 
 static int QueryFileV1(int fd, fileHeaderV2_t *fileHeaderV2);
@@ -141,12 +179,87 @@ static void UpdateStat(stat_record_t *s, stat_recordV1_t *sv1);
 
 static queue_t *fileQueue = NULL;
 
+static blockFilter_t blockFilter = NULL;
+
+// write data blocks of new files in columnar layout
+static int columnBlocks = 0;
+
+// return columnar data blocks of files opened by GetNextFile() without restoring the records
+static int columnRead = 0;
+
 /* function definitions */
 
 #define QueueSize 4
 
+// adaptive compression
+#define SMALLBLOCKSIZE 4096  // blocks below this size are always LZ4 compressed
+#define POORRATIO 900        // compressed/raw size in 1/1000 - use LZ4 if above
+
+// ZSTD dictionary training
+#define DICTSIZE (110 * 1024)  // default dictionary size
+#define DICTSAMPLESIZE 4096    // size of a training sample
+#define DICTBLOCKSAMPLES 16    // max number of samples, taken from each data block
+#define DICTMAXSAMPLES 100     // sample up to DICTMAXSAMPLES times the dictionary size
+
+// parallel reader job - one data block in file order
+typedef struct readJob_s {
+    dataBlock_t *dataBlock;
+    fileMap_t *fileMap;  // mapping of a raw block, NULL for an allocated block
+    int done;
+} readJob_t;
+
+// ordered writer slot - one compressed data block in sequence order
+typedef struct writeSlot_s {
+    dataBlock_t *dataBlock;   // uncompressed block
+    dataBlock_t *buff;        // compressed block or NULL, if not compressed
+    blockIndex_t blockIndex;  // summary of the block
+    int state;
+#define SLOT_EMPTY 0
+#define SLOT_READY 1
+#define SLOT_FAILED 2
+} writeSlot_t;
+
+// max blocks written with one writev()
+#define MAXWRITEBATCH 16
+
 static _Atomic unsigned blocksInUse;
 
+/*
+ * data block pool
+ * Freed data blocks are kept in a free list and recycled by NewDataBlock() instead of
+ * returning BUFFSIZE bytes to malloc for each block. The list is linked through the
+ * block memory itself and never holds more than maxPoolBlocks blocks.
+ * Optionally blocks are allocated 2MB aligned and backed by transparent huge pages.
+ */
+#define DEFAULTPOOLBLOCKS 32
+#define HUGEPAGESIZE (2 * 1024 * 1024)
+
+typedef struct poolBlock_s {
+    struct poolBlock_s *next;
+} poolBlock_t;
+
+static pthread_mutex_t blockPoolMutex = PTHREAD_MUTEX_INITIALIZER;
+static poolBlock_t *blockPool = NULL;
+static unsigned numPoolBlocks = 0;
+static unsigned maxPoolBlocks = DEFAULTPOOLBLOCKS;
+static int useHugePages = 0;
+static _Atomic unsigned blocksPeak;
+static _Atomic uint64_t poolHits;
+static _Atomic uint64_t poolMisses;
+
+/*
+ * memory mapped files
+ * Raw data blocks read from a mapped file point into the read only mapping. They are
+ * uncompressed from the mapping into a data block or copied, if not compressed, so
+ * processing never writes to the mapping. Each raw block holds a reference to the
+ * mapping as well as the open file. The mapping is released with the last reference.
+ */
+struct fileMap_s {
+    void *base;
+    size_t size;
+    _Atomic uint32_t refCount;
+};
+
 int Init_nffile(int workers, queue_t *fileList) {
     fileQueue = fileList;
     if (!LZO_initialize()) {
@@ -167,6 +280,17 @@ int Init_nffile(int workers, queue_t *fileList) {
     }
 
     atomic_init(&blocksInUse, 0);
+    atomic_init(&blocksPeak, 0);
+    atomic_init(&poolHits, 0);
+    atomic_init(&poolMisses, 0);
+
+    // a configured pool size of -1 disables the pool
+    int confPoolBlocks = ConfGetValue("blockpool");
+    if (confPoolBlocks < 0)
+        maxPoolBlocks = 0;
+    else if (confPoolBlocks > 0)
+        maxPoolBlocks = confPoolBlocks;
+    useHugePages = ConfGetValue("hugepages");
 
     NumWorkers = GetNumWorkers(workers);
     return 1;
@@ -241,6 +365,21 @@ int ParseCompression(char *arg) {
     }
 #endif
 
+    // adaptive: the level applies to the strong codec, used if the writers are idle
+    if (strcmp(arg, "auto") == 0 || strcmp(arg, "5") == 0) {
+#ifdef HAVE_ZSTD
+        int maxLevel = ZSTD_maxCLevel();
+#else
+        int maxLevel = LZ4HC_CLEVEL_MAX;
+#endif
+        if (level <= maxLevel) {
+            return (level << 16) | ADAPTIVE_COMPRESSED;
+        } else {
+            LogError("Adaptive max compression level is %d", maxLevel);
+            return -1;
+        }
+    }
+
     // anything else is invalid
     return -1;
 
@@ -251,6 +390,12 @@ unsigned ReportBlocks(void) {
     return inUse;
 }
 
+void ReportBlockPool(uint64_t *hits, uint64_t *misses, unsigned *peak) {
+    *hits = atomic_load(&poolHits);
+    *misses = atomic_load(&poolMisses);
+    *peak = atomic_load(&blocksPeak);
+}  // End of ReportBlockPool
+
 static int LZO_initialize(void) {
     if (lzo_init() != LZO_E_OK) {
         // this usually indicates a compiler bug - try recompiling
@@ -275,6 +420,73 @@ static int LZ4_initialize(void) {
 
 static int BZ2_initialize(void) { return 1; }  // End of BZ2_initialize
 
+#ifdef HAVE_ZSTD
+static void FreeCCtx(void *cctx) { ZSTD_freeCCtx((ZSTD_CCtx *)cctx); }  // End of FreeCCtx
+
+static void FreeDCtx(void *dctx) { ZSTD_freeDCtx((ZSTD_DCtx *)dctx); }  // End of FreeDCtx
+
+static void CreateZstdKeys(void) {
+    pthread_key_create(&zstdCCtxKey, FreeCCtx);
+    pthread_key_create(&zstdDCtxKey, FreeDCtx);
+}  // End of CreateZstdKeys
+
+// return the compression context of the calling thread
+static ZSTD_CCtx *GetCCtx(void) {
+    ZSTD_CCtx *cctx = pthread_getspecific(zstdCCtxKey);
+    if (cctx == NULL) {
+        cctx = ZSTD_createCCtx();
+        if (cctx) pthread_setspecific(zstdCCtxKey, cctx);
+    }
+    return cctx;
+}  // End of GetCCtx
+
+// return the decompression context of the calling thread
+static ZSTD_DCtx *GetDCtx(void) {
+    ZSTD_DCtx *dctx = pthread_getspecific(zstdDCtxKey);
+    if (dctx == NULL) {
+        dctx = ZSTD_createDCtx();
+        if (dctx) pthread_setspecific(zstdDCtxKey, dctx);
+    }
+    return dctx;
+}  // End of GetDCtx
+
+// load the dictionary for new ZSTD compressed files
+static int LoadZstdDict(char *dictFile) {
+    struct stat stat_buf;
+    if (stat(dictFile, &stat_buf) < 0) {
+        LogError("stat() dictionary %s: %s", dictFile, strerror(errno));
+        return 0;
+    }
+
+    int fd = open(dictFile, O_RDONLY);
+    if (fd < 0) {
+        LogError("open() dictionary %s: %s", dictFile, strerror(errno));
+        return 0;
+    }
+
+    void *dict = malloc(stat_buf.st_size);
+    if (!dict) {
+        LogError("malloc() allocation error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+        close(fd);
+        return 0;
+    }
+
+    ssize_t ret = read(fd, dict, stat_buf.st_size);
+    close(fd);
+    if (ret != stat_buf.st_size || ZDICT_getDictID(dict, stat_buf.st_size) == 0) {
+        LogError("File %s is not a valid ZSTD dictionary", dictFile);
+        free(dict);
+        return 0;
+    }
+
+    confDict = dict;
+    confDictSize = stat_buf.st_size;
+    LogVerbose("Loaded ZSTD dictionary %s, id: %u, size: %zu", dictFile, ZDICT_getDictID(dict, confDictSize), confDictSize);
+    return 1;
+
+}  // End of LoadZstdDict
+#endif
+
 static int ZSTD_initialize(void) {
 #ifdef HAVE_ZSTD
     size_t const cBuffSize = ZSTD_compressBound(WRITE_BUFFSIZE);
@@ -282,78 +494,68 @@ static int ZSTD_initialize(void) {
         LogError("LZSTD_compressBound() error in %s line %d: Buffer too small", __FILE__, __LINE__);
         return 0;
     }
+    pthread_once(&zstdKeyOnce, CreateZstdKeys);
+
+    // Init_nffile() may be called more than once
+    if (confDict == NULL) {
+        char *dictFile = ConfGetString("zstd.dict");
+        if (dictFile) {
+            int ok = LoadZstdDict(dictFile);
+            free(dictFile);
+            if (!ok) return 0;
+        }
+    }
     return 1;
 #else
     return 1;
 #endif
 }  // End of ZSTD_initialize
 
-static int Compress_Block_LZO(dataBlock_t *in_block, dataBlock_t *out_block, size_t block_size) {
-    unsigned char __LZO_MMODEL *in;
-    unsigned char __LZO_MMODEL *out;
-    int r;
-
-    in = (unsigned char __LZO_MMODEL *)((void *)in_block + sizeof(dataBlock_t));
-    out = (unsigned char __LZO_MMODEL *)((void *)out_block + sizeof(dataBlock_t));
-    lzo_uint in_len = in_block->size;
+static int Compress_LZO(const void *in_buff, uint32_t in_len, void *out_buff, uint32_t out_size) {
+    const unsigned char __LZO_MMODEL *in = (const unsigned char __LZO_MMODEL *)in_buff;
+    unsigned char __LZO_MMODEL *out = (unsigned char __LZO_MMODEL *)out_buff;
     lzo_uint out_len = 0;
 
     HEAP_ALLOC(wrkmem, LZO1X_1_MEM_COMPRESS);
-    r = lzo1x_1_compress(in, in_len, out, &out_len, wrkmem);
+    int r = lzo1x_1_compress(in, in_len, out, &out_len, wrkmem);
 
     if (r != LZO_E_OK) {
         LogError("Compress_Block_LZO() error compression failed in %s line %d: LZ4 : %d", __FILE__, __LINE__, r);
         return -1;
     }
 
-    // copy header
-    *out_block = *in_block;
-    out_block->size = out_len;
-
-    return 1;
+    return out_len;
 
-}  // End of Compress_Block_LZO
+}  // End of Compress_LZO
 
-static int Uncompress_Block_LZO(dataBlock_t *in_block, dataBlock_t *out_block, size_t block_size) {
-    unsigned char __LZO_MMODEL *in;
-    unsigned char __LZO_MMODEL *out;
-    lzo_uint in_len;
-    lzo_uint out_len;
-    int r;
-
-    in = (unsigned char __LZO_MMODEL *)((void *)in_block + sizeof(dataBlock_t));
-    out = (unsigned char __LZO_MMODEL *)((void *)out_block + sizeof(dataBlock_t));
-    in_len = in_block->size;
-    out_len = block_size;
+static int Uncompress_LZO(const void *in_buff, uint32_t in_len, void *out_buff, uint32_t out_size) {
+    const unsigned char __LZO_MMODEL *in = (const unsigned char __LZO_MMODEL *)in_buff;
+    unsigned char __LZO_MMODEL *out = (unsigned char __LZO_MMODEL *)out_buff;
+    lzo_uint out_len = out_size;
 
     if (in_len == 0) {
         LogError("Uncompress_Block_LZO() header length error in %s line %d", __FILE__, __LINE__);
         return -1;
     }
-    r = lzo1x_decompress_safe(in, in_len, out, &out_len, NULL);
+    int r = lzo1x_decompress_safe(in, in_len, out, &out_len, NULL);
     if (r != LZO_E_OK) {
         LogError("Uncompress_Block_LZO() error decompression failed in %s line %d: LZO error: %d", __FILE__, __LINE__, r);
         return -1;
     }
 
-    // copy header
-    *out_block = *in_block;
-    out_block->size = out_len;
-
-    return 1;
+    return out_len;
 
-}  // End of Uncompress_Block_LZO
+}  // End of Uncompress_LZO
 
-static int Compress_Block_LZ4(dataBlock_t *in_block, dataBlock_t *out_block, size_t block_size, int level) {
-    const char *in = (const char *)((void *)in_block + sizeof(dataBlock_t));
-    char *out = (char *)((void *)out_block + sizeof(dataBlock_t));
-    int in_len = in_block->size;
+static int Compress_LZ4(const void *in_buff, uint32_t in_len, void *out_buff, uint32_t out_size, int level) {
+    const char *in = (const char *)in_buff;
+    char *out = (char *)out_buff;
 
     int out_len;
     if (level > LZ4HC_CLEVEL_MIN)
-        out_len = LZ4_compress_HC(in, out, in_len, block_size, level);
+        out_len = LZ4_compress_HC(in, out, in_len, out_size, level);
     else
-        out_len = LZ4_compress_default(in, out, in_len, block_size);
+        out_len = LZ4_compress_default(in, out, in_len, out_size);
 
     if (out_len == 0) {
         LogError("Compress_Block_LZ4() error compression aborted in %s line %d: LZ4 : buffer too small", __FILE__, __LINE__);
@@ -364,20 +566,15 @@ static int Compress_Block_LZ4(dataBlock_t *in_block, dataBlock_t *out_block, siz
         return -1;
     }
 
-    // copy header
-    *out_block = *in_block;
-    out_block->size = out_len;
-
-    return 1;
+    return out_len;
 
-}  // End of Compress_Block_LZ4
+}  // End of Compress_LZ4
 
-static int Uncompress_Block_LZ4(dataBlock_t *in_block, dataBlock_t *out_block, size_t block_size) {
-    const char *in = (const char *)((void *)in_block + sizeof(dataBlock_t));
-    char *out = (char *)((void *)out_block + sizeof(dataBlock_t));
-    int in_len = in_block->size;
+static int Uncompress_LZ4(const void *in_buff, uint32_t in_len, void *out_buff, uint32_t out_size) {
+    const char *in = (const char *)in_buff;
+    char *out = (char *)out_buff;
 
-    int out_len = LZ4_decompress_safe(in, out, in_len, block_size);
+    int out_len = LZ4_decompress_safe(in, out, in_len, out_size);
     if (out_len == 0) {
         LogError("LZ4_decompress_safe() error compression aborted in %s line %d: LZ4 : buffer too small", __FILE__, __LINE__);
         return -1;
@@ -387,57 +584,51 @@ static int Uncompress_Block_LZ4(dataBlock_t *in_block, dataBlock_t *out_block, s
         return -1;
     }
 
-    // copy header
-    *out_block = *in_block;
-    out_block->size = out_len;
+    return out_len;
 
-    return 1;
-
-}  // End of Uncompress_Block_LZ4
+}  // End of Uncompress_LZ4
 
-static int Compress_Block_BZ2(dataBlock_t *in_block, dataBlock_t *out_block, size_t block_size) {
+static int Compress_BZ2(const void *in_buff, uint32_t in_len, void *out_buff, uint32_t out_size) {
 #ifdef HAVE_BZIP2
     bz_stream bs = {0};
 
     BZ2_bzCompressInit(&bs, 9, 0, 0);
 
-    bs.next_in = (char *)((void *)in_block + sizeof(dataBlock_t));
-    bs.next_out = (char *)((void *)out_block + sizeof(dataBlock_t));
-    bs.avail_in = in_block->size;
-    bs.avail_out = block_size;
+    bs.next_in = (char *)in_buff;
+    bs.next_out = (char *)out_buff;
+    bs.avail_in = in_len;
+    bs.avail_out = out_size;
 
     for (;;) {
         int r = BZ2_bzCompress(&bs, BZ_FINISH);
         if (r == BZ_FINISH_OK) continue;
         if (r != BZ_STREAM_END) {
             LogError("Compress_Block_BZ2() error compression failed in %s line %d: LZ4 : %d", __FILE__, __LINE__, r);
+            BZ2_bzCompressEnd(&bs);
             return -1;
         }
         break;
     }
 
-    // copy header
-    *out_block = *in_block;
-    out_block->size = bs.total_out_lo32;
-
+    int out_len = bs.total_out_lo32;
     BZ2_bzCompressEnd(&bs);
 
-    return 1;
+    return out_len;
 #else
-    return 0;
+    return -1;
 #endif
-}  // End of Compress_Block_BZ2
+}  // End of Compress_BZ2
 
-static int Uncompress_Block_BZ2(dataBlock_t *in_block, dataBlock_t *out_block, size_t block_size) {
+static int Uncompress_BZ2(const void *in_buff, uint32_t in_len, void *out_buff, uint32_t out_size) {
 #ifdef HAVE_BZIP2
     bz_stream bs = {0};
 
     BZ2_bzDecompressInit(&bs, 0, 0);
 
-    bs.next_in = (char *)((void *)in_block + sizeof(dataBlock_t));
-    bs.next_out = (char *)((void *)out_block + sizeof(dataBlock_t));
-    bs.avail_in = in_block->size;
-    bs.avail_out = block_size;
+    bs.next_in = (char *)in_buff;
+    bs.next_out = (char *)out_buff;
+    bs.avail_in = in_len;
+    bs.avail_out = out_size;
 
     for (;;) {
         int r = BZ2_bzDecompress(&bs);
@@ -451,85 +642,434 @@ static int Uncompress_Block_BZ2(dataBlock_t *in_block, dataBlock_t *out_block, s
         }
     }
 
-    // copy header
-    *out_block = *in_block;
-    out_block->size = bs.total_out_lo32;
-
+    int out_len = bs.total_out_lo32;
     BZ2_bzDecompressEnd(&bs);
 
-    return 1;
+    return out_len;
 #else
-    return 0;
+    return -1;
 #endif
 
-}  // End of Uncompress_Block_BZ2
+}  // End of Uncompress_BZ2
 
-static int Compress_Block_ZSTD(dataBlock_t *in_block, dataBlock_t *out_block, size_t block_size, int level) {
 #ifdef HAVE_ZSTD
-    const char *in = (const char *)((void *)in_block + sizeof(dataBlock_t));
-    char *out = (char *)((void *)out_block + sizeof(dataBlock_t));
-    int in_len = in_block->size;
+// return the prepared dictionary for level. A level is prepared with its first block
+static ZSTD_CDict *GetCDict(zstdDict_t *zstdDict, int level) {
+    if (level < 1 || level > MAXCDICTLEVEL) return NULL;
+
+    pthread_mutex_lock(&zstdDict->cdictMutex);
+    if (zstdDict->cdict[level] == NULL) zstdDict->cdict[level] = ZSTD_createCDict(zstdDict->dict, zstdDict->size, level);
+    ZSTD_CDict *cdict = zstdDict->cdict[level];
+    pthread_mutex_unlock(&zstdDict->cdictMutex);
+
+    return cdict;
+
+}  // End of GetCDict
+#endif
+
+static int Compress_ZSTD(const void *in, uint32_t in_len, void *out, uint32_t out_size, int level, zstdDict_t *zstdDict) {
+#ifdef HAVE_ZSTD
+    ZSTD_CCtx *cctx = GetCCtx();
+    if (!cctx) {
+        LogError("ZSTD_createCCtx() error in %s line %d", __FILE__, __LINE__);
+        return -1;
+    }
 
     if (level == 0) level = ZSTD_CLEVEL_DEFAULT;
-    int out_len = ZSTD_compress(out, block_size, in, in_len, level);
+    size_t out_len;
+    ZSTD_CDict *cdict = zstdDict ? GetCDict(zstdDict, level) : NULL;
+    if (cdict)
+        out_len = ZSTD_compress_usingCDict(cctx, out, out_size, in, in_len, cdict);
+    else if (zstdDict)
+        // no prepared dictionary for this level - load the dictionary
+        out_len = ZSTD_compress_usingDict(cctx, out, out_size, in, in_len, zstdDict->dict, zstdDict->size, level);
+    else
+        out_len = ZSTD_compressCCtx(cctx, out, out_size, in, in_len, level);
 
     if (ZSTD_isError(out_len)) {
         LogError("Compress_Block_ZSTD() error compression aborted in %s line %d: LZ4 : buffer too small", __FILE__, __LINE__);
         return -1;
     }
 
-    // copy header
-    *out_block = *in_block;
-    out_block->size = out_len;
-
-    return 1;
+    return out_len;
 #else
-    return 0;
+    return -1;
 #endif
 
-}  // End of Compress_Block_ZSTD
+}  // End of Compress_ZSTD
 
-static int Uncompress_Block_ZSTD(dataBlock_t *in_block, dataBlock_t *out_block, size_t block_size) {
+static int Uncompress_ZSTD(const void *in, uint32_t in_len, void *out, uint32_t out_size, zstdDict_t *zstdDict) {
 #ifdef HAVE_ZSTD
-    const char *in = (const char *)((void *)in_block + sizeof(dataBlock_t));
-    char *out = (char *)((void *)out_block + sizeof(dataBlock_t));
-    int in_len = in_block->size;
+    ZSTD_DCtx *dctx = GetDCtx();
+    if (!dctx) {
+        LogError("ZSTD_createDCtx() error in %s line %d", __FILE__, __LINE__);
+        return -1;
+    }
 
-    size_t out_len = ZSTD_decompress(out, block_size, in, in_len);
+    // only frames compressed with a dictionary carry a dictionary ID
+    size_t out_len;
+    if (zstdDict && zstdDict->ddict && ZSTD_getDictID_fromFrame(in, in_len) != 0)
+        out_len = ZSTD_decompress_usingDDict(dctx, out, out_size, in, in_len, zstdDict->ddict);
+    else
+        out_len = ZSTD_decompressDCtx(dctx, out, out_size, in, in_len);
     if (ZSTD_isError(out_len)) {
         LogError("LZ4_decompress_safe() error compression aborted in %s line %d: LZ4 : buffer too small", __FILE__, __LINE__);
         return -1;
     }
 
+    return out_len;
+#else
+    return -1;
+#endif
+}  // End of Uncompress_ZSTD
+
+static int Compress_Block_LZO(dataBlock_t *in_block, dataBlock_t *out_block, size_t block_size) {
+    int out_len = Compress_LZO(GetCursor(in_block), in_block->size, GetCursor(out_block), block_size);
+    if (out_len < 0) return -1;
+
     // copy header
     *out_block = *in_block;
     out_block->size = out_len;
 
     return 1;
-#else
-    return 0;
-#endif
+
+}  // End of Compress_Block_LZO
+
+static int Uncompress_Block_LZO(dataBlock_t *in_block, dataBlock_t *out_block, size_t block_size) {
+    int out_len = Uncompress_LZO(GetCursor(in_block), in_block->size, GetCursor(out_block), block_size);
+    if (out_len < 0) return -1;
+
+    // copy header
+    *out_block = *in_block;
+    out_block->size = out_len;
+
+    return 1;
+
+}  // End of Uncompress_Block_LZO
+
+static int Compress_Block_LZ4(dataBlock_t *in_block, dataBlock_t *out_block, size_t block_size, int level) {
+    int out_len = Compress_LZ4(GetCursor(in_block), in_block->size, GetCursor(out_block), block_size, level);
+    if (out_len < 0) return -1;
+
+    // copy header
+    *out_block = *in_block;
+    out_block->size = out_len;
+
+    return 1;
+
+}  // End of Compress_Block_LZ4
+
+static int Uncompress_Block_LZ4(dataBlock_t *in_block, dataBlock_t *out_block, size_t block_size) {
+    int out_len = Uncompress_LZ4(GetCursor(in_block), in_block->size, GetCursor(out_block), block_size);
+    if (out_len < 0) return -1;
+
+    // copy header
+    *out_block = *in_block;
+    out_block->size = out_len;
+
+    return 1;
+
+}  // End of Uncompress_Block_LZ4
+
+static int Compress_Block_BZ2(dataBlock_t *in_block, dataBlock_t *out_block, size_t block_size) {
+    int out_len = Compress_BZ2(GetCursor(in_block), in_block->size, GetCursor(out_block), block_size);
+    if (out_len < 0) return -1;
+
+    // copy header
+    *out_block = *in_block;
+    out_block->size = out_len;
+
+    return 1;
+
+}  // End of Compress_Block_BZ2
+
+static int Uncompress_Block_BZ2(dataBlock_t *in_block, dataBlock_t *out_block, size_t block_size) {
+    int out_len = Uncompress_BZ2(GetCursor(in_block), in_block->size, GetCursor(out_block), block_size);
+    if (out_len < 0) return -1;
+
+    // copy header
+    *out_block = *in_block;
+    out_block->size = out_len;
+
+    return 1;
+
+}  // End of Uncompress_Block_BZ2
+
+static int Compress_Block_ZSTD(dataBlock_t *in_block, dataBlock_t *out_block, size_t block_size, int level, zstdDict_t *zstdDict) {
+    int out_len = Compress_ZSTD(GetCursor(in_block), in_block->size, GetCursor(out_block), block_size, level, zstdDict);
+    if (out_len < 0) return -1;
+
+    // copy header
+    *out_block = *in_block;
+    out_block->size = out_len;
+
+    return 1;
+
+}  // End of Compress_Block_ZSTD
+
+static int Uncompress_Block_ZSTD(dataBlock_t *in_block, dataBlock_t *out_block, size_t block_size, zstdDict_t *zstdDict) {
+    int out_len = Uncompress_ZSTD(GetCursor(in_block), in_block->size, GetCursor(out_block), block_size, zstdDict);
+    if (out_len < 0) return -1;
+
+    // copy header
+    *out_block = *in_block;
+    out_block->size = out_len;
+
+    return 1;
+
 }  // End of Uncompress_Block_ZSTD
 
-dataBlock_t *NewDataBlock(void) {
-    dataBlock_t *dataBlock = malloc(BUFFSIZE);
-    if (!dataBlock) {
-        LogError("malloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+// compress a buffer with codec compression. Returns the compressed size or -1 on error
+int CompressBuffer(int compression, int level, const void *in, uint32_t in_len, void *out, uint32_t out_size) {
+    switch (compression) {
+        case LZO_COMPRESSED:
+            return Compress_LZO(in, in_len, out, out_size);
+        case LZ4_COMPRESSED:
+            return Compress_LZ4(in, in_len, out, out_size, level);
+        case BZ2_COMPRESSED:
+            return Compress_BZ2(in, in_len, out, out_size);
+        case ZSTD_COMPRESSED:
+            return Compress_ZSTD(in, in_len, out, out_size, level, NULL);
+    }
+    LogError("Unknown compression ID: %d", compression);
+    return -1;
+
+}  // End of CompressBuffer
+
+// uncompress a buffer with codec compression. Returns the uncompressed size or -1 on error
+int UncompressBuffer(int compression, const void *in, uint32_t in_len, void *out, uint32_t out_size) {
+    switch (compression) {
+        case LZO_COMPRESSED:
+            return Uncompress_LZO(in, in_len, out, out_size);
+        case LZ4_COMPRESSED:
+            return Uncompress_LZ4(in, in_len, out, out_size);
+        case BZ2_COMPRESSED:
+            return Uncompress_BZ2(in, in_len, out, out_size);
+        case ZSTD_COMPRESSED:
+            return Uncompress_ZSTD(in, in_len, out, out_size, NULL);
+    }
+    LogError("Unknown compression ID: %d", compression);
+    return -1;
+
+}  // End of UncompressBuffer
+
+static zstdDict_t *NewZstdDict(uint32_t size) {
+    zstdDict_t *zstdDict = calloc(1, sizeof(zstdDict_t));
+    if (!zstdDict) {
+        LogError("calloc() allocation error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+        return NULL;
+    }
+    zstdDict->dict = malloc(size);
+    if (!zstdDict->dict) {
+        LogError("malloc() allocation error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+        free(zstdDict);
         return NULL;
     }
+    zstdDict->size = size;
+#ifdef HAVE_ZSTD
+    pthread_mutex_init(&zstdDict->cdictMutex, NULL);
+#endif
+
+    return zstdDict;
+
+}  // End of NewZstdDict
+
+static void FreeZstdDict(zstdDict_t *zstdDict) {
+    if (!zstdDict) return;
+#ifdef HAVE_ZSTD
+    for (int level = 0; level <= MAXCDICTLEVEL; level++) {
+        if (zstdDict->cdict[level]) ZSTD_freeCDict(zstdDict->cdict[level]);
+    }
+    pthread_mutex_destroy(&zstdDict->cdictMutex);
+    if (zstdDict->ddict) ZSTD_freeDDict(zstdDict->ddict);
+#endif
+    free(zstdDict->dict);
+    free(zstdDict);
+
+}  // End of FreeZstdDict
+
+// prepare the dictionary for compressing the data blocks of a new or appended file.
+// Appended files continue with their own dictionary, new files use the configured one
+static void PrepareCompressDict(nffile_t *nffile) {
+#ifdef HAVE_ZSTD
+    int compression = nffile->file_header->compression;
+    if (compression != ZSTD_COMPRESSED && compression != ADAPTIVE_COMPRESSED) return;
+
+    if (nffile->zstdDict == NULL) {
+        if (confDict == NULL) return;
+        nffile->zstdDict = NewZstdDict(confDictSize);
+        if (!nffile->zstdDict) return;
+        memcpy(nffile->zstdDict->dict, confDict, confDictSize);
+        nffile->zstdDict->received = confDictSize;
+    }
+
+    // prepare the dictionary for the level of the file - adaptive blocks add their levels
+    int level = nffile->compression_level ? nffile->compression_level : ZSTD_CLEVEL_DEFAULT;
+    if (level <= MAXCDICTLEVEL && !GetCDict(nffile->zstdDict, level)) {
+        LogError("ZSTD_createCDict() error in %s line %d - compress without dictionary", __FILE__, __LINE__);
+        FreeZstdDict(nffile->zstdDict);
+        nffile->zstdDict = NULL;
+    }
+#endif
+}  // End of PrepareCompressDict
+
+// allocate a fresh data block from the system
+static dataBlock_t *AllocDataBlock(void) {
+    void *mem = NULL;
+    if (useHugePages) {
+        int err = posix_memalign(&mem, HUGEPAGESIZE, BUFFSIZE);
+        if (err) {
+            LogError("posix_memalign() error in %s line %d: %s", __FILE__, __LINE__, strerror(err));
+            return NULL;
+        }
+#ifdef MADV_HUGEPAGE
+        if (madvise(mem, BUFFSIZE, MADV_HUGEPAGE) < 0) {
+            dbg_printf("madvise(MADV_HUGEPAGE) failed: %s\n", strerror(errno));
+        }
+#endif
+    } else {
+        mem = malloc(BUFFSIZE);
+        if (!mem) {
+            LogError("malloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+            return NULL;
+        }
+    }
+    return (dataBlock_t *)mem;
+
+}  // End of AllocDataBlock
+
+dataBlock_t *NewDataBlock(void) {
+    dataBlock_t *dataBlock = NULL;
+
+    pthread_mutex_lock(&blockPoolMutex);
+    if (blockPool) {
+        dataBlock = (dataBlock_t *)blockPool;
+        blockPool = blockPool->next;
+        numPoolBlocks--;
+    }
+    pthread_mutex_unlock(&blockPoolMutex);
+
+    if (dataBlock) {
+        atomic_fetch_add(&poolHits, 1);
+    } else {
+        atomic_fetch_add(&poolMisses, 1);
+        dataBlock = AllocDataBlock();
+        if (!dataBlock) return NULL;
+    }
+
     InitDataBlock(dataBlock);
-    atomic_fetch_add(&blocksInUse, 1);
+    unsigned inUse = atomic_fetch_add(&blocksInUse, 1) + 1;
+    unsigned peak = atomic_load(&blocksPeak);
+    while (inUse > peak && !atomic_compare_exchange_weak(&blocksPeak, &peak, inUse))
+        ;
     return dataBlock;
 
-}  // End of NewDataBlock
+}  // End of NewDataBlock
+
+// drop a reference of fileMap - unmap the file with the last reference
+static void ReleaseFileMap(fileMap_t *fileMap) {
+    if (atomic_fetch_sub(&fileMap->refCount, 1) > 1) return;
+
+    dbg_printf("Unmap file mapping of size: %zu\n", fileMap->size);
+    if (munmap(fileMap->base, fileMap->size) < 0) {
+        LogError("munmap() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+    }
+    free(fileMap);
+
+}  // End of ReleaseFileMap
+
+void FreeDataBlock(dataBlock_t *dataBlock) {
+    // Release block
+    if (dataBlock) {
+        atomic_fetch_sub(&blocksInUse, 1);
+
+        // recycle block, unless the pool is full
+        pthread_mutex_lock(&blockPoolMutex);
+        if (numPoolBlocks < maxPoolBlocks) {
+            poolBlock_t *poolBlock = (poolBlock_t *)dataBlock;
+            poolBlock->next = blockPool;
+            blockPool = poolBlock;
+            numPoolBlocks++;
+            dataBlock = NULL;
+        }
+        pthread_mutex_unlock(&blockPoolMutex);
+
+        if (dataBlock) free((void *)dataBlock);
+    }
+}  // End of FreeDataBlock
+
+// release a raw data block. A block of a file mapping drops the pages of the block
+// and its reference to the mapping, all other blocks are freed
+static void FreeRawBlock(dataBlock_t *dataBlock, fileMap_t *fileMap) {
+    if (fileMap == NULL) {
+        FreeDataBlock(dataBlock);
+        return;
+    }
+
+    // only pages, which do not overlap with the next or previous block
+    uintptr_t pageSize = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t start = ((uintptr_t)dataBlock + pageSize - 1) & ~(pageSize - 1);
+    uintptr_t end = ((uintptr_t)dataBlock + sizeof(dataBlock_t) + dataBlock->size) & ~(pageSize - 1);
+    if (end > start) madvise((void *)start, end - start, MADV_DONTNEED);
+
+    ReleaseFileMap(fileMap);
+
+}  // End of FreeRawBlock
+
+// map the data blocks of a file opened for reading. Blocks get read from the
+// mapping, starting at the current file position. If the file can not be
+// mapped, blocks are read() as usual
+static void MapFile(nffile_t *nffile) {
+    struct stat stat_buf;
+    if (fstat(nffile->fd, &stat_buf) < 0 || stat_buf.st_size == 0) return;
+
+    off_t currentPos = lseek(nffile->fd, 0, SEEK_CUR);
+    if (currentPos < 0) return;
+
+    fileMap_t *fileMap = calloc(1, sizeof(fileMap_t));
+    if (!fileMap) {
+        LogError("calloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+        return;
+    }
+
+    // read only mapping: blocks are uncompressed or copied out of the mapping
+    void *base = mmap(NULL, stat_buf.st_size, PROT_READ, MAP_SHARED, nffile->fd, 0);
+    if (base == MAP_FAILED) {
+        dbg_printf("mmap() failed: %s - read file\n", strerror(errno));
+        free(fileMap);
+        return;
+    }
+    madvise(base, stat_buf.st_size, MADV_SEQUENTIAL);
+
+    fileMap->base = base;
+    fileMap->size = stat_buf.st_size;
+    atomic_init(&fileMap->refCount, 1);
+
+    nffile->fileMap = fileMap;
+    nffile->mapPos = currentPos;
+    dbg_printf("Mapped file %s, size: %zu\n", nffile->fileName, fileMap->size);
+
+}  // End of MapFile
+
+// append numEntries block index entries to the block index of nffile
+static int AddBlockIndex(nffile_t *nffile, void *entries, uint32_t numEntries) {
+    if ((nffile->numIndex + numEntries) > nffile->maxIndex) {
+        uint32_t maxIndex = nffile->maxIndex ? 2 * nffile->maxIndex : 64;
+        while (maxIndex < (nffile->numIndex + numEntries)) maxIndex *= 2;
+        blockIndex_t *blockIndex = realloc(nffile->blockIndex, maxIndex * sizeof(blockIndex_t));
+        if (!blockIndex) {
+            LogError("realloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+            return 0;
+        }
+        nffile->blockIndex = blockIndex;
+        nffile->maxIndex = maxIndex;
+    }
+    memcpy((void *)&nffile->blockIndex[nffile->numIndex], entries, numEntries * sizeof(blockIndex_t));
+    nffile->numIndex += numEntries;
+
+    return 1;
 
-void FreeDataBlock(dataBlock_t *dataBlock) {
-    // Release block
-    if (dataBlock) {
-        free((void *)dataBlock);
-        atomic_fetch_sub(&blocksInUse, 1);
-    }
-}  // End of FreeDataBlock
+}  // End of AddBlockIndex
 
 static int ReadAppendix(nffile_t *nffile) {
     dbg_printf("Process appendix ..\n");
@@ -545,8 +1085,16 @@ static int ReadAppendix(nffile_t *nffile) {
         return 0;
     }
 
+    struct stat stat_buf;
+    if (fstat(nffile->fd, &stat_buf) < 0) {
+        LogError("fstat() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+        return 0;
+    }
+
     dbg_printf("Num of appendix records: %u\n", nffile->file_header->appendixBlocks);
-    for (int i = 0; i < nffile->file_header->appendixBlocks; i++) {
+    int indexError = 0;
+    // the appendix blocks are followed by the extension blocks up to the end of the file
+    for (int i = 0; i < nffile->file_header->appendixBlocks || lseek(nffile->fd, 0, SEEK_CUR) < stat_buf.st_size; i++) {
         size_t processed = 0;
         dataBlock_t *block_header = nfread(nffile);
         if (!block_header) {
@@ -580,8 +1128,37 @@ static int ReadAppendix(nffile_t *nffile) {
                         LogError("Error processing appendix stat record");
                     }
                     break;
+                case TYPE_BLOCKINDEX: {
+                    dbg_printf("Read block index record from appendix block\n");
+                    if (indexError) break;
+                    uint32_t numEntries = dataSize / sizeof(blockIndex_t);
+                    if ((dataSize % sizeof(blockIndex_t)) != 0 || !AddBlockIndex(nffile, data, numEntries)) {
+                        LogError("Error processing appendix block index record - ignore index");
+                        nffile->numIndex = 0;
+                        indexError = 1;
+                    }
+                } break;
+                case TYPE_ZSTDDICT: {
+                    dbg_printf("Read ZSTD dictionary chunk from appendix block\n");
+                    zstdDictChunk_t *chunk = (zstdDictChunk_t *)data;
+                    uint32_t chunkSize = dataSize - sizeof(zstdDictChunk_t);
+                    if (dataSize < sizeof(zstdDictChunk_t) || chunk->dictSize == 0) {
+                        LogError("Error processing appendix dictionary record");
+                        break;
+                    }
+                    if (nffile->zstdDict == NULL) nffile->zstdDict = NewZstdDict(chunk->dictSize);
+                    zstdDict_t *zstdDict = nffile->zstdDict;
+                    if (!zstdDict) break;
+                    if (chunk->dictSize != zstdDict->size || chunk->offset != zstdDict->received || (chunk->offset + chunkSize) > zstdDict->size) {
+                        LogError("Error processing appendix dictionary record");
+                        break;
+                    }
+                    memcpy(zstdDict->dict + chunk->offset, (void *)chunk + sizeof(zstdDictChunk_t), chunkSize);
+                    zstdDict->received += chunkSize;
+                } break;
                 default:
-                    LogError("Error process appendix record type: %u", record_header->type);
+                    // skip records of newer versions
+                    dbg_printf("Skip unknown appendix record type: %u\n", record_header->type);
             }
             processed += record_header->size;
             buff_ptr += record_header->size;
@@ -594,6 +1171,26 @@ static int ReadAppendix(nffile_t *nffile) {
         FreeDataBlock(block_header);
     }
 
+    if (nffile->zstdDict) {
+        if (nffile->zstdDict->received != nffile->zstdDict->size) {
+            LogError("Incomplete ZSTD dictionary in file: %s", nffile->fileName);
+            FreeZstdDict(nffile->zstdDict);
+            nffile->zstdDict = NULL;
+        }
+#ifdef HAVE_ZSTD
+        else if (nffile->zstdDict->ddict == NULL) {
+            nffile->zstdDict->ddict = ZSTD_createDDict(nffile->zstdDict->dict, nffile->zstdDict->size);
+            if (!nffile->zstdDict->ddict) LogError("ZSTD_createDDict() error in %s line %d", __FILE__, __LINE__);
+        }
+#endif
+    }
+
+    // the block index is only usable, if it describes all data blocks
+    if (nffile->numIndex != nffile->file_header->NumBlocks) {
+        dbg_printf("Block index entries: %u, data blocks: %u - ignore index\n", nffile->numIndex, nffile->file_header->NumBlocks);
+        nffile->numIndex = 0;
+    }
+
     // seek back to currentPos
     off_t backPosition = lseek(nffile->fd, currentPos, SEEK_SET);
     dbg_printf("Reset position to %lld -> %lld\n", currentPos, backPosition);
@@ -619,6 +1216,9 @@ static int WriteAppendix(nffile_t *nffile) {
     nffile->file_header->offAppendix = currentPos;
     nffile->file_header->appendixBlocks = 1;
 
+    // appendix blocks are not counted as data blocks
+    uint32_t numBlocks = nffile->file_header->NumBlocks;
+
     // make sure ident is set
     if (nffile->ident == NULL) nffile->ident = strdup("none");
 
@@ -649,9 +1249,73 @@ static int WriteAppendix(nffile_t *nffile) {
     block_header->size += recordHeader->size;
     buff_ptr += recordHeader->size;
 
-    nfwrite(nffile, block_header);
+    nfwrite(nffile, block_header, NULL);
+
+    // the dictionary and the block index follow in extension blocks, which are not
+    // counted in appendixBlocks, so older versions read the appendix without them
+    InitDataBlock(block_header);
+    buff_ptr = GetCursor(block_header);
+
+    // write dictionary, the data blocks are compressed with
+    if (nffile->zstdDict) {
+        zstdDict_t *zstdDict = nffile->zstdDict;
+        for (uint32_t offset = 0; offset < zstdDict->size; offset += ZSTDDICT_CHUNKSIZE) {
+            uint32_t chunkSize = zstdDict->size - offset;
+            if (chunkSize > ZSTDDICT_CHUNKSIZE) chunkSize = ZSTDDICT_CHUNKSIZE;
+            size_t required = sizeof(recordHeader_t) + sizeof(zstdDictChunk_t) + chunkSize;
+            if (!IsAvailable(block_header, required)) {
+                // continue with next extension block
+                nfwrite(nffile, block_header, NULL);
+                InitDataBlock(block_header);
+                buff_ptr = GetCursor(block_header);
+            }
+
+            recordHeader = (recordHeader_t *)buff_ptr;
+            zstdDictChunk_t *chunk = (zstdDictChunk_t *)((void *)recordHeader + sizeof(recordHeader_t));
+
+            recordHeader->type = TYPE_ZSTDDICT;
+            recordHeader->size = required;
+            chunk->dictSize = zstdDict->size;
+            chunk->offset = offset;
+            memcpy((void *)chunk + sizeof(zstdDictChunk_t), zstdDict->dict + offset, chunkSize);
+
+            block_header->NumRecords++;
+            block_header->size += recordHeader->size;
+            buff_ptr += recordHeader->size;
+        }
+    }
+
+    // write block index, if it covers all data blocks
+    if (nffile->numIndex && nffile->numIndex == numBlocks) {
+        for (uint32_t i = 0; i < nffile->numIndex; i += BLOCKINDEX_PER_RECORD) {
+            uint32_t numEntries = nffile->numIndex - i;
+            if (numEntries > BLOCKINDEX_PER_RECORD) numEntries = BLOCKINDEX_PER_RECORD;
+            size_t required = sizeof(recordHeader_t) + numEntries * sizeof(blockIndex_t);
+            if (!IsAvailable(block_header, required)) {
+                // continue with next extension block
+                nfwrite(nffile, block_header, NULL);
+                InitDataBlock(block_header);
+                buff_ptr = GetCursor(block_header);
+            }
+
+            recordHeader = (recordHeader_t *)buff_ptr;
+            data = (void *)recordHeader + sizeof(recordHeader_t);
+
+            recordHeader->type = TYPE_BLOCKINDEX;
+            recordHeader->size = required;
+            memcpy(data, (void *)&nffile->blockIndex[i], numEntries * sizeof(blockIndex_t));
+
+            block_header->NumRecords++;
+            block_header->size += recordHeader->size;
+            buff_ptr += recordHeader->size;
+        }
+    }
+
+    if (block_header->NumRecords) nfwrite(nffile, block_header, NULL);
     FreeDataBlock(block_header);
 
+    nffile->file_header->NumBlocks = numBlocks;
+
     return 1;
 
 }  // End of WriteAppendix
@@ -689,6 +1353,11 @@ nffile_t *NewFile(nffile_t *nffile) {
             return NULL;
         }
         queue_close(nffile->processQueue);
+
+        pthread_mutex_init(&nffile->jobMutex, NULL);
+        pthread_cond_init(&nffile->jobCond, NULL);
+        pthread_mutex_init(&nffile->seqLock, NULL);
+        pthread_cond_init(&nffile->wcond, NULL);
     } else {
         compression = nffile->file_header->compression;
         encryption = nffile->file_header->encryption;
@@ -702,6 +1371,7 @@ nffile_t *NewFile(nffile_t *nffile) {
 
     nffile->fd = 0;
     nffile->compat16 = 0;
+    atomic_store(&nffile->compressRatio, 0);
 
     if (nffile->fileName) {
         free(nffile->fileName);
@@ -714,6 +1384,15 @@ nffile_t *NewFile(nffile_t *nffile) {
     memset((void *)nffile->stat_record, 0, sizeof(stat_record_t));
     nffile->stat_record->firstseen = 0x7fffffffffffffff;
 
+    nffile->numIndex = 0;
+    nffile->blockFilter = NULL;
+    nffile->skippedBlocks = 0;
+    nffile->columnRead = 0;
+
+    FreeZstdDict(nffile->zstdDict);
+    nffile->zstdDict = NULL;
+    nffile->columnBlocks = 0;
+
     for (int i = 0; i < MAXWORKERS; i++) nffile->worker[i] = 0;
     atomic_store(&nffile->terminate, 0);
     pthread_mutex_init(&nffile->wlock, NULL);
@@ -878,17 +1557,35 @@ static nffile_t *OpenFileStatic(char *filename, nffile_t *nffile) {
 
 }  // End of OpenFileStatic
 
-nffile_t *OpenFile(char *filename, nffile_t *nffile) {
+// open file for reading and launch the reader threads. Skip data blocks
+// rejected by filter, if the file contains a block index. If columns is set,
+// columnar data blocks are returned as they are
+static nffile_t *OpenFileFiltered(char *filename, nffile_t *nffile, blockFilter_t filter, int columns) {
     nffile = OpenFileStatic(filename, nffile);  // Open the file
     if (!nffile) {
         return NULL;
     }
+    nffile->blockFilter = filter;
+    nffile->columnRead = columns;
+
+    // read data blocks from a file mapping, if possible
+    MapFile(nffile);
+
+    atomic_store(&nffile->terminate, 0);
+    queue_open(nffile->processQueue);
+
+    // compressed files are uncompressed by a pool of workers, if available
+    if (FILE_COMPRESSION(nffile) != NOT_COMPRESSED && NumWorkers > 1) {
+        if (!LaunchParallelReader(nffile, NumWorkers)) {
+            CloseFile(nffile);
+            return NULL;
+        }
+        return nffile;
+    }
 
     // kick off nfreader
     // there is only 1 reader thread -> slot 0
     pthread_t tid;
-    atomic_store(&nffile->terminate, 0);
-    queue_open(nffile->processQueue);
     int err = pthread_create(&tid, NULL, nfreader, (void *)nffile);
     if (err) {
         nffile->worker[0] = 0;
@@ -898,6 +1595,10 @@ nffile_t *OpenFile(char *filename, nffile_t *nffile) {
     nffile->worker[0] = tid;
     return nffile;
 
+}  // End of OpenFileFiltered
+
+nffile_t *OpenFile(char *filename, nffile_t *nffile) {
+    return OpenFileFiltered(filename, nffile, NULL, 0);  // Open the file
 }  // End of OpenFile
 
 // Create a new nffile
@@ -961,22 +1662,14 @@ nffile_t *OpenNewFile(char *filename, nffile_t *nffile, int creator, int compres
         return NULL;
     }
 
-    // kick off nfwriter
-    atomic_store(&nffile->terminate, 0);
-    queue_open(nffile->processQueue);
+    PrepareCompressDict(nffile);
+    nffile->columnBlocks = columnBlocks;
 
+    // kick off nfwriter
     // if file is not compressed, 2 workers are fine.
     unsigned NumThreads = nffile->file_header->compression == 0 ? 2 : NumWorkers;
-    for (unsigned i = 0; i < NumThreads; i++) {
-        pthread_t tid;
-        int err = pthread_create(&tid, NULL, nfwriter, (void *)nffile);
-        if (err) {
-            nffile->worker[i] = 0;
-            LogError("pthread_create() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
-            return NULL;
-        }
-        nffile->worker[i] = tid;
-    }
+    if (!LaunchWriters(nffile, NumThreads)) return NULL;
+
     return nffile;
 
 } /* End of OpenNewFile */
@@ -1020,21 +1713,12 @@ nffile_t *AppendFile(char *filename) {
         }
     }
 
-    // kick off NumWorkers nfwriter threads
-    atomic_store(&nffile->terminate, 0);
-    queue_open(nffile->processQueue);
+    PrepareCompressDict(nffile);
 
+    // kick off NumWorkers nfwriter threads
     unsigned NumThreads = nffile->file_header->compression == 0 ? 1 : NumWorkers;
-    for (unsigned i = 0; i < NumThreads; i++) {
-        pthread_t tid;
-        int err = pthread_create(&tid, NULL, nfwriter, (void *)nffile);
-        if (err) {
-            nffile->worker[i] = 0;
-            LogError("pthread_create() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
-            return NULL;
-        }
-        nffile->worker[i] = tid;
-    }
+    if (!LaunchWriters(nffile, NumThreads)) return NULL;
+
     return nffile;
 
 } /* End of AppendFile */
@@ -1092,8 +1776,8 @@ static void FlushFile(nffile_t *nffile) {
     queue_sync(nffile->processQueue);
     // writers terminate, on queue closed and empty
 
-    // wait for all nfwriter threads to exit
-    for (unsigned i = 0; i < NumWorkers; i++) {
+    // wait for all nfwriter threads and the nfwsequencer to exit
+    for (unsigned i = 0; i < MAXWORKERS; i++) {
         if (nffile->worker[i]) {
             int err = pthread_join(nffile->worker[i], NULL);
             if (err) {
@@ -1111,12 +1795,31 @@ void CloseFile(nffile_t *nffile) {
     if (!nffile || nffile->fd == 0) return;
 
     // make sure all workers are gone
-    for (unsigned i = 0; i < NumWorkers; i++) {
+    for (unsigned i = 0; i < MAXWORKERS; i++) {
         if (nffile->worker[i]) {
             SignalTerminate(nffile);
         }
     }
 
+    // release parallel reader queues
+    if (nffile->uncompressQueue) {
+        queue_close(nffile->uncompressQueue);
+        queue_free(nffile->uncompressQueue);
+        nffile->uncompressQueue = NULL;
+    }
+    if (nffile->sequenceQueue) {
+        queue_close(nffile->sequenceQueue);
+        queue_free(nffile->sequenceQueue);
+        nffile->sequenceQueue = NULL;
+    }
+    nffile->numUncompressors = 0;
+
+    // blocks in use keep the mapping until they are freed
+    if (nffile->fileMap) {
+        ReleaseFileMap(nffile->fileMap);
+        nffile->fileMap = NULL;
+    }
+
     close(nffile->fd);
     nffile->fd = 0;
 
@@ -1138,6 +1841,7 @@ void CloseFile(nffile_t *nffile) {
     }
 
     nffile->file_header->NumBlocks = 0;
+    nffile->numIndex = 0;
 }  // End of CloseFile
 
 // close writing file
@@ -1154,9 +1858,6 @@ int CloseUpdateFile(nffile_t *nffile) {
         return 0;
     }
 
-    // NumBlocks are plain data blocks - subtract appendix blocks
-    nffile->file_header->NumBlocks -= nffile->file_header->appendixBlocks;
-
     if (write(nffile->fd, (void *)nffile->file_header, sizeof(fileHeaderV2_t)) <= 0) {
         LogError("write() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
         return 0;
@@ -1183,6 +1884,9 @@ void DisposeFile(nffile_t *nffile) {
     if (nffile->stat_record) free(nffile->stat_record);
     if (nffile->ident) free(nffile->ident);
     if (nffile->fileName) free(nffile->fileName);
+    if (nffile->blockIndex) free(nffile->blockIndex);
+    if (nffile->writeSlots) free(nffile->writeSlots);
+    FreeZstdDict(nffile->zstdDict);
 
     queue_close(nffile->processQueue);
     for (size_t queueLen = queue_length(nffile->processQueue); queueLen > 0; queueLen--) {
@@ -1216,7 +1920,7 @@ nffile_t *GetNextFile(nffile_t *nffile) {
         }
 
         dbg_printf("Process: '%s'\n", nextFile);
-        nffile = OpenFile(nextFile, nffile);  // Open the file
+        nffile = OpenFileFiltered(nextFile, nffile, blockFilter, columnRead);  // Open the file
         free(nextFile);
         return nffile;
     }
@@ -1225,6 +1929,22 @@ nffile_t *GetNextFile(nffile_t *nffile) {
 
 }  // End of GetNextFile
 
+// set the block filter for all files opened by GetNextFile()
+void SetBlockFilter(blockFilter_t filter) {
+    blockFilter = filter;
+}  // End of SetBlockFilter
+
+// write the data blocks of all files opened by OpenNewFile() in columnar layout
+void SetColumnBlocks(int enable) {
+    columnBlocks = enable;
+}  // End of SetColumnBlocks
+
+// return the columnar data blocks of all files opened by GetNextFile() as type 5 blocks.
+// The caller restores the records with a column view
+void SetColumnRead(int enable) {
+    columnRead = enable;
+}  // End of SetColumnRead
+
 dataBlock_t *ReadBlock(nffile_t *nffile, dataBlock_t *dataBlock) {
     if (dataBlock) FreeDataBlock(dataBlock);
     dataBlock = queue_pop(nffile->processQueue);
@@ -1238,8 +1958,57 @@ dataBlock_t *ReadBlock(nffile_t *nffile, dataBlock_t *dataBlock) {
 
 }  // End of ReadBlock
 
-// generic read und uncompress a data block from current position
-static dataBlock_t *nfread(nffile_t *nffile) {
+// return the next raw data block from the file mapping
+static dataBlock_t *nfreadMapped(nffile_t *nffile) {
+    fileMap_t *fileMap = nffile->fileMap;
+    if (nffile->mapPos == fileMap->size) {  // EOF
+        return NULL;
+    }
+
+    // pages beyond the end of a truncated file raise SIGBUS - check the size first
+    struct stat stat_buf;
+    if (fstat(nffile->fd, &stat_buf) < 0) {
+        LogError("fstat() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+        return NULL;
+    }
+    if ((size_t)stat_buf.st_size < fileMap->size) {
+        LogError("ReadBlock() file %s truncated while reading", nffile->fileName);
+        return NULL;
+    }
+
+    if ((nffile->mapPos + sizeof(dataBlock_t)) > fileMap->size) {
+        LogError("Corrupt data file: Read %zu bytes, requested %zu", (size_t)(fileMap->size - nffile->mapPos), sizeof(dataBlock_t));
+        return NULL;
+    }
+
+    dataBlock_t *buff = (dataBlock_t *)(fileMap->base + nffile->mapPos);
+    dbg_printf("ReadBlock - type: %u, size: %u, numRecords: %u, flags: %u\n", buff->type, buff->size, buff->NumRecords, buff->flags);
+
+    if (buff->size > (BUFFSIZE - sizeof(dataBlock_t)) || buff->size == 0 || buff->NumRecords == 0) {
+        // this is most likely a corrupt file
+        LogError("Corrupt data file: Error buffer size %u", buff->size);
+        return NULL;
+    }
+
+    if ((nffile->mapPos + sizeof(dataBlock_t) + buff->size) > fileMap->size) {
+        LogError("ReadBlock() Corrupt data file: Unexpected EOF while reading data block");
+        return NULL;
+    }
+    nffile->mapPos += sizeof(dataBlock_t) + buff->size;
+
+    // the block holds a reference to the mapping until it is released by FreeRawBlock()
+    atomic_fetch_add(&fileMap->refCount, 1);
+
+    return buff;
+
+}  // End of nfreadMapped
+
+// read the next raw data block from current position. fileMap returns the mapping
+// of a block read from a mapped file, NULL otherwise
+static dataBlock_t *nfreadRaw(nffile_t *nffile, fileMap_t **fileMap) {
+    *fileMap = nffile->fileMap;
+    if (nffile->fileMap) return nfreadMapped(nffile);
+
     dataBlock_t *buff = NewDataBlock();
     ssize_t ret = read(nffile->fd, buff, sizeof(dataBlock_t));
     if (ret == 0) {  // EOF
@@ -1270,62 +2039,261 @@ static dataBlock_t *nfread(nffile_t *nffile) {
         return NULL;
     }
 
-    int compression = nffile->file_header->compression;
-
     void *p = (void *)((void *)buff + sizeof(dataBlock_t));
     dbg_printf("ReadBlock - read: %u\n", buff->size);
     ret = read(nffile->fd, p, buff->size);
     if (ret == buff->size) {
-        dataBlock_t *block_header = NULL;
-        int failed = 0;
         // we have the whole record and are done for now
-        switch (compression) {
-            case NOT_COMPRESSED:
-                block_header = buff;
-                break;
-            case LZO_COMPRESSED:
-                block_header = NewDataBlock();
-                if (Uncompress_Block_LZO(buff, block_header, nffile->buff_size) < 0) failed = 1;
-                FreeDataBlock(buff);
-                break;
-            case LZ4_COMPRESSED:
-                block_header = NewDataBlock();
-                if (Uncompress_Block_LZ4(buff, block_header, nffile->buff_size) < 0) failed = 1;
-                FreeDataBlock(buff);
-                break;
-            case BZ2_COMPRESSED:
-                block_header = NewDataBlock();
-                if (Uncompress_Block_BZ2(buff, block_header, nffile->buff_size) < 0) failed = 1;
-                FreeDataBlock(buff);
-                break;
-            case ZSTD_COMPRESSED:
-                block_header = NewDataBlock();
-                if (Uncompress_Block_ZSTD(buff, block_header, nffile->buff_size) < 0) failed = 1;
-                FreeDataBlock(buff);
-                break;
+        return buff;
+    } else if (ret == 0) {
+        LogError("ReadBlock() Corrupt data file: Unexpected EOF while reading data block");
+    } else if (ret == -1) {  // ERROR
+        LogError("read() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+    } else {
+        LogError("read() error: Short read: Expected: %u, received: %u\n", buff->size, ret);
+    }
+
+    FreeDataBlock(buff);
+    return NULL;
+
+}  // End of nfreadRaw
+
+// uncompress a raw data block according to the file compression or the block codec
+// the raw block of fileMap is consumed. Returns NULL on error
+static dataBlock_t *nfuncompress(nffile_t *nffile, dataBlock_t *buff, fileMap_t *fileMap) {
+    int compression = nffile->file_header->compression;
+    if (compression == ADAPTIVE_COMPRESSED) compression = BLOCK_CODEC(buff);
+    if (TestFlag(buff->flags, FLAG_BLOCK_UNCOMPRESSED)) compression = NOT_COMPRESSED;
+
+    if (fileMap && (compression == NOT_COMPRESSED || buff->type == DATA_BLOCK_TYPE_5)) {
+        // these blocks are modified in place - copy them out of the read only mapping
+        dataBlock_t *dataBlock = NewDataBlock();
+        if (dataBlock) memcpy((void *)dataBlock, (void *)buff, sizeof(dataBlock_t) + buff->size);
+        FreeRawBlock(buff, fileMap);
+        if (dataBlock == NULL) return NULL;
+        buff = dataBlock;
+        fileMap = NULL;
+    }
+
+    if (buff->type == DATA_BLOCK_TYPE_5) {
+        // the sections of columnar blocks are compressed separately - keep the codec in the block
+        SetBlockCodec(buff, compression, BLOCK_LEVEL(buff));
+        if (nffile->columnRead) return buff;
+
+        // restore the records of a columnar block
+        dataBlock_t *rowBlock = RowBlock(buff);
+        FreeDataBlock(buff);
+        return rowBlock;
+    }
+
+    dataBlock_t *block_header = NULL;
+    int failed = 0;
+    switch (compression) {
+        case NOT_COMPRESSED:
+            block_header = buff;
+            break;
+        case LZO_COMPRESSED:
+            block_header = NewDataBlock();
+            if (Uncompress_Block_LZO(buff, block_header, nffile->buff_size) <= 0) failed = 1;
+            FreeRawBlock(buff, fileMap);
+            break;
+        case LZ4_COMPRESSED:
+            block_header = NewDataBlock();
+            if (Uncompress_Block_LZ4(buff, block_header, nffile->buff_size) <= 0) failed = 1;
+            FreeRawBlock(buff, fileMap);
+            break;
+        case BZ2_COMPRESSED:
+            block_header = NewDataBlock();
+            if (Uncompress_Block_BZ2(buff, block_header, nffile->buff_size) <= 0) failed = 1;
+            FreeRawBlock(buff, fileMap);
+            break;
+        case ZSTD_COMPRESSED:
+            block_header = NewDataBlock();
+            if (Uncompress_Block_ZSTD(buff, block_header, nffile->buff_size, nffile->zstdDict) <= 0) failed = 1;
+            FreeRawBlock(buff, fileMap);
+            break;
+        default:
+            LogError("Unknown block compression: %d", compression);
+            FreeRawBlock(buff, fileMap);
+            failed = 1;
+    }
+
+    if (failed) {
+        FreeDataBlock(block_header);
+        return NULL;
+    }
+
+    // blocks may be written to another file - clear the compression of this file
+    ClearBlockCodec(block_header);
+
+    // success - done
+    return block_header;
+
+}  // End of nfuncompress
+
+// generic read und uncompress a data block from current position
+static dataBlock_t *nfread(nffile_t *nffile) {
+    fileMap_t *fileMap;
+    dataBlock_t *buff = nfreadRaw(nffile, &fileMap);
+    if (buff == NULL) return NULL;
+
+    return nfuncompress(nffile, buff, fileMap);
+
+}  // End of nfread
+
+// check the block index of data block blockNum at the current file position
+// returns 1, if the block is rejected by the block filter and skipped
+static int SkipBlock(nffile_t *nffile, uint32_t blockNum) {
+    if (nffile->blockFilter == NULL || blockNum >= nffile->numIndex) return 0;
+
+    blockIndex_t *blockIndex = &nffile->blockIndex[blockNum];
+    if ((blockIndex->flags & BLOCKINDEX_NOSKIP) || nffile->blockFilter(blockIndex)) return 0;
+
+    off_t currentPos = nffile->fileMap ? nffile->mapPos : lseek(nffile->fd, 0, SEEK_CUR);
+    if (currentPos != (off_t)blockIndex->offset) {
+        LogError("Block index of file %s does not match data block %u - ignore index", nffile->fileName, blockNum);
+        nffile->numIndex = 0;
+        return 0;
+    }
+
+    if (nffile->fileMap) {
+        nffile->mapPos = blockIndex->offset + blockIndex->size;
+    } else if (lseek(nffile->fd, blockIndex->offset + blockIndex->size, SEEK_SET) < 0) {
+        LogError("lseek() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+        nffile->numIndex = 0;
+        return 0;
+    }
+
+    dbg_printf("Skip block %u\n", blockNum);
+    nffile->skippedBlocks++;
+    return 1;
+
+}  // End of SkipBlock
+
+__attribute__((noreturn)) void *nfreader(void *arg) {
+    nffile_t *nffile = (nffile_t *)arg;
+
+    /* Signal handling */
+    sigset_t set = {0};
+    sigfillset(&set);
+    pthread_sigmask(SIG_SETMASK, &set, NULL);
+
+    int terminate = atomic_load(&nffile->terminate);
+    int blockCount = 0;
+    dataBlock_t *block_header = NULL;
+    while (!terminate && blockCount < nffile->file_header->NumBlocks) {
+        if (SkipBlock(nffile, blockCount)) {
+            blockCount++;
+            continue;
+        }
+        block_header = nfread(nffile);
+        if (!block_header) {
+            dbg_printf("block_header == NULL\n");
+            break;
+        }
+
+        if (queue_push(nffile->processQueue, (void *)block_header) == QUEUE_CLOSED) {
+            FreeDataBlock(block_header);
+            dbg_printf("nfreader - processQueue closed\n");
+            terminate = 1;
+        } else {
+            blockCount++;
+            terminate = atomic_load(&nffile->terminate);
+            dbg_printf("ReadBlock - expanded: %u\n", block_header->size);
+            dbg_printf("Blocks: %u\n", blockCount);
+        }
+
+#ifdef DEVEL
+        if (terminate) {
+            printf("Terminate nfreader by signal\n");
+        }
+#endif
+    }
+
+    // eof or error ends processing
+    queue_close(nffile->processQueue);
+
+    dbg_printf("nfreader done - read %u blocks\n", blockCount);
+    dbg_printf("nfreader exit\n");
+
+    atomic_store(&nffile->terminate, 2);
+    pthread_exit(NULL);
+
+}  // End of nfreader
+
+/*
+ * parallel reader
+ * nfreadIO reads the raw blocks in file order and pushes a read job for each block
+ * into the sequenceQueue and the uncompressQueue. The nfuncompressor workers pop
+ * jobs and uncompress the blocks in parallel. The nfsequencer pops the jobs in file
+ * order from the sequenceQueue, waits until each job is done, and pushes the
+ * uncompressed blocks in file order into the processQueue.
+ */
+__attribute__((noreturn)) static void *nfreadIO(void *arg) {
+    nffile_t *nffile = (nffile_t *)arg;
+
+    /* Signal handling */
+    sigset_t set = {0};
+    sigfillset(&set);
+    pthread_sigmask(SIG_SETMASK, &set, NULL);
+
+    int terminate = atomic_load(&nffile->terminate);
+    int blockCount = 0;
+    while (!terminate && blockCount < nffile->file_header->NumBlocks) {
+        if (SkipBlock(nffile, blockCount)) {
+            blockCount++;
+            continue;
+        }
+        fileMap_t *fileMap;
+        dataBlock_t *buff = nfreadRaw(nffile, &fileMap);
+        if (!buff) {
+            dbg_printf("nfreadIO - buff == NULL\n");
+            break;
         }
 
-        if (failed) {
-            FreeDataBlock(block_header);
-            return NULL;
+        readJob_t *job = malloc(sizeof(readJob_t));
+        if (!job) {
+            LogError("malloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+            FreeRawBlock(buff, fileMap);
+            break;
         }
-        // success - done
-        return block_header;
+        job->dataBlock = buff;
+        job->fileMap = fileMap;
+        job->done = 0;
 
-    } else if (ret == 0) {
-        LogError("ReadBlock() Corrupt data file: Unexpected EOF while reading data block");
-    } else if (ret == -1) {  // ERROR
-        LogError("read() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
-    } else {
-        LogError("read() error: Short read: Expected: %u, received: %u\n", buff->size, ret);
+        if (queue_push(nffile->sequenceQueue, (void *)job) == QUEUE_CLOSED) {
+            FreeRawBlock(buff, fileMap);
+            free(job);
+            dbg_printf("nfreadIO - sequenceQueue closed\n");
+            break;
+        }
+
+        if (queue_push(nffile->uncompressQueue, (void *)job) == QUEUE_CLOSED) {
+            // job is already queued for the sequencer - release it as empty job
+            pthread_mutex_lock(&nffile->jobMutex);
+            FreeRawBlock(job->dataBlock, job->fileMap);
+            job->dataBlock = NULL;
+            job->done = 1;
+            pthread_cond_broadcast(&nffile->jobCond);
+            pthread_mutex_unlock(&nffile->jobMutex);
+            dbg_printf("nfreadIO - uncompressQueue closed\n");
+            break;
+        }
+
+        blockCount++;
+        terminate = atomic_load(&nffile->terminate);
     }
 
-    FreeDataBlock(buff);
-    return NULL;
+    // eof or error ends reading
+    queue_close(nffile->uncompressQueue);
+    queue_close(nffile->sequenceQueue);
 
-}  // End of nfread
+    dbg_printf("nfreadIO done - read %u blocks\n", blockCount);
+    pthread_exit(NULL);
 
-__attribute__((noreturn)) void *nfreader(void *arg) {
+}  // End of nfreadIO
+
+__attribute__((noreturn)) static void *nfuncompressor(void *arg) {
     nffile_t *nffile = (nffile_t *)arg;
 
     /* Signal handling */
@@ -1333,44 +2301,107 @@ __attribute__((noreturn)) void *nfreader(void *arg) {
     sigfillset(&set);
     pthread_sigmask(SIG_SETMASK, &set, NULL);
 
-    int terminate = atomic_load(&nffile->terminate);
+    while (1) {
+        readJob_t *job = queue_pop(nffile->uncompressQueue);
+        if (job == QUEUE_CLOSED) break;
+
+        // uncompress outside the lock - NULL signals an error
+        dataBlock_t *dataBlock = nfuncompress(nffile, job->dataBlock, job->fileMap);
+
+        pthread_mutex_lock(&nffile->jobMutex);
+        job->dataBlock = dataBlock;
+        job->done = 1;
+        pthread_cond_broadcast(&nffile->jobCond);
+        pthread_mutex_unlock(&nffile->jobMutex);
+    }
+
+    dbg_printf("nfuncompressor exit\n");
+    pthread_exit(NULL);
+
+}  // End of nfuncompressor
+
+__attribute__((noreturn)) static void *nfsequencer(void *arg) {
+    nffile_t *nffile = (nffile_t *)arg;
+
+    /* Signal handling */
+    sigset_t set = {0};
+    sigfillset(&set);
+    pthread_sigmask(SIG_SETMASK, &set, NULL);
+
+    int abort = 0;
     int blockCount = 0;
-    dataBlock_t *block_header = NULL;
-    while (!terminate && blockCount < nffile->file_header->NumBlocks) {
-        block_header = nfread(nffile);
-        if (!block_header) {
-            dbg_printf("block_header == NULL\n");
-            break;
-        }
+    while (1) {
+        readJob_t *job = queue_pop(nffile->sequenceQueue);
+        if (job == QUEUE_CLOSED) break;
 
-        if (queue_push(nffile->processQueue, (void *)block_header) == QUEUE_CLOSED) {
-            FreeDataBlock(block_header);
-            dbg_printf("nfreader - processQueue closed\n");
-            terminate = 1;
-        } else {
-            blockCount++;
-            terminate = atomic_load(&nffile->terminate);
-            dbg_printf("ReadBlock - expanded: %u\n", block_header->size);
-            dbg_printf("Blocks: %u\n", blockCount);
+        pthread_mutex_lock(&nffile->jobMutex);
+        while (!job->done) pthread_cond_wait(&nffile->jobCond, &nffile->jobMutex);
+        pthread_mutex_unlock(&nffile->jobMutex);
+
+        dataBlock_t *dataBlock = job->dataBlock;
+        free(job);
+
+        if (abort) {
+            // drain remaining jobs
+            FreeDataBlock(dataBlock);
+            continue;
         }
 
-#ifdef DEVEL
-        if (terminate) {
-            printf("Terminate nfreader by signal\n");
+        if (dataBlock == NULL || queue_push(nffile->processQueue, (void *)dataBlock) == QUEUE_CLOSED) {
+            // corrupt block or consumer closed the queue - stop reading
+            dbg_printf("nfsequencer - abort reading\n");
+            FreeDataBlock(dataBlock);
+            abort = 1;
+            atomic_store(&nffile->terminate, 1);
+            queue_close(nffile->uncompressQueue);
+            queue_close(nffile->sequenceQueue);
+            continue;
         }
-#endif
+        blockCount++;
     }
 
     // eof or error ends processing
     queue_close(nffile->processQueue);
 
-    dbg_printf("nfreader done - read %u blocks\n", blockCount);
-    dbg_printf("nfreader exit\n");
+    dbg_printf("nfsequencer done - processed %u blocks\n", blockCount);
 
     atomic_store(&nffile->terminate, 2);
     pthread_exit(NULL);
 
-}  // End of nfreader
+}  // End of nfsequencer
+
+// launch the parallel reader: 1 nfreadIO, numUncompressors nfuncompressor and 1 nfsequencer thread
+static int LaunchParallelReader(nffile_t *nffile, unsigned numUncompressors) {
+    if (numUncompressors > (MAXWORKERS - 2)) numUncompressors = MAXWORKERS - 2;
+
+    // limit blocks in flight to twice the number of workers
+    size_t queueLen = 4;
+    while (queueLen < (2 * numUncompressors)) queueLen <<= 1;
+
+    nffile->uncompressQueue = queue_init(queueLen);
+    nffile->sequenceQueue = queue_init(queueLen);
+    if (!nffile->uncompressQueue || !nffile->sequenceQueue) {
+        return 0;
+    }
+    nffile->numUncompressors = numUncompressors;
+
+    // slot 0: nfreadIO, slot 1: nfsequencer, slot 2..n: nfuncompressor
+    void *(*threadFunc[3])(void *) = {nfreadIO, nfsequencer, nfuncompressor};
+    for (unsigned i = 0; i < (numUncompressors + 2); i++) {
+        pthread_t tid;
+        int err = pthread_create(&tid, NULL, threadFunc[i < 2 ? i : 2], (void *)nffile);
+        if (err) {
+            nffile->worker[i] = 0;
+            LogError("pthread_create() error in %s line %d: %s", __FILE__, __LINE__, strerror(err));
+            return 0;
+        }
+        nffile->worker[i] = tid;
+    }
+
+    dbg_printf("Parallel reader launched with %u uncompress workers\n", numUncompressors);
+    return 1;
+
+}  // End of LaunchParallelReader
 
 dataBlock_t *WriteBlock(nffile_t *nffile, dataBlock_t *dataBlock) {
     if (dataBlock == NULL) {
@@ -1398,55 +2429,197 @@ void FlushBlock(nffile_t *nffile, dataBlock_t *dataBlock) {
     }
 }  // End of FlushBlock
 
-static int nfwrite(nffile_t *nffile, dataBlock_t *block_header) {
-    if (block_header->size == 0) {
-        return 1;
+// summarize a data block for the block index
+static void SummarizeBlock(dataBlock_t *dataBlock, blockIndex_t *blockIndex) {
+    memset((void *)blockIndex, 0, sizeof(blockIndex_t));
+    blockIndex->msecFirstMin = 0xFFFFFFFFFFFFFFFFLL;
+    blockIndex->msecLastMin = 0xFFFFFFFFFFFFFFFFLL;
+
+    if (dataBlock->type != DATA_BLOCK_TYPE_3) {
+        blockIndex->flags |= BLOCKINDEX_NOSKIP;
+        return;
     }
 
-    dbg_printf("nfwrite - write: %u\n", block_header->size);
+    recordHeader_t *recordHeader = (recordHeader_t *)GetCursor(dataBlock);
+    uint32_t sumSize = 0;
+    for (int i = 0; i < dataBlock->NumRecords; i++) {
+        if (recordHeader->size < sizeof(recordHeader_t) || (sumSize + recordHeader->size) > dataBlock->size) {
+            // corrupt block - never skip
+            blockIndex->flags |= BLOCKINDEX_NOSKIP;
+            return;
+        }
+        if (recordHeader->type != V3Record) {
+            // exporter, sampler etc. records must always be processed
+            blockIndex->flags |= BLOCKINDEX_NOSKIP;
+        } else {
+            recordHeaderV3_t *recordHeaderV3 = (recordHeaderV3_t *)recordHeader;
+            void *eor = (void *)recordHeader + recordHeader->size;
+            EXgenericFlow_t *genericFlow = NULL;
+            uint64_t msecEvent = 0;
+            elementHeader_t *elementHeader = (elementHeader_t *)((void *)recordHeaderV3 + sizeof(recordHeaderV3_t));
+            for (int j = 0; j < recordHeaderV3->numElements; j++) {
+                if (((void *)elementHeader + sizeof(elementHeader_t)) > eor || elementHeader->length == 0) break;
+                void *element = (void *)elementHeader + sizeof(elementHeader_t);
+                switch (elementHeader->type) {
+                    case EXgenericFlowID:
+                        genericFlow = (EXgenericFlow_t *)element;
+                        break;
+                    case EXipv4FlowID: {
+                        EXipv4Flow_t *ipv4Flow = (EXipv4Flow_t *)element;
+                        BloomAdd(blockIndex->bloom, ipv4Flow->srcAddr);
+                        BloomAdd(blockIndex->bloom, ipv4Flow->dstAddr);
+                    } break;
+                    case EXipv6FlowID: {
+                        EXipv6Flow_t *ipv6Flow = (EXipv6Flow_t *)element;
+                        BloomAdd(blockIndex->bloom, ipv6Flow->srcAddr[0]);
+                        BloomAdd(blockIndex->bloom, ipv6Flow->srcAddr[1]);
+                        BloomAdd(blockIndex->bloom, ipv6Flow->dstAddr[0]);
+                        BloomAdd(blockIndex->bloom, ipv6Flow->dstAddr[1]);
+                    } break;
+                    case EXnselCommonID:
+                    case EXnatCommonID:
+                        // msecEvent is the first element of both extensions
+                        if (msecEvent == 0) msecEvent = *((uint64_t *)element);
+                        break;
+                }
+                elementHeader = (elementHeader_t *)((void *)elementHeader + elementHeader->length);
+            }
+            if (genericFlow) {
+                // same as MapRecordHandle(): events without msecFirst use the event time
+                uint64_t msecFirst = genericFlow->msecFirst ? genericFlow->msecFirst : msecEvent;
+                uint64_t msecLast = genericFlow->msecLast;
+                if (msecFirst < blockIndex->msecFirstMin) blockIndex->msecFirstMin = msecFirst;
+                if (msecFirst > blockIndex->msecFirstMax) blockIndex->msecFirstMax = msecFirst;
+                if (msecLast < blockIndex->msecLastMin) blockIndex->msecLastMin = msecLast;
+                if (msecLast > blockIndex->msecLastMax) blockIndex->msecLastMax = msecLast;
+                blockIndex->proto[genericFlow->proto >> 6] |= 1ULL << (genericFlow->proto & 0x3F);
+            }
+        }
+        sumSize += recordHeader->size;
+        recordHeader = (recordHeader_t *)((void *)recordHeader + recordHeader->size);
+    }
 
-    dataBlock_t *buff = NULL;
-    dataBlock_t *wptr = NULL;
+}  // End of SummarizeBlock
+
+// adaptive compression: select the codec and level of a data block
+// LZ4 for small blocks, if the writers can not keep up, or if the data compresses poorly,
+// the strong codec otherwise. The strong codec is ZSTD if available, LZ4HC otherwise
+static int SelectCodec(nffile_t *nffile, dataBlock_t *block_header, int *level) {
+    int strongLevel = *level;
+    *level = 0;
+
+    if (block_header->size < SMALLBLOCKSIZE) return LZ4_COMPRESSED;
+
+    // blocks pile up in the queue
+    if (queue_length(nffile->processQueue) >= (QueueSize / 2)) return LZ4_COMPRESSED;
+
+    if (atomic_load(&nffile->compressRatio) > POORRATIO) return LZ4_COMPRESSED;
+
+#ifdef HAVE_ZSTD
+    *level = strongLevel ? strongLevel : ZSTD_CLEVEL_DEFAULT;
+    return ZSTD_COMPRESSED;
+#else
+    *level = strongLevel ? strongLevel : LZ4HC_CLEVEL_DEFAULT;
+    return LZ4_COMPRESSED;
+#endif
+
+}  // End of SelectCodec
+
+// compress a block according the file compression. Returns the block to write in wptr
+// and the compressed block in buff, which is NULL for uncompressed blocks.
+// Only type 3 data blocks are compressed with the ZSTD dictionary of the file, if any
+static int CompressBlock(nffile_t *nffile, dataBlock_t *block_header, dataBlock_t **wptr, dataBlock_t **buff, int useDict) {
     int failed = 0;
     // compress according file compression
     int compression = nffile->file_header->compression;
     int level = nffile->compression_level;
+    int adaptive = compression == ADAPTIVE_COMPRESSED;
+    if (adaptive) compression = SelectCodec(nffile, block_header, &level);
+    // the dictionary is trained on row blocks - columnar blocks are compressed without it
+    zstdDict_t *zstdDict = block_header->type == DATA_BLOCK_TYPE_3 ? nffile->zstdDict : NULL;
     dbg_printf("nfwrite - compression: %u\n", compression);
-    switch (compression) {
-        case NOT_COMPRESSED:
-            wptr = block_header;
-            break;
-        case LZO_COMPRESSED:
-            buff = NewDataBlock();
-            if (Compress_Block_LZO(block_header, buff, nffile->buff_size) < 0) failed = 1;
-            wptr = buff;
-            break;
-        case LZ4_COMPRESSED:
-            buff = NewDataBlock();
-            if (Compress_Block_LZ4(block_header, buff, nffile->buff_size, level) < 0) failed = 1;
-            wptr = buff;
-            break;
-        case BZ2_COMPRESSED:
-            buff = NewDataBlock();
-            if (Compress_Block_BZ2(block_header, buff, nffile->buff_size) < 0) failed = 1;
-            wptr = buff;
-            break;
-        case ZSTD_COMPRESSED:
-            buff = NewDataBlock();
-            if (Compress_Block_ZSTD(block_header, buff, nffile->buff_size, level) < 0) failed = 1;
-            wptr = buff;
-            break;
+    *buff = NULL;
+    *wptr = NULL;
+    if (block_header->type == DATA_BLOCK_TYPE_5 && compression != NOT_COMPRESSED) {
+        // columnar blocks compress the row stream and each column separately
+        *buff = CompressColumns(block_header, compression, level);
+        *wptr = *buff;
+    } else {
+        switch (compression) {
+            case NOT_COMPRESSED:
+                *wptr = block_header;
+                break;
+            case LZO_COMPRESSED:
+                *buff = NewDataBlock();
+                if (Compress_Block_LZO(block_header, *buff, nffile->buff_size) < 0) failed = 1;
+                *wptr = *buff;
+                break;
+            case LZ4_COMPRESSED:
+                *buff = NewDataBlock();
+                if (Compress_Block_LZ4(block_header, *buff, nffile->buff_size, level) < 0) failed = 1;
+                *wptr = *buff;
+                break;
+            case BZ2_COMPRESSED:
+                *buff = NewDataBlock();
+                if (Compress_Block_BZ2(block_header, *buff, nffile->buff_size) < 0) failed = 1;
+                *wptr = *buff;
+                break;
+            case ZSTD_COMPRESSED:
+                *buff = NewDataBlock();
+                if (Compress_Block_ZSTD(block_header, *buff, nffile->buff_size, level, useDict ? zstdDict : NULL) < 0) failed = 1;
+                *wptr = *buff;
+                break;
+        }
     }
 
-    if (failed) {  // error
-        FreeDataBlock(buff);
+    if (failed || *wptr == NULL) {  // error
+        FreeDataBlock(*buff);
+        *buff = NULL;
         return 0;
     }
 
-    dbg_printf("WriteBlock - type: %u, size: %u, compressed: %u, numRecords: %u, flags: %u\n", wptr->type, block_header->size, compression,
-               wptr->NumRecords, wptr->flags);
+    if (adaptive) {
+        if ((*wptr)->size >= block_header->size) {
+            // incompressible - store the block
+            FreeDataBlock(*buff);
+            *buff = NULL;
+            *wptr = block_header;
+            compression = NOT_COMPRESSED;
+            level = 0;
+        }
+        // moving average of the compression ratio of the recent blocks
+        uint32_t ratio = (1000ULL * (*wptr)->size) / block_header->size;
+        atomic_store(&nffile->compressRatio, (7 * atomic_load(&nffile->compressRatio) + ratio) / 8);
+
+        SetBlockCodec(*wptr, compression, level);
+        if (compression == NOT_COMPRESSED) SetFlag((*wptr)->flags, FLAG_BLOCK_UNCOMPRESSED);
+    }
+
+    dbg_printf("CompressBlock - type: %u, size: %u, compressed: %u, numRecords: %u, flags: %u\n", (*wptr)->type, block_header->size, compression,
+               (*wptr)->NumRecords, (*wptr)->flags);
+
+    return 1;
+
+}  // End of CompressBlock
+
+// compress and write a block. If blockIndex is not NULL, add it as
+// block index entry of this data block
+static int nfwrite(nffile_t *nffile, dataBlock_t *block_header, blockIndex_t *blockIndex) {
+    if (block_header->size == 0) {
+        return 1;
+    }
+
+    dbg_printf("nfwrite - write: %u\n", block_header->size);
+
+    dataBlock_t *buff = NULL;
+    dataBlock_t *wptr = NULL;
+    if (!CompressBlock(nffile, block_header, &wptr, &buff, 0)) return 0;
 
     pthread_mutex_lock(&nffile->wlock);
+    if (blockIndex) {
+        blockIndex->offset = lseek(nffile->fd, 0, SEEK_CUR);
+        blockIndex->size = sizeof(dataBlock_t) + wptr->size;
+    }
     ssize_t ret = write(nffile->fd, (void *)wptr, sizeof(dataBlock_t) + wptr->size);
     FreeDataBlock(buff);
     if (ret < 0) {
@@ -1455,12 +2628,22 @@ static int nfwrite(nffile_t *nffile, dataBlock_t *block_header) {
         return 0;
     }
 
+    // the index must describe all data blocks - a failed entry invalidates the index
+    if (blockIndex && !AddBlockIndex(nffile, (void *)blockIndex, 1)) nffile->numIndex = 0;
     nffile->file_header->NumBlocks++;
     pthread_mutex_unlock(&nffile->wlock);
     return 1;
 
 }  // End of nfwrite
 
+/*
+ * ordered parallel writer
+ * The nfwriter workers pop the blocks from the processQueue and number them in queue order.
+ * Each worker compresses its block and puts it into the write slot of its sequence number.
+ * The nfwsequencer writes the slots strictly in sequence order, batching consecutive
+ * finished slots into one writev(). Workers wait, if their slot is still in use, which
+ * limits the blocks in flight to the number of write slots.
+ */
 __attribute__((noreturn)) void *nfwriter(void *arg) {
     nffile_t *nffile = (nffile_t *)arg;
 
@@ -1470,22 +2653,54 @@ __attribute__((noreturn)) void *nfwriter(void *arg) {
     sigfillset(&set);
     pthread_sigmask(SIG_SETMASK, &set, NULL);
 
-    dataBlock_t *block_header;
     while (1) {
-        block_header = queue_pop(nffile->processQueue);
-        if (block_header == QUEUE_CLOSED) break;
-
-        int ok = 1;
-        if (block_header->size) {
-            // block with data
-            dbg_printf("nfwriter write\n");
-            ok = nfwrite(nffile, block_header);
+        // pop and number the next block in queue order
+        pthread_mutex_lock(&nffile->seqLock);
+        dataBlock_t *block_header = queue_pop(nffile->processQueue);
+        if (block_header == QUEUE_CLOSED) {
+            pthread_mutex_unlock(&nffile->seqLock);
+            break;
+        }
+        if (block_header->size == 0) {
+            // empty blocks need not to be written
+            pthread_mutex_unlock(&nffile->seqLock);
+            FreeDataBlock(block_header);
+            continue;
+        }
+        uint64_t sequence = nffile->nextSequence++;
+        pthread_mutex_unlock(&nffile->seqLock);
+
+        // summarize and compress in parallel
+        dbg_printf("nfwriter compress block %llu\n", (unsigned long long)sequence);
+        writeSlot_t job = {.dataBlock = block_header, .state = SLOT_READY};
+        SummarizeBlock(block_header, &job.blockIndex);
+        if (nffile->columnBlocks) {
+            // blocks, which can not be converted, are written as they are
+            dataBlock_t *columnBlock = ColumnBlock(block_header);
+            if (columnBlock) {
+                FreeDataBlock(block_header);
+                block_header = job.dataBlock = columnBlock;
+            }
+        }
+        dataBlock_t *wptr;
+        if (!CompressBlock(nffile, block_header, &wptr, &job.buff, 1)) {
+            LogError("nfwriter: failed to compress data block");
+            job.state = SLOT_FAILED;
         }
-        FreeDataBlock(block_header);
 
-        if (!ok) break;
+        // wait for the slot of this block and hand it over to the sequencer
+        pthread_mutex_lock(&nffile->wlock);
+        while (sequence >= (nffile->nextWrite + nffile->numWriteSlots)) pthread_cond_wait(&nffile->wcond, &nffile->wlock);
+        nffile->writeSlots[sequence % nffile->numWriteSlots] = job;
+        pthread_cond_broadcast(&nffile->wcond);
+        pthread_mutex_unlock(&nffile->wlock);
     }
 
+    pthread_mutex_lock(&nffile->wlock);
+    nffile->activeWriters--;
+    pthread_cond_broadcast(&nffile->wcond);
+    pthread_mutex_unlock(&nffile->wlock);
+
     dbg_printf("nfwriter exit\n");
     pthread_exit(NULL);
 
@@ -1493,13 +2708,166 @@ __attribute__((noreturn)) void *nfwriter(void *arg) {
 
 }  // End of nfwriter
 
+// write all iovec entries - writev() may return after a partial write
+static int writeAll(int fd, struct iovec *iov, int iovcnt) {
+    while (iovcnt) {
+        ssize_t ret = writev(fd, iov, iovcnt);
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        while (iovcnt && (size_t)ret >= iov->iov_len) {
+            ret -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt) {
+            iov->iov_base = (char *)iov->iov_base + ret;
+            iov->iov_len -= ret;
+        }
+    }
+    return 1;
+
+}  // End of writeAll
+
+__attribute__((noreturn)) static void *nfwsequencer(void *arg) {
+    nffile_t *nffile = (nffile_t *)arg;
+
+    /* Signal handling */
+    sigset_t set = {0};
+    sigfillset(&set);
+    pthread_sigmask(SIG_SETMASK, &set, NULL);
+
+    off_t offset = lseek(nffile->fd, 0, SEEK_CUR);
+    int writeError = 0;
+    uint32_t numSlots = nffile->numWriteSlots;
+    while (1) {
+        pthread_mutex_lock(&nffile->wlock);
+        while (nffile->writeSlots[nffile->nextWrite % numSlots].state == SLOT_EMPTY && nffile->activeWriters > 0)
+            pthread_cond_wait(&nffile->wcond, &nffile->wlock);
+        if (nffile->writeSlots[nffile->nextWrite % numSlots].state == SLOT_EMPTY) {
+            // all writers done and all blocks written
+            pthread_mutex_unlock(&nffile->wlock);
+            break;
+        }
+
+        // collect consecutive finished slots
+        uint64_t first = nffile->nextWrite;
+        uint32_t numBlocks = 0;
+        while (numBlocks < MAXWRITEBATCH && numBlocks < numSlots && nffile->writeSlots[(first + numBlocks) % numSlots].state != SLOT_EMPTY)
+            numBlocks++;
+        pthread_mutex_unlock(&nffile->wlock);
+
+        // the collected slots are owned by the sequencer until released
+        struct iovec iov[MAXWRITEBATCH];
+        int iovcnt = 0;
+        for (uint32_t i = 0; i < numBlocks; i++) {
+            writeSlot_t *slot = &nffile->writeSlots[(first + i) % numSlots];
+            if (slot->state != SLOT_READY) continue;
+            dataBlock_t *wptr = slot->buff ? slot->buff : slot->dataBlock;
+            iov[iovcnt].iov_base = (void *)wptr;
+            iov[iovcnt].iov_len = sizeof(dataBlock_t) + wptr->size;
+            slot->blockIndex.offset = offset;
+            slot->blockIndex.size = iov[iovcnt].iov_len;
+            offset += iov[iovcnt].iov_len;
+            iovcnt++;
+        }
+
+        if (!writeError && iovcnt && !writeAll(nffile->fd, iov, iovcnt)) {
+            LogError("writev() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+            writeError = 1;
+        }
+
+        for (uint32_t i = 0; i < numBlocks; i++) {
+            writeSlot_t *slot = &nffile->writeSlots[(first + i) % numSlots];
+            if (slot->state == SLOT_READY && !writeError) {
+                // the index must describe all data blocks - a failed entry invalidates the index
+                if (!AddBlockIndex(nffile, (void *)&slot->blockIndex, 1)) nffile->numIndex = 0;
+                nffile->file_header->NumBlocks++;
+            } else {
+                // missing block
+                nffile->numIndex = 0;
+            }
+            FreeDataBlock(slot->buff);
+            FreeDataBlock(slot->dataBlock);
+            slot->buff = NULL;
+            slot->dataBlock = NULL;
+        }
+
+        // release the slots
+        pthread_mutex_lock(&nffile->wlock);
+        for (uint32_t i = 0; i < numBlocks; i++) nffile->writeSlots[(first + i) % numSlots].state = SLOT_EMPTY;
+        nffile->nextWrite += numBlocks;
+        pthread_cond_broadcast(&nffile->wcond);
+        pthread_mutex_unlock(&nffile->wlock);
+    }
+
+    dbg_printf("nfwsequencer exit\n");
+    pthread_exit(NULL);
+
+}  // End of nfwsequencer
+
+// launch the ordered writer: 1 nfwsequencer and numWriters nfwriter threads
+static int LaunchWriters(nffile_t *nffile, unsigned numWriters) {
+    if (numWriters > (MAXWORKERS - 1)) numWriters = MAXWORKERS - 1;
+
+    // limit blocks in flight to twice the number of workers
+    uint32_t numSlots = 2 * numWriters;
+    if (numSlots < 4) numSlots = 4;
+    if (nffile->numWriteSlots != numSlots) {
+        free(nffile->writeSlots);
+        nffile->writeSlots = NULL;
+        nffile->numWriteSlots = 0;
+    }
+    if (nffile->writeSlots == NULL) {
+        nffile->writeSlots = malloc(numSlots * sizeof(writeSlot_t));
+        if (!nffile->writeSlots) {
+            LogError("malloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+            return 0;
+        }
+        nffile->numWriteSlots = numSlots;
+    }
+    for (uint32_t i = 0; i < numSlots; i++) {
+        nffile->writeSlots[i].dataBlock = NULL;
+        nffile->writeSlots[i].buff = NULL;
+        nffile->writeSlots[i].state = SLOT_EMPTY;
+    }
+    nffile->nextSequence = 0;
+    nffile->nextWrite = 0;
+    nffile->activeWriters = numWriters;
+
+    atomic_store(&nffile->terminate, 0);
+    queue_open(nffile->processQueue);
+
+    // slot 0: nfwsequencer, slot 1..n: nfwriter
+    for (unsigned i = 0; i < (numWriters + 1); i++) {
+        pthread_t tid;
+        int err = pthread_create(&tid, NULL, i == 0 ? nfwsequencer : nfwriter, (void *)nffile);
+        if (err) {
+            nffile->worker[i] = 0;
+            LogError("pthread_create() error in %s line %d: %s", __FILE__, __LINE__, strerror(err));
+            // let the sequencer terminate with the started writers
+            pthread_mutex_lock(&nffile->wlock);
+            nffile->activeWriters -= numWriters - (i ? i - 1 : 0);
+            pthread_cond_broadcast(&nffile->wcond);
+            pthread_mutex_unlock(&nffile->wlock);
+            return 0;
+        }
+        nffile->worker[i] = tid;
+    }
+
+    dbg_printf("Writer launched with %u compress workers\n", numWriters);
+    return 1;
+
+}  // End of LaunchWriters
+
 static int SignalTerminate(nffile_t *nffile) {
     // set terminate
     atomic_store(&nffile->terminate, 1);
     queue_close(nffile->processQueue);
 
     pthread_cond_broadcast(&(nffile->processQueue->cond));
-    for (unsigned i = 0; i < NumWorkers; i++) {
+    for (unsigned i = 0; i < MAXWORKERS; i++) {
         if (nffile->worker[i]) {
             int err = pthread_join(nffile->worker[i], NULL);
             if (err && err != ESRCH) {
@@ -1549,8 +2917,6 @@ int ChangeIdent(char *filename, char *Ident) {
             DisposeFile(nffile);
             return 0;
         }
-        // remove old appendix block
-        nffile->file_header->NumBlocks--;
     } else {
         // if no appendix
         if (lseek(nffile->fd, 0, SEEK_END) < 0) {
@@ -1565,6 +2931,11 @@ int ChangeIdent(char *filename, char *Ident) {
         LogError("Failed to write appendix");
     }
 
+    // update appendix info in file header
+    if (lseek(nffile->fd, 0, SEEK_SET) < 0 || write(nffile->fd, (void *)nffile->file_header, sizeof(fileHeaderV2_t)) <= 0) {
+        LogError("write() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+    }
+
     if (close(nffile->fd) < 0) {
         LogError("close() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
         return 0;
@@ -1589,7 +2960,7 @@ void ModifyCompressFile(int compress) {
         // last file
         if (nffile_r == NULL) break;
 
-        if (nffile_r->file_header->compression == COMPRESSION_TYPE(compress)) {
+        if (nffile_r->file_header->compression == COMPRESSION_TYPE(compress) && !columnBlocks) {
             printf("File %s is already same compression method\n", nffile_r->fileName);
             continue;
         }
@@ -1642,16 +3013,92 @@ void ModifyCompressFile(int compress) {
 
 }  // End of ModifyCompressFile
 
+// train a ZSTD dictionary from the data blocks of all files given and save it in dictFile
+// samples are spread over the blocks until DICTMAXSAMPLES times the dictionary size is collected
+int TrainZstdDict(char *dictFile) {
+#ifdef HAVE_ZSTD
+    size_t maxSamples = (size_t)DICTMAXSAMPLES * DICTSIZE / DICTSAMPLESIZE;
+    void *samples = malloc(maxSamples * DICTSAMPLESIZE);
+    size_t *sampleSizes = calloc(maxSamples, sizeof(size_t));
+    void *dict = malloc(DICTSIZE);
+    if (!samples || !sampleSizes || !dict) {
+        LogError("malloc() allocation error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+        free(samples);
+        free(sampleSizes);
+        free(dict);
+        return 0;
+    }
+
+    size_t numSamples = 0;
+    size_t samplesSize = 0;
+    nffile_t *nffile = NULL;
+    while (numSamples < maxSamples) {
+        nffile = GetNextFile(nffile);
+        if (nffile == NULL) break;
+
+        dataBlock_t *dataBlock = NULL;
+        while (numSamples < maxSamples && (dataBlock = ReadBlock(nffile, dataBlock)) != NULL) {
+            if (dataBlock->type != DATA_BLOCK_TYPE_3) continue;
+
+            // cut up to DICTBLOCKSAMPLES evenly spaced samples out of the block
+            uint32_t numChunks = dataBlock->size / DICTSAMPLESIZE;
+            if (numChunks == 0) numChunks = 1;
+            uint32_t step = numChunks > DICTBLOCKSAMPLES ? numChunks / DICTBLOCKSAMPLES : 1;
+            for (uint32_t i = 0; i < numChunks && numSamples < maxSamples; i += step) {
+                size_t offset = (size_t)i * DICTSAMPLESIZE;
+                size_t size = dataBlock->size - offset;
+                if (size > DICTSAMPLESIZE) size = DICTSAMPLESIZE;
+                memcpy(samples + samplesSize, GetCursor(dataBlock) + offset, size);
+                sampleSizes[numSamples++] = size;
+                samplesSize += size;
+            }
+        }
+        FreeDataBlock(dataBlock);
+    }
+    // stop the reader threads of a partly read file
+    DisposeFile(nffile);
+
+    int ok = 0;
+    size_t dictSize = ZDICT_trainFromBuffer(dict, DICTSIZE, samples, sampleSizes, numSamples);
+    if (ZDICT_isError(dictSize)) {
+        LogError("ZDICT_trainFromBuffer() failed with %zu samples: %s", numSamples, ZDICT_getErrorName(dictSize));
+    } else {
+        int fd = open(dictFile, O_CREAT | O_WRONLY | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+        if (fd < 0) {
+            LogError("Failed to open file %s: '%s'", dictFile, strerror(errno));
+        } else {
+            if (write(fd, dict, dictSize) != (ssize_t)dictSize) {
+                LogError("write() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+            } else {
+                printf("Dictionary %s: id: %u, size: %zu, trained with %zu samples, %zu bytes\n", dictFile, ZDICT_getDictID(dict, dictSize),
+                       dictSize, numSamples, samplesSize);
+                ok = 1;
+            }
+            close(fd);
+        }
+    }
+
+    free(samples);
+    free(sampleSizes);
+    free(dict);
+    return ok;
+#else
+    LogError("ZSTD compression not compiled in");
+    return 0;
+#endif
+
+}  // End of TrainZstdDict
+
 int QueryFile(char *filename, int verbose) {
     int fd;
-    uint32_t totalRecords, numBlocks, type1, type2, type3, type4;
+    uint32_t totalRecords, numBlocks, type1, type2, type3, type4, type5;
     struct stat stat_buf;
     ssize_t ret;
 
     dbg_printf("Query mode verbose: %d\n", verbose);
     if (!Init_nffile(1, NULL)) return 0;
 
-    type1 = type2 = type3 = type4 = 0;
+    type1 = type2 = type3 = type4 = type5 = 0;
     totalRecords = numBlocks = 0;
 
     if (stat(filename, &stat_buf)) {
@@ -1699,7 +3146,7 @@ int QueryFile(char *filename, int verbose) {
             return 0;
         }
 
-        if (fileHeader.compression > ZSTD_COMPRESSED) {
+        if (fileHeader.compression > ADAPTIVE_COMPRESSED) {
             LogError("Unknown compression: %u", fileHeader.compression);
             close(fd);
             return 0;
@@ -1710,6 +3157,7 @@ int QueryFile(char *filename, int verbose) {
                : fileHeader.compression == LZ4_COMPRESSED  ? "lz4 compressed"
                : fileHeader.compression == ZSTD_COMPRESSED ? "zstd compressed"
                : fileHeader.compression == BZ2_COMPRESSED  ? "bz2 compressed"
+               : fileHeader.compression == ADAPTIVE_COMPRESSED ? "adaptive compressed"
                                                            : "not compressed");
 
         if (fileHeader.encryption != NOT_ENCRYPTED) {
@@ -1770,6 +3218,12 @@ int QueryFile(char *filename, int verbose) {
     nffile->fileName = strdup(filename);
     memcpy(nffile->file_header, &fileHeader, sizeof(fileHeader));
 
+    // data blocks may be compressed with the dictionary in the appendix
+    if (fileHeader.appendixBlocks && (fileHeader.compression == ZSTD_COMPRESSED || fileHeader.compression == ADAPTIVE_COMPRESSED)) {
+        ReadAppendix(nffile);
+        nffile->numIndex = 0;
+    }
+
     // read buffer
     dataBlock_t *readBlock = NewDataBlock();
     // tmp uncompress buffer
@@ -1778,7 +3232,9 @@ int QueryFile(char *filename, int verbose) {
     printf("Checking data blocks\n");
     if (verbose == 0) setvbuf(stdout, (char *)NULL, _IONBF, 0);
 
-    for (int i = 0; i < fileHeader.NumBlocks + fileHeader.appendixBlocks; i++) {
+    // extension blocks follow the appendix blocks up to the end of the file
+    int fileBlocks = fileHeader.NumBlocks + fileHeader.appendixBlocks;
+    for (int i = 0; i < fileBlocks || (fileHeader.appendixBlocks && lseek(fd, 0, SEEK_CUR) < stat_buf.st_size); i++) {
         if (verbose == 0) {
             char spinner[] = {'|', '/', '-', '\\'};
             if (verbose == 0 && ((numBlocks & 0x7) == 0)) printf(" %c\r", spinner[(numBlocks >> 3) & 0x2]);
@@ -1823,6 +3279,9 @@ int QueryFile(char *filename, int verbose) {
             case DATA_BLOCK_TYPE_4:
                 type4++;
                 break;
+            case DATA_BLOCK_TYPE_5:
+                type5++;
+                break;
             default:
                 printf("block %i has unknown type %u\n", numBlocks, readBlock->type);
                 close(fd);
@@ -1846,6 +3305,10 @@ int QueryFile(char *filename, int verbose) {
                    readBlock->size, readBlock->flags, readBlock->NumRecords);
         }
         int compression = nffile->file_header->compression;
+        if (compression == ADAPTIVE_COMPRESSED) {
+            compression = BLOCK_CODEC(readBlock);
+            if (verbose) printf("Block codec: %u, level: %u\n", compression, BLOCK_LEVEL(readBlock));
+        }
         if (TestFlag(readBlock->flags, FLAG_BLOCK_UNCOMPRESSED)) {
             compression = NOT_COMPRESSED;
         }
@@ -1869,6 +3332,12 @@ int QueryFile(char *filename, int verbose) {
             return 0;
         }
 
+        if (readBlock->type == DATA_BLOCK_TYPE_5) {
+            // the sections of columnar blocks are compressed separately
+            SetBlockCodec(readBlock, compression, BLOCK_LEVEL(readBlock));
+            compression = NOT_COMPRESSED;
+        }
+
         int failed = 0;
         switch (compression) {
             case NOT_COMPRESSED:
@@ -1904,7 +3373,7 @@ int QueryFile(char *filename, int verbose) {
                 dataBlock_t *b = readBlock;
                 readBlock = buff;
                 buff = b;
-                if (Uncompress_Block_ZSTD(buff, readBlock, nffile->buff_size) < 0) {
+                if (Uncompress_Block_ZSTD(buff, readBlock, nffile->buff_size, nffile->zstdDict) < 0) {
                     LogError("Zstd decompress failed");
                     failed = 1;
                 }
@@ -1916,6 +3385,17 @@ int QueryFile(char *filename, int verbose) {
 
         if (failed) continue;
 
+        if (readBlock->type == DATA_BLOCK_TYPE_5) {
+            // count the records of the restored block
+            dataBlock_t *rowBlock = RowBlock(readBlock);
+            if (!rowBlock) {
+                LogError("Columnar block %i corrupt", numBlocks);
+                continue;
+            }
+            FreeDataBlock(readBlock);
+            readBlock = rowBlock;
+        }
+
         if (verbose)
             printf("Uncompressed block %i, type: %u, size: %u, flags: 0x%x, records: %u\n", numBlocks, readBlock->type, readBlock->size,
                    readBlock->flags, readBlock->NumRecords);
@@ -2018,6 +3498,7 @@ int QueryFile(char *filename, int verbose) {
     if (type2) printf("Type 2 blocks : %u\n", type2);
     if (type3) printf("Type 3 blocks : %u\n", type3);
     if (type4) printf("Type 4 blocks : %u\n", type4);
+    if (type5) printf("Type 5 blocks : %u\n", type5);
     printf("Records       : %u\n", totalRecords);
 
     DisposeFile(nffile);
@@ -172,6 +172,15 @@ typedef struct data_block_header_s {
                           // 2 - block compressed
 } data_block_headerV1_t;
 
+/*
+ * block filter: returns 0, if no record of the data block, described
+ * by the block index entry, can match
+ */
+typedef int (*blockFilter_t)(const blockIndex_t *blockIndex);
+
+// memory mapping of a file
+typedef struct fileMap_s fileMap_t;
+
 /*
  * Generic file handle for reading/writing files
  * if a file is read only writeto and block_header are NULL
@@ -190,6 +199,37 @@ typedef struct nffile_s {
 
     queue_t *processQueue;  // blocks ready to be processed. Connects consumer/producer threads
 
+    // parallel block decompression
+    queue_t *uncompressQueue;   // compressed blocks waiting for a decompress worker
+    queue_t *sequenceQueue;     // blocks in file order waiting for the sequencer
+    pthread_mutex_t jobMutex;   // protects done flag of read jobs
+    pthread_cond_t jobCond;     // signals a finished read job
+    unsigned numUncompressors;  // number of decompress workers for this file
+
+    // ordered parallel block compression
+    pthread_mutex_t seqLock;              // serializes popping and numbering of blocks to write
+    pthread_cond_t wcond;                 // signals filled and written write slots
+    struct writeSlot_s *writeSlots;       // compressed blocks waiting to be written in order
+    uint32_t numWriteSlots;               // size of writeSlots
+    uint32_t activeWriters;               // running nfwriter threads
+    uint64_t nextSequence;                // sequence number of the next block to compress
+    uint64_t nextWrite;                   // sequence number of the next block to write
+    _Atomic uint32_t compressRatio;       // adaptive compression: recent compressed/raw size in 1/1000
+    struct zstdDict_s *zstdDict;          // ZSTD dictionary of this file, if any
+    int columnBlocks;                     // write data blocks in columnar layout
+
+    // block index
+    blockIndex_t *blockIndex;   // summary of each data block
+    uint32_t numIndex;          // number of valid entries
+    uint32_t maxIndex;          // number of allocated entries
+    blockFilter_t blockFilter;  // skip data blocks, if set
+    uint32_t skippedBlocks;     // number of data blocks skipped by the blockFilter
+    int columnRead;             // return columnar data blocks without restoring the records
+
+    // mapped file
+    fileMap_t *fileMap;  // mapping of the file, if data blocks are read from memory
+    off_t mapPos;        // read position in the mapping
+
     stat_record_t *stat_record;  // flow stat record
     char *ident;                 // source identifier
     char *fileName;              // file name
@@ -240,6 +280,8 @@ int ParseCompression(char *arg);
 
 unsigned ReportBlocks(void);
 
+void ReportBlockPool(uint64_t *hits, uint64_t *misses, unsigned *peak);
+
 void SumStatRecords(stat_record_t *s1, stat_record_t *s2);
 
 nffile_t *OpenFile(char *filename, nffile_t *nffile);
@@ -271,6 +313,12 @@ int RenameAppend(char *oldName, char *newName);
 
 nffile_t *GetNextFile(nffile_t *nffile);
 
+void SetBlockFilter(blockFilter_t blockFilter);
+
+void SetColumnBlocks(int enable);
+
+void SetColumnRead(int enable);
+
 dataBlock_t *NewDataBlock(void);
 
 dataBlock_t *ReadBlock(nffile_t *nffile, dataBlock_t *dataBlock);
@@ -285,6 +333,12 @@ void SetIdent(nffile_t *nffile, char *Ident);
 
 void ModifyCompressFile(int compress);
 
+int TrainZstdDict(char *dictFile);
+
+int CompressBuffer(int compression, int level, const void *in, uint32_t in_len, void *out, uint32_t out_size);
+
+int UncompressBuffer(int compression, const void *in, uint32_t in_len, void *out, uint32_t out_size);
+
 void *nfreader(void *arg);
 
 void *nfwriter(void *arg);
@@ -72,11 +72,13 @@ typedef struct fileHeaderV2_s {
 #define BZ2_COMPRESSED 2
 #define LZ4_COMPRESSED 3
 #define ZSTD_COMPRESSED 4
+#define ADAPTIVE_COMPRESSED 5  // codec selected per data block - see block flags
 
     uint8_t encryption;
 #define NOT_ENCRYPTED 0
     uint16_t appendixBlocks;  // number of blocks to read from appendix
                               // on open file for internal data structs
+                              // followed by extension blocks up to the end of the file
     uint32_t creator;         // program created this file
 #define CREATOR_UNKNOWN 0
 #define CREATOR_NFCAPD 1
@@ -123,6 +125,17 @@ typedef struct fileHeaderV2_s {
  * array elements without any header. The number of array elements is
  * NumRecords in the block header
  *
+ * datablock type 5 is the columnar layout of a type 3 block
+ *   +------------+-------------+----------------+------------+----------+-----+----------+
+ *   |Blockheader | columnLayout| column headers | row stream | column 0 | ... | column n |
+ *   +------------+-------------+----------------+------------+----------+-----+----------+
+ * The payload of the common extensions of all V3 records is moved into one column
+ * per extension. The row stream holds all records with the remaining data, including
+ * the element headers of the moved extensions. Columns of equal sized elements are
+ * stored byte plane by byte plane. The row stream and each column are compressed
+ * separately with the block codec, so readers may uncompress single columns. A section,
+ * which does not shrink, is stored uncompressed. Readers restore the type 3 block.
+ *
  */
 typedef struct dataBlock_s {
     uint32_t NumRecords;  // size of this block in bytes without this header
@@ -130,14 +143,38 @@ typedef struct dataBlock_s {
     uint16_t type;        // Block type
 #define DATA_BLOCK_TYPE_3 3
 #define DATA_BLOCK_TYPE_4 4
+#define DATA_BLOCK_TYPE_5 5
     uint16_t flags;  // Bit 0: 0: file block compression, 1: block uncompressed
                      // Bit 1: 0: file block encryption, 1: block unencrypted
                      // Bit 2: 0: no autoread, 1: autoread - internal structure
+                     // Bit 8-11: codec of this block in ADAPTIVE_COMPRESSED files
+                     // Bit 12-15: compression level of this block, informational only
 #define FLAG_BLOCK_UNCOMPRESSED 0x1
 #define FLAG_BLOCK_UNENCRYPTED 0x2
 #define FLAG_BLOCK_AUTOREAD 0x4
+#define BLOCK_CODEC(b) (((b)->flags >> 8) & 0xF)
+#define BLOCK_LEVEL(b) (((b)->flags >> 12) & 0xF)
+#define SetBlockCodec(b, codec, level) \
+    ((b)->flags = ((b)->flags & 0xFF) | (((codec)&0xF) << 8) | ((((level) > 15 ? 15 : (level)) & 0xF) << 12))
+#define ClearBlockCodec(b) ((b)->flags &= (0xFF & ~FLAG_BLOCK_UNCOMPRESSED))
 } dataBlock_t;
 
+// type 5 block layout, follows the block header
+typedef struct columnLayout_s {
+    uint32_t rowSize;     // size of the row stream
+    uint32_t rowStored;   // stored size of the row stream, rowSize if uncompressed
+    uint16_t numColumns;  // number of column headers
+    uint16_t fill;
+#define MAXCOLUMNS 16
+} columnLayout_t;
+
+typedef struct columnHeader_s {
+    uint16_t extID;        // extension stored in this column
+    uint16_t elementSize;  // payload size of all elements, 0 if sizes differ - no byte planes
+    uint32_t size;         // size of this column
+    uint32_t stored;       // stored size of this column, size if uncompressed
+} columnHeader_t;
+
 /*
  * Generic data record
  * Contains any type of data, specified by type
@@ -155,5 +192,82 @@ typedef struct recordHeader_s {
 
 #define TYPE_IDENT 0x8001
 #define TYPE_STAT 0x8002
+#define TYPE_BLOCKINDEX 0x8003
+#define TYPE_ZSTDDICT 0x8004
+
+/*
+ * ZSTD dictionary
+ * ===============
+ * Data blocks of ZSTD or adaptive compressed files may be compressed with a
+ * ZSTD dictionary. The dictionary is stored in the appendix extension blocks in
+ * TYPE_ZSTDDICT records, each holding a chunk of the dictionary. Appendix blocks
+ * are never compressed with the dictionary.
+ */
+typedef struct zstdDictChunk_s {
+    uint32_t dictSize;  // size of the complete dictionary
+    uint32_t offset;    // offset of this chunk in the dictionary
+    // followed by the chunk data
+} zstdDictChunk_t;
+
+// max dictionary bytes per TYPE_ZSTDDICT record
+#define ZSTDDICT_CHUNKSIZE 32768
+
+/*
+ * Block index
+ * ===========
+ * The appendix extension blocks may contain a block index with a summary of each
+ * data block, stored in TYPE_BLOCKINDEX records as an array of blockIndex_t. Entry n
+ * describes data block n. A reader may skip a block without reading or
+ * uncompressing it, if the summary proves that no flow record of the block
+ * matches the time window or filter. The index is only valid if it covers
+ * all data blocks of the file. Files without index are read as usual.
+ */
+#define BLOOMBITS 131072
+#define BLOOMHASHES 3
+typedef struct blockIndex_s {
+    uint64_t offset;  // file offset of the data block
+    uint32_t size;    // size of the data block on disk incl. block header
+    uint32_t flags;
+#define BLOCKINDEX_NOSKIP 0x1  // block contains records other than flow records
+    // time range of all flow records in the block
+    uint64_t msecFirstMin;
+    uint64_t msecFirstMax;
+    uint64_t msecLastMin;
+    uint64_t msecLastMax;
+    // bitmap of all protocols
+    uint64_t proto[4];
+    // bloom filter of all IPv4 addresses and IPv6 address halves
+    uint64_t bloom[BLOOMBITS / 64];
+} blockIndex_t;
+
+// number of blockIndex_t entries fitting into a TYPE_BLOCKINDEX record
+#define BLOCKINDEX_PER_RECORD ((0xFFFF - sizeof(recordHeader_t)) / sizeof(blockIndex_t))
+
+static inline uint64_t BloomHash(uint64_t key) {
+    // murmur3 fmix64
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+}  // End of BloomHash
+
+static inline void BloomAdd(uint64_t *bloom, uint64_t key) {
+    uint64_t hash = BloomHash(key);
+    for (int i = 0; i < BLOOMHASHES; i++) {
+        uint32_t bit = (hash >> (i * 21)) & (BLOOMBITS - 1);
+        bloom[bit >> 6] |= 1ULL << (bit & 0x3F);
+    }
+}  // End of BloomAdd
+
+static inline int BloomTest(const uint64_t *bloom, uint64_t key) {
+    uint64_t hash = BloomHash(key);
+    for (int i = 0; i < BLOOMHASHES; i++) {
+        uint32_t bit = (hash >> (i * 21)) & (BLOOMBITS - 1);
+        if ((bloom[bit >> 6] & (1ULL << (bit & 0x3F))) == 0) return 0;
+    }
+    return 1;
+}  // End of BloomTest
 
 #endif  //_NFFILEV2_H
@@ -75,8 +75,108 @@ static void CompactSequencer(sequencer_t *sequencer) {
 
 }  // End of CompactSequencer
 
+/*
+ * Compile a template with fixed length fields only into a flat list of operations.
+ * All input and output offsets are known in advance, so a record is decoded by
+ * copying a preformatted image of the output elements and executing the operations
+ * without any per element length or offset calculations.
+ */
+static void CompileSequencer(sequencer_t *sequencer) {
+    for (int i = 0; i < sequencer->numSequences; i++) {
+        uint16_t type = sequencer->sequenceTable[i].inputType;
+        if (type == subTemplateListType || type == subTemplateMultiListType) {
+            dbg_printf("CompileSequencer() sub template list - use generic sequencer\n");
+            return;
+        }
+    }
+
+    sequenceOp_t *opTable = calloc(sequencer->numSequences, sizeof(sequenceOp_t));
+    sequenceElement_t *elementTable = calloc(sequencer->numElements, sizeof(sequenceElement_t));
+    uint8_t *outImage = calloc(1, sequencer->outLength);
+    if (!opTable || !elementTable || !outImage) {
+        LogError("CompileSequencer: calloc() error in %s line %d: %s\n", __FILE__, __LINE__, strerror(errno));
+        free(opTable);
+        free(elementTable);
+        free(outImage);
+        return;
+    }
+
+    // data offset of each extension in the output record
+    uint32_t dataOffset[MAXEXTENSIONS] = {0};
+    uint32_t numElements = 0;
+    uint32_t outOffset = 0;
+    uint32_t inOffset = 0;
+    uint32_t numOps = 0;
+    for (int i = 0; i < sequencer->numSequences; i++) {
+        sequence_t *sequence = &(sequencer->sequenceTable[i]);
+        uint32_t ExtID = sequence->extensionID;
+        uint16_t inLength = sequence->inputLength;
+        uint16_t outLength = sequence->outputLength;
+
+        // skip sequence
+        if (ExtID == EXnull && sequence->stackID == 0) {
+            inOffset += inLength;
+            continue;
+        }
+
+        // elements are added in order of their first sequence
+        if (ExtID != EXnull && dataOffset[ExtID] == 0) {
+            if (numElements == sequencer->numElements || (outOffset + sequencer->ExtSize[ExtID]) > sequencer->outLength) break;
+            elementHeader_t *elementHeader = (elementHeader_t *)(outImage + outOffset);
+            elementHeader->type = extensionTable[ExtID].id;
+            elementHeader->length = sequencer->ExtSize[ExtID];
+            dataOffset[ExtID] = outOffset + sizeof(elementHeader_t);
+            elementTable[numElements].extensionID = ExtID;
+            elementTable[numElements].offset = dataOffset[ExtID];
+            numElements++;
+            outOffset += sequencer->ExtSize[ExtID];
+        }
+
+        // placeholder sequence
+        if (inLength == 0) continue;
+
+        sequenceOp_t *op = &opTable[numOps++];
+        op->stackID = sequence->stackID;
+        op->inLength = inLength;
+        op->outLength = ExtID == EXnull ? 0 : outLength;
+        op->inOffset = inOffset;
+        op->outOffset = dataOffset[ExtID] + sequence->offsetRel;
+        if (sequence->copyMode == ByteCopy || inLength > 16) {
+            op->opCode = OpCopy;
+            if (op->outLength > inLength) op->outLength = inLength;
+        } else if (inLength == op->outLength && inLength == 1) {
+            op->opCode = OpNum8;
+        } else if (inLength == op->outLength && inLength == 2) {
+            op->opCode = OpNum16;
+        } else if (inLength == op->outLength && inLength == 4) {
+            op->opCode = OpNum32;
+        } else if (inLength == op->outLength && inLength == 8) {
+            op->opCode = OpNum64;
+        } else {
+            op->opCode = OpNumber;
+        }
+        inOffset += inLength;
+    }
+
+    if (numElements != sequencer->numElements || outOffset != sequencer->outLength || inOffset != sequencer->inLength) {
+        dbg_printf("CompileSequencer() layout mismatch - use generic sequencer\n");
+        free(opTable);
+        free(elementTable);
+        free(outImage);
+        return;
+    }
+
+    sequencer->opTable = opTable;
+    sequencer->numOps = numOps;
+    sequencer->elementTable = elementTable;
+    sequencer->outImage = outImage;
+    dbg_printf("CompileSequencer() compiled %u sequences into %u operations\n", sequencer->numSequences, numOps);
+
+}  // End of CompileSequencer
+
 uint16_t *SetupSequencer(sequencer_t *sequencer, sequence_t *sequenceTable, uint32_t numSequences) {
     memset((void *)sequencer->ExtSize, 0, sizeof(sequencer->ExtSize));
+    memset((void *)sequencer->offsetCache, 0, sizeof(sequencer->offsetCache));
 
     sequencer->sequenceTable = sequenceTable;
     sequencer->numSequences = numSequences;
@@ -129,7 +229,9 @@ uint16_t *SetupSequencer(sequencer_t *sequencer, sequence_t *sequenceTable, uint
     if (!hasVarInLength && !hasVarOutLength) {
         dbg_printf("SetupSequencer() Fixed length fields, found %u elements in %u sequences\n", sequencer->numElements, sequencer->numSequences);
         dbg_printf("SetupSequencer() Calculated input length: %lu, output length: %lu\n", sequencer->inLength, sequencer->outLength);
+        if (sequencer->inLength && sequencer->outLength) CompileSequencer(sequencer);
     }
+    sequencer->recordSize = sequencer->outLength ? sequencer->outLength : 1024;
 
     // dynamically create extension list
     dbg_printf("Extensionlist:\n");
@@ -152,25 +254,14 @@ uint16_t *SetupSequencer(sequencer_t *sequencer, sequence_t *sequenceTable, uint
 
 void ClearSequencer(sequencer_t *sequencer) {
     if (sequencer->sequenceTable) free(sequencer->sequenceTable);
+    if (sequencer->opTable) free(sequencer->opTable);
+    if (sequencer->elementTable) free(sequencer->elementTable);
+    if (sequencer->outImage) free(sequencer->outImage);
 
     memset((void *)sequencer, 0, sizeof(sequencer_t));
 
 }  // End of ClearSequencer
 
-size_t CalcOutRecordSize(sequencer_t *sequencer, void *in, size_t inSize) {
-    size_t length;
-    if (sequencer->outLength == 0) {
-        length = 1024;
-        dbg_printf("Dyn record length: %zu\n", length);
-    } else {
-        length = sequencer->outLength;
-        dbg_printf("Fix record length: %zu\n", length);
-    }
-
-    return length;
-
-}  // End of OutRecordSize
-
 static sequencer_t *GetSubTemplateSequencer(sequencer_t *sequencer, uint16_t templateID) {
     sequencer_t *self = sequencer;
     while (sequencer->next != self && sequencer->templateID != templateID) {
@@ -242,10 +333,128 @@ static int ProcessSubTemplate(sequencer_t *sequencer, uint16_t type, const void
 
 }  // End of ProcessSubTemplate
 
-// SequencerRun requires calling CalcOutRecordSize first
+// execute a compiled fixed length template
+static int RunCompiledSequencer(sequencer_t *sequencer, const uint8_t *inBuff, size_t inSize, void *outBuff, size_t outSize, uint64_t *stack) {
+    if (inSize == 0) return SEQ_OK;
+
+    if (sequencer->inLength > inSize) {
+        LogError("SequencerRun() ERROR - Attempt to read beyond input stream size");
+        dbg_printf("Attempt to read beyond input stream size: inLength: %zu, inSize: %zu\n", sequencer->inLength, inSize);
+        return SEQ_ERROR;
+    }
+
+    recordHeaderV3_t *recordHeaderV3 = (recordHeaderV3_t *)outBuff;
+    if ((recordHeaderV3->size + sequencer->outLength) > outSize) {
+        dbg_printf("Size error add output elements: header size: %u, elements size: %zu, output size: %zu\n", recordHeaderV3->size,
+                   sequencer->outLength, outSize);
+        return SEQ_MEM_ERR;
+    }
+
+    uint8_t *outRecord = (uint8_t *)outBuff + recordHeaderV3->size;
+    memcpy(outRecord, sequencer->outImage, sequencer->outLength);
+    for (int i = 0; i < sequencer->numElements; i++) {
+        sequencer->offsetCache[sequencer->elementTable[i].extensionID] = outRecord + sequencer->elementTable[i].offset;
+    }
+
+    for (int i = 0; i < sequencer->numOps; i++) {
+        sequenceOp_t *op = &(sequencer->opTable[i]);
+        const uint8_t *in = inBuff + op->inOffset;
+        uint8_t *out = outRecord + op->outOffset;
+        uint64_t val = 0;
+        switch (op->opCode) {
+            case OpCopy:
+                memcpy(out, in, op->outLength);
+                continue;
+            case OpNum8:
+                val = in[0];
+                *out = val;
+                break;
+            case OpNum16:
+                val = Get_val16(in);
+                *((uint16_t *)out) = val;
+                break;
+            case OpNum32:
+                val = Get_val32(in);
+                *((uint32_t *)out) = val;
+                break;
+            case OpNum64:
+                val = Get_val64(in);
+                *((uint64_t *)out) = val;
+                break;
+            default: {
+                uint64_t valBuff[2] = {0};
+                switch (op->inLength) {
+                    case 1:
+                        valBuff[0] = in[0];
+                        break;
+                    case 2:
+                        valBuff[0] = Get_val16(in);
+                        break;
+                    case 3:
+                        valBuff[0] = Get_val24(in);
+                        break;
+                    case 4:
+                        valBuff[0] = Get_val32(in);
+                        break;
+                    case 5:
+                        valBuff[0] = Get_val40(in);
+                        break;
+                    case 6:
+                        valBuff[0] = Get_val48(in);
+                        break;
+                    case 7:
+                        valBuff[0] = Get_val56(in);
+                        break;
+                    case 8:
+                        valBuff[0] = Get_val64(in);
+                        break;
+                    case 16:
+                        valBuff[0] = Get_val64(in);
+                        valBuff[1] = Get_val64(in + 8);
+                        break;
+                    default:
+                        memcpy(valBuff, in, op->inLength);
+                }
+                val = valBuff[0];
+                switch (op->outLength) {
+                    case 0:
+                        break;
+                    case 1:
+                        *out = valBuff[0];
+                        break;
+                    case 2:
+                        *((uint16_t *)out) = valBuff[0];
+                        break;
+                    case 4:
+                        *((uint32_t *)out) = valBuff[0];
+                        break;
+                    case 8:
+                        *((uint64_t *)out) = valBuff[0];
+                        break;
+                    case 16:
+                        memcpy(out, valBuff, 16);
+                        break;
+                    default:
+                        memcpy(out, valBuff, op->inLength < op->outLength ? op->inLength : op->outLength);
+                }
+            }
+        }
+        if (op->stackID && stack) stack[op->stackID] = val;
+    }
+
+    recordHeaderV3->size += sequencer->outLength;
+    recordHeaderV3->numElements += sequencer->numElements;
+
+    return SEQ_OK;
+
+}  // End of RunCompiledSequencer
+
+// output buffer must provide at least sequencer->recordSize bytes
 int SequencerRun(sequencer_t *sequencer, const void *inBuff, size_t inSize, void *outBuff, size_t outSize, uint64_t *stack) {
     static int nestLevel = 0;
 
+    if (sequencer->opTable) return RunCompiledSequencer(sequencer, inBuff, inSize, outBuff, outSize, stack);
+
     nestLevel++;
     dbg_printf("[%u] Run sequencer ID: %u, inSize: %zu, outSize: %zu\n", nestLevel, sequencer->templateID, inSize, outSize);
 
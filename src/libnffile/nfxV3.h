@@ -787,6 +787,27 @@ typedef struct sequence_s {
     uint16_t stackID;
 } sequence_t;
 
+// compiled sequence operation for fixed length templates
+typedef struct sequenceOp_s {
+#define OpCopy 1
+#define OpNum8 2
+#define OpNum16 3
+#define OpNum32 4
+#define OpNum64 5
+#define OpNumber 6
+    uint16_t opCode;
+    uint16_t stackID;
+    uint16_t inLength;
+    uint16_t outLength;
+    uint32_t inOffset;
+    uint32_t outOffset;
+} sequenceOp_t;
+
+typedef struct sequenceElement_s {
+    uint16_t extensionID;
+    uint16_t offset;
+} sequenceElement_t;
+
 typedef struct sequencer_s {
     struct sequencer_s *next;
     void *offsetCache[MAXEXTENSIONS];
@@ -797,6 +818,13 @@ typedef struct sequencer_s {
     uint32_t numElements;
     size_t inLength;
     size_t outLength;
+    // output space to reserve for a record
+    size_t recordSize;
+    // compiled fixed length template
+    sequenceOp_t *opTable;
+    uint32_t numOps;
+    sequenceElement_t *elementTable;
+    void *outImage;
 } sequencer_t;
 
 #define SEQ_OK 0
@@ -807,8 +835,6 @@ uint16_t *SetupSequencer(sequencer_t *sequencer, sequence_t *sequenceTable, uint
 
 void ClearSequencer(sequencer_t *sequencer);
 
-size_t CalcOutRecordSize(sequencer_t *sequencer, void *in, size_t inSize);
-
 int SequencerRun(sequencer_t *sequencer, const void *inBuff, size_t inSize, void *outBuff, size_t outSize, uint64_t *stack);
 
 void PrintSequencer(sequencer_t *sequencer);
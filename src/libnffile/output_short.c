@@ -49,7 +49,7 @@
 #define IP_STRING_LEN (INET6_ADDRSTRLEN)
 
 static char *FlagsString(uint16_t flags) {
-    static char string[16];
+    static _Thread_local char string[16];
 
     string[0] = flags & 128 ? 'C' : '.';  // Congestion window reduced -  CWR
     string[1] = flags & 64 ? 'E' : '.';   // ECN-Echo
@@ -546,6 +546,8 @@ void flow_record_short(FILE *stream, recordHeaderV3_t *recordHeaderV3) {
         }
     }
 
+    // keep the lines of a record together, if several decoder threads print
+    flockfile(stream);
     fprintf(stream,
             "\n"
             "Flow Record: \n"
@@ -562,5 +564,6 @@ void flow_record_short(FILE *stream, recordHeaderV3_t *recordHeaderV3) {
     for (int i = 0; i < MAXEXTENSIONS; i++) {
         if (record_map.offsetMap[i] && funcPrintRecord[i]) funcPrintRecord[i](stream, &record_map);
     }
+    funlockfile(stream);
 
 }  // flow_record_short
@@ -36,9 +36,15 @@
 #include "config.h"
 #include "nfxV3.h"
 
+// hash table size for the templates of an exporter
+#define TEMPLATE_HASHSIZE 64
+#define TEMPLATE_HASH(id) ((id) & (TEMPLATE_HASHSIZE - 1))
+
 typedef struct templateList_s {
     // linked list
     struct templateList_s *next;
+    // hash chain
+    struct templateList_s *hashNext;
 
     // template information
     time_t updated;  // last update/refresh of template
@@ -117,6 +117,9 @@ typedef struct exporterDomain_s {
     // list of all templates of this exporter
     templateList_t *template;
 
+    // hash table of all templates of this exporter
+    templateList_t *templateHash[TEMPLATE_HASHSIZE];
+
 } exporterDomain_t;
 
 static int ExtensionsEnabled[MAXEXTENSIONS];
@@ -272,7 +275,8 @@ static const struct ipfixReverseMap_s {
 };
 
 // module limited globals
-static uint32_t processed_records;
+// processed_records is counted per decoder thread - printRecord is set once in Init
+static _Thread_local uint32_t processed_records;
 static int printRecord;
 uint32_t defaultSampling;
 
@@ -445,16 +449,17 @@ static int LookupElement(uint16_t type, uint32_t EnterpriseNumber) {
 }  // End of LookupElement
 
 static exporterDomain_t *getExporter(FlowSource_t *fs, uint32_t ObservationDomain) {
-    exporterDomain_t **e = (exporterDomain_t **)&(fs->exporter_data);
+    exporterDomain_t *exporter = (exporterDomain_t *)LookupExporter(fs, 10, ObservationDomain);
+    if (exporter) return exporter;
 
+    // new exporter - append to exporter list
+    exporterDomain_t **e = (exporterDomain_t **)&(fs->exporter_data);
     while (*e) {
-        if ((*e)->info.id == ObservationDomain && (*e)->info.version == 10 && (*e)->info.ip.V6[0] == fs->ip.V6[0] &&
-            (*e)->info.ip.V6[1] == fs->ip.V6[1])
-            return *e;
         e = &((*e)->next);
     }
 
-    char *ipstr = GetExporterIP(fs);
+    char ipstr[INET6_ADDRSTRLEN];
+    GetExporterIP(fs, ipstr, sizeof(ipstr));
 
     // nothing found
     *e = (exporterDomain_t *)calloc(1, sizeof(exporterDomain_t));
@@ -469,6 +474,11 @@ static exporterDomain_t *getExporter(FlowSource_t *fs, uint32_t ObservationDomai
     (*e)->info.sa_family = fs->sa_family;
     (*e)->info.version = 10;
     (*e)->info.sysid = 0;
+    if (!InsertExporter(fs, (exporter_t *)(*e))) {
+        free(*e);
+        *e = NULL;
+        return NULL;
+    }
 
     (*e)->TemplateRecords = 0;
     (*e)->DataRecords = 0;
@@ -603,14 +613,14 @@ static templateList_t *getTemplate(exporterDomain_t *exporter, uint16_t id) {
 
     if (exporter->currentTemplate && (exporter->currentTemplate->id == id)) return exporter->currentTemplate;
 
-    template = exporter->template;
+    template = exporter->templateHash[TEMPLATE_HASH(id)];
     while (template) {
         if (template->id == id) {
             exporter->currentTemplate = template;
             dbg_printf("[%u] Get template - found %u\n", exporter->info.id, id);
             return template;
         }
-        template = template->next;
+        template = template->hashNext;
     }
 
     dbg_printf("[%u] Get template - not found %u\n", exporter->info.id, id);
@@ -634,6 +644,8 @@ static templateList_t *newTemplate(exporterDomain_t *exporter, uint16_t id) {
     template->data = NULL;
 
     exporter->template = template;
+    template->hashNext = exporter->templateHash[TEMPLATE_HASH(id)];
+    exporter->templateHash[TEMPLATE_HASH(id)] = template;
     dbg_printf("[%u] Add new template ID %u\n", exporter->info.id, id);
 
     return template;
@@ -660,6 +672,11 @@ static void removeTemplate(exporterDomain_t *exporter, uint16_t id) {
     // clear table cache, if this is the table to delete
     if (exporter->currentTemplate == template) exporter->currentTemplate = NULL;
 
+    // remove template from hash chain
+    templateList_t **hashSlot = &(exporter->templateHash[TEMPLATE_HASH(id)]);
+    while (*hashSlot != template) hashSlot = &((*hashSlot)->hashNext);
+    *hashSlot = template->hashNext;
+
     if (parent) {
         // remove temeplate from list
         parent->next = template->next;
@@ -701,6 +718,10 @@ static void removeAllTemplates(exporterDomain_t *exporter) {
         template = next;
     }
 
+    exporter->template = NULL;
+    exporter->currentTemplate = NULL;
+    memset((void *)exporter->templateHash, 0, sizeof(exporter->templateHash));
+
 }  // End of removeAllTemplates
 
 static void relinkSequencerList(exporterDomain_t *exporter) {
@@ -1261,6 +1282,7 @@ static void Process_ipfix_data(exporterDomain_t *exporter, uint32_t ExportTime,
         receivedSize = ExtensionsEnabled[EXipReceivedV6ID] ? EXipReceivedV6Size : 0;
     else
         receivedSize = ExtensionsEnabled[EXipReceivedV4ID] ? EXipReceivedV4Size : 0;
+    uint32_t outRecordSize = sizeof(recordHeaderV3_t) + sequencer->recordSize + receivedSize;
 
     while (size_left > 0) {
         if (size_left < 4) {  // rounding pads
@@ -1269,9 +1291,7 @@ static void Process_ipfix_data(exporterDomain_t *exporter, uint32_t ExportTime,
         }
 
         // check for enough space in output buffer
-        uint32_t outRecordSize = CalcOutRecordSize(sequencer, inBuff, size_left);
-
-        if (!IsAvailable(fs->dataBlock, sizeof(recordHeaderV3_t) + outRecordSize + receivedSize)) {
+        if (!IsAvailable(fs->dataBlock, outRecordSize)) {
             // flush block - get an empty one
             fs->dataBlock = WriteBlock(fs->nffile, fs->dataBlock);
         }
@@ -1918,7 +1938,7 @@ void Process_IPFIX(void *in_buff, ssize_t in_buff_cnt, FlowSource_t *fs) {
     void *flowset_header;
 
 #ifdef DEVEL
-    static uint32_t pkg_num = 1;
+    static _Thread_local uint32_t pkg_num = 1;
     printf("Process_ipfix: Next packet: %i\n", pkg_num);
 #endif
 
@@ -141,7 +141,8 @@ static inline exporter_v1_t *getExporter(FlowSource_t *fs, netflow_v1_header_t *
                                      .ip = fs->ip,
                                      .sa_family = fs->sa_family,
                                      .sysid = 0}};
-    char *ipstr = GetExporterIP(fs);
+    char ipstr[INET6_ADDRSTRLEN];
+    GetExporterIP(fs, ipstr, sizeof(ipstr));
     if (fs->sa_family == PF_INET6) {
         (*e)->outRecordSize = baseRecordSize + EXipReceivedV6Size;
         dbg_printf("Process_v1: New IPv6 exporter %s - add EXipReceivedV6\n", ipstr);
@@ -220,7 +220,8 @@ static inline exporter_v5_t *getExporter(FlowSource_t *fs, netflow_v5_header_t *
     (*e)->flows = 0;
     (*e)->first = 1;
 
-    char *ipstr = GetExporterIP(fs);
+    char ipstr[INET6_ADDRSTRLEN];
+    GetExporterIP(fs, ipstr, sizeof(ipstr));
     if (fs->sa_family == PF_INET6) {
         (*e)->outRecordSize = baseRecordSize + EXipReceivedV6Size;
         dbg_printf("Process_v5: New IPv6 exporter %s - add EXipReceivedV6\n", ipstr);
@@ -312,7 +313,9 @@ void Process_v5_v7(void *in_buff, ssize_t in_buff_cnt, FlowSource_t *fs) {
         uint16_t count = ntohs(v5_header->count);
         // input buffer size check for all expected records
         if (size_left < (NETFLOW_V5_HEADER_LENGTH + count * rawRecordSize)) {
-            LogError("Process_v5: Exporter: %s Not enough data to process v5 record. Abort v5/v7 record processing", GetExporterIP(fs));
+            char ipstr[INET6_ADDRSTRLEN];
+            LogError("Process_v5: Exporter: %s Not enough data to process v5 record. Abort v5/v7 record processing",
+                     GetExporterIP(fs, ipstr, sizeof(ipstr)));
             return;
         }
 
@@ -120,6 +120,9 @@ typedef struct exporterDomain_s {
     // list of all templates of this exporter
     templateList_t *template;
 
+    // hash table of all templates of this exporter
+    templateList_t *templateHash[TEMPLATE_HASHSIZE];
+
 } exporterDomain_t;
 
 static int ExtensionsEnabled[MAXEXTENSIONS];
@@ -276,7 +279,8 @@ static const struct v9ReverseMap_s {
 };
 
 // module limited globals
-static uint32_t processed_records;
+// processed_records is counted per decoder thread - printRecord is set once in Init
+static _Thread_local uint32_t processed_records;
 static int printRecord;
 static int32_t defaultSampling;
 
@@ -392,15 +396,17 @@ static int LookupElement(uint16_t type, int EnterpriseNumber) {
 }  // End of LookupElement
 
 static inline exporterDomain_t *getExporter(FlowSource_t *fs, uint32_t exporter_id) {
-    exporterDomain_t **e = (exporterDomain_t **)&(fs->exporter_data);
+    exporterDomain_t *exporter = (exporterDomain_t *)LookupExporter(fs, 9, exporter_id);
+    if (exporter) return exporter;
 
+    // new exporter - append to exporter list
+    exporterDomain_t **e = (exporterDomain_t **)&(fs->exporter_data);
     while (*e) {
-        if ((*e)->info.id == exporter_id && (*e)->info.version == 9 && (*e)->info.ip.V6[0] == fs->ip.V6[0] && (*e)->info.ip.V6[1] == fs->ip.V6[1])
-            return *e;
         e = &((*e)->next);
     }
 
-    char *ipstr = GetExporterIP(fs);
+    char ipstr[INET6_ADDRSTRLEN];
+    GetExporterIP(fs, ipstr, sizeof(ipstr));
 
     // nothing found
     *e = (exporterDomain_t *)calloc(1, sizeof(exporterDomain_t));
@@ -415,6 +421,11 @@ static inline exporterDomain_t *getExporter(FlowSource_t *fs, uint32_t exporter_
     (*e)->info.ip = fs->ip;
     (*e)->info.sa_family = fs->sa_family;
     (*e)->info.sysid = 0;
+    if (!InsertExporter(fs, (exporter_t *)(*e))) {
+        free(*e);
+        *e = NULL;
+        return NULL;
+    }
 
     (*e)->first = 1;
     (*e)->sequence_failure = 0;
@@ -540,14 +551,14 @@ static templateList_t *getTemplate(exporterDomain_t *exporter, uint16_t id) {
 
     if (exporter->currentTemplate && (exporter->currentTemplate->id == id)) return exporter->currentTemplate;
 
-    template = exporter->template;
+    template = exporter->templateHash[TEMPLATE_HASH(id)];
     while (template) {
         if (template->id == id) {
             exporter->currentTemplate = template;
             dbg_printf("[%u] Get template - found %u\n", exporter->info.id, id);
             return template;
         }
-        template = template->next;
+        template = template->hashNext;
     }
 
     dbg_printf("[%u] Get template %u: not found\n", exporter->info.id, id);
@@ -571,6 +582,8 @@ static templateList_t *newTemplate(exporterDomain_t *exporter, uint16_t id) {
     template->data = NULL;
 
     exporter->template = template;
+    template->hashNext = exporter->templateHash[TEMPLATE_HASH(id)];
+    exporter->templateHash[TEMPLATE_HASH(id)] = template;
     dbg_printf("[%u] Add new template ID %u\n", exporter->info.id, id);
 
     return template;
@@ -597,6 +610,11 @@ static void removeTemplate(exporterDomain_t *exporter, uint16_t id) {
     // clear table cache, if this is the table to delete
     if (exporter->currentTemplate == template) exporter->currentTemplate = NULL;
 
+    // remove template from hash chain
+    templateList_t **hashSlot = &(exporter->templateHash[TEMPLATE_HASH(id)]);
+    while (*hashSlot != template) hashSlot = &((*hashSlot)->hashNext);
+    *hashSlot = template->hashNext;
+
     if (parent) {
         // remove temeplate from list
         parent->next = template->next;
@@ -1007,6 +1025,7 @@ static inline void Process_v9_data(exporterDomain_t *exporter, void *data_flowse
         receivedSize = ExtensionsEnabled[EXipReceivedV6ID] ? EXipReceivedV6Size : 0;
     else
         receivedSize = ExtensionsEnabled[EXipReceivedV4ID] ? EXipReceivedV4Size : 0;
+    uint32_t outRecordSize = sizeof(recordHeaderV3_t) + sequencer->recordSize + receivedSize;
 
     while (size_left > 0) {
         if (size_left < 4) {  // rounding pads
@@ -1015,8 +1034,7 @@ static inline void Process_v9_data(exporterDomain_t *exporter, void *data_flowse
         }
 
         // check for enough space in output buffer
-        uint32_t outRecordSize = CalcOutRecordSize(sequencer, inBuff, size_left);
-        if (!IsAvailable(fs->dataBlock, sizeof(recordHeaderV3_t) + outRecordSize + receivedSize)) {
+        if (!IsAvailable(fs->dataBlock, outRecordSize)) {
             // flush block - get an empty one
             fs->dataBlock = WriteBlock(fs->nffile, fs->dataBlock);
         }
@@ -1678,7 +1696,7 @@ void Process_v9(void *in_buff, ssize_t in_buff_cnt, FlowSource_t *fs) {
     ssize_t size_left;
 
 #ifdef DEVEL
-    static int pkg_num = 1;
+    static _Thread_local int pkg_num = 1;
     dbg_printf("\nProcess_v9: Next packet: %i\n", pkg_num++);
 #endif
 
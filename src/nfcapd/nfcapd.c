@@ -29,14 +29,21 @@
  *
  */
 
+// recvmmsg() on Linux
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include <arpa/inet.h>
 #include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <pthread.h>
 #include <signal.h>
 #include <stdarg.h>
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -99,6 +106,62 @@ static int verbose = 0;
 // Define a generic type to get data from socket or pcap file
 typedef ssize_t (*packet_function_t)(int, void *, size_t, int, struct sockaddr *, socklen_t *);
 
+// max number of packets received with one recvmmsg() call
+#define RECV_BATCH 32
+
+// a batch of received packets
+typedef struct packetBatch_s {
+    uint32_t numPackets;
+    void *buffer;  // RECV_BATCH * NETWORK_INPUT_BUFF_SIZE
+    ssize_t size[RECV_BATCH];
+    socklen_t senderSize[RECV_BATCH];
+    struct sockaddr_storage sender[RECV_BATCH];
+#ifdef HAVE_RECVMMSG
+    struct mmsghdr msgs[RECV_BATCH];
+    struct iovec iovecs[RECV_BATCH];
+#endif
+} packetBatch_t;
+
+// receiver thread on its own SO_REUSEPORT socket
+typedef struct receiver_s {
+    pthread_t tid;
+    int socket;
+    int compress;
+} receiver_t;
+
+// ring size of a decoder
+#define DECODER_RINGSIZE (16 * 1024 * 1024)
+#define RING_WRAP 0xFFFFFFFF
+
+// packet in a decoder ring
+typedef struct ringPacket_s {
+    uint32_t size;  // size of ring entry or RING_WRAP
+    uint32_t dataSize;
+    socklen_t senderSize;
+    struct timeval received;
+    struct sockaddr_storage sender;
+    uint8_t data[];
+} ringPacket_t;
+
+// decoder thread and its packet ring
+typedef struct decoder_s {
+    pthread_t tid;
+    int compress;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int done;
+
+    void *ring;
+    size_t readOffset;
+    size_t writeOffset;
+    size_t used;
+
+    // queue counters
+    uint32_t numQueued;
+    uint32_t maxQueued;
+    uint64_t dropped;
+} decoder_t;
+
 /* module limited globals */
 static FlowSource_t *FlowSource;
 
@@ -106,6 +169,21 @@ static int done = 0;
 static int periodic_trigger;
 static int gotSIGCHLD = 0;
 
+// FlowSource list lock for multiple receivers
+static pthread_mutex_t sourceMutex = PTHREAD_MUTEX_INITIALIZER;
+
+// packet repeater
+static pthread_mutex_t repeaterMutex = PTHREAD_MUTEX_INITIALIZER;
+static int repeaterFd = 0;
+
+static _Atomic uint64_t packets;
+static _Atomic uint32_t ignored_packets;
+static _Atomic int receiversDone;
+static _Atomic int receiverError;
+
+static decoder_t *decoders = NULL;
+static int numDecoders = 0;
+
 /* Local function Prototypes */
 static void usage(char *name);
 
@@ -115,7 +193,8 @@ static void IntHandler(int signal);
 
 static inline FlowSource_t *GetFlowSource(struct sockaddr_storage *ss);
 
-static void run(packet_function_t receive_packet, int socket, int pfd, int rfd, time_t twin, time_t t_begin, char *time_extension, int compress);
+static void run(packet_function_t receive_packet, int *sockets, int numSockets, int pfd, int rfd, time_t twin, time_t t_begin, char *time_extension,
+                int compress, int decoderThreads);
 
 /* Functions */
 static void usage(char *name) {
@@ -146,10 +225,13 @@ static void usage(char *name) {
         "-s rate\tset default sampling rate (default 1)\n"
         "-x process\tlaunch process after a new file becomes available\n"
         "-W workers\toptionally set the number of workers to compress flows\n"
+        "-N receivers\tset the number of receiver threads on SO_REUSEPORT sockets\n"
+        "-K decoders\tset the number of decoder threads. 0 decodes in the receivers. (default 0)\n"
         "-z=lzo\t\tLZO compress flows in output file.\n"
         "-z=bz2\t\tBZIP2 compress flows in output file.\n"
         "-z=lz4[:level]\tLZ4 compress flows in output file.\n"
         "-z=zstd[:level]\tZSTD compress flows in output file.\n"
+        "-z=auto[:level]\tSelect LZ4 or strong compression per block.\n"
         "-B bufflen\tSet socket buffer to bufflen bytes\n"
         "-e\t\tExpire data at each cycle.\n"
         "-D\t\tFork to background\n"
@@ -270,17 +352,469 @@ static int SendRepeaterMessage(int fd, void *in_buff, size_t cnt, struct sockadd
     return 0;
 }  // End of SendRepeaterMessage
 
-static void run(packet_function_t receive_packet, int socket, int pfd, int rfd, time_t twin, time_t t_begin, char *time_extension, int compress) {
-    struct sockaddr_storage nf_sender;
-    socklen_t nf_sender_size = sizeof(nf_sender);
+static packetBatch_t *NewBatch(void) {
+    packetBatch_t *batch = calloc(1, sizeof(packetBatch_t));
+    if (!batch) {
+        LogError("calloc() allocation error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+        return NULL;
+    }
 
-    void *in_buff = malloc(NETWORK_INPUT_BUFF_SIZE);
-    if (!in_buff) {
+    batch->buffer = malloc(RECV_BATCH * NETWORK_INPUT_BUFF_SIZE);
+    if (!batch->buffer) {
         LogError("malloc() allocation error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
-        return;
+        free(batch);
+        return NULL;
+    }
+
+#ifdef HAVE_RECVMMSG
+    for (int i = 0; i < RECV_BATCH; i++) {
+        batch->iovecs[i].iov_base = batch->buffer + i * NETWORK_INPUT_BUFF_SIZE;
+        batch->iovecs[i].iov_len = NETWORK_INPUT_BUFF_SIZE;
+        batch->msgs[i].msg_hdr.msg_iov = &batch->iovecs[i];
+        batch->msgs[i].msg_hdr.msg_iovlen = 1;
+        batch->msgs[i].msg_hdr.msg_name = &batch->sender[i];
+    }
+#endif
+
+    return batch;
+
+}  // End of NewBatch
+
+static void FreeBatch(packetBatch_t *batch) {
+    free(batch->buffer);
+    free(batch);
+}  // End of FreeBatch
+
+// receive a batch of packets from socket. Returns the number of packets
+// or -1 on error with errno set
+static ssize_t ReceiveBatch(int socket, packetBatch_t *batch) {
+    batch->numPackets = 0;
+#ifdef HAVE_RECVMMSG
+    for (int i = 0; i < RECV_BATCH; i++) {
+        batch->msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+    }
+    // block for the first packet, then take what is already queued
+    int cnt = recvmmsg(socket, batch->msgs, RECV_BATCH, MSG_WAITFORONE, NULL);
+    if (cnt < 0) return -1;
+
+    for (int i = 0; i < cnt; i++) {
+        batch->size[i] = batch->msgs[i].msg_len;
+        batch->senderSize[i] = batch->msgs[i].msg_hdr.msg_namelen;
+    }
+#else
+    batch->senderSize[0] = sizeof(struct sockaddr_storage);
+    ssize_t size = recvfrom(socket, batch->buffer, NETWORK_INPUT_BUFF_SIZE, 0, (struct sockaddr *)&batch->sender[0], &batch->senderSize[0]);
+    if (size < 0) return -1;
+
+    batch->size[0] = size;
+    int cnt = 1;
+#endif
+    batch->numPackets = cnt;
+
+    return cnt;
+
+}  // End of ReceiveBatch
+
+static void RepeatPacket(void *in_buff, size_t cnt, struct sockaddr_storage *sender, socklen_t sender_size) {
+    pthread_mutex_lock(&repeaterMutex);
+    if (repeaterFd && SendRepeaterMessage(repeaterFd, in_buff, cnt, sender, sender_size) != 0) {
+        LogError("Disable packet repeater due to errors");
+        close(repeaterFd);
+        repeaterFd = 0;
     }
+    pthread_mutex_unlock(&repeaterMutex);
+}  // End of RepeatPacket
+
+// process a single packet. Returns 0 on fatal errors, 1 otherwise
+static int ProcessPacket(void *in_buff, ssize_t cnt, struct sockaddr_storage *nf_sender, socklen_t nf_sender_size, struct timeval *tv,
+                         int compress) {
+    // repeat this packet
+    if (repeaterFd) RepeatPacket(in_buff, cnt, nf_sender, nf_sender_size);
+
+    // get flow source record for current packet, identified by sender IP address
+    // the flow source is locked, while processing the packet
+    ip_addr_t ip;
+    in_port_t port;
+    pthread_mutex_lock(&sourceMutex);
+    FlowSource_t *fs = FindFlowSource(nf_sender, &ip, &port);
+    if (fs == NULL) {
+        fs = AddDynamicSource(&FlowSource, nf_sender);
+        if (fs == NULL) {
+            pthread_mutex_unlock(&sourceMutex);
+            LogError("Skip UDP packet. Ignored packets so far %u packets", atomic_load(&ignored_packets));
+            atomic_fetch_add(&ignored_packets, 1);
+            return 1;
+        }
+        if (InitBookkeeper(&fs->bookkeeper, fs->datadir, getpid()) != BOOKKEEPER_OK) {
+            pthread_mutex_unlock(&sourceMutex);
+            LogError("Failed to initialise bookkeeper for new source");
+            // fatal error
+            return 0;
+        }
+        fs->nffile = OpenNewFile(fs->current, NULL, CREATOR_NFCAPD, compress, NOT_ENCRYPTED);
+        if (!fs->nffile) {
+            pthread_mutex_unlock(&sourceMutex);
+            LogError("Failed to open new collector file");
+            return 0;
+        }
+        fs->dataBlock = WriteBlock(fs->nffile, NULL);
+        SetIdent(fs->nffile, fs->Ident);
+    }
+    pthread_mutex_lock(&fs->mutex);
+    pthread_mutex_unlock(&sourceMutex);
+
+    SetFlowSourceSender(fs, nf_sender, ip, port);
 
+    /* check for too little data - cnt must be > 0 at this point */
+    if (cnt < (ssize_t)sizeof(common_flow_header_t)) {
+        LogError("Ident: %s, Data size error: not enough data for netflow header - cnt: %i", fs->Ident, (int)cnt);
+        fs->bad_packets++;
+        pthread_mutex_unlock(&fs->mutex);
+        return 1;
+    }
+
+    fs->received = *tv;
+    /* Process data - have a look at the common header */
     common_flow_header_t *nf_header = (common_flow_header_t *)in_buff;
+    uint16_t version = ntohs(nf_header->version);
+    switch (version) {
+        case 1:
+            Process_v1(in_buff, cnt, fs);
+            break;
+        case 5:  // fall through
+        case 7:
+            Process_v5_v7(in_buff, cnt, fs);
+            break;
+        case 9:
+            Process_v9(in_buff, cnt, fs);
+            break;
+        case 10:
+            Process_IPFIX(in_buff, cnt, fs);
+            break;
+        case NFD_PROTOCOL:
+            Process_nfd(in_buff, cnt, fs);
+            break;
+        default:
+            // data error, while reading data from socket
+            LogError("Ident: %s, Error reading netflow header: Unexpected netflow version %i", fs->Ident, version);
+            fs->bad_packets++;
+    }
+    // each Process_xx function has to process the entire input buffer, therefore it's empty
+    // now.
+    pthread_mutex_unlock(&fs->mutex);
+
+    return 1;
+
+}  // End of ProcessPacket
+
+/*
+ * decoder pipeline
+ * Receivers copy the packets into the ring of a decoder thread, selected by the
+ * sender IP address. All packets of an exporter are decoded by the same decoder
+ * in the order received, which keeps the template state of the exporter consistent.
+ * If the ring of a decoder is full, the packet is dropped and counted.
+ */
+static uint32_t DecoderIndex(struct sockaddr_storage *sender) {
+    uint32_t hash = 0;
+    if (sender->ss_family == PF_INET6) {
+        uint32_t *addr = (uint32_t *)((struct sockaddr_in6 *)sender)->sin6_addr.s6_addr;
+        hash = addr[0] ^ addr[1] ^ addr[2] ^ addr[3];
+    } else {
+        hash = ((struct sockaddr_in *)sender)->sin_addr.s_addr;
+    }
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6b;
+    hash ^= hash >> 13;
+
+    return hash % numDecoders;
+
+}  // End of DecoderIndex
+
+// copy packet into the ring of its decoder
+static void DispatchPacket(void *in_buff, ssize_t cnt, struct sockaddr_storage *sender, socklen_t senderSize, struct timeval *tv) {
+    decoder_t *decoder = &decoders[DecoderIndex(sender)];
+    size_t need = (sizeof(ringPacket_t) + cnt + 7) & ~(size_t)7;
+
+    pthread_mutex_lock(&decoder->mutex);
+    if (decoder->numQueued == 0) {
+        // ring empty - restart at the beginning
+        decoder->readOffset = decoder->writeOffset = decoder->used = 0;
+    }
+
+    if ((decoder->writeOffset + need) > DECODER_RINGSIZE) {
+        // wrap around - mark the unused tail of the ring
+        size_t waste = DECODER_RINGSIZE - decoder->writeOffset;
+        if ((decoder->used + waste + need) > DECODER_RINGSIZE) {
+            decoder->dropped++;
+            pthread_mutex_unlock(&decoder->mutex);
+            return;
+        }
+        ((ringPacket_t *)(decoder->ring + decoder->writeOffset))->size = RING_WRAP;
+        decoder->used += waste;
+        decoder->writeOffset = 0;
+    } else if ((decoder->used + need) > DECODER_RINGSIZE) {
+        decoder->dropped++;
+        pthread_mutex_unlock(&decoder->mutex);
+        return;
+    }
+
+    ringPacket_t *ringPacket = (ringPacket_t *)(decoder->ring + decoder->writeOffset);
+    ringPacket->size = need;
+    ringPacket->dataSize = cnt;
+    ringPacket->senderSize = senderSize;
+    ringPacket->received = *tv;
+    memcpy((void *)&ringPacket->sender, (void *)sender, senderSize);
+    memcpy(ringPacket->data, in_buff, cnt);
+
+    decoder->writeOffset += need;
+    if (decoder->writeOffset == DECODER_RINGSIZE) decoder->writeOffset = 0;
+    decoder->used += need;
+    decoder->numQueued++;
+    if (decoder->numQueued > decoder->maxQueued) decoder->maxQueued = decoder->numQueued;
+    if (decoder->numQueued == 1) pthread_cond_signal(&decoder->cond);
+    pthread_mutex_unlock(&decoder->mutex);
+
+}  // End of DispatchPacket
+
+static void *decoderThread(void *arg) {
+    decoder_t *decoder = (decoder_t *)arg;
+
+    while (1) {
+        pthread_mutex_lock(&decoder->mutex);
+        while (decoder->numQueued == 0 && !decoder->done) pthread_cond_wait(&decoder->cond, &decoder->mutex);
+        if (decoder->numQueued == 0) {
+            // done and ring drained
+            pthread_mutex_unlock(&decoder->mutex);
+            break;
+        }
+
+        ringPacket_t *ringPacket = (ringPacket_t *)(decoder->ring + decoder->readOffset);
+        if (ringPacket->size == RING_WRAP) {
+            decoder->used -= DECODER_RINGSIZE - decoder->readOffset;
+            decoder->readOffset = 0;
+            ringPacket = (ringPacket_t *)decoder->ring;
+        }
+        pthread_mutex_unlock(&decoder->mutex);
+
+        // the packet stays in the ring until processed
+        int ok = ProcessPacket(ringPacket->data, ringPacket->dataSize, &ringPacket->sender, ringPacket->senderSize, &ringPacket->received,
+                               decoder->compress);
+
+        pthread_mutex_lock(&decoder->mutex);
+        decoder->readOffset += ringPacket->size;
+        if (decoder->readOffset == DECODER_RINGSIZE) decoder->readOffset = 0;
+        decoder->used -= ringPacket->size;
+        decoder->numQueued--;
+        pthread_mutex_unlock(&decoder->mutex);
+
+        if (!ok) {
+            // fatal error - terminate collector
+            atomic_store(&receiverError, 1);
+            done = 1;
+            break;
+        }
+    }
+
+    dbg_printf("Decoder thread done\n");
+    pthread_exit(NULL);
+
+}  // End of decoderThread
+
+static int StartDecoders(int compress) {
+    decoders = calloc(numDecoders, sizeof(decoder_t));
+    if (!decoders) {
+        LogError("calloc() allocation error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+        return 0;
+    }
+
+    sigset_t signalSet, saveSet;
+    sigfillset(&signalSet);
+    pthread_sigmask(SIG_SETMASK, &signalSet, &saveSet);
+
+    for (int i = 0; i < numDecoders; i++) {
+        decoder_t *decoder = &decoders[i];
+        decoder->ring = malloc(DECODER_RINGSIZE);
+        if (!decoder->ring) {
+            LogError("malloc() allocation error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+            numDecoders = i;
+            pthread_sigmask(SIG_SETMASK, &saveSet, NULL);
+            return 0;
+        }
+        decoder->compress = compress;
+        pthread_mutex_init(&decoder->mutex, NULL);
+        pthread_cond_init(&decoder->cond, NULL);
+        int err = pthread_create(&decoder->tid, NULL, decoderThread, (void *)decoder);
+        if (err) {
+            LogError("pthread_create() error in %s line %d: %s", __FILE__, __LINE__, strerror(err));
+            free(decoder->ring);
+            numDecoders = i;
+            pthread_sigmask(SIG_SETMASK, &saveSet, NULL);
+            return 0;
+        }
+    }
+
+    pthread_sigmask(SIG_SETMASK, &saveSet, NULL);
+    LogInfo("Started %d decoders", numDecoders);
+
+    return 1;
+
+}  // End of StartDecoders
+
+// let the decoders drain their rings and terminate
+static void StopDecoders(void) {
+    for (int i = 0; i < numDecoders; i++) {
+        decoder_t *decoder = &decoders[i];
+        pthread_mutex_lock(&decoder->mutex);
+        decoder->done = 1;
+        pthread_cond_signal(&decoder->cond);
+        pthread_mutex_unlock(&decoder->mutex);
+        int err = pthread_join(decoder->tid, NULL);
+        if (err) {
+            LogError("pthread_join() error in %s line %d: %s", __FILE__, __LINE__, strerror(err));
+        }
+        free(decoder->ring);
+        pthread_mutex_destroy(&decoder->mutex);
+        pthread_cond_destroy(&decoder->cond);
+    }
+    free(decoders);
+    decoders = NULL;
+    numDecoders = 0;
+
+}  // End of StopDecoders
+
+// log and reset decoder queue counters
+static void ReportDecoders(void) {
+    uint32_t maxQueued = 0;
+    uint64_t dropped = 0;
+    for (int i = 0; i < numDecoders; i++) {
+        decoder_t *decoder = &decoders[i];
+        pthread_mutex_lock(&decoder->mutex);
+        if (decoder->maxQueued > maxQueued) maxQueued = decoder->maxQueued;
+        dropped += decoder->dropped;
+        decoder->maxQueued = decoder->numQueued;
+        decoder->dropped = 0;
+        pthread_mutex_unlock(&decoder->mutex);
+    }
+    LogInfo("Decoder queue max depth: %u packets, dropped packets: %llu", maxQueued, (unsigned long long)dropped);
+
+}  // End of ReportDecoders
+
+// receiver thread for one or multiple SO_REUSEPORT sockets
+// the kernel distributes the packets by sender, so packets of an exporter stay in order
+static void *receiverThread(void *arg) {
+    receiver_t *receiver = (receiver_t *)arg;
+
+    packetBatch_t *batch = NewBatch();
+    if (!batch) {
+        atomic_store(&receiverError, 1);
+        done = 1;
+        pthread_exit(NULL);
+    }
+
+    while (!atomic_load(&receiversDone)) {
+        ssize_t cnt = ReceiveBatch(receiver->socket, batch);
+        if (cnt < 0) {
+            // socket timeout - check for done
+            if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) {
+                LogError("ReceiveBatch() error in '%s', line '%d': %s", __FILE__, __LINE__, strerror(errno));
+            }
+            continue;
+        }
+        atomic_fetch_add(&packets, cnt);
+
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        for (int i = 0; i < cnt; i++) {
+            void *in_buff = batch->buffer + i * NETWORK_INPUT_BUFF_SIZE;
+            if (numDecoders) {
+                DispatchPacket(in_buff, batch->size[i], &batch->sender[i], batch->senderSize[i], &tv);
+            } else if (ProcessPacket(in_buff, batch->size[i], &batch->sender[i], batch->senderSize[i], &tv, receiver->compress) == 0) {
+                // fatal error - terminate collector
+                atomic_store(&receiverError, 1);
+                done = 1;
+                FreeBatch(batch);
+                pthread_exit(NULL);
+            }
+        }
+    }
+
+    FreeBatch(batch);
+    dbg_printf("Receiver thread %d done\n", receiver->socket);
+    pthread_exit(NULL);
+
+}  // End of receiverThread
+
+// start a receiver thread for each socket. Signals are handled by the main thread
+static receiver_t *StartReceivers(int *sockets, int numSockets, int compress) {
+    receiver_t *receivers = calloc(numSockets, sizeof(receiver_t));
+    if (!receivers) {
+        LogError("calloc() allocation error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+        return NULL;
+    }
+
+    sigset_t signalSet, saveSet;
+    sigfillset(&signalSet);
+    pthread_sigmask(SIG_SETMASK, &signalSet, &saveSet);
+
+    atomic_store(&receiversDone, 0);
+    for (int i = 0; i < numSockets; i++) {
+        // wake up regularly to check for done
+        struct timeval timeout = {.tv_sec = 1, .tv_usec = 0};
+        if (setsockopt(sockets[i], SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) < 0) {
+            LogError("setsockopt(SO_RCVTIMEO) error: %s", strerror(errno));
+        }
+        receivers[i].socket = sockets[i];
+        receivers[i].compress = compress;
+        int err = pthread_create(&receivers[i].tid, NULL, receiverThread, (void *)&receivers[i]);
+        if (err) {
+            LogError("pthread_create() error in %s line %d: %s", __FILE__, __LINE__, strerror(err));
+            atomic_store(&receiversDone, 1);
+            for (int j = 0; j < i; j++) pthread_join(receivers[j].tid, NULL);
+            pthread_sigmask(SIG_SETMASK, &saveSet, NULL);
+            free(receivers);
+            return NULL;
+        }
+    }
+
+    pthread_sigmask(SIG_SETMASK, &saveSet, NULL);
+    LogInfo("Started %d receivers", numSockets);
+
+    return receivers;
+
+}  // End of StartReceivers
+
+static void StopReceivers(receiver_t *receivers, int numSockets) {
+    atomic_store(&receiversDone, 1);
+    for (int i = 0; i < numSockets; i++) {
+        int err = pthread_join(receivers[i].tid, NULL);
+        if (err) {
+            LogError("pthread_join() error in %s line %d: %s", __FILE__, __LINE__, strerror(err));
+        }
+    }
+    free(receivers);
+}  // End of StopReceivers
+
+// lock all flow sources, while the files get rotated
+static void LockFlowSources(void) {
+    pthread_mutex_lock(&sourceMutex);
+    for (FlowSource_t *fs = FlowSource; fs; fs = fs->next) pthread_mutex_lock(&fs->mutex);
+}  // End of LockFlowSources
+
+static void UnlockFlowSources(void) {
+    for (FlowSource_t *fs = FlowSource; fs; fs = fs->next) pthread_mutex_unlock(&fs->mutex);
+    pthread_mutex_unlock(&sourceMutex);
+}  // End of UnlockFlowSources
+
+static void CloseSockets(int *sockets, int numSockets) {
+    for (int i = 0; i < numSockets; i++) close(sockets[i]);
+}  // End of CloseSockets
+
+static void run(packet_function_t receive_packet, int *sockets, int numSockets, int pfd, int rfd, time_t twin, time_t t_begin, char *time_extension,
+                int compress, int decoderThreads) {
+    packetBatch_t *batch = NewBatch();
+    if (!batch) return;
+
+    repeaterFd = rfd;
 
     // Init each netflow source output data buffer
     FlowSource_t *fs = FlowSource;
@@ -302,12 +836,22 @@ static void run(packet_function_t receive_packet, int socket, int pfd, int rfd,
         fs = fs->next;
     }
 
+    // with decoders or multiple sockets, the receiver threads process the packets.
+    // the main thread rotates the files only
+    receiver_t *receivers = NULL;
+    if (decoderThreads || numSockets > 1) {
+        numDecoders = decoderThreads;
+        if (numDecoders && !StartDecoders(compress)) return;
+        receivers = StartReceivers(sockets, numSockets, compress);
+        if (!receivers) return;
+    }
+
     time_t t_start = t_begin;
 
     periodic_trigger = 0;
     ssize_t cnt = 0;
-    uint32_t ignored_packets = 0;
-    uint64_t packets = 0;
+    atomic_store(&packets, 0);
+    atomic_store(&ignored_packets, 0);
 
     // wake up at least at next time slot (twin) + 1s
     alarm(t_start + twin + 1 - time(NULL));
@@ -322,31 +866,48 @@ static void run(packet_function_t receive_packet, int socket, int pfd, int rfd,
 
         /* read next bunch of data into begin of input buffer */
         if (!done) {
+            if (receivers) {
+                // wait for signals or the next rotation
+                sleep(1);
+                cnt = -1;
+                errno = EINTR;
+            } else {
 #ifdef PCAP
-            // Debug code to read from pcap file, or from socket
-            cnt = receive_packet(socket, in_buff, NETWORK_INPUT_BUFF_SIZE, 0, (struct sockaddr *)&nf_sender, &nf_sender_size);
-
-            // in case of reading from file EOF => -2
-            if (cnt == -2) done = 1;
-            if (cnt == 0) {
-                ignored_packets++;
-                packets++;
-                continue;
-            }
+                // Debug code to read from pcap file, or from socket
+                batch->senderSize[0] = sizeof(struct sockaddr_storage);
+                cnt = receive_packet(sockets[0], batch->buffer, NETWORK_INPUT_BUFF_SIZE, 0, (struct sockaddr *)&batch->sender[0],
+                                     &batch->senderSize[0]);
+
+                // in case of reading from file EOF => -2
+                if (cnt == -2) done = 1;
+                if (cnt == 0) {
+                    atomic_fetch_add(&ignored_packets, 1);
+                    atomic_fetch_add(&packets, 1);
+                    continue;
+                }
+                batch->size[0] = cnt;
+                batch->numPackets = cnt > 0 ? 1 : 0;
 #else
-            cnt = recvfrom(socket, in_buff, NETWORK_INPUT_BUFF_SIZE, 0, (struct sockaddr *)&nf_sender, &nf_sender_size);
+                cnt = ReceiveBatch(sockets[0], batch);
 #endif
-
-            if (cnt == -1) {
-                if (errno != EINTR) {
-                    LogError("recvfrom() error in '%s', line '%d', cnt: %d:, %s", __FILE__, __LINE__, cnt, strerror(errno));
-                    continue;
+                if (cnt == -1) {
+                    if (errno != EINTR) {
+                        LogError("ReceiveBatch() error in '%s', line '%d': %s", __FILE__, __LINE__, strerror(errno));
+                        continue;
+                    }
+                } else {
+                    atomic_fetch_add(&packets, batch->numPackets);
                 }
-            } else {
-                packets++;
             }
         }
 
+        if (receivers && atomic_load(&receiverError)) {
+            // fatal error in receiver or decoder
+            StopReceivers(receivers, numSockets);
+            StopDecoders();
+            return;
+        }
+
         /* Periodic file renaming, if time limit reached or if we are done.  */
         gettimeofday(&tv, NULL);
         time_t t_now = tv.tv_sec;
@@ -355,7 +916,17 @@ static void run(packet_function_t receive_packet, int socket, int pfd, int rfd,
             // rotate cycle
             alarm(0);
 
+            // on termination let receivers finish their current batch
+            // and decoders drain their rings
+            if (done && receivers) {
+                StopReceivers(receivers, numSockets);
+                receivers = NULL;
+                StopDecoders();
+            }
+
+            LockFlowSources();
             if (RotateFlowFiles(t_start, time_extension, FlowSource, done) == 0) {
+                UnlockFlowSources();
                 return;
             }
 
@@ -364,9 +935,12 @@ static void run(packet_function_t receive_packet, int socket, int pfd, int rfd,
                 close(pfd);
                 pfd = 0;
             }
+            UnlockFlowSources();
 
-            LogInfo("Total packets received: %llu avg: %3.2f ignored packets: %u", packets, (double)packets / (double)twin, ignored_packets);
-            ignored_packets = 0;
+            uint64_t numPackets = atomic_exchange(&packets, 0);
+            LogInfo("Total packets received: %llu avg: %3.2f ignored packets: %u", numPackets, (double)numPackets / (double)twin,
+                    atomic_exchange(&ignored_packets, 0));
+            if (numDecoders) ReportDecoders();
             periodic_trigger = 0;
 
             if (done) break;
@@ -389,79 +963,16 @@ static void run(packet_function_t receive_packet, int socket, int pfd, int rfd,
             continue;
         }
 
-        // repeat this packet
-        if (rfd) {
-            if (SendRepeaterMessage(rfd, in_buff, cnt, &nf_sender, nf_sender_size) != 0) {
-                LogError("Disable packet repeater due to errors");
-                close(rfd);
-                rfd = 0;
-            }
-        }
-
-        // get flow source record for current packet, identified by sender IP address
-        fs = GetFlowSource(&nf_sender);
-        if (fs == NULL) {
-            fs = AddDynamicSource(&FlowSource, &nf_sender);
-            if (fs == NULL) {
-                LogError("Skip UDP packet. Ignored packets so far %u packets", ignored_packets);
-                ignored_packets++;
-                continue;
-            }
-            if (InitBookkeeper(&fs->bookkeeper, fs->datadir, getpid()) != BOOKKEEPER_OK) {
-                LogError("Failed to initialise bookkeeper for new source");
+        for (uint32_t i = 0; i < batch->numPackets; i++) {
+            void *in_buff = batch->buffer + i * NETWORK_INPUT_BUFF_SIZE;
+            if (ProcessPacket(in_buff, batch->size[i], &batch->sender[i], batch->senderSize[i], &tv, compress) == 0) {
                 // fatal error
                 return;
             }
-            fs->nffile = OpenNewFile(fs->current, NULL, CREATOR_NFCAPD, compress, NOT_ENCRYPTED);
-            if (!fs->nffile) {
-                LogError("Failed to open new collector file");
-                return;
-            }
-            fs->dataBlock = WriteBlock(fs->nffile, NULL);
-            SetIdent(fs->nffile, fs->Ident);
         }
-
-        /* check for too little data - cnt must be > 0 at this point */
-        if (cnt < (ssize_t)sizeof(common_flow_header_t)) {
-            LogError("Ident: %s, Data size error: not enough data for netflow header - cnt: %i", fs->Ident, (int)cnt);
-            fs->bad_packets++;
-            continue;
-        }
-
-        fs->received = tv;
-        /* Process data - have a look at the common header */
-        uint16_t version = ntohs(nf_header->version);
-        switch (version) {
-            case 1:
-                Process_v1(in_buff, cnt, fs);
-                break;
-            case 5:  // fall through
-            case 7:
-                Process_v5_v7(in_buff, cnt, fs);
-                break;
-            case 9:
-                Process_v9(in_buff, cnt, fs);
-                break;
-            case 10:
-                Process_IPFIX(in_buff, cnt, fs);
-                break;
-            case NFD_PROTOCOL:
-                Process_nfd(in_buff, cnt, fs);
-                break;
-            default:
-                // data error, while reading data from socket
-                LogError("Ident: %s, Error reading netflow header: Unexpected netflow version %i", fs->Ident, version);
-                fs->bad_packets++;
-                continue;
-
-                // not reached
-                break;
-        }
-        // each Process_xx function has to process the entire input buffer, therefore it's empty
-        // now.
     }
 
-    free(in_buff);
+    FreeBatch(batch);
 
     fs = FlowSource;
     while (fs) {
@@ -483,7 +994,8 @@ int main(int argc, char **argv) {
     FlowSource_t *fs;
     int family, bufflen, metricInterval;
     time_t twin;
-    int sock, do_daemonize, expire, spec_time_extension, workers;
+    int sockets[MAXWORKERS];
+    int numSockets, decoderThreads, do_daemonize, expire, spec_time_extension, workers;
     int subdir_index, sampling_rate, compress, srcSpoofing;
 #ifdef PCAP
     char *pcap_file = NULL;
@@ -518,9 +1030,11 @@ int main(int argc, char **argv) {
     metricInterval = 60;
     extensionList = NULL;
     workers = 0;
+    numSockets = 1;
+    decoderThreads = 0;
 
     int c;
-    while ((c = getopt(argc, argv, "46AB:b:C:d:DeEf:g:hI:i:jJ:l:m:M:n:p:P:R:s:S:t:T:u:vVW:w:x:X:yz::Z")) != EOF) {
+    while ((c = getopt(argc, argv, "46AB:b:C:d:DeEf:g:hI:i:jJ:K:l:m:M:n:N:p:P:R:s:S:t:T:u:vVW:w:x:X:yz::Z")) != EOF) {
         switch (c) {
             case 'h':
                 usage(argv[0]);
@@ -717,6 +1231,22 @@ int main(int argc, char **argv) {
                     exit(EXIT_FAILURE);
                 }
                 break;
+            case 'K':
+                CheckArgLen(optarg, 16);
+                decoderThreads = atoi(optarg);
+                if (decoderThreads < 0 || decoderThreads > MAXWORKERS) {
+                    LogError("Number of decoder threads out of range 0..%d", MAXWORKERS);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'N':
+                CheckArgLen(optarg, 16);
+                numSockets = atoi(optarg);
+                if (numSockets < 1 || numSockets > MAXWORKERS) {
+                    LogError("Number of receiver threads out of range 1..%d", MAXWORKERS);
+                    exit(EXIT_FAILURE);
+                }
+                break;
             case 'j':
                 if (compress) {
                     LogError("Use one compression: -z for LZO, -j for BZ2 or -y for LZ4 compression");
@@ -830,9 +1360,19 @@ int main(int argc, char **argv) {
         exit(EXIT_FAILURE);
     }
 
+    if (numSockets > 1 && mcastgroup) {
+        LogError("ERROR, multiple receivers -N require a unicast socket");
+        exit(EXIT_FAILURE);
+    }
+
+    int sock;
 // Debug code to read from pcap file
 #ifdef PCAP
     sock = 0;
+    if (pcap_file || pcap_device) {
+        numSockets = 1;
+        decoderThreads = 0;
+    }
     if (pcap_file) {
         printf("Setup pcap file reader\n");
         if (!setup_pcap_offline(pcap_file, NULL)) {
@@ -852,13 +1392,23 @@ int main(int argc, char **argv) {
         if (mcastgroup)
         sock = Multicast_receive_socket(mcastgroup, listenport, family, bufflen);
     else
-        sock = Unicast_receive_socket(bindhost, listenport, family, bufflen);
+        sock = Unicast_receive_socket(bindhost, listenport, family, bufflen, numSockets > 1);
 
     if (sock == -1) {
         LogError("Terminated due to errors");
         exit(EXIT_FAILURE);
     }
 
+    // additional receiver sockets bound to the same port
+    sockets[0] = sock;
+    for (int i = 1; i < numSockets; i++) {
+        sockets[i] = Unicast_receive_socket(bindhost, listenport, family, bufflen, 1);
+        if (sockets[i] == -1) {
+            LogError("Terminated due to errors");
+            exit(EXIT_FAILURE);
+        }
+    }
+
     pid_t repeater_pid = 0;
     int rfd = 0;
     if (repeater[0].hostname) {
@@ -873,7 +1423,7 @@ int main(int argc, char **argv) {
     }
 
     if (subdir_index && !InitHierPath(subdir_index)) {
-        close(sock);
+        CloseSockets(sockets, numSockets);
         exit(EXIT_FAILURE);
     }
 
@@ -890,7 +1440,7 @@ int main(int argc, char **argv) {
     }
 
     if (metricSocket && !OpenMetric(metricSocket, metricInterval)) {
-        close(sock);
+        CloseSockets(sockets, numSockets);
         exit(EXIT_FAILURE);
     }
 
@@ -911,7 +1461,7 @@ int main(int argc, char **argv) {
                 ReleaseBookkeeper(fs->bookkeeper, DESTROY_BOOKKEEPER);
                 fs = fs->next;
             }
-            close(sock);
+            CloseSockets(sockets, numSockets);
             signalPrivsepChild(launcher_pid, pfd);
             signalPrivsepChild(repeater_pid, rfd);
             if (pidfile) remove_pid(pidfile);
@@ -935,10 +1485,12 @@ int main(int argc, char **argv) {
     sigaction(SIGPIPE, &act, NULL);
 
     LogInfo("Startup nfcapd.");
-    run(receive_packet, sock, pfd, rfd, twin, t_start, time_extension, compress);
+    run(receive_packet, sockets, numSockets, pfd, rfd, twin, t_start, time_extension, compress, decoderThreads);
+    // finish rotated files, which may still be pending after a fatal error
+    StopFinisher();
 
     // shutdown
-    close(sock);
+    CloseSockets(sockets, numSockets);
     signalPrivsepChild(launcher_pid, pfd);
     signalPrivsepChild(repeater_pid, rfd);
     CloseMetric();
@@ -217,4 +217,99 @@ void blocksort(SortElement_t *data, int len) {
     while (n_threads > 0) pthread_cond_wait(&cond, &mutex);
     pthread_mutex_unlock(&mutex);
 
-}  // End of blocksort
\ No newline at end of file
+}  // End of blocksort
+
+// element a ranks before element b, if it gets printed first
+// equal counts rank by their position in data, as a stable sort would do
+static inline int ranks_before(SortElement_t *data, uint32_t a, uint32_t b, int ascending) {
+    if (data[a].count != data[b].count) return ascending ? data[a].count < data[b].count : data[a].count > data[b].count;
+    return a < b;
+}  // End of ranks_before
+
+// sift down element i in heap of n element indices
+// the root heap[0] is the selected element, which ranks last
+static inline void sift_down(SortElement_t *data, uint32_t *heap, int n, int i, int ascending) {
+    while (1) {
+        int last = i;
+        int l = 2 * i + 1;
+        int r = l + 1;
+        if (l < n && ranks_before(data, heap[last], heap[l], ascending)) last = l;
+        if (r < n && ranks_before(data, heap[last], heap[r], ascending)) last = r;
+        if (last == i) return;
+        uint32_t h = heap[i];
+        heap[i] = heap[last];
+        heap[last] = h;
+        i = last;
+    }
+}  // End of sift_down
+
+/*
+ * sort only the topN elements, which get printed. data remains a permutation of all elements
+ * ascending: the topN smallest elements are sorted into data[0] .. data[topN-1]
+ * otherwise: the topN largest elements are sorted into data[len-topN] .. data[len-1]
+ * selection is done with a bounded heap of topN elements, so only topN elements need a full sort.
+ * Elements with equal counts are printed in the order they appear in data, so the output for
+ * a smaller topN is always the beginning of the output for a larger one.
+ */
+void topNsort(SortElement_t *data, int len, int topN, int ascending) {
+    // no limit - sort all elements
+    if (topN <= 0) {
+        blocksort(data, len);
+        return;
+    }
+    if (topN > len) topN = len;
+
+    uint32_t *heap = (uint32_t *)malloc(topN * sizeof(uint32_t));
+    SortElement_t *top = (SortElement_t *)malloc(topN * sizeof(SortElement_t));
+    uint8_t *selected = (uint8_t *)calloc((len >> 3) + 1, 1);
+    if (!heap || !top || !selected) {
+        free(heap);
+        free(top);
+        free(selected);
+        blocksort(data, len);
+        return;
+    }
+
+    // bounded heap of the topN elements ranked first so far
+    for (int i = 0; i < topN; i++) heap[i] = i;
+    for (int i = (topN >> 1) - 1; i >= 0; i--) sift_down(data, heap, topN, i, ascending);
+    for (int i = topN; i < len; i++) {
+        if (ranks_before(data, i, heap[0], ascending)) {
+            heap[0] = i;
+            sift_down(data, heap, topN, 0, ascending);
+        }
+    }
+
+    // heap sort - heap[0] .. heap[topN-1] becomes the print order
+    for (int n = topN - 1; n > 0; n--) {
+        uint32_t h = heap[0];
+        heap[0] = heap[n];
+        heap[n] = h;
+        sift_down(data, heap, n, 0, ascending);
+    }
+
+    for (int i = 0; i < topN; i++) {
+        top[i] = data[heap[i]];
+        selected[heap[i] >> 3] |= 1 << (heap[i] & 0x7);
+    }
+
+    // move the remaining elements out of the print region and place the topN elements in print order
+    if (ascending) {
+        int w = len - 1;
+        for (int i = len - 1; i >= 0; i--) {
+            if ((selected[i >> 3] & (1 << (i & 0x7))) == 0) data[w--] = data[i];
+        }
+        for (int i = 0; i < topN; i++) data[i] = top[i];
+    } else {
+        int w = 0;
+        for (int i = 0; i < len; i++) {
+            if ((selected[i >> 3] & (1 << (i & 0x7))) == 0) data[w++] = data[i];
+        }
+        for (int i = 0; i < topN; i++) data[len - 1 - i] = top[i];
+    }
+
+    free(heap);
+    free(top);
+    free(selected);
+
+}  // End of topNsort
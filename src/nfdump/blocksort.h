@@ -44,4 +44,6 @@ typedef struct SortElement_s {
 
 void blocksort(SortElement_t *data, int len);
 
+void topNsort(SortElement_t *data, int len, int topN, int ascending);
+
 #endif  //_BLOCKSORT_H
@@ -83,6 +83,13 @@ typedef struct dataHandle_s {
     dataBlock_t *dataBlock;
     char *ident;
     uint64_t recordCnt;
+    // sequence number of the block
+    uint64_t blockNum;
+    // extension offsets of all passed records, set by the filter workers:
+    // number of extensions n, followed by n pairs of extension type and offset
+    uint16_t *recordMap;
+    uint32_t mapSize;
+    uint32_t mapUsed;
 } dataHandle_t;
 
 typedef struct prepareArgs_s {
@@ -91,6 +98,36 @@ typedef struct prepareArgs_s {
     uint32_t skippedBlocks;
 } prepareArgs_t;
 
+// number of formatted blocks, which may wait for output
+#define OUTPUTWINDOW 16
+// initial size of an output buffer
+#define OUTPUTBUFFSIZE (1024 * 1024)
+
+/*
+ * ordered output of blocks formatted by the filter workers
+ * workers get the number of records printed before their block in block order,
+ * format the block into the buffer of its output slot and the writer thread writes the slots in block order.
+ * Slot buffers are reused for the following blocks.
+ */
+typedef struct outputQueue_s {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    outputParams_t *outputParams;
+    RecordPrinter_t print_record;
+    // number of printed records of all blocks before block nextCount
+    uint64_t nextCount;
+    uint64_t printCount;
+    // next block to write
+    uint64_t nextWrite;
+    int done;
+    struct outputBuffer_s {
+        char *buffer;
+        size_t capacity;
+        size_t size;
+        int ready;
+    } slot[OUTPUTWINDOW];
+} outputQueue_t;
+
 typedef struct filterArgs_s {
     _Atomic int self;
     int numWorkers;
@@ -99,8 +136,12 @@ typedef struct filterArgs_s {
     int hasGeoDB;
     queue_t *prepareQueue;
     queue_t *processQueue;
+    flowShard_t **flowShards;        // if set, aggregate -A/-s record flows in the filter threads
+    elementShard_t **elementShards;  // if set, collect -s element stats in the filter threads
+    _Atomic int numShards;
     _Atomic uint64_t processedRecords;
     _Atomic uint64_t passedRecords;
+    outputQueue_t *outputQueue;  // if set, format printed records in the filter threads
 } filterArgs_t;
 
 typedef struct filterStat_s {
@@ -115,6 +156,10 @@ static uint32_t skippedBlocks = 0;
 static uint64_t t_first_flow = 0, t_last_flow = 0;
 static _Atomic uint32_t abortProcessing = 0;
 
+// filter engine and time window to skip data blocks using the block index
+static void *blockFilterEngine = NULL;
+static timeWindow_t *blockFilterTimeWindow = NULL;
+
 enum processType { FLOWSTAT = 1, ELEMENTSTAT, ELEMENTFLOWSTAT, SORTRECORDS, WRITEFILE, PRINTRECORD };
 
 extern exporter_t **exporter_list;
@@ -158,12 +203,15 @@ static void usage(char *name) {
         "\t\tand ordered by <order>: packets, bytes, flows, bps pps and bpp.\n"
         "-q\t\tQuiet: Do not print the header and bottom stat lines.\n"
         "-i <ident>\tChange Ident to <ident> in file given by -r.\n"
-        "-J <num>\tModify file compression: 0: uncompressed - 1: LZO - 2: BZ2 - 3: LZ4 - 4: ZSTD"
+        "-J <num>\tModify file compression: 0: uncompressed - 1: LZO - 2: BZ2 - 3: LZ4 - 4: ZSTD - 5: auto"
         "compressed.\n"
+        "-K <dict>\tTrain a ZSTD dictionary from the files given by -r/-R and save it in <dict>.\n"
+        "-Y\t\tWrite data blocks in columnar layout with -w or -J.\n"
         "-z=lzo\t\tLZO compress flows in output file.\n"
         "-z=bz2\t\tBZIP2 compress flows in output file.\n"
         "-z=lz4[:level]\tLZ4 compress flows in output file.\n"
         "-z=zstd[:level]\tZSTD compress flows in output file.\n"
+        "-z=auto[:level]\tSelect LZ4 or strong compression per block.\n"
         "-l <expr>\tSet limit on packets for line and packed output format.\n"
         "\t\tkey: 32 character string or 64 digit hex string starting with 0x.\n"
         "-L <expr>\tSet limit on bytes for line and packed output format.\n"
@@ -192,7 +240,7 @@ static void usage(char *name) {
         "\t\t\tmode may be extended by '6' for full IPv6 listing. e.g.long6, extended6.\n"
         "-E <file>\tPrint exporter and sampling info for collected flows.\n"
         "-v <file>\tverify netflow data file. Print version and blocks.\n"
-        "-W <num>\tOptionally set the number of workers to compress flows\n"
+        "-W <num>\tOptionally set the number of workers to compress/uncompress flows\n"
         "-x <file>\tverify extension records in netflow data file.\n"
         "-X\t\tDump Filtertable and exit (debug option).\n"
         "-Z\t\tCheck filter syntax and exit.\n"
@@ -267,6 +315,17 @@ static int SetStat(char *str, int *element_stat, int *flow_stat) {
 
 }  // End of SetStat
 
+// returns 0, if no record of a data block can match the time window and the filter
+static int BlockFilter(const blockIndex_t *blockIndex) {
+    if (blockFilterTimeWindow) {
+        // same time window test as in filterThread()
+        uint64_t twin_msecFirst = blockFilterTimeWindow->first * 1000LL;
+        uint64_t twin_msecLast = blockFilterTimeWindow->last ? blockFilterTimeWindow->last * 1000LL : 0x7FFFFFFFFFFFFFFFLL;
+        if (blockIndex->msecFirstMax <= twin_msecFirst || blockIndex->msecLastMin >= twin_msecLast) return 0;
+    }
+    return blockFilterEngine ? FilterBlock(blockFilterEngine, blockIndex) : 1;
+}  // End of BlockFilter
+
 __attribute__((noreturn)) static void *prepareThread(void *arg) {
     prepareArgs_t *prepareArgs = (prepareArgs_t *)arg;
 
@@ -285,6 +344,7 @@ __attribute__((noreturn)) static void *prepareThread(void *arg) {
 
     dataHandle_t *dataHandle = NULL;
     uint64_t recordCnt = 0;
+    uint64_t blockNum = 0;
     int processedBlocks = 0;
     int skippedBlocks = 0;
 
@@ -298,6 +358,8 @@ __attribute__((noreturn)) static void *prepareThread(void *arg) {
 
         // get next data block from file
         if (dataHandle->dataBlock == NULL) {
+            // blocks skipped by the block index
+            skippedBlocks += nffile->skippedBlocks;
             // continue with next file
             if (GetNextFile(nffile) == NULL) {
                 done = 1;
@@ -323,6 +385,9 @@ __attribute__((noreturn)) static void *prepareThread(void *arg) {
             case DATA_BLOCK_TYPE_3:
                 // processed blocks
                 break;
+            case DATA_BLOCK_TYPE_5:
+                // columnar blocks - restored by the filter threads
+                break;
             case DATA_BLOCK_TYPE_4:
                 // silently skipped
                 goto SKIP;
@@ -335,6 +400,7 @@ __attribute__((noreturn)) static void *prepareThread(void *arg) {
         }
 
         dataHandle->recordCnt = recordCnt;
+        dataHandle->blockNum = blockNum++;
         recordCnt += (uint64_t)dataHandle->dataBlock->NumRecords;
         queue_push(prepareQueue, (void *)dataHandle);
         dataHandle = NULL;
@@ -355,6 +421,217 @@ __attribute__((noreturn)) static void *prepareThread(void *arg) {
 
 }  // End of prepareThread
 
+// append the extension offsets of a passed record to the record map of the block
+static void AddRecordMap(dataHandle_t *dataHandle, const recordHandle_t *recordHandle) {
+    uint32_t required = dataHandle->mapUsed + 1 + 2 * recordHandle->numMapped;
+    if (required > dataHandle->mapSize) {
+        uint32_t mapSize = dataHandle->mapSize ? 2 * dataHandle->mapSize : 4096;
+        while (mapSize < required) mapSize *= 2;
+        uint16_t *recordMap = realloc(dataHandle->recordMap, mapSize * sizeof(uint16_t));
+        if (!recordMap) {
+            LogError("realloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+            exit(255);
+        }
+        dataHandle->recordMap = recordMap;
+        dataHandle->mapSize = mapSize;
+    }
+
+    uint16_t *map = dataHandle->recordMap + dataHandle->mapUsed;
+    *map++ = recordHandle->numMapped;
+    for (int i = 0; i < recordHandle->numMapped; i++) {
+        uint32_t type = recordHandle->mapped[i];
+        *map++ = type;
+        *map++ = (uint16_t)((void *)recordHandle->extensionList[type] - (void *)recordHandle->recordHeaderV3);
+    }
+    dataHandle->mapUsed = required;
+
+}  // End of AddRecordMap
+
+// set the passed flag of a batch of filtered records and add the passed records to the shards and the record map
+static uint64_t FlushBatch(void *engine, dataHandle_t *dataHandle, recordHandle_t *recordHandles, uint32_t numRecords, uint64_t active,
+                           flowShard_t *flowShard, elementShard_t *elementShard) {
+    uint64_t passed = active ? FilterRecordBatch(engine, recordHandles, numRecords, active) : 0;
+    for (int i = 0; i < numRecords; i++) {
+        recordHandle_t *recordHandle = &recordHandles[i];
+        // the flow cache copies the record - set the passed flag after the record is aggregated
+        ClearFlag(recordHandle->recordHeaderV3->flags, V3_FLAG_PASSED);
+        if (passed & (1ULL << i)) {  // record passed all filters
+            AddRecordMap(dataHandle, recordHandle);
+            if (flowShard) AddFlowShard(flowShard, recordHandle);
+            if (elementShard) AddElementShard(elementShard, recordHandle);
+            SetFlag(recordHandle->recordHeaderV3->flags, V3_FLAG_PASSED);
+        }
+    }
+    return __builtin_popcountll(passed);
+
+}  // End of FlushBatch
+
+static outputQueue_t *NewOutputQueue(outputParams_t *outputParams, RecordPrinter_t print_record) {
+    outputQueue_t *outputQueue = calloc(1, sizeof(outputQueue_t));
+    if (!outputQueue) {
+        LogError("calloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+        return NULL;
+    }
+    pthread_mutex_init(&outputQueue->mutex, NULL);
+    pthread_cond_init(&outputQueue->cond, NULL);
+    outputQueue->outputParams = outputParams;
+    outputQueue->print_record = print_record;
+    return outputQueue;
+}  // End of NewOutputQueue
+
+static void DisposeOutputQueue(outputQueue_t *outputQueue) {
+    for (int i = 0; i < OUTPUTWINDOW; i++) free(outputQueue->slot[i].buffer);
+    pthread_mutex_destroy(&outputQueue->mutex);
+    pthread_cond_destroy(&outputQueue->cond);
+    free(outputQueue);
+}  // End of DisposeOutputQueue
+
+/*
+ * format all passed records of a block into the buffer of its output slot and queue it for the writer
+ * numPassed is the number of passed records of the block
+ */
+static void FormatBlock(outputQueue_t *outputQueue, dataHandle_t *dataHandle, uint64_t numPassed, recordHandle_t *recordHandle) {
+    uint64_t blockNum = dataHandle->blockNum;
+
+    // wait for the number of records printed before this block
+    pthread_mutex_lock(&outputQueue->mutex);
+    while (outputQueue->nextCount != blockNum) pthread_cond_wait(&outputQueue->cond, &outputQueue->mutex);
+    uint64_t printCount = outputQueue->printCount;
+    outputQueue->printCount += numPassed;
+    outputQueue->nextCount++;
+    pthread_cond_broadcast(&outputQueue->cond);
+
+    // wait for the output slot of this block to be written
+    while (blockNum >= (outputQueue->nextWrite + OUTPUTWINDOW)) pthread_cond_wait(&outputQueue->cond, &outputQueue->mutex);
+    pthread_mutex_unlock(&outputQueue->mutex);
+
+    // the slot is owned by this thread until ready
+    struct outputBuffer_s *slot = &outputQueue->slot[blockNum % OUTPUTWINDOW];
+    slot->size = 0;
+    while (numPassed) {
+        if (slot->capacity == 0) {
+            slot->capacity = OUTPUTBUFFSIZE;
+            slot->buffer = malloc(slot->capacity);
+            if (!slot->buffer) {
+                LogError("malloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+                exit(255);
+            }
+        }
+        FILE *stream = fmemopen(slot->buffer, slot->capacity, "w");
+        if (!stream) {
+            LogError("fmemopen() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+            exit(255);
+        }
+        SetPrintCount(outputQueue->outputParams, printCount);
+
+        dataBlock_t *dataBlock = dataHandle->dataBlock;
+        const uint16_t *recordMap = dataHandle->recordMap;
+        record_header_t *record_ptr = GetCursor(dataBlock);
+        uint64_t recordCounter = dataHandle->recordCnt;
+        for (int i = 0; i < dataBlock->NumRecords; i++) {
+            recordCounter++;
+            recordHeaderV3_t *recordHeaderV3 = (recordHeaderV3_t *)record_ptr;
+            if (record_ptr->type == V3Record && TestFlag(recordHeaderV3->flags, V3_FLAG_PASSED)) {
+                uint32_t numOffsets = *recordMap++;
+                MapRecordOffsets(recordHandle, recordHeaderV3, recordCounter, recordMap, numOffsets);
+                recordMap += 2 * numOffsets;
+                outputQueue->print_record(stream, recordHandle, outputQueue->outputParams->doTag);
+            }
+            record_ptr = (record_header_t *)((void *)record_ptr + record_ptr->size);
+        }
+        fflush(stream);
+        long size = ftell(stream);
+        fclose(stream);
+
+        if (size >= 0 && (size_t)size < (slot->capacity - 1)) {
+            slot->size = size;
+            break;
+        }
+        // buffer too small - format block again with a larger buffer
+        slot->capacity *= 2;
+        char *buffer = realloc(slot->buffer, slot->capacity);
+        if (!buffer) {
+            LogError("realloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+            exit(255);
+        }
+        slot->buffer = buffer;
+    }
+
+    pthread_mutex_lock(&outputQueue->mutex);
+    slot->ready = 1;
+    pthread_cond_broadcast(&outputQueue->cond);
+    pthread_mutex_unlock(&outputQueue->mutex);
+
+}  // End of FormatBlock
+
+// write the formatted blocks in block order to stdout
+__attribute__((noreturn)) static void *writerThread(void *arg) {
+    outputQueue_t *outputQueue = (outputQueue_t *)arg;
+
+    while (1) {
+        pthread_mutex_lock(&outputQueue->mutex);
+        struct outputBuffer_s *slot = &outputQueue->slot[outputQueue->nextWrite % OUTPUTWINDOW];
+        while (!slot->ready && !outputQueue->done) pthread_cond_wait(&outputQueue->cond, &outputQueue->mutex);
+        if (!slot->ready) {
+            // done and all blocks written
+            pthread_mutex_unlock(&outputQueue->mutex);
+            break;
+        }
+        pthread_mutex_unlock(&outputQueue->mutex);
+
+        char *ptr = slot->buffer;
+        size_t size = slot->size;
+        while (size) {
+            ssize_t ret = write(STDOUT_FILENO, ptr, size);
+            if (ret < 0) {
+                if (errno == EINTR) continue;
+                LogError("write() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+                abortProcessing = 1;
+                break;
+            }
+            ptr += ret;
+            size -= ret;
+        }
+
+        // release the slot for the next block
+        pthread_mutex_lock(&outputQueue->mutex);
+        slot->ready = 0;
+        outputQueue->nextWrite++;
+        pthread_cond_broadcast(&outputQueue->cond);
+        pthread_mutex_unlock(&outputQueue->mutex);
+    }
+
+    dbg_printf("writerThread done\n");
+    pthread_exit(NULL);
+
+}  // End of writerThread
+
+/*
+ * evaluate the filter on the columns of a columnar block and restore only the records, which may match.
+ * All other V3 records become placeholders, which keep the position of the record in the block.
+ * Returns an empty block, if the columnar block is corrupt
+ */
+static dataBlock_t *FilterColumnBlock(void *engine, dataBlock_t *columnBlock) {
+    dataBlock_t *rowBlock = NULL;
+    columnView_t *columnView = OpenColumnView(columnBlock);
+    if (columnView) {
+        // without select all records are restored
+        uint8_t *select = malloc(columnView->numRecords);
+        if (select) FilterColumns(engine, columnView, select);
+        rowBlock = RestoreRecords(columnView, select);
+        free(select);
+        CloseColumnView(columnView);
+    }
+
+    if (rowBlock == NULL) {
+        LogError("Corrupt columnar data block. Skip block");
+        rowBlock = NewDataBlock();
+        if (rowBlock == NULL) exit(255);
+    }
+    return rowBlock;
+
+}  // End of FilterColumnBlock
+
 __attribute__((noreturn)) static void *filterThread(void *arg) {
     filterArgs_t *filterArgs = (filterArgs_t *)arg;
 
@@ -383,15 +660,32 @@ __attribute__((noreturn)) static void *filterThread(void *arg) {
             twin_msecLast = 0x7FFFFFFFFFFFFFFFLL;
     }
 
-    recordHandle_t *recordHandle = calloc(1, sizeof(recordHandle_t));
-    if (recordHandle == NULL) {
+    // records are mapped and filtered in batches
+    recordHandle_t *recordHandles = calloc(FILTERBATCHSIZE, sizeof(recordHandle_t));
+    if (recordHandles == NULL) {
         LogError("malloc() error in %s line %d: %s\n", __FILE__, __LINE__, strerror(errno));
         exit(255);
     }
 
+    // thread local flow cache and element stat, merged by process_data() when done
+    int shardIndex = filterArgs->numShards++;
+    flowShard_t *flowShard = NULL;
+    if (filterArgs->flowShards) {
+        flowShard = NewFlowShard();
+        if (flowShard == NULL) exit(255);
+        filterArgs->flowShards[shardIndex] = flowShard;
+    }
+    elementShard_t *elementShard = NULL;
+    if (filterArgs->elementShards) {
+        elementShard = NewElementShard();
+        if (elementShard == NULL) exit(255);
+        filterArgs->elementShards[shardIndex] = elementShard;
+    }
+
     // counters for this thread
     uint64_t processedRecords = 0;
     uint64_t passedRecords = 0;
+    outputQueue_t *outputQueue = filterArgs->outputQueue;
     while (1) {
         // append data blocks
         dataHandle_t *dataHandle = queue_pop(prepareQueue);
@@ -401,9 +695,15 @@ __attribute__((noreturn)) static void *filterThread(void *arg) {
         // sequential record counter from input
         // set with new block
         uint64_t recordCounter = dataHandle->recordCnt;
+        uint64_t blockPassed = passedRecords;
 
         FilterSetParam(engine, dataHandle->ident, hasGeoDB);
 
+        if (dataHandle->dataBlock->type == DATA_BLOCK_TYPE_5) {
+            dataBlock_t *rowBlock = FilterColumnBlock(engine, dataHandle->dataBlock);
+            FreeDataBlock(dataHandle->dataBlock);
+            dataHandle->dataBlock = rowBlock;
+        }
         dataBlock_t *dataBlock = dataHandle->dataBlock;
 
 #ifdef DEVEL
@@ -411,6 +711,8 @@ __attribute__((noreturn)) static void *filterThread(void *arg) {
         printf("Filter thread %i working on next Block: %u, records: %u\n", self, numBlocks, dataBlock->NumRecords);
 #endif
 
+        // validate the record sizes of the block first, so the records of a corrupt block
+        // are dropped, before any of them is aggregated in the shards
         record_header_t *record_ptr = GetCursor(dataBlock);
         uint32_t sumSize = 0;
         for (int i = 0; i < dataBlock->NumRecords; i++) {
@@ -423,9 +725,20 @@ __attribute__((noreturn)) static void *filterThread(void *arg) {
                 }
                 LogError("Corrupt data file. Inconsistent block size in %s line %d\n", __FILE__, __LINE__);
                 LogError("DataBlock: count: %u, size: %u. Found: %u, size: %u", dataBlock->NumRecords, dataBlock->size, i, sumSize);
+                processedRecords += i;
                 sumSize = 0;
                 break;
             }
+            sumSize += record_ptr->size;
+            record_ptr = (record_header_t *)((void *)record_ptr + record_ptr->size);
+        }
+
+        record_ptr = GetCursor(dataBlock);
+        uint32_t numRecords = sumSize ? dataBlock->NumRecords : 0;
+        uint32_t numBatch = 0;
+        uint64_t active = 0;
+        sumSize = 0;
+        for (int i = 0; i < numRecords; i++) {
             sumSize += record_ptr->size;
             processedRecords++;
             recordCounter++;
@@ -438,6 +751,7 @@ __attribute__((noreturn)) static void *filterThread(void *arg) {
                     break;
                 case V3Record: {
                     recordHeaderV3_t *recordHeaderV3 = (recordHeaderV3_t *)record_ptr;
+                    recordHandle_t *recordHandle = &recordHandles[numBatch];
                     int match = MapRecordHandle(recordHandle, recordHeaderV3, recordCounter);
                     // Time based filter
                     // if no time filter is given, the result is always true
@@ -450,15 +764,13 @@ __attribute__((noreturn)) static void *filterThread(void *arg) {
                         }
                     }
 
-                    if (match) {
-                        // filter netflow record with user supplied filter
-                        match = FilterRecord(engine, recordHandle);
-                    }
-                    if (match) {  // record passed all filters
-                        SetFlag(recordHeaderV3->flags, V3_FLAG_PASSED);
-                        passedRecords++;
-                    } else {
-                        ClearFlag(recordHeaderV3->flags, V3_FLAG_PASSED);
+                    // filter netflow record with user supplied filter, when the batch is full
+                    if (match) active |= 1ULL << numBatch;
+                    numBatch++;
+                    if (numBatch == FILTERBATCHSIZE) {
+                        passedRecords += FlushBatch(engine, dataHandle, recordHandles, numBatch, active, flowShard, elementShard);
+                        numBatch = 0;
+                        active = 0;
                     }
 
                 } break;
@@ -471,6 +783,9 @@ __attribute__((noreturn)) static void *filterThread(void *arg) {
                 case VrfNameRecordType:
                     // Silently skip exporter/sampler records
                     break;
+                case SkippedRecordType:
+                    // record of a columnar block, which can not match
+                    break;
 
                 default: {
                     LogError("Skip unknown record: %" PRIu64 " type %i", recordCounter, record_ptr->type);
@@ -480,6 +795,9 @@ __attribute__((noreturn)) static void *filterThread(void *arg) {
             // Advance pointer by number of bytes for netflow record
             record_ptr = (record_header_t *)((void *)record_ptr + record_ptr->size);
         }
+        if (numBatch) passedRecords += FlushBatch(engine, dataHandle, recordHandles, numBatch, active, flowShard, elementShard);
+        // a dropped block prints nothing
+        if (outputQueue) FormatBlock(outputQueue, dataHandle, sumSize ? passedRecords - blockPassed : 0, recordHandles);
         dbg_printf("Filter thread %i push next block: %u\n", self, numBlocks);
         if (sumSize) queue_push(processQueue, dataHandle);
     }
@@ -487,7 +805,7 @@ __attribute__((noreturn)) static void *filterThread(void *arg) {
     queue_close(processQueue);
     dbg_printf("FilterThread %d done. blocks: %u records: %" PRIu64 " \n", self, numBlocks, processedRecords);
 
-    free(recordHandle);
+    free(recordHandles);
     filterArgs->processedRecords += processedRecords;
     filterArgs->passedRecords += passedRecords;
     pthread_exit(NULL);
@@ -498,6 +816,13 @@ static stat_record_t process_data(void *engine, int processMode, char *wfile, Re
     stat_record_t stat_record = {0};
     stat_record.firstseen = 0x7fffffffffffffffLL;
 
+    // skip data blocks, which can not match, if the files have a block index
+    blockFilterEngine = engine;
+    blockFilterTimeWindow = timeWindow;
+    SetBlockFilter(BlockFilter);
+    // columnar blocks are filtered on their columns by the filter threads
+    SetColumnRead(1);
+
     // launch prepareThread
     prepareArgs_t prepareArgs = {.prepareQueue = queue_init(8)};
     pthread_t tidPrepare;
@@ -519,6 +844,41 @@ static stat_record_t process_data(void *engine, int processMode, char *wfile, Re
     };
     queue_producers(filterArgs.processQueue, numWorkers);
 
+    // flow aggregation and element stat are order independent, unless the -c limit applies
+    if ((processMode == FLOWSTAT || processMode == ELEMENTFLOWSTAT) && limitRecords == 0 && ParallelFlowCache()) {
+        filterArgs.flowShards = (flowShard_t **)calloc(numWorkers, sizeof(flowShard_t *));
+        if (!filterArgs.flowShards) {
+            LogError("calloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+            exit(255);
+        }
+    }
+    int flowShards = filterArgs.flowShards != NULL;
+    // element stat must see the records after flow aggregation, if both are requested
+    if ((processMode == ELEMENTSTAT || (processMode == ELEMENTFLOWSTAT && flowShards)) && limitRecords == 0) {
+        filterArgs.elementShards = (elementShard_t **)calloc(numWorkers, sizeof(elementShard_t *));
+        if (!filterArgs.elementShards) {
+            LogError("calloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+            exit(255);
+        }
+    }
+    int elementShards = filterArgs.elementShards != NULL;
+
+    // records are formatted by the filter threads and written in order by the writer thread
+    pthread_t tidWriter;
+    if (processMode == PRINTRECORD && limitRecords == 0 && numWorkers > 1 && ParallelOutput(outputParams)) {
+        filterArgs.outputQueue = NewOutputQueue(outputParams, print_record);
+        if (filterArgs.outputQueue) {
+            // the prolog is already printed
+            fflush(stdout);
+            int err = pthread_create(&tidWriter, NULL, writerThread, (void *)filterArgs.outputQueue);
+            if (err) {
+                LogError("pthread_create() error in %s line %d: %s", __FILE__, __LINE__, strerror(err));
+                exit(255);
+            }
+        }
+    }
+    outputQueue_t *outputQueue = filterArgs.outputQueue;
+
     pthread_t tidFilter[32];
     for (int i = 0; i < numWorkers; i++) {
         int err = pthread_create(&(tidFilter[i]), NULL, filterThread, (void *)&filterArgs);
@@ -558,6 +918,9 @@ static stat_record_t process_data(void *engine, int processMode, char *wfile, Re
         record_header_t *record_ptr = GetCursor(dataBlock);
 
         uint64_t recordCounter = dataHandle->recordCnt;
+        // extension offsets of the passed records
+        const uint16_t *recordMap = dataHandle->recordMap;
+        const uint16_t *recordMapEnd = recordMap + dataHandle->mapUsed;
 
         // successfully read block
         total_bytes += dataBlock->size;
@@ -576,7 +939,14 @@ static stat_record_t process_data(void *engine, int processMode, char *wfile, Re
                     // clear filter flag after use
                     ClearFlag(recordHeaderV3->flags, V3_FLAG_PASSED);
                     totalRecords++;
-                    MapRecordHandle(recordHandle, (recordHeaderV3_t *)record_ptr, recordCounter);
+                    if (recordMap < recordMapEnd) {
+                        // reuse the mapping of the filter worker
+                        uint32_t numOffsets = *recordMap++;
+                        MapRecordOffsets(recordHandle, recordHeaderV3, recordCounter, recordMap, numOffsets);
+                        recordMap += 2 * numOffsets;
+                    } else {
+                        MapRecordHandle(recordHandle, recordHeaderV3, recordCounter);
+                    }
                     // check if we are done, if -c option was set
                     if (limitRecords) abortProcessing = totalRecords >= limitRecords;
 
@@ -584,14 +954,14 @@ static stat_record_t process_data(void *engine, int processMode, char *wfile, Re
 
                     switch (processMode) {
                         case FLOWSTAT:
-                            AddFlowCache(recordHandle);
+                            if (!flowShards) AddFlowCache(recordHandle);
                             break;
                         case ELEMENTSTAT:
-                            AddElementStat(recordHandle);
+                            if (!elementShards) AddElementStat(recordHandle);
                             break;
                         case ELEMENTFLOWSTAT:
-                            AddFlowCache(recordHandle);
-                            AddElementStat(recordHandle);
+                            if (!flowShards) AddFlowCache(recordHandle);
+                            if (!elementShards) AddElementStat(recordHandle);
                             break;
                         case SORTRECORDS:
                             InsertFlow(recordHandle);
@@ -600,7 +970,8 @@ static stat_record_t process_data(void *engine, int processMode, char *wfile, Re
                             dataBlock_w = AppendToBuffer(nffile_w, dataBlock_w, (void *)record_ptr, record_ptr->size);
                             break;
                         case PRINTRECORD:
-                            print_record(stdout, recordHandle, outputParams->doTag);
+                            // already formatted by the filter thread
+                            if (!outputQueue) print_record(stdout, recordHandle, outputParams->doTag);
                             break;
                     }
 
@@ -652,6 +1023,9 @@ static stat_record_t process_data(void *engine, int processMode, char *wfile, Re
                 case CommonRecordV0Type:
                     LogError("Skip lagecy record type: %d", record_ptr->type);
                     break;
+                case SkippedRecordType:
+                    // not restored record of a columnar block
+                    break;
                 default: {
                     LogError("Skip unknown record type %i\n", record_ptr->type);
                 }
@@ -664,6 +1038,7 @@ static stat_record_t process_data(void *engine, int processMode, char *wfile, Re
 
         // free resources
         FreeDataBlock(dataHandle->dataBlock);
+        if (dataHandle->recordMap) free(dataHandle->recordMap);
     }  // while
 
     dbg_printf("processData() done\n");
@@ -692,6 +1067,27 @@ static stat_record_t process_data(void *engine, int processMode, char *wfile, Re
         dbg_printf("processData() filter thread: %d\n", i);
     }
 
+    if (outputQueue) {
+        // all blocks are queued - let the writer finish
+        pthread_mutex_lock(&outputQueue->mutex);
+        outputQueue->done = 1;
+        pthread_cond_broadcast(&outputQueue->cond);
+        pthread_mutex_unlock(&outputQueue->mutex);
+        if (pthread_join(tidWriter, NULL)) {
+            LogError("pthread_join() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+        }
+        DisposeOutputQueue(outputQueue);
+    }
+
+    if (flowShards) {
+        MergeFlowShards(filterArgs.flowShards, filterArgs.numShards);
+        free(filterArgs.flowShards);
+    }
+    if (elementShards) {
+        MergeElementShards(filterArgs.elementShards, filterArgs.numShards);
+        free(filterArgs.elementShards);
+    }
+
     totalPassed = filterArgs.passedRecords;
     skippedBlocks = prepareArgs.skippedBlocks;
     return stat_record;
@@ -741,6 +1137,7 @@ int main(int argc, char **argv) {
     print_order = NULL;
     query_file = NULL;
     ModifyCompress = -1;
+    char *dictFile = NULL;
     aggr_fmt = NULL;
 
     configFile = NULL;
@@ -756,7 +1153,7 @@ int main(int argc, char **argv) {
 
     Ident[0] = '\0';
     int c;
-    while ((c = getopt(argc, argv, "6aA:Bbc:C:D:E:G:s:gH:hn:i:jf:qyz::r:v:w:J:M:NImO:P:R:XZt:TVv:W:x:o:")) != EOF) {
+    while ((c = getopt(argc, argv, "6aA:Bbc:C:D:E:G:s:gH:hn:i:jf:qyz::r:v:w:J:K:M:NImO:P:R:XYZt:TVv:W:x:o:")) != EOF) {
         switch (c) {
             case 'h':
                 usage(argv[0]);
@@ -972,6 +1369,13 @@ int main(int argc, char **argv) {
                     exit(EXIT_FAILURE);
                 }
                 break;
+            case 'K':
+                CheckArgLen(optarg, MAXPATHLEN);
+                dictFile = strdup(optarg);
+                break;
+            case 'Y':
+                SetColumnBlocks(1);
+                break;
             case 'x': {
                 CheckArgLen(optarg, MAXPATHLEN);
                 InitExtensionMaps(NO_EXTENSION_LIST);
@@ -1118,6 +1522,15 @@ int main(int argc, char **argv) {
         exit(EXIT_SUCCESS);
     }
 
+    // Train ZSTD dictionary
+    if (dictFile) {
+        if (!flist.single_file && !flist.multiple_files) {
+            LogError("Expected -r <file> or -R <dir> to train a dictionary\n");
+            exit(EXIT_FAILURE);
+        }
+        exit(TrainZstdDict(dictFile) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
     // Change Ident only
     if (flist.single_file && strlen(Ident) > 0) {
         ChangeIdent(flist.single_file, Ident);
@@ -156,9 +156,13 @@ static struct aggregationElement_s {
 // original flow record attached for later printing the record
 // for -A -s hashkey points to the aggregation key in hash table
 // for -O <sort> next points to next record in list
+// for -A -s recordCnt holds the sequence number of the first record aggregated
 typedef struct FlowHashRecord {
     recordHeaderV3_t *flowrecord;  // orig flow record for printing
-    struct FlowHashRecord *next;   // record chain for flow list, unused otherwise
+    union {
+        struct FlowHashRecord *next;  // record chain for flow list
+        uint64_t recordCnt;           // first record seen in hash - used to merge flow shards
+    };
 
     uint8_t inFlags;   // tcp in flags
     uint8_t outFlags;  // tcp out flags XXX unused currently
@@ -334,6 +338,12 @@ typedef struct flowHash_s {
 // FlowHash var
 static flowHash_t *flowHash = NULL;
 
+// per worker flow hash, merged into flowHash after all records are processed
+struct flowShard_s {
+    flowHash_t *flowHash;
+    void *keyMem;  // recycled key memory for keys > 16 bytes
+};
+
 static flowHash_t *flowHash_init(uint32_t bitSize) {
     flowHash_t *flowHash = calloc(1, sizeof(flowHash_t));
     if (!flowHash) return NULL;
@@ -787,10 +797,11 @@ static inline int New_HashKey(void *keymem, recordHandle_t *recordHandle, int sw
                 case 16: {
                     ((uint64_t *)keymem)[0] = ((uint64_t *)inPtr)[0];
                     ((uint64_t *)keymem)[1] = ((uint64_t *)inPtr)[1];
-                    keymem += sizeof(uint64_t);
+                    keymem += 2 * sizeof(uint64_t);
                 } break;
                 default:
                     memcpy((void *)keymem, inPtr, param->length);
+                    keymem += param->length;
             }
         }
 
@@ -1198,14 +1209,8 @@ char *ParseAggregateMask(char *print_format, char *arg) {
             }
             aggregationTable[index].active = 1;
             aggregateInfo[elementCount++] = index;
-            size_t len = aggregationTable[index].param.length;
-            if (aggregationTable[index].param.af == AF_INET) {
-                // nothing
-            } else if (aggregationTable[index].param.af == AF_INET6) {
-                maxKeyLen += len;
-            } else {
-                maxKeyLen += len;
-            }
+            // a record may carry v4 and v6 alternates of the same element - count both
+            maxKeyLen += aggregationTable[index].param.length;
             index++;
         } while (aggregationTable[index].aggrElement && (strcasecmp(p, aggregationTable[index].aggrElement) == 0));
 
@@ -1435,10 +1440,12 @@ static void AddBidirFlow(recordHandle_t *recordHandle) {
 
 }  // End of AddBidirFlow
 
-void AddFlowCache(recordHandle_t *recordHandle) {
-    dbg_printf("\nEnter %s\n", __func__);
+/*
+ * aggregate record into the flow hash table
+ * keyMem points to the recycled key memory for key sizes > 16 bytes
+ */
+static inline void AddFlowHash(flowHash_t *flowHash, void **keyMem, recordHandle_t *recordHandle) {
     EXgenericFlow_t *genericFlow = (EXgenericFlow_t *)recordHandle->extensionList[EXgenericFlowID];
-    if (!genericFlow) return;
 
     EXcntFlow_t *cntFlow = (EXcntFlow_t *)recordHandle->extensionList[EXcntFlowID];
     uint64_t inPackets = genericFlow->inPackets;
@@ -1452,10 +1459,8 @@ void AddFlowCache(recordHandle_t *recordHandle) {
         aggrFlows = cntFlow->flows ? cntFlow->flows : 1;
     }
 
-    if (bidir_flows) return AddBidirFlow(recordHandle);
-
     void *keymem = NULL;
-    static void *mem = NULL;
+    void *mem = *keyMem;
     recordHeaderV3_t *record = recordHandle->recordHeaderV3;
 
     hashValue_t hashValue = {0};
@@ -1469,7 +1474,7 @@ void AddFlowCache(recordHandle_t *recordHandle) {
     if (maxKeyLen > 16) {
         if (mem == NULL) {
             dbg_printf("Allocate: %zu\n", maxKeyLen);
-            mem = nfmalloc(maxKeyLen);
+            mem = *keyMem = nfmalloc(maxKeyLen);
         } else {
             dbg_printf("Recycle: %zu\n", maxKeyLen);
         }
@@ -1526,14 +1531,139 @@ void AddFlowCache(recordHandle_t *recordHandle) {
         flowHash->records[index].msecFirst = genericFlow->msecFirst;
         flowHash->records[index].msecLast = genericFlow->msecLast;
         flowHash->records[index].swap = NeedSwap(keymem);
+        flowHash->records[index].recordCnt = recordHandle->flowCount;
         void *p = nfmalloc(record->size);
         memcpy((void *)p, record, record->size);
         flowHash->records[index].flowrecord = p;
-        mem = NULL;
+        *keyMem = NULL;
     }
 
+}  // End of AddFlowHash
+
+void AddFlowCache(recordHandle_t *recordHandle) {
+    dbg_printf("\nEnter %s\n", __func__);
+    EXgenericFlow_t *genericFlow = (EXgenericFlow_t *)recordHandle->extensionList[EXgenericFlowID];
+    if (!genericFlow) return;
+
+    if (bidir_flows) return AddBidirFlow(recordHandle);
+
+    static void *mem = NULL;
+    AddFlowHash(flowHash, &mem, recordHandle);
+
 }  // End of AddFlowCache
 
+// bidir aggregation depends on the record order and can not be split into shards
+int ParallelFlowCache(void) { return bidir_flows == 0; }
+
+flowShard_t *NewFlowShard(void) {
+    flowShard_t *flowShard = calloc(1, sizeof(flowShard_t));
+    if (!flowShard) {
+        LogError("calloc() error in %s line %d: %s\n", __FILE__, __LINE__, strerror(errno));
+        return NULL;
+    }
+    flowShard->flowHash = flowHash_init(InitFlowHashBits);
+    if (!flowShard->flowHash) {
+        LogError("calloc() error in %s line %d: %s\n", __FILE__, __LINE__, strerror(errno));
+        free(flowShard);
+        return NULL;
+    }
+
+    return flowShard;
+
+}  // End of NewFlowShard
+
+void AddFlowShard(flowShard_t *flowShard, recordHandle_t *recordHandle) {
+    dbg_printf("\nEnter %s\n", __func__);
+    EXgenericFlow_t *genericFlow = (EXgenericFlow_t *)recordHandle->extensionList[EXgenericFlowID];
+    if (!genericFlow) return;
+
+    AddFlowHash(flowShard->flowHash, &flowShard->keyMem, recordHandle);
+
+}  // End of AddFlowShard
+
+typedef struct shardEntry_s {
+    hashValue_t *cell;
+    FlowHashRecord_t *record;
+} shardEntry_t;
+
+static int shardEntryCmp(const void *p1, const void *p2) {
+    const shardEntry_t *e1 = (const shardEntry_t *)p1;
+    const shardEntry_t *e2 = (const shardEntry_t *)p2;
+    if (e1->record->recordCnt == e2->record->recordCnt) return 0;
+    return e1->record->recordCnt < e2->record->recordCnt ? -1 : 1;
+
+}  // End of shardEntryCmp
+
+/*
+ * merge all flow shards into the flow hash and free the shards.
+ * Entries are merged in the order of their first record, so the flow hash
+ * ends up with the same record order and the same flow records, as if all
+ * records had been added sequentially with AddFlowCache()
+ */
+void MergeFlowShards(flowShard_t **flowShards, int numShards) {
+    dbg_printf("Enter %s\n", __func__);
+
+    size_t numEntries = 0;
+    for (int i = 0; i < numShards; i++) {
+        if (flowShards[i]) numEntries += flowShards[i]->flowHash->count;
+    }
+
+    shardEntry_t *entries = NULL;
+    if (numEntries) {
+        entries = (shardEntry_t *)malloc(numEntries * sizeof(shardEntry_t));
+        if (!entries) {
+            LogError("malloc() error in %s line %d: %s\n", __FILE__, __LINE__, strerror(errno));
+            exit(255);
+        }
+    }
+
+    size_t cnt = 0;
+    for (int i = 0; i < numShards; i++) {
+        if (!flowShards[i]) continue;
+        flowHash_t *shardHash = flowShards[i]->flowHash;
+        for (uint32_t cell = 0; cell < shardHash->capacity; cell++) {
+            if (is_used(shardHash->flags, cell)) {
+                entries[cnt].cell = &(shardHash->cells[cell]);
+                entries[cnt].record = &(shardHash->records[shardHash->cells[cell].index]);
+                cnt++;
+            }
+        }
+    }
+    if (cnt) qsort(entries, cnt, sizeof(shardEntry_t), shardEntryCmp);
+
+    for (size_t i = 0; i < cnt; i++) {
+        int insert;
+        int index = flowHash_add(flowHash, *(entries[i].cell), &insert);
+        FlowHashRecord_t *record = &(flowHash->records[index]);
+        FlowHashRecord_t *shardRecord = entries[i].record;
+        if (insert) {
+            *record = *shardRecord;
+        } else {
+            record->inBytes += shardRecord->inBytes;
+            record->inPackets += shardRecord->inPackets;
+            record->outBytes += shardRecord->outBytes;
+            record->outPackets += shardRecord->outPackets;
+            record->flows += shardRecord->flows;
+            record->inFlags |= shardRecord->inFlags;
+            if (shardRecord->msecFirst < record->msecFirst) record->msecFirst = shardRecord->msecFirst;
+            if (shardRecord->msecLast > record->msecLast) record->msecLast = shardRecord->msecLast;
+        }
+    }
+    free(entries);
+
+    for (int i = 0; i < numShards; i++) {
+        if (!flowShards[i]) continue;
+        flowHash_t *shardHash = flowShards[i]->flowHash;
+        free(shardHash->flags);
+        free(shardHash->cells);
+        free(shardHash->records);
+        free(shardHash);
+        free(flowShards[i]);
+        flowShards[i] = NULL;
+    }
+
+}  // End of MergeFlowShards
+
 // return a linear list of aggregated/listed flows for later sorting
 static SortElement_t *GetSortList(uint64_t *size) {
     dbg_printf("Enter %s\n", __func__);
@@ -1743,7 +1873,7 @@ void PrintFlowStat(RecordPrinter_t print_record, outputParams_t *outputParams) {
                 SortList[i].count = order_mode[order_index].record_function(r);
             }
 
-            blocksort(SortList, maxindex);
+            topNsort(SortList, maxindex, outputParams->topN, PrintDirection);
 
             if (!outputParams->quiet) {
                 if (outputParams->mode == MODE_FMT) {
@@ -1777,7 +1907,7 @@ void PrintFlowTable(RecordPrinter_t print_record, outputParams_t *outputParams,
             SortList[i].count = order_mode[PrintOrder].record_function(r);
         }
 
-        blocksort(SortList, maxindex);
+        topNsort(SortList, maxindex, outputParams->topN, PrintDirection);
 
         PrintSortList(SortList, maxindex, outputParams, GuessDir, print_record, PrintDirection);
     } else {
@@ -42,6 +42,9 @@
 
 #define InitFlowHashBits 23
 
+// per worker flow cache
+typedef struct flowShard_s flowShard_t;
+
 #define SwapFlow(r)                              \
     {                                            \
         uint64_t _tmp_ip[2];                     \
@@ -137,6 +140,14 @@ void InsertFlow(recordHandle_t *recordHandle);
 
 void AddFlowCache(recordHandle_t *recordHandle);
 
+int ParallelFlowCache(void);
+
+flowShard_t *NewFlowShard(void);
+
+void AddFlowShard(flowShard_t *flowShard, recordHandle_t *recordHandle);
+
+void MergeFlowShards(flowShard_t **flowShards, int numShards);
+
 void PrintFlowTable(RecordPrinter_t print_record, outputParams_t *outputParams, int GuessDir);
 
 void PrintFlowStat(RecordPrinter_t print_record, outputParams_t *outputParams);
@@ -242,8 +242,12 @@ typedef struct hashkey_s {
 } hashkey_t;
 
 // value record in hash for element stat
+// recordSeq orders the entries of element shards - hashkey is set by StatTopN()
 typedef struct StatRecord {
-    hashkey_t *hashkey;
+    union {
+        hashkey_t *hashkey;
+        uint64_t recordSeq;  // (record counter << 4) | element index of first insert
+    };
     uint64_t msecFirst;
     uint64_t msecLast;
     uint64_t inBytes;
@@ -342,6 +346,11 @@ static ElementHash_t *ElementHashes[MaxStats] = {0};
 static uint32_t NumStats = 0;  // number of stats in StatRequest
 static int HasGeoDB = 0;
 
+// per worker element hash tables, merged into ElementHashes after all records are processed
+struct elementShard_s {
+    ElementHash_t *elementHashes[MaxStats];
+};
+
 static ElementHash_t *elementHash_init(uint32_t bitSize) {
     ElementHash_t *elementHash = calloc(1, sizeof(ElementHash_t));
     if (elementHash == NULL) return NULL;
@@ -810,7 +819,7 @@ static inline void *JA4S_PreProcess(void *inPtr, recordHandle_t *recordHandle) {
 }  // End of JA4S_PreProcess
 #endif
 
-void AddElementStat(recordHandle_t *recordHandle) {
+static inline void AddElementHash(ElementHash_t **elementHashes, recordHandle_t *recordHandle) {
     EXgenericFlow_t *genericFlow = (EXgenericFlow_t *)recordHandle->extensionList[EXgenericFlowID];
     if (!genericFlow) return;
 
@@ -874,7 +883,7 @@ void AddElementStat(recordHandle_t *recordHandle) {
             }
 
             int insert;
-            StatRecord_t *record = elementHash_add(ElementHashes[i], &hashkey, &insert);
+            StatRecord_t *record = elementHash_add(elementHashes[i], &hashkey, &insert);
             if (insert == 0) {
                 record->inBytes += genericFlow->inBytes;
                 record->inPackets += genericFlow->inPackets;
@@ -897,12 +906,115 @@ void AddElementStat(recordHandle_t *recordHandle) {
                 record->msecFirst = genericFlow->msecFirst;
                 record->msecLast = genericFlow->msecLast;
                 record->flows = numFlows;
+                record->recordSeq = (recordHandle->flowCount << 4) | (index - StatRequest[i].StatType);
             }
             index++;
         } while (StatParameters[index].HeaderInfo == NULL);
     }  // for every requested -s stat
+}  // AddElementHash
+
+void AddElementStat(recordHandle_t *recordHandle) {
+    AddElementHash(ElementHashes, recordHandle);
 }  // AddElementStat
 
+elementShard_t *NewElementShard(void) {
+    elementShard_t *elementShard = calloc(1, sizeof(elementShard_t));
+    if (!elementShard) {
+        LogError("calloc() error in %s line %d: %s\n", __FILE__, __LINE__, strerror(errno));
+        return NULL;
+    }
+
+    for (int i = 0; i < NumStats; i++) {
+        elementShard->elementHashes[i] = elementHash_init(InitStatHashBits);
+        if (!elementShard->elementHashes[i]) {
+            LogError("calloc() error in %s line %d: %s\n", __FILE__, __LINE__, strerror(errno));
+            return NULL;
+        }
+    }
+
+    return elementShard;
+
+}  // End of NewElementShard
+
+void AddElementShard(elementShard_t *elementShard, recordHandle_t *recordHandle) {
+    AddElementHash(elementShard->elementHashes, recordHandle);
+}  // End of AddElementShard
+
+typedef struct shardEntry_s {
+    hashkey_t *key;
+    StatRecord_t *record;
+} shardEntry_t;
+
+static int shardEntryCmp(const void *p1, const void *p2) {
+    const shardEntry_t *e1 = (const shardEntry_t *)p1;
+    const shardEntry_t *e2 = (const shardEntry_t *)p2;
+    if (e1->record->recordSeq == e2->record->recordSeq) return 0;
+    return e1->record->recordSeq < e2->record->recordSeq ? -1 : 1;
+
+}  // End of shardEntryCmp
+
+/*
+ * merge all element shards into ElementHashes and free the shards.
+ * Keys are inserted in the order they were first seen, which results in the same
+ * hash layout and therefore the same output order for equal counts, as if all
+ * records had been added sequentially with AddElementStat()
+ */
+void MergeElementShards(elementShard_t **elementShards, int numShards) {
+    for (int i = 0; i < NumStats; i++) {
+        size_t numEntries = 0;
+        for (int j = 0; j < numShards; j++) {
+            if (elementShards[j]) numEntries += elementShards[j]->elementHashes[i]->count;
+        }
+        if (numEntries == 0) continue;
+
+        shardEntry_t *entries = (shardEntry_t *)malloc(numEntries * sizeof(shardEntry_t));
+        if (!entries) {
+            LogError("malloc() error in %s line %d: %s\n", __FILE__, __LINE__, strerror(errno));
+            exit(255);
+        }
+
+        size_t cnt = 0;
+        for (int j = 0; j < numShards; j++) {
+            if (!elementShards[j]) continue;
+            ElementHash_t *shardHash = elementShards[j]->elementHashes[i];
+            for (uint32_t cell = 0; cell < shardHash->capacity; cell++) {
+                if (shardHash->keys[cell].active) {
+                    entries[cnt].key = &(shardHash->keys[cell].key);
+                    entries[cnt].record = &(shardHash->records[cell]);
+                    cnt++;
+                }
+            }
+        }
+        qsort(entries, cnt, sizeof(shardEntry_t), shardEntryCmp);
+
+        for (size_t j = 0; j < cnt; j++) {
+            int insert;
+            StatRecord_t *record = elementHash_add(ElementHashes[i], entries[j].key, &insert);
+            StatRecord_t *shardRecord = entries[j].record;
+            if (insert) {
+                *record = *shardRecord;
+            } else {
+                record->inBytes += shardRecord->inBytes;
+                record->inPackets += shardRecord->inPackets;
+                record->outBytes += shardRecord->outBytes;
+                record->outPackets += shardRecord->outPackets;
+                record->flows += shardRecord->flows;
+                if (shardRecord->msecFirst < record->msecFirst) record->msecFirst = shardRecord->msecFirst;
+                if (shardRecord->msecLast > record->msecLast) record->msecLast = shardRecord->msecLast;
+            }
+        }
+        free(entries);
+    }
+
+    for (int j = 0; j < numShards; j++) {
+        if (!elementShards[j]) continue;
+        for (int i = 0; i < NumStats; i++) elementHash_free(elementShards[j]->elementHashes[i]);
+        free(elementShards[j]);
+        elementShards[j] = NULL;
+    }
+
+}  // End of MergeElementShards
+
 static void PrintStatLine(stat_record_t *stat, outputParams_t *outputParams, SortElement_t *element, int type, int order_proto, int inout) {
     char valstr[64];
     valstr[0] = '\0';
@@ -1491,7 +1603,7 @@ static SortElement_t *StatTopN(int topN, uint32_t *count, int hash_num, int orde
     *count = numCells;
     dbg_printf("Sort %u flows\n", c);
 
-    if (c > 1) blocksort((SortElement_t *)topN_list, c);
+    if (c > 1) topNsort((SortElement_t *)topN_list, c, topN, direction == ASCENDING);
 
     return topN_list;
 
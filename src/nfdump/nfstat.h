@@ -45,6 +45,9 @@
 
 #define InitStatHashBits 25
 
+// per worker element stat
+typedef struct elementShard_s elementShard_t;
+
 /* Function prototypes */
 int Init_StatTable(int hasGeoDB);
 
@@ -54,6 +57,12 @@ int SetElementStat(char *elementStat, char *orderBy);
 
 void AddElementStat(recordHandle_t *recordHandle);
 
+elementShard_t *NewElementShard(void);
+
+void AddElementShard(elementShard_t *elementShard, recordHandle_t *recordHandle);
+
+void MergeElementShards(elementShard_t **elementShards, int numShards);
+
 void PrintElementStat(stat_record_t *sum_stat, outputParams_t *outputParams, RecordPrinter_t print_record);
 
 void ListPrintOrder(void);
@@ -380,9 +380,13 @@ __attribute__((noreturn)) void *flow_thread(void *thread_data) {
     fs->bad_packets = 0;
     fs->msecFirst = 0xffffffffffffLL;
     fs->msecLast = 0;
+    int syncCnt = 0;
     while (1) {
         struct FlowNode *Node = Pop_Node(flowParam->NodeList);
-        if (Node->signal == SIGNAL_SYNC) {
+        if (Node->signal == SIGNAL_SYNC && ++syncCnt < flowParam->numWorkers) {
+            // wait for the sync nodes of all packet workers
+        } else if (Node->signal == SIGNAL_SYNC) {
+            syncCnt = 0;
             // Flush Exporter Stat to file
             FlushExporterStats(fs);
             // flush current block and close file
@@ -48,6 +48,7 @@ typedef struct flowParam_s {
     // arguments
     NodeList_t *NodeList;  // pop new nodes from this list
     time_t t_win;
+    int numWorkers;  // number of packet workers sending sync nodes
 
     // flow file
     FlowSource_t *fs;
@@ -50,12 +50,7 @@
 
 static int ExtendCache(void);
 
-static int FlowNodeCMP(struct FlowNode *e1, struct FlowNode *e2);
-
-static void DumpTreeStat(NodeList_t *NodeList);
-
-// Insert the IP RB tree code here
-RB_GENERATE(FlowTree, FlowNode, entry, FlowNodeCMP);
+static void DumpTreeStat(flowTree_t *flowTree, NodeList_t *NodeList);
 
 // Flow Cache to store all nodes
 #define EXPIREINTERVALL 10
@@ -63,10 +58,9 @@ RB_GENERATE(FlowTree, FlowNode, entry, FlowNodeCMP);
 #define ExtentSize 4096
 #define MaxSize (1024 * 1024 * 512)
 static uint32_t FlowCacheSize = 0;
-static time_t lastExpire = 0;
+static uint32_t FlowHashInitSize = 0;
 static uint32_t expireActiveTimeout = 300;
 static uint32_t expireInactiveTimeout = 60;
-static struct FlowNode *FlowElementCache = NULL;
 
 // free list
 static struct FlowNode *FlowNode_FreeList = NULL;
@@ -74,47 +68,73 @@ static pthread_mutex_t m_FreeList = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t c_FreeList = PTHREAD_COND_INITIALIZER;
 static uint32_t EmptyFreeList = 0;
 static uint32_t EmptyFreeListEvents = 0;
-static uint32_t Allocated = 0;
-
-// Flow tree
-static FlowTree_t *FlowTree = NULL;
-static int NumFlows = 0;
-static flowTreeStat_t flowTreeStat = {0};
-
-// Simple unprotected list
-typedef struct FlowNode_list_s {
-    struct FlowNode *list;
-    struct FlowNode *tail;
-    uint32_t size;
-} Linked_list_t;
+static _Atomic uint32_t Allocated = 0;
+
+// per thread node slab - nodes move between the free list and the slabs in batches
+#define NodeBatch 256
+static _Thread_local struct FlowNode *localFreeList = NULL;
+static _Thread_local uint32_t localFree = 0;
+
+#define MinHashSize (64 * 1024)
+#define WheelSize 4096
+#define WheelMask (WheelSize - 1)
+#define NoSlot WheelSize
+#define FragTimeout 15
+
+// Flow cache of a packet thread
+struct flowTree_s {
+    // Flow hash table - open addressing with linear probing
+    struct FlowNode **FlowHash;
+    uint32_t FlowHashSize;
+    uint32_t FlowHashMask;
+    int NumFlows;
+    flowTreeStat_t flowTreeStat;
+
+    // expire wheel - one slot per second, nodes are sorted in by their earliest expire time
+    struct FlowNode **ExpireWheel;
+    time_t wheelTime;
+    time_t lastExpire;
+};
 
 /* Free list handling functions */
-// Get next free node from free list
+// Get next free node from the thread slab. Refill slab from the free list
 struct FlowNode *New_Node(void) {
-    struct FlowNode *node;
+    if (localFreeList == NULL) {
+        pthread_mutex_lock(&m_FreeList);
+        while (FlowNode_FreeList == NULL) {
+            EmptyFreeList = 1;
+            EmptyFreeListEvents++;
+            if (FlowCacheSize < MaxSize) {
+                dbg_printf("Auto expand flow cache\n");
+                if (!ExtendCache()) abort();
+            } else {
+                LogError("Max cache size reached");
+                pthread_cond_wait(&c_FreeList, &m_FreeList);
+            }
+        }
 
-    pthread_mutex_lock(&m_FreeList);
-    while (FlowNode_FreeList == NULL) {
-        EmptyFreeList = 1;
-        EmptyFreeListEvents++;
-        if (FlowCacheSize < MaxSize) {
-            dbg_printf("Auto expand flow cache\n");
-            if (!ExtendCache()) abort();
-        } else {
-            LogError("Max cache size reached");
-            pthread_cond_wait(&c_FreeList, &m_FreeList);
+        // move a batch of nodes into the slab
+        struct FlowNode *node = FlowNode_FreeList;
+        localFreeList = node;
+        localFree = 1;
+        while (node->right && localFree < NodeBatch) {
+            node = node->right;
+            localFree++;
         }
+        FlowNode_FreeList = node->right;
+        node->right = NULL;
+        pthread_mutex_unlock(&m_FreeList);
     }
 
-    node = FlowNode_FreeList;
+    struct FlowNode *node = localFreeList;
     if (node->memflag != NODE_FREE) {
         LogError("New_Node() unexpected error in %s line %d: %s\n", __FILE__, __LINE__, "Tried to allocate a non free Node");
         abort();
     }
 
-    FlowNode_FreeList = node->right;
-    Allocated++;
-    pthread_mutex_unlock(&m_FreeList);
+    localFreeList = node->right;
+    localFree--;
+    atomic_fetch_add_explicit(&Allocated, 1, memory_order_relaxed);
 
     node->left = NULL;
     node->right = NULL;
@@ -124,7 +144,7 @@ struct FlowNode *New_Node(void) {
 
 }  // End of New_Node
 
-// return node into free list
+// return node into the thread slab. Return a batch to the free list, if the slab is full
 void Free_Node(struct FlowNode *node) {
     if (node->memflag == NODE_FREE) {
         LogError("Free_Node() Fatal: Tried to free an already freed Node");
@@ -144,12 +164,24 @@ void Free_Node(struct FlowNode *node) {
 
     memset((void *)node, 0, sizeof(struct FlowNode));
 
-    pthread_mutex_lock(&m_FreeList);
-    node->right = FlowNode_FreeList;
-    node->left = NULL;
+    node->right = localFreeList;
     node->memflag = NODE_FREE;
-    FlowNode_FreeList = node;
-    Allocated--;
+    localFreeList = node;
+    localFree++;
+    atomic_fetch_sub_explicit(&Allocated, 1, memory_order_relaxed);
+
+    if (localFree < (2 * NodeBatch)) return;
+
+    // detach a batch from the slab
+    struct FlowNode *first = localFreeList;
+    struct FlowNode *last = first;
+    for (int i = 1; i < NodeBatch; i++) last = last->right;
+    localFreeList = last->right;
+    localFree -= NodeBatch;
+
+    pthread_mutex_lock(&m_FreeList);
+    last->right = FlowNode_FreeList;
+    FlowNode_FreeList = first;
     if (EmptyFreeList) {
         EmptyFreeList = 0;
         pthread_cond_signal(&c_FreeList);
@@ -187,6 +219,95 @@ static int ExtendCache(void) {
 
 }  // End of ExtendCache
 
+/* flow hash functions */
+static inline uint32_t FlowKeyHash(const struct flowKey_s *flowKey) {
+    _Static_assert((sizeof(struct flowKey_s) % sizeof(uint64_t)) == 0, "flowKey size must be a multiple of 8");
+
+    const uint64_t *key = (const uint64_t *)flowKey;
+    uint64_t hash = 0x9E3779B97F4A7C15ULL;
+    for (int i = 0; i < (sizeof(struct flowKey_s) / sizeof(uint64_t)); i++) {
+        hash ^= key[i];
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 32;
+    }
+
+    return (uint32_t)hash;
+
+}  // End of FlowKeyHash
+
+static inline uint32_t HashSlot(flowTree_t *flowTree, struct FlowNode *node) {
+    uint32_t slot = node->hash & flowTree->FlowHashMask;
+    while (flowTree->FlowHash[slot] != node) slot = (slot + 1) & flowTree->FlowHashMask;
+    return slot;
+}  // End of HashSlot
+
+static int ResizeFlowHash(flowTree_t *flowTree, uint32_t size) {
+    struct FlowNode **newHash = calloc(size, sizeof(struct FlowNode *));
+    if (!newHash) {
+        LogError("calloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+        return 0;
+    }
+
+    uint32_t mask = size - 1;
+    for (uint32_t i = 0; i < flowTree->FlowHashSize; i++) {
+        struct FlowNode *node = flowTree->FlowHash[i];
+        if (node == NULL) continue;
+        uint32_t slot = node->hash & mask;
+        while (newHash[slot]) slot = (slot + 1) & mask;
+        newHash[slot] = node;
+    }
+
+    free(flowTree->FlowHash);
+    flowTree->FlowHash = newHash;
+    flowTree->FlowHashSize = size;
+    flowTree->FlowHashMask = mask;
+    dbg_printf("Resized flow hash to %u slots\n", size);
+
+    return 1;
+
+}  // End of ResizeFlowHash
+
+/* expire wheel functions */
+static inline void WheelLink(flowTree_t *flowTree, struct FlowNode *node, time_t expire) {
+    // never schedule into the past or beyond one wheel turn
+    time_t wheelTime = flowTree->wheelTime;
+    if (expire <= wheelTime) expire = wheelTime + 1;
+    if (wheelTime && (expire - wheelTime) >= WheelSize) expire = wheelTime + WheelSize - 1;
+
+    uint32_t slot = expire & WheelMask;
+    node->wheelSlot = slot;
+    node->wheelPrev = NULL;
+    node->wheelNext = flowTree->ExpireWheel[slot];
+    if (node->wheelNext) node->wheelNext->wheelPrev = node;
+    flowTree->ExpireWheel[slot] = node;
+
+}  // End of WheelLink
+
+static inline void WheelUnlink(flowTree_t *flowTree, struct FlowNode *node) {
+    if (node->wheelSlot == NoSlot) return;
+
+    if (node->wheelPrev)
+        node->wheelPrev->wheelNext = node->wheelNext;
+    else
+        flowTree->ExpireWheel[node->wheelSlot] = node->wheelNext;
+    if (node->wheelNext) node->wheelNext->wheelPrev = node->wheelPrev;
+    node->wheelNext = NULL;
+    node->wheelPrev = NULL;
+    node->wheelSlot = NoSlot;
+
+}  // End of WheelUnlink
+
+// earliest time, the node may expire. t_last only moves forward, so the node
+// is checked again when its slot is due and moved to a later slot if still active
+static inline time_t NodeExpire(struct FlowNode *node) {
+    if (node->nodeType == FRAG_NODE) return node->t_last.tv_sec + FragTimeout + 1;
+
+    time_t inactive = node->t_last.tv_sec + expireInactiveTimeout + 1;
+    time_t active = node->t_first.tv_sec + expireActiveTimeout + 1;
+    return inactive < active ? inactive : active;
+
+}  // End of NodeExpire
+
 /* flow tree functions */
 int Init_FlowTree(uint32_t CacheSize, int32_t expireActive, int32_t expireInactive) {
     if (expireActive) {
@@ -207,91 +328,127 @@ int Init_FlowTree(uint32_t CacheSize, int32_t expireActive, int32_t expireInacti
         LogInfo("Set inactive flow expire timeout to %us", expireInactiveTimeout);
     }
 
-    FlowTree = malloc(sizeof(FlowTree_t));
-    if (!FlowTree) {
-        LogError("malloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
-        return 0;
-    }
-    RB_INIT(FlowTree);
-
     if (CacheSize == 0) CacheSize = DefaultCacheSize;
 
+    // hash table with load factor <= 0.5 for the expected number of flows
+    FlowHashInitSize = MinHashSize;
+    while (FlowHashInitSize < (2 * CacheSize) && FlowHashInitSize < (1U << 31)) FlowHashInitSize <<= 1;
+
     while (FlowCacheSize < CacheSize)
         if (!ExtendCache()) return 0;
 
     EmptyFreeList = 0;
     Allocated = 0;
-    NumFlows = 0;
 
     return 1;
 }  // End of Init_FlowTree
 
-void Dispose_FlowTree(void) {
-    struct FlowNode *node, *nxt;
+// create a new flow cache for a packet thread
+flowTree_t *New_FlowTree(void) {
+    flowTree_t *flowTree = calloc(1, sizeof(flowTree_t));
+    if (!flowTree) {
+        LogError("calloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+        return NULL;
+    }
 
-    // Dump all incomplete flows to the file
-    nxt = NULL;
-    for (node = RB_MIN(FlowTree, FlowTree); node != NULL; node = nxt) {
-        nxt = RB_NEXT(FlowTree, FlowTree, node);
-        Remove_Node(node);
+    flowTree->ExpireWheel = calloc(WheelSize, sizeof(struct FlowNode *));
+    if (!flowTree->ExpireWheel || !ResizeFlowHash(flowTree, FlowHashInitSize ? FlowHashInitSize : MinHashSize)) {
+        LogError("calloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+        free(flowTree->ExpireWheel);
+        free(flowTree);
+        return NULL;
     }
-    free(FlowElementCache);
-    FlowElementCache = NULL;
-    FlowNode_FreeList = NULL;
-    EmptyFreeList = 0;
+
+    return flowTree;
+
+}  // End of New_FlowTree
+
+void Dispose_FlowTree(flowTree_t *flowTree) {
+    if (!flowTree) return;
+
+    for (int i = 0; i < WheelSize; i++) {
+        struct FlowNode *node;
+        while ((node = flowTree->ExpireWheel[i]) != NULL) {
+            Remove_Node(flowTree, node);
+            Free_Node(node);
+        }
+    }
+    free(flowTree->FlowHash);
+    free(flowTree->ExpireWheel);
+    free(flowTree);
 
 }  // End of Dispose_FlowTree
 
 /* safety check - this must never become 0 - otherwise the cache is too small */
-void CacheCheck(NodeList_t *NodeList, time_t when) {
+void CacheCheck(flowTree_t *flowTree, NodeList_t *NodeList, time_t when) {
     dbg_printf("Cache check: ");
-    if (lastExpire == 0) {
-        lastExpire = when;
+    if (flowTree->lastExpire == 0) {
+        flowTree->lastExpire = when;
         dbg_printf("Init\n");
         return;
     }
-    if ((when - lastExpire) > EXPIREINTERVALL) {
-        uint32_t num __attribute__((unused)) = Expire_FlowTree(NodeList, when);
+    if ((when - flowTree->lastExpire) > EXPIREINTERVALL) {
+        uint32_t num __attribute__((unused)) = Expire_FlowTree(flowTree, NodeList, when);
         dbg_printf("  Expire cache: %u\n", num);
-        lastExpire = when;
+        flowTree->lastExpire = when;
     }
 
 }  // End of CacheCheck
 
-static int FlowNodeCMP(struct FlowNode *e1, struct FlowNode *e2) {
-    int i = memcmp((void *)&e1->flowKey, (void *)&e2->flowKey, sizeof(e1->flowKey));
-    return i;
-}  // End of FlowNodeCMP
+struct FlowNode *Lookup_Node(flowTree_t *flowTree, struct FlowNode *node) {
+    uint32_t hash = FlowKeyHash(&node->flowKey);
+    uint32_t slot = hash & flowTree->FlowHashMask;
+    struct FlowNode *n;
+    while ((n = flowTree->FlowHash[slot]) != NULL) {
+        if (n->hash == hash && memcmp((void *)&n->flowKey, (void *)&node->flowKey, sizeof(node->flowKey)) == 0) return n;
+        slot = (slot + 1) & flowTree->FlowHashMask;
+    }
 
-struct FlowNode *Lookup_Node(struct FlowNode *node) { return RB_FIND(FlowTree, FlowTree, node); }  // End of Lookup_FlowTree
+    return NULL;
 
-struct FlowNode *Insert_Node(struct FlowNode *node) {
-    struct FlowNode *n;
+}  // End of Lookup_Node
 
+struct FlowNode *Insert_Node(flowTree_t *flowTree, struct FlowNode *node) {
     dbg_assert(node->left == NULL);
     dbg_assert(node->right == NULL);
 
-    // return RB_INSERT(FlowTree, FlowTree, node);
-    n = RB_INSERT(FlowTree, FlowTree, node);
-    if (n) {  // existing node
-        return n;
-    } else {
-        flowTreeStat.activeNodes++;
-        if (node->nodeType == FLOW_NODE)
-            flowTreeStat.flowNodes++;
-        else if (node->nodeType == FRAG_NODE)
-            flowTreeStat.fragNodes++;
-        NumFlows++;
-        return NULL;
+    uint32_t hash = FlowKeyHash(&node->flowKey);
+    uint32_t slot = hash & flowTree->FlowHashMask;
+    struct FlowNode *n;
+    while ((n = flowTree->FlowHash[slot]) != NULL) {
+        if (n->hash == hash && memcmp((void *)&n->flowKey, (void *)&node->flowKey, sizeof(node->flowKey)) == 0) {
+            // existing node
+            return n;
+        }
+        slot = (slot + 1) & flowTree->FlowHashMask;
+    }
+
+    node->hash = hash;
+    flowTree->FlowHash[slot] = node;
+    WheelLink(flowTree, node, NodeExpire(node));
+
+    flowTree->flowTreeStat.activeNodes++;
+    if (node->nodeType == FLOW_NODE)
+        flowTree->flowTreeStat.flowNodes++;
+    else if (node->nodeType == FRAG_NODE)
+        flowTree->flowTreeStat.fragNodes++;
+    flowTree->NumFlows++;
+
+    // keep load factor <= 0.5
+    if ((2 * (uint32_t)flowTree->NumFlows) > flowTree->FlowHashSize && flowTree->FlowHashSize < (1U << 31)) {
+        if (!ResizeFlowHash(flowTree, 2 * flowTree->FlowHashSize)) abort();
     }
+
+    return NULL;
+
 }  // End of Insert_Node
 
-void Remove_Node(struct FlowNode *node) {
+void Remove_Node(flowTree_t *flowTree, struct FlowNode *node) {
     struct FlowNode *rev_node;
 
 #ifdef DEVEL
     assert(node->memflag == NODE_IN_USE);
-    if (NumFlows == 0) {
+    if (flowTree->NumFlows == 0) {
         LogError("Remove_Node() Fatal Tried to remove a Node from empty tree");
         return;
     }
@@ -304,12 +461,32 @@ void Remove_Node(struct FlowNode *node) {
         rev_node->rev_node = NULL;
         node->rev_node = NULL;
     }
-    RB_REMOVE(FlowTree, FlowTree, node);
-    NumFlows--;
+
+    // backward shift deletion - move following entries of the probe chain into the gap
+    struct FlowNode **FlowHash = flowTree->FlowHash;
+    uint32_t mask = flowTree->FlowHashMask;
+    uint32_t gap = HashSlot(flowTree, node);
+    uint32_t slot = gap;
+    FlowHash[gap] = NULL;
+    while (1) {
+        slot = (slot + 1) & mask;
+        struct FlowNode *n = FlowHash[slot];
+        if (n == NULL) break;
+        uint32_t home = n->hash & mask;
+        // move entry, unless its home slot lies cyclically in (gap, slot]
+        if (((slot - home) & mask) >= ((slot - gap) & mask)) {
+            FlowHash[gap] = n;
+            FlowHash[slot] = NULL;
+            gap = slot;
+        }
+    }
+
+    WheelUnlink(flowTree, node);
+    flowTree->NumFlows--;
 
 }  // End of Remove_Node
 
-int Link_RevNode(struct FlowNode *node) {
+int Link_RevNode(flowTree_t *flowTree, struct FlowNode *node) {
     struct FlowNode lookup_node, *rev_node;
 
     dbg_printf("Link node: ");
@@ -322,7 +499,7 @@ int Link_RevNode(struct FlowNode *node) {
     lookup_node.flowKey.dst_addr = node->flowKey.src_addr;
     lookup_node.flowKey.src_port = node->flowKey.dst_port;
     lookup_node.flowKey.dst_port = node->flowKey.src_port;
-    rev_node = Lookup_Node(&lookup_node);
+    rev_node = Lookup_Node(flowTree, &lookup_node);
     if (rev_node) {
         dbg_printf("Found revnode ");
         // rev node must not be linked already - otherwise there is an inconsistency
@@ -345,63 +522,77 @@ int Link_RevNode(struct FlowNode *node) {
 
 }  // End of Link_RevNode
 
-uint32_t Flush_FlowTree(NodeList_t *NodeList, time_t when) {
-    struct FlowNode *node, *nxt;
-
-    // Dump all incomplete flows to the file
-    nxt = NULL;
-    for (node = RB_MIN(FlowTree, FlowTree); node != NULL; node = nxt) {
-        nxt = RB_NEXT(FlowTree, FlowTree, node);
-        Remove_Node(node);
-        if (node->nodeType == FRAG_NODE) {
-            Free_Node(node);
-        } else {
-            Push_Node(NodeList, node);
+// push all flows of the flow cache to the node list
+uint32_t Flush_FlowTree(flowTree_t *flowTree, NodeList_t *NodeList) {
+    uint32_t flowCnt = 0;
+    for (int i = 0; i < WheelSize; i++) {
+        struct FlowNode *node;
+        while ((node = flowTree->ExpireWheel[i]) != NULL) {
+            Remove_Node(flowTree, node);
+            if (node->nodeType == FRAG_NODE) {
+                Free_Node(node);
+            } else {
+                Push_Node(NodeList, node);
+                flowCnt++;
+            }
         }
     }
 
-    node = New_Node();
-    node->timestamp = when;
-    node->nodeType = SIGNAL_NODE;
-    node->signal = SIGNAL_DONE;
-    Push_Node(NodeList, node);
-
-    return 0;
+    return flowCnt;
 
 }  // End of Flush_FlowTree
 
-uint32_t Expire_FlowTree(NodeList_t *NodeList, time_t when) {
-    struct FlowNode *node, *nxt;
+// process all wheel slots due since the last run. Only nodes of due slots are checked
+uint32_t Expire_FlowTree(flowTree_t *flowTree, NodeList_t *NodeList, time_t when) {
+    if (flowTree->NumFlows == 0) {
+        flowTree->wheelTime = when;
+        return 0;
+    }
+
+    // first run, clock jumps or when == 0 - check all slots
+    time_t wheelTime = flowTree->wheelTime;
+    time_t start = wheelTime + 1;
+    if (wheelTime == 0 || when == 0 || (when - wheelTime) >= WheelSize || when < wheelTime) start = when - WheelSize + 1;
 
-    if (NumFlows == 0) return 0;
+    if (when) flowTree->wheelTime = when;
 
+    flowTreeStat_t *flowTreeStat = &(flowTree->flowTreeStat);
     uint32_t flowCnt = 0;
     uint32_t fragCnt = 0;
-    // Dump all incomplete flows to the file
-    nxt = NULL;
-    for (node = RB_MIN(FlowTree, FlowTree); node != NULL; node = nxt) {
-        nxt = RB_NEXT(FlowTree, FlowTree, node);
-        if ((node->nodeType == FLOW_NODE) &&
-            // inactive timeout
-            ((when - node->t_last.tv_sec) > expireInactiveTimeout ||
-             // active timeout
-             (when - node->t_first.tv_sec) > expireActiveTimeout || when == 0)) {
-            Remove_Node(node);
-            Push_Node(NodeList, node);
-            flowTreeStat.activeNodes--;
-            flowTreeStat.flowNodes--;
-            flowCnt++;
-        } else if ((node->nodeType == FRAG_NODE) && ((when - node->t_last.tv_sec) > 15 || when == 0)) {
-            Remove_Node(node);
-            Free_Node(node);
-            flowTreeStat.activeNodes--;
-            flowTreeStat.fragNodes--;
+    for (time_t t = start; t <= when; t++) {
+        uint32_t slot = t & WheelMask;
+        // detach slot list - nodes not yet expired are sorted into their new slot
+        struct FlowNode *node = flowTree->ExpireWheel[slot];
+        flowTree->ExpireWheel[slot] = NULL;
+        while (node) {
+            struct FlowNode *nxt = node->wheelNext;
+            node->wheelNext = NULL;
+            node->wheelPrev = NULL;
+            node->wheelSlot = NoSlot;
+
+            time_t expire = NodeExpire(node);
+            if (expire <= when || when == 0) {
+                Remove_Node(flowTree, node);
+                if (node->nodeType == FLOW_NODE) {
+                    Push_Node(NodeList, node);
+                    flowTreeStat->flowNodes--;
+                    flowCnt++;
+                } else {
+                    Free_Node(node);
+                    flowTreeStat->fragNodes--;
+                    fragCnt++;
+                }
+                flowTreeStat->activeNodes--;
+            } else {
+                WheelLink(flowTree, node, expire);
+            }
+            node = nxt;
         }
     }
 
     if (flowCnt || fragCnt)
         LogVerbose("Expired flow nodes: %u, expired frag nodes: %u, active tree nodes: %u, allocated nodes %u", flowCnt, fragCnt,
-                   flowTreeStat.activeNodes, Allocated);
+                   flowTreeStat->activeNodes, Allocated);
 
     return flowCnt + fragCnt;
 }  // End of Expire_FlowTree
@@ -438,9 +629,9 @@ void DisposeNodeList(NodeList_t *NodeList) {
 
 }  // End of DisposeNodeList
 
-static void DumpTreeStat(NodeList_t *NodeList) {
-    LogInfo("Nodes: in use: %u, Flows: %u, Frag: %u, Nodes list length: %u, Waiting for freelist: %u", Allocated, flowTreeStat.activeNodes,
-            flowTreeStat.fragNodes, NodeList->length, EmptyFreeListEvents);
+static void DumpTreeStat(flowTree_t *flowTree, NodeList_t *NodeList) {
+    LogInfo("Nodes: in use: %u, Flows: %u, Frag: %u, Nodes list length: %u, Waiting for freelist: %u", Allocated, flowTree->flowTreeStat.activeNodes,
+            flowTree->flowTreeStat.fragNodes, NodeList->length, EmptyFreeListEvents);
     EmptyFreeListEvents = 0;
 }  // End of DumpTreeStat
 
@@ -502,12 +693,21 @@ struct FlowNode *Pop_Node(NodeList_t *NodeList) {
     return node;
 }  // End of Pop_Node
 
-void Push_SyncNode(NodeList_t *NodeList, time_t timestamp) {
+void Push_SyncNode(flowTree_t *flowTree, NodeList_t *NodeList, time_t timestamp) {
     struct FlowNode *Node = New_Node();
     Node->timestamp = timestamp;
     Node->nodeType = SIGNAL_NODE;
     Node->signal = SIGNAL_SYNC;
     Push_Node(NodeList, Node);
-    DumpTreeStat(NodeList);
+    DumpTreeStat(flowTree, NodeList);
 
 }  // End of Push_SyncNode
+
+void Push_DoneNode(NodeList_t *NodeList, time_t timestamp) {
+    struct FlowNode *Node = New_Node();
+    Node->timestamp = timestamp;
+    Node->nodeType = SIGNAL_NODE;
+    Node->signal = SIGNAL_DONE;
+    Push_Node(NodeList, Node);
+
+}  // End of Push_DoneNode
@@ -42,7 +42,6 @@
 #include "config.h"
 #include "nfdump.h"
 #include "nfxV3.h"
-#include "rbtree.h"
 
 #define v4 ip_addr._v4
 #define v6 ip_addr._v6
@@ -54,8 +53,11 @@ typedef struct flowTreeStat_s {
 } flowTreeStat_t;
 
 struct FlowNode {
-    // tree
-    RB_ENTRY(FlowNode) entry;
+    // flow hash table and expire wheel
+    struct FlowNode *wheelNext;
+    struct FlowNode *wheelPrev;
+    uint32_t wheelSlot;
+    uint32_t hash;
 
     // linked list
     struct FlowNode *left;
@@ -146,35 +148,34 @@ typedef struct NodeList_s {
     uint64_t waits;
 } NodeList_t;
 
-/* flow tree type */
-typedef RB_HEAD(FlowTree, FlowNode) FlowTree_t;
-
-// Insert the RB prototypes here
-RB_PROTOTYPE(FlowTree, FlowNode, entry, FlowNodeCMP);
+// flow cache of a packet thread
+typedef struct flowTree_s flowTree_t;
 
 int Init_FlowTree(uint32_t CacheSize, int32_t expireActive, int32_t expireInactive);
 
-void Dispose_FlowTree(void);
+flowTree_t *New_FlowTree(void);
+
+void Dispose_FlowTree(flowTree_t *flowTree);
 
-uint32_t Flush_FlowTree(NodeList_t *NodeList, time_t when);
+uint32_t Flush_FlowTree(flowTree_t *flowTree, NodeList_t *NodeList);
 
-uint32_t Expire_FlowTree(NodeList_t *NodeList, time_t when);
+uint32_t Expire_FlowTree(flowTree_t *flowTree, NodeList_t *NodeList, time_t when);
 
-struct FlowNode *Lookup_Node(struct FlowNode *node);
+struct FlowNode *Lookup_Node(flowTree_t *flowTree, struct FlowNode *node);
 
 struct FlowNode *New_Node(void);
 
 void Free_Node(struct FlowNode *node);
 
-void CacheCheck(NodeList_t *NodeList, time_t when);
+void CacheCheck(flowTree_t *flowTree, NodeList_t *NodeList, time_t when);
 
 int AddNodeData(struct FlowNode *node, uint32_t seq, void *payload, uint32_t size);
 
-struct FlowNode *Insert_Node(struct FlowNode *node);
+struct FlowNode *Insert_Node(flowTree_t *flowTree, struct FlowNode *node);
 
-void Remove_Node(struct FlowNode *node);
+void Remove_Node(flowTree_t *flowTree, struct FlowNode *node);
 
-int Link_RevNode(struct FlowNode *node);
+int Link_RevNode(flowTree_t *flowTree, struct FlowNode *node);
 
 // Node list functions
 NodeList_t *NewNodeList(void);
@@ -185,7 +186,9 @@ void Push_Node(NodeList_t *NodeList, struct FlowNode *node);
 
 struct FlowNode *Pop_Node(NodeList_t *NodeList);
 
-void Push_SyncNode(NodeList_t *NodeList, time_t timestamp);
+void Push_SyncNode(flowTree_t *flowTree, NodeList_t *NodeList, time_t timestamp);
+
+void Push_DoneNode(NodeList_t *NodeList, time_t timestamp);
 
 void DumpList(NodeList_t *NodeList);
 
@@ -144,10 +144,12 @@ static void usage(char *name) {
         "-P pidfile\tset the PID file\n"
         "-t time frame\tset the time window to rotate pcap/nfcapd file\n"
         "-W workers\toptionally set the number of workers to compress flows\n"
+        "-N workers\tset the number of packet workers, each with its own flow cache. (default 1)\n"
         "-z=lzo\t\tLZO compress flows in output file.\n"
         "-z=bz2\t\tBZIP2 compress flows in output file.\n"
         "-z=lz4[:level]\tLZ4 compress flows in output file.\n"
         "-z=zstd[:level]\tZSTD compress flows in output file.\n"
+        "-z=auto[:level]\tSelect LZ4 or strong compression per block.\n"
         "-v\t\tverbose logging.\n"
         "-D\t\tdetach from terminal (daemonize)\n",
         name);
@@ -261,7 +263,7 @@ int main(int argc, char *argv[]) {
     struct sigaction sa;
     int c, snaplen, bufflen, err, do_daemonize, doDedup;
     int subdir_index, compress, expire, cache_size, buff_size;
-    int activeTimeout, inactiveTimeout, metricInterval, workers;
+    int activeTimeout, inactiveTimeout, metricInterval, workers, packetWorkers;
     dirstat_t *dirstat;
     repeater_t *sendHost;
     time_t t_win;
@@ -298,8 +300,9 @@ int main(int argc, char *argv[]) {
     activeTimeout = 0;
     inactiveTimeout = 0;
     workers = 0;
+    packetWorkers = 1;
 
-    while ((c = getopt(argc, argv, "b:B:C:dDe:g:hH:I:i:j:l:m:o:p:P:r:s:S:T:t:u:vVw:W:yz::")) != EOF) {
+    while ((c = getopt(argc, argv, "b:B:C:dDe:g:hH:I:i:j:l:m:N:o:p:P:r:s:S:T:t:u:vVw:W:yz::")) != EOF) {
         switch (c) {
             struct stat fstat;
             case 'h':
@@ -465,6 +468,14 @@ int main(int argc, char *argv[]) {
                     exit(EXIT_FAILURE);
                 }
                 break;
+            case 'N':
+                CheckArgLen(optarg, 16);
+                packetWorkers = atoi(optarg);
+                if (packetWorkers < 1 || packetWorkers > MAXWORKERS) {
+                    LogError("Number of packet workers out of range 1..%d", MAXWORKERS);
+                    exit(EXIT_FAILURE);
+                }
+                break;
             case 'j':
                 if (compress) {
                     LogError("Use either -z for LZO or -j for BZ2 compression, but not both");
@@ -548,6 +559,19 @@ int main(int argc, char *argv[]) {
         exit(EXIT_FAILURE);
     }
 
+    if (packetWorkers > 1) {
+        if (pcap_datadir) {
+            LogError("Packet workers can not be used together with pcap dumping");
+            exit(EXIT_FAILURE);
+        }
+#ifndef USE_TPACKETV3
+        if (device) {
+            LogError("Packet workers for live capture require Linux TPACKET_V3 support");
+            exit(EXIT_FAILURE);
+        }
+#endif
+    }
+
     flushParam_t flushParam = {0};
     packetParam_t packetParam = {0};
     flowParam_t flowParam = {0};
@@ -581,10 +605,24 @@ int main(int argc, char *argv[]) {
     int buffsize = 64 * 1024;
     int ret;
     void *(*packet_thread)(void *) = NULL;
+    // optional packet workers
+    packetParam_t *packetWorker = NULL;
+    void *(*worker_thread)(void *) = NULL;
+    int firstWorker = 0;
     if (pcapfile) {
         packetParam.live = 0;
         ret = setup_pcap_file(&packetParam, pcapfile, filter, snaplen);
         packet_thread = pcap_packet_thread;
+        if (ret == 0 && packetWorkers > 1) {
+            // packetParam reads the file and dispatches the packets to the workers
+            packetWorker = calloc(packetWorkers, sizeof(packetParam_t));
+            if (!packetWorker) {
+                LogError("calloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+                exit(EXIT_FAILURE);
+            }
+            packet_thread = pcap_fanout_thread;
+            worker_thread = pcap_worker_thread;
+        }
     } else {
         packetParam.live = 1;
 #ifdef USE_BPFSOCKET
@@ -592,8 +630,23 @@ int main(int argc, char *argv[]) {
         ret = setup_bpf_live(&packetParam, device, filter, snaplen, buffsize, TO_MS);
         packet_thread = bpf_packet_thread;
 #elif USE_TPACKETV3
-        ret = setup_linux_live(&packetParam, device, filter, snaplen, buffsize, TO_MS);
+        // all packet worker sockets join the same fanout group
+        int fanoutGroup = packetWorkers > 1 ? (getpid() & 0xFFFF) : 0;
+        ret = setup_linux_live(&packetParam, device, filter, snaplen, buffsize, TO_MS, fanoutGroup);
         packet_thread = linux_packet_thread;
+        if (ret == 0 && packetWorkers > 1) {
+            // packetParam is the first worker
+            packetWorker = calloc(packetWorkers, sizeof(packetParam_t));
+            if (!packetWorker) {
+                LogError("calloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+                exit(EXIT_FAILURE);
+            }
+            for (int i = 1; i < packetWorkers && ret == 0; i++) {
+                ret = setup_linux_live(&packetWorker[i], device, filter, snaplen, buffsize, TO_MS, fanoutGroup);
+            }
+            worker_thread = linux_packet_thread;
+            firstWorker = 1;
+        }
 #else
         ret = setup_pcap_live(&packetParam, device, filter, snaplen, buffsize, TO_MS);
         packet_thread = pcap_packet_thread;
@@ -708,6 +761,7 @@ int main(int argc, char *argv[]) {
     flowParam.subdir_index = subdir_index;
     flowParam.parent = pthread_self();
     flowParam.NodeList = NewNodeList();
+    flowParam.numWorkers = packetWorkers;
     flowParam.printRecord = (do_daemonize == 0) && (verbose > 2);
     if (sendHost) {
         err = pthread_create(&flowParam.tid, NULL, sendflow_thread, (void *)&flowParam);
@@ -722,10 +776,41 @@ int main(int argc, char *argv[]) {
 
     packetParam.parent = pthread_self();
     packetParam.NodeList = flowParam.NodeList;
+    packetParam.flowTree = New_FlowTree();
     packetParam.extendedFlow = flowParam.extendedFlow;
     packetParam.addPayload = flowParam.addPayload;
     packetParam.t_win = t_win;
     packetParam.done = &done;
+    if (!packetParam.flowTree) exit(EXIT_FAILURE);
+
+    for (int i = firstWorker; packetWorker && i < packetWorkers; i++) {
+        packetParam_t *worker = &packetWorker[i];
+        worker->parent = packetParam.parent;
+        worker->NodeList = packetParam.NodeList;
+        worker->extendedFlow = packetParam.extendedFlow;
+        worker->addPayload = packetParam.addPayload;
+        worker->t_win = packetParam.t_win;
+        worker->done = packetParam.done;
+        worker->doDedup = packetParam.doDedup;
+        worker->live = packetParam.live;
+        worker->linktype = packetParam.linktype;
+        worker->snaplen = packetParam.snaplen;
+        if (worker_thread == pcap_worker_thread) {
+            if (!InitPacketWorker(worker)) exit(EXIT_FAILURE);
+        } else {
+            worker->flowTree = New_FlowTree();
+            if (!worker->flowTree) exit(EXIT_FAILURE);
+        }
+        err = pthread_create(&worker->tid, NULL, worker_thread, (void *)worker);
+        if (err) {
+            LogError("pthread_create() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        dbg_printf("Started packet worker[%lu]\n", (long unsigned)worker->tid);
+    }
+    packetParam.workers = packetWorker;
+    packetParam.numWorkers = packetWorkers;
+
     err = pthread_create(&packetParam.tid, NULL, packet_thread, (void *)&packetParam);
     if (err) {
         LogError("pthread_create() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
@@ -741,13 +826,34 @@ int main(int argc, char *argv[]) {
     pthread_join(packetParam.tid, NULL);
     dbg_printf("Packet thread joined\n");
 
+    // file workers terminate on the closed packet queue, live workers need a signal
+    for (int i = firstWorker; packetWorker && i < packetWorkers; i++) {
+        if (packetParam.live) pthread_kill(packetWorker[i].tid, SIGUSR2);
+        pthread_join(packetWorker[i].tid, NULL);
+    }
+    dbg_printf("Packet workers joined\n");
+
     if (pcap_datadir) {
         pthread_join(flushParam.tid, NULL);
         dbg_printf("Pcap flush thread joined\n");
     }
 
     dbg_printf("Flush flow tree\n");
-    Flush_FlowTree(flowParam.NodeList, packetParam.t_win);
+    Flush_FlowTree(packetParam.flowTree, flowParam.NodeList);
+    Dispose_FlowTree(packetParam.flowTree);
+    for (int i = firstWorker; packetWorker && i < packetWorkers; i++) {
+        packetParam_t *worker = &packetWorker[i];
+        Flush_FlowTree(worker->flowTree, flowParam.NodeList);
+        Dispose_FlowTree(worker->flowTree);
+        DisposePacketWorker(worker);
+        packetParam.proc_stat.packets += worker->proc_stat.packets;
+        packetParam.proc_stat.skipped += worker->proc_stat.skipped;
+        packetParam.proc_stat.short_snap += worker->proc_stat.short_snap;
+        packetParam.proc_stat.unknown += worker->proc_stat.unknown;
+        packetParam.proc_stat.duplicates += worker->proc_stat.duplicates;
+    }
+    free(packetWorker);
+    Push_DoneNode(flowParam.NodeList, packetParam.t_win);
 
     // flow thread terminates on end of node queue
     pthread_join(flowParam.tid, NULL);
@@ -283,10 +283,10 @@ void __attribute__((noreturn)) * bpf_packet_thread(void *args) {
                 }
                 // Rotate flow file
                 ReportStat(packetParam);
-                Push_SyncNode(packetParam->NodeList, t_start);
+                Push_SyncNode(packetParam->flowTree, packetParam->NodeList, t_start);
                 t_start = t_packet - (t_packet % t_win);
             }
-            CacheCheck(packetParam->NodeList, t_start);
+            CacheCheck(packetParam->flowTree, packetParam->NodeList, t_start);
             continue;
         }
 
@@ -321,7 +321,7 @@ void __attribute__((noreturn)) * bpf_packet_thread(void *args) {
                 }
                 // Rotate flow file
                 ReportStat(packetParam);
-                Push_SyncNode(packetParam->NodeList, t_start);
+                Push_SyncNode(packetParam->flowTree, packetParam->NodeList, t_start);
                 t_start = t_packet - (t_packet % t_win);
             }
 
@@ -70,9 +70,6 @@ static void ReportStat(packetParam_t *param);
 
 static inline void PcapDump(packetBuffer_t *packetBuffer, struct tpacket3_hdr *ppd);
 
-static struct tpacket_stats_v3 last_stat = {0};
-static proc_stat_t proc_stat = {0};
-
 /*
  * Functions
  */
@@ -145,7 +142,7 @@ static int InitRing(packetParam_t *param, char *device) {
 }  // End of InitRing
 
 // live device
-int setup_linux_live(packetParam_t *param, char *device, char *filter, int snaplen, int buffsize, int to_ms) {
+int setup_linux_live(packetParam_t *param, char *device, char *filter, int snaplen, int buffsize, int to_ms, int fanoutGroup) {
     param->pcap_dev = NULL;
     param->fd = 0;
 
@@ -169,6 +166,17 @@ int setup_linux_live(packetParam_t *param, char *device, char *filter, int snapl
         return -1;
     }
 
+    if (fanoutGroup) {
+        // join the fanout group - the kernel distributes the packets by flow hash over all sockets of the group
+        int fanoutArg = (fanoutGroup & 0xFFFF) | ((PACKET_FANOUT_HASH | PACKET_FANOUT_FLAG_DEFRAG) << 16);
+        err = setsockopt(fd, SOL_PACKET, PACKET_FANOUT, &fanoutArg, sizeof(fanoutArg));
+        if (err < 0) {
+            LogError("setsockopt(PACKET_FANOUT) failed: %s", strerror(errno));
+            CloseSocket(param);
+            return -1;
+        }
+    }
+
     // XXX fix data link type
     param->linktype = DLT_EN10MB;
 
@@ -215,16 +223,18 @@ static void ReportStat(packetParam_t *param) {
     if (err < 0) {
         LogError("getsockopt(PACKET_STATISTICS) failed: %s", strerror(errno));
     } else {
-        LogInfo("Stat: received: %u, dropped by OS/Buffer: %u, freeze_q_cnt: %u", pstat.tp_packets - last_stat.tp_packets,
-                pstat.tp_drops - last_stat.tp_drops, pstat.tp_freeze_q_cnt - last_stat.tp_freeze_q_cnt);
-        last_stat = pstat;
+        struct tpacket_stats_v3 *last_stat = &(param->last_stat);
+        LogInfo("Stat: received: %u, dropped by OS/Buffer: %u, freeze_q_cnt: %u", pstat.tp_packets - last_stat->tp_packets,
+                pstat.tp_drops - last_stat->tp_drops, pstat.tp_freeze_q_cnt - last_stat->tp_freeze_q_cnt);
+        param->last_stat = pstat;
     }
 
-    LogInfo("Processed: %u, skipped: %u, short caplen: %u, unknown: %u", param->proc_stat.packets - proc_stat.packets,
-            param->proc_stat.skipped - proc_stat.skipped, param->proc_stat.short_snap - proc_stat.short_snap,
-            param->proc_stat.unknown - proc_stat.unknown);
+    proc_stat_t *last_proc_stat = &(param->last_proc_stat);
+    LogInfo("Processed: %u, skipped: %u, short caplen: %u, unknown: %u", param->proc_stat.packets - last_proc_stat->packets,
+            param->proc_stat.skipped - last_proc_stat->skipped, param->proc_stat.short_snap - last_proc_stat->short_snap,
+            param->proc_stat.unknown - last_proc_stat->unknown);
 
-    proc_stat = param->proc_stat;
+    param->last_proc_stat = param->proc_stat;
 
 }  // End of ReportStat
 
@@ -292,10 +302,10 @@ void __attribute__((noreturn)) * linux_packet_thread(void *args) {
                     }
                     // Rotate flow file
                     ReportStat(packetParam);
-                    Push_SyncNode(packetParam->NodeList, t_start);
+                    Push_SyncNode(packetParam->flowTree, packetParam->NodeList, t_start);
                     t_start = t_packet - (t_packet % t_win);
                 }
-                CacheCheck(packetParam->NodeList, t_start);
+                CacheCheck(packetParam->flowTree, packetParam->NodeList, t_start);
                 continue;
             }
         }
@@ -320,7 +330,7 @@ void __attribute__((noreturn)) * linux_packet_thread(void *args) {
                 }
                 // Rotate flow file
                 ReportStat(packetParam);
-                Push_SyncNode(packetParam->NodeList, t_start);
+                Push_SyncNode(packetParam->flowTree, packetParam->NodeList, t_start);
                 t_start = t_packet - (t_packet % t_win);
             }
 
@@ -57,8 +57,14 @@ static void ReportStat(packetParam_t *param);
 
 static inline void PcapDump(packetBuffer_t *packetBuffer, struct pcap_pkthdr *hdr, const u_char *sp);
 
+static uint32_t PacketHash(uint32_t linktype, const uint8_t *data, uint32_t caplen);
+
 static struct pcap_stat last_stat = {0};
-static proc_stat_t proc_stat = {0};
+
+// packet batches passed from the pcap file reader to the packet workers
+#define PACKETBATCHSIZE (1024 * 1024)
+#define NUMPACKETBATCHES 8
+#define BatchEntrySize(caplen) ((sizeof(struct pcap_pkthdr) + (caplen) + 7) & ~(size_t)7)
 
 /*
  * Functions
@@ -203,11 +209,12 @@ static void ReportStat(packetParam_t *param) {
         }
     }
 
-    LogInfo("Processed: %u, skipped: %u, short caplen: %u, unknown: %u", param->proc_stat.packets - proc_stat.packets,
-            param->proc_stat.skipped - proc_stat.skipped, param->proc_stat.short_snap - proc_stat.short_snap,
-            param->proc_stat.unknown - proc_stat.unknown);
+    proc_stat_t *last_proc_stat = &(param->last_proc_stat);
+    LogInfo("Processed: %u, skipped: %u, short caplen: %u, unknown: %u", param->proc_stat.packets - last_proc_stat->packets,
+            param->proc_stat.skipped - last_proc_stat->skipped, param->proc_stat.short_snap - last_proc_stat->short_snap,
+            param->proc_stat.unknown - last_proc_stat->unknown);
 
-    proc_stat = param->proc_stat;
+    param->last_proc_stat = param->proc_stat;
 
 }  // End of ReportStat
 
@@ -276,7 +283,7 @@ void __attribute__((noreturn)) * pcap_packet_thread(void *args) {
                     }
                     // Rotate flow file
                     ReportStat(packetParam);
-                    Push_SyncNode(packetParam->NodeList, t_start);
+                    Push_SyncNode(packetParam->flowTree, packetParam->NodeList, t_start);
                     t_start = t_packet - (t_packet % t_win);
                 }
 
@@ -306,10 +313,10 @@ void __attribute__((noreturn)) * pcap_packet_thread(void *args) {
                         packetBuffer = queue_pop(packetParam->bufferQueue);
                     }
                     ReportStat(packetParam);
-                    Push_SyncNode(packetParam->NodeList, t_start);
+                    Push_SyncNode(packetParam->flowTree, packetParam->NodeList, t_start);
                     t_start = t_packet - (t_packet % t_win);
                 }
-                CacheCheck(packetParam->NodeList, t_start);
+                CacheCheck(packetParam->flowTree, packetParam->NodeList, t_start);
             } break;
             case -1:
                 // signal error reading the packet
@@ -347,3 +354,225 @@ void __attribute__((noreturn)) * pcap_packet_thread(void *args) {
     /* NOTREACHED */
 
 } /* End of packet_thread */
+
+/*
+ * packet workers
+ * The pcap file reader dispatches the packets by a hash of the IP addresses to the
+ * packet workers, each running its own flow cache. Both directions of a flow and all
+ * fragments of a packet end up in the same worker.
+ */
+static uint32_t PacketHash(uint32_t linktype, const uint8_t *data, uint32_t caplen) {
+    uint32_t offset = 0;
+    uint16_t ethertype = 0;
+    switch (linktype) {
+        case DLT_EN10MB:
+            if (caplen < 14) return 0;
+            ethertype = (data[12] << 8) | data[13];
+            offset = 14;
+            // skip vlan tags
+            while ((ethertype == ETHERTYPE_VLAN || ethertype == 0x88a8) && (offset + 4) <= caplen) {
+                ethertype = (data[offset + 2] << 8) | data[offset + 3];
+                offset += 4;
+            }
+            break;
+        case DLT_LINUX_SLL:
+            if (caplen < 16) return 0;
+            ethertype = (data[14] << 8) | data[15];
+            offset = 16;
+            break;
+        case DLT_NULL:
+        case DLT_LOOP:
+            offset = 4;
+        // fall through
+        case DLT_RAW:
+            if (offset >= caplen) return 0;
+            if ((data[offset] >> 4) == 4)
+                ethertype = ETHERTYPE_IP;
+            else if ((data[offset] >> 4) == 6)
+                ethertype = ETHERTYPE_IPV6;
+            break;
+        default:
+            return 0;
+    }
+
+    uint32_t hash = 0;
+    if (ethertype == ETHERTYPE_IP && (offset + 20) <= caplen) {
+        uint32_t addr[2];
+        memcpy(addr, data + offset + 12, sizeof(addr));
+        hash = addr[0] ^ addr[1];
+    } else if (ethertype == ETHERTYPE_IPV6 && (offset + 40) <= caplen) {
+        uint32_t addr[8];
+        memcpy(addr, data + offset + 8, sizeof(addr));
+        for (int i = 0; i < 8; i++) hash ^= addr[i];
+    } else {
+        return 0;
+    }
+
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6b;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35;
+    hash ^= hash >> 16;
+
+    return hash;
+
+}  // End of PacketHash
+
+int InitPacketWorker(packetParam_t *param) {
+    param->flowTree = New_FlowTree();
+    param->packetQueue = queue_init(NUMPACKETBATCHES);
+    param->freeQueue = queue_init(NUMPACKETBATCHES);
+    if (!param->flowTree || !param->packetQueue || !param->freeQueue) return 0;
+
+    for (int i = 0; i < NUMPACKETBATCHES; i++) {
+        packetBuffer_t *packetBuffer = calloc(1, sizeof(packetBuffer_t));
+        if (!packetBuffer) {
+            LogError("calloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+            return 0;
+        }
+        packetBuffer->buffer = malloc(PACKETBATCHSIZE);
+        if (!packetBuffer->buffer) {
+            LogError("malloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+            free(packetBuffer);
+            return 0;
+        }
+        queue_push(param->freeQueue, (void *)packetBuffer);
+    }
+
+    return 1;
+
+}  // End of InitPacketWorker
+
+void DisposePacketWorker(packetParam_t *param) {
+    if (param->freeQueue) {
+        queue_close(param->freeQueue);
+        packetBuffer_t *packetBuffer;
+        while ((packetBuffer = queue_pop(param->freeQueue)) != QUEUE_CLOSED) {
+            free(packetBuffer->buffer);
+            free(packetBuffer);
+        }
+        queue_free(param->freeQueue);
+    }
+    if (param->packetQueue) queue_free(param->packetQueue);
+    param->freeQueue = param->packetQueue = NULL;
+
+}  // End of DisposePacketWorker
+
+// read pcap file and dispatch packets to the packet workers
+void __attribute__((noreturn)) * pcap_fanout_thread(void *args) {
+    packetParam_t *packetParam = (packetParam_t *)args;
+    packetParam_t *workers = packetParam->workers;
+    uint32_t numWorkers = packetParam->numWorkers;
+
+    time_t t_win = packetParam->t_win;
+    time_t now = 0;
+    struct pcap_pkthdr *hdr;
+    const u_char *data;
+    // start time is time of 1st packet for file reading
+    long pos = ftell(pcap_file(packetParam->pcap_dev));
+    if (pcap_next_ex(packetParam->pcap_dev, &hdr, &data) == 1) {
+        now = hdr->ts.tv_sec;
+    }
+    // reset file to 1st packet
+    fseek(pcap_file(packetParam->pcap_dev), pos, SEEK_SET);
+    time_t t_start = now - (now % t_win);
+
+    packetBuffer_t *batch[MAXWORKERS];
+    for (int i = 0; i < numWorkers; i++) batch[i] = queue_pop(workers[i].freeQueue);
+
+    int done = *(packetParam->done);
+    while (!done) {
+        int ret = pcap_next_ex(packetParam->pcap_dev, &hdr, &data);
+        switch (ret) {
+            case 1: {
+                // packet read ok
+                time_t t_packet = hdr->ts.tv_sec;
+                if ((t_packet - t_start) >= t_win) {
+                    // Rotate flow file - each worker syncs after its current batch
+                    for (int i = 0; i < numWorkers; i++) {
+                        batch[i]->timeStamp = t_start;
+                        queue_push(workers[i].packetQueue, batch[i]);
+                        batch[i] = queue_pop(workers[i].freeQueue);
+                    }
+                    t_start = t_packet - (t_packet % t_win);
+                }
+
+                uint32_t worker = PacketHash(packetParam->linktype, data, hdr->caplen) % numWorkers;
+                size_t size = BatchEntrySize(hdr->caplen);
+                packetBuffer_t *packetBuffer = batch[worker];
+                if ((packetBuffer->bufferSize + size) > PACKETBATCHSIZE) {
+                    packetBuffer->timeStamp = 0;
+                    queue_push(workers[worker].packetQueue, packetBuffer);
+                    packetBuffer = batch[worker] = queue_pop(workers[worker].freeQueue);
+                }
+                void *p = packetBuffer->buffer + packetBuffer->bufferSize;
+                memcpy(p, (void *)hdr, sizeof(struct pcap_pkthdr));
+                memcpy(p + sizeof(struct pcap_pkthdr), (void *)data, hdr->caplen);
+                packetBuffer->bufferSize += size;
+            } break;
+            case -1:
+                // signal error reading the packet
+                LogError("pcap_next_ex() read error: '%s'", pcap_geterr(packetParam->pcap_dev));
+                done = 1;
+                break;
+            case -2:  // End of packet file
+                dbg_printf("pcap_next_ex() eof\n");
+                done = 1;
+                break;
+            default:
+                LogError("Unexpected pcap_next_ex() return value: %i", ret);
+                done = 1;
+        }
+        done = done || *(packetParam->done);
+    }
+
+    dbg_printf("Done reading packets - close worker queues\n");
+    for (int i = 0; i < numWorkers; i++) {
+        batch[i]->timeStamp = 0;
+        queue_push(workers[i].packetQueue, batch[i]);
+        queue_close(workers[i].packetQueue);
+    }
+
+    CloseSocket(packetParam);
+    packetParam->t_win = t_start;
+
+    // Tell parent we are gone
+    pthread_kill(packetParam->parent, SIGUSR1);
+    pthread_exit("leave pcap_fanout_thread()");
+    /* NOTREACHED */
+
+}  // End of pcap_fanout_thread
+
+// process the packet batches of the pcap file reader
+void __attribute__((noreturn)) * pcap_worker_thread(void *args) {
+    packetParam_t *packetParam = (packetParam_t *)args;
+
+    while (1) {
+        packetBuffer_t *packetBuffer = queue_pop(packetParam->packetQueue);
+        if (packetBuffer == QUEUE_CLOSED) break;
+
+        size_t offset = 0;
+        while (offset < packetBuffer->bufferSize) {
+            struct pcap_pkthdr *hdr = (struct pcap_pkthdr *)(packetBuffer->buffer + offset);
+            const u_char *data = (const u_char *)hdr + sizeof(struct pcap_pkthdr);
+            ProcessPacket(packetParam, hdr, data);
+            offset += BatchEntrySize(hdr->caplen);
+        }
+
+        if (packetBuffer->timeStamp) {
+            // Rotate flow file
+            ReportStat(packetParam);
+            Push_SyncNode(packetParam->flowTree, packetParam->NodeList, packetBuffer->timeStamp);
+        }
+
+        packetBuffer->bufferSize = 0;
+        packetBuffer->timeStamp = 0;
+        queue_push(packetParam->freeQueue, packetBuffer);
+    }
+
+    ReportStat(packetParam);
+    dbg_printf("Packet worker done\n");
+    pthread_exit("leave pcap_worker_thread()");
+    /* NOTREACHED */
+
+}  // End of pcap_worker_thread
@@ -92,9 +92,17 @@ typedef struct packetParam_s {
 #ifdef USE_TPACKETV3
     int fd;
     struct ring ring;
+    struct tpacket_stats_v3 last_stat;
 #endif
 
     NodeList_t *NodeList;
+    flowTree_t *flowTree;
+
+    // packet workers
+    struct packetParam_s *workers;  // pcap file reader: dispatch packets to workers
+    uint32_t numWorkers;
+    queue_t *packetQueue;  // worker: packet batches to process
+    queue_t *freeQueue;    // worker: processed packet batches
     pcap_t *pcap_dev;
     time_t t_win;
     int *done;
@@ -108,12 +116,21 @@ typedef struct packetParam_s {
     uint32_t extendedFlow;
     uint32_t addPayload;
     proc_stat_t proc_stat;
+    proc_stat_t last_proc_stat;
 } packetParam_t;
 
 int setup_pcap_live(packetParam_t *param, char *device, char *filter, int snaplen, int buffsize, int to_ms);
 
 void __attribute__((noreturn)) * pcap_packet_thread(void *args);
 
+int InitPacketWorker(packetParam_t *param);
+
+void DisposePacketWorker(packetParam_t *param);
+
+void __attribute__((noreturn)) * pcap_fanout_thread(void *args);
+
+void __attribute__((noreturn)) * pcap_worker_thread(void *args);
+
 #ifdef USE_BPFSOCKET
 int setup_bpf_live(packetParam_t *param, char *device, char *filter, int snaplen, int buffsize, int to_ms);
 
@@ -121,7 +138,7 @@ void __attribute__((noreturn)) * bpf_packet_thread(void *args);
 #endif
 
 #ifdef USE_TPACKETV3
-int setup_linux_live(packetParam_t *param, char *device, char *filter, int snaplen, int buffsize, int to_ms);
+int setup_linux_live(packetParam_t *param, char *device, char *filter, int snaplen, int buffsize, int to_ms, int fanoutGroup);
 
 void __attribute__((noreturn)) * linux_packet_thread(void *args);
 #endif
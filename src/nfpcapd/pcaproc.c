@@ -93,16 +93,16 @@ typedef struct vlan_hdr_s {
     uint16_t type;
 } vlan_hdr_t;
 
-// remember the last SlotSize packets with len and hash
+// remember the last SlotSize packets of the packet thread with len and hash
 // for duplicate check
 #define SlotSize 8
-static struct {
+static _Thread_local struct {
     uint32_t len;
     uint64_t hash;
 } lastPacketStat[SlotSize] = {0};
-static uint32_t packetSlot = 0;
+static _Thread_local uint32_t packetSlot = 0;
 
-static time_t lastRun = 0;  // remember last run to idle cache
+static _Thread_local time_t lastRun = 0;  // remember last run to idle cache
 
 static inline void SetServer_latency(struct FlowNode *node);
 
@@ -304,7 +304,7 @@ static inline struct FlowNode *ProcessIPfrag(packetParam_t *packetParam, const s
         Node->flowKey.dst_port = 0;
         Node->nodeType = FRAG_NODE;
 
-        if (Insert_Node(Node) != NULL) {
+        if (Insert_Node(packetParam->flowTree, Node) != NULL) {
             dbg_printf("IP fragment: initial node already exists! Skip!\n");
             Free_Node(Node);
             return NULL;
@@ -314,7 +314,7 @@ static inline struct FlowNode *ProcessIPfrag(packetParam_t *packetParam, const s
         Node->payload = calloc(1, 65536);
         if (!Node->payload) {
             LogError("malloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
-            Remove_Node(Node);
+            Remove_Node(packetParam->flowTree, Node);
             Free_Node(Node);
             return NULL;
         }
@@ -327,7 +327,7 @@ static inline struct FlowNode *ProcessIPfrag(packetParam_t *packetParam, const s
         FindNode.flowKey.src_port = ntohs(ip->ip_id);
         FindNode.flowKey.dst_port = 0;
 
-        Node = Lookup_Node(&FindNode);
+        Node = Lookup_Node(packetParam->flowTree, &FindNode);
         if (!Node || Node->nodeType != FRAG_NODE) {
             dbg_printf("IP fragment: initial node missing! Skip!\n");
             packetParam->proc_stat.skipped++;
@@ -342,7 +342,7 @@ static inline struct FlowNode *ProcessIPfrag(packetParam_t *packetParam, const s
     dbg_printf("IP frag: Insert fragment at offset: %u, length: %td\n", frag_offset, len);
     if ((frag_offset + len) > 65536) {
         LogError("IP fragmen too large: %.", frag_offset + len);
-        Remove_Node(Node);
+        Remove_Node(packetParam->flowTree, Node);
         Free_Node(Node);
         return NULL;
     }
@@ -354,7 +354,7 @@ static inline struct FlowNode *ProcessIPfrag(packetParam_t *packetParam, const s
         Node->payloadSize = frag_offset + len;
         Node->bytes = size_ip + Node->payloadSize;
         dbg_printf("Fragmented packet: last segment: ip_off: %u, frag_offset: %u, total len: %u\n", ip_off, frag_offset, Node->payloadSize);
-        Remove_Node(Node);
+        Remove_Node(packetParam->flowTree, Node);
         return Node;
     }
 
@@ -375,7 +375,7 @@ static inline void ProcessTCPFlow(packetParam_t *packetParam, struct FlowNode *N
     struct FlowNode *Node;
 
     assert(NewNode->memflag == NODE_IN_USE);
-    Node = Insert_Node(NewNode);
+    Node = Insert_Node(packetParam->flowTree, NewNode);
     // Return existing Node if flow exists already, otherwise insert es new
     if (Node == NULL) {
         // Insert as new
@@ -389,7 +389,7 @@ static inline void ProcessTCPFlow(packetParam_t *packetParam, struct FlowNode *N
         // in case it's a FIN/RST only packet - immediately flush it
         if (NewNode->signal == SIGNAL_FIN) {
             // flush node to flow thread
-            Remove_Node(NewNode);
+            Remove_Node(packetParam->flowTree, NewNode);
             Push_Node(packetParam->NodeList, NewNode);
             return;
         }
@@ -402,7 +402,7 @@ static inline void ProcessTCPFlow(packetParam_t *packetParam, struct FlowNode *N
             printf("SYN ACK Node\n");
         }
 #endif
-        if (packetParam->extendedFlow && Link_RevNode(NewNode)) {
+        if (packetParam->extendedFlow && Link_RevNode(packetParam->flowTree, NewNode)) {
             // if we could link this new node, it is the server answer
             // -> calculate server latency
             SetServer_latency(NewNode);
@@ -448,7 +448,7 @@ static inline void ProcessTCPFlow(packetParam_t *packetParam, struct FlowNode *N
         // flush node
         Node->signal = SIGNAL_FIN;
         // flush node to flow thread
-        Remove_Node(Node);
+        Remove_Node(packetParam->flowTree, Node);
         Push_Node(packetParam->NodeList, Node);
     }
 
@@ -472,7 +472,7 @@ static inline void ProcessUDPFlow(packetParam_t *packetParam, struct FlowNode *N
     }
 
     // insert other UDP traffic
-    Node = Insert_Node(NewNode);
+    Node = Insert_Node(packetParam->flowTree, NewNode);
     if (Node == NULL) {
         dbg_printf("New UDP flow: Packets: %u, Bytes: %u\n", NewNode->packets, NewNode->bytes);
         if (payloadSize && packetParam->addPayload) {
@@ -513,7 +513,7 @@ static inline void ProcessOtherFlow(packetParam_t *packetParam, struct FlowNode
     assert(NewNode->memflag == NODE_IN_USE);
 
     // insert other traffic
-    struct FlowNode *Node = Insert_Node(NewNode);
+    struct FlowNode *Node = Insert_Node(packetParam->flowTree, NewNode);
     // if insert fails, the existing node is returned -> flow exists already
     if (Node == NULL) {
         dbg_printf("New flow IP proto: %u. Packets: %u, Bytes: %u\n", NewNode->flowKey.proto, NewNode->packets, NewNode->bytes);
@@ -545,7 +545,7 @@ int ProcessPacket(packetParam_t *packetParam, const struct pcap_pkthdr *hdr, con
     uint16_t version, IPproto;
     char s1[64];
     char s2[64];
-    static unsigned pkg_cnt = 0;
+    static _Thread_local unsigned pkg_cnt = 0;
 
     pkg_cnt++;
     packetParam->proc_stat.packets++;
@@ -1256,7 +1256,7 @@ END_FUNC:
     }
 
     if ((hdr->ts.tv_sec - lastRun) > 1) {
-        CacheCheck(packetParam->NodeList, hdr->ts.tv_sec);
+        CacheCheck(packetParam->flowTree, packetParam->NodeList, hdr->ts.tv_sec);
         lastRun = hdr->ts.tv_sec;
     }
 
@@ -67,15 +67,54 @@ char influxdb_url[1024] = "";
 #define PROFILEWRITERS 2
 #define MAXPROFILERS 8
 
-typedef struct worker_param_s {
-    int self;
-    uint32_t numWorkers;
+// number of blocks in the block queue
+#define NUMBLOCKSLOTS 16
+// number of channel groups per worker, for balancing uneven channel costs
+#define GROUPSPERWORKER 2
+
+/*
+ * block pipeline
+ * The reader pushes the data blocks into a ring of block slots. The channels are split
+ * into groups of consecutive channels. A task is the next block of a channel group. Any
+ * idle worker picks the next available task of any idle group. A group is processed by
+ * one worker at a time and all blocks of a group are processed in order, therefore the
+ * records of each channel are written in the same order as read. A block slot is
+ * released, after all groups processed the block.
+ */
+typedef struct blockSlot_s {
+    dataBlock_t *dataBlock;
+    char *ident;       // ident of the file of this block
+    uint32_t pending;  // number of groups, which still need to process this block
+} blockSlot_t;
+
+typedef struct channelGroup_s {
+    uint32_t firstChannel;
     uint32_t numChannels;
+    void *multiFilter;     // filters of all channels of this group
+    uint64_t *matchMap;    // matching channels of a record
+    uint64_t nextBlock;    // sequence number of next block to process
+    int busy;              // group is processed by a worker
+} channelGroup_t;
+
+typedef struct profileQueue_s {
+    pthread_mutex_t mutex;
+    pthread_cond_t workerCond;  // new task or end of data
+    pthread_cond_t readerCond;  // block slot released
+
+    blockSlot_t slot[NUMBLOCKSLOTS];
+    uint64_t numBlocks;   // number of blocks pushed
+    uint64_t firstBlock;  // sequence number of the oldest unreleased block
+    int done;             // no more blocks
+
     profile_channel_info_t *channels;
-    dataBlock_t **dataBlock;
+    channelGroup_t *groups;
+    uint32_t numGroups;
+    int hasGeoDB;
+} profileQueue_t;
 
-    // sync barrier
-    pthread_control_barrier_t *barrier;
+typedef struct worker_param_s {
+    int self;
+    profileQueue_t *profileQueue;
 } worker_param_t;
 
 /* Function Prototypes */
@@ -83,8 +122,7 @@ static void usage(char *name);
 
 static profile_param_info_t *ParseParams(char *profile_datadir);
 
-static void process_data(profile_channel_info_t *channels, unsigned int numChannels, time_t tslot, worker_param_t **workerList, int numWorkers,
-                         pthread_control_barrier_t *barrier, int hasGeoDB);
+static void process_data(profileQueue_t *profileQueue);
 
 /* Functions */
 
@@ -116,51 +154,41 @@ static void usage(char *name) {
         name);
 } /* usage */
 
-__attribute__((noreturn)) static void *worker(void *arg) {
-    worker_param_t *worker_param = (worker_param_t *)arg;
-
-    uint32_t self = worker_param->self;
-    uint32_t numWorkers = worker_param->numWorkers;
-    uint32_t numChannels = worker_param->numChannels;
-    profile_channel_info_t *channels = worker_param->channels;
-
-    recordHandle_t *recordHandle = calloc(1, sizeof(recordHandle_t));
-    if (!recordHandle) {
-        LogError("malloc() error in %s line %d: %s\n", __FILE__, __LINE__, strerror(errno));
-        pthread_exit(NULL);
-    }
-
-    // wait in barrier after launch
-    pthread_control_barrier_wait(worker_param->barrier);
-
-    while (*(worker_param->dataBlock)) {
-        dataBlock_t *dataBlock = *(worker_param->dataBlock);
-        dbg_printf("Worker %i working on %p\n", self, dataBlock);
-        uint32_t recordCount = 0;
-
-        record_header_t *record_ptr = GetCursor(dataBlock);
-        uint32_t sumSize = 0;
-        for (int i = 0; i < dataBlock->NumRecords; i++) {
-            if ((sumSize + record_ptr->size) > dataBlock->size || (record_ptr->size < sizeof(record_header_t))) {
-                LogError("Corrupt data file. Inconsistent block size in %s line %d", __FILE__, __LINE__);
-                exit(255);
-            }
-            sumSize += record_ptr->size;
-            recordCount++;
-
-            switch (record_ptr->type) {
-                case V3Record:
-                    MapRecordHandle(recordHandle, (recordHeaderV3_t *)record_ptr, recordCount);
+// process all records of a block for the channels of a group
+static void ProcessGroupBlock(profileQueue_t *profileQueue, channelGroup_t *group, blockSlot_t *slot, recordHandle_t *recordHandle) {
+    profile_channel_info_t *channels = profileQueue->channels;
+    uint32_t firstChannel = group->firstChannel;
+    uint32_t lastChannel = group->firstChannel + group->numChannels;
+    uint32_t numWords = MULTIFILTERWORDS(group->numChannels);
+    uint64_t *matchMap = group->matchMap;
+    dataBlock_t *dataBlock = slot->dataBlock;
+
+    MultiFilterSetParam(group->multiFilter, slot->ident, profileQueue->hasGeoDB);
+
+    uint32_t recordCount = 0;
+    record_header_t *record_ptr = GetCursor(dataBlock);
+    uint32_t sumSize = 0;
+    for (int i = 0; i < dataBlock->NumRecords; i++) {
+        if ((sumSize + record_ptr->size) > dataBlock->size || (record_ptr->size < sizeof(record_header_t))) {
+            LogError("Corrupt data file. Inconsistent block size in %s line %d", __FILE__, __LINE__);
+            exit(255);
+        }
+        sumSize += record_ptr->size;
+        recordCount++;
 
-                    for (int j = self; j < numChannels; j += numWorkers) {
-                        int match;
+        switch (record_ptr->type) {
+            case V3Record:
+                MapRecordHandle(recordHandle, (recordHeaderV3_t *)record_ptr, recordCount);
 
-                        // apply profile filter
-                        void *engine = channels[j].engine;
-                        match = FilterRecord(engine, recordHandle);
+                // apply all profile filters of this group at once
+                MultiFilterRecord(group->multiFilter, recordHandle, matchMap);
 
-                        // if profile filter failed -> next profile
-                        if (!match) continue;
+                // for all matching channels - bit n is channel firstChannel + n
+                for (int w = 0; w < numWords; w++) {
+                    uint64_t matchBits = matchMap[w];
+                    while (matchBits) {
+                        int j = firstChannel + (w << 6) + __builtin_ctzll(matchBits);
+                        matchBits &= matchBits - 1;
 
                         // filter was successful -> continue record processing
 
@@ -173,82 +201,193 @@ __attribute__((noreturn)) static void *worker(void *arg) {
                             // write record to output buffer
                             channels[j].dataBlock = AppendToBuffer(channels[j].nffile, channels[j].dataBlock, (void *)record_ptr, record_ptr->size);
                         }
+                    }
+                }  // End of for all channels
 
-                    }  // End of for all channels
-
-                    break;
-                case ExporterInfoRecordType: {
-                    for (int j = self; j < numChannels; j += numWorkers) {
-                        if (channels[j].nffile != NULL) {
-                            // flush new exporter
-                            channels[j].dataBlock = AppendToBuffer(channels[j].nffile, channels[j].dataBlock, (void *)record_ptr, record_ptr->size);
-                        }
+                break;
+            case ExporterInfoRecordType: {
+                for (int j = firstChannel; j < lastChannel; j++) {
+                    if (channels[j].nffile != NULL) {
+                        // flush new exporter
+                        channels[j].dataBlock = AppendToBuffer(channels[j].nffile, channels[j].dataBlock, (void *)record_ptr, record_ptr->size);
                     }
-                } break;
-                case SamplerLegacyRecordType:
-                case SamplerRecordType: {
-                    for (int j = self; j < numChannels; j += numWorkers) {
-                        if (channels[j].nffile != NULL) {
-                            // flush new map
-                            channels[j].dataBlock = AppendToBuffer(channels[j].nffile, channels[j].dataBlock, (void *)record_ptr, record_ptr->size);
-                        }
+                }
+            } break;
+            case SamplerLegacyRecordType:
+            case SamplerRecordType: {
+                for (int j = firstChannel; j < lastChannel; j++) {
+                    if (channels[j].nffile != NULL) {
+                        // flush new map
+                        channels[j].dataBlock = AppendToBuffer(channels[j].nffile, channels[j].dataBlock, (void *)record_ptr, record_ptr->size);
                     }
-                } break;
-                case NbarRecordType:
-                case IfNameRecordType:
-                case VrfNameRecordType:
-                    for (int j = self; j < numChannels; j += numWorkers) {
-                        if (channels[j].nffile != NULL) {
-                            // flush new map
-                            channels[j].dataBlock = AppendToBuffer(channels[j].nffile, channels[j].dataBlock, (void *)record_ptr, record_ptr->size);
-                        }
+                }
+            } break;
+            case NbarRecordType:
+            case IfNameRecordType:
+            case VrfNameRecordType:
+                for (int j = firstChannel; j < lastChannel; j++) {
+                    if (channels[j].nffile != NULL) {
+                        // flush new map
+                        channels[j].dataBlock = AppendToBuffer(channels[j].nffile, channels[j].dataBlock, (void *)record_ptr, record_ptr->size);
                     }
+                }
+                break;
+            case LegacyRecordType1:
+            case LegacyRecordType2:
+            case ExporterStatRecordType:
+                // Silently skip exporter records
+                break;
+            default: {
+                // report unknown records once - by the first group only
+                if (firstChannel == 0) LogError("Skip unknown record type %i", record_ptr->type);
+            }
+        }
+        // Advance pointer by number of bytes for netflow record
+        record_ptr = (record_header_t *)((pointer_addr_t)record_ptr + record_ptr->size);
+
+    }  // End of for all umRecords
+
+}  // End of ProcessGroupBlock
+
+__attribute__((noreturn)) static void *worker(void *arg) {
+    worker_param_t *worker_param = (worker_param_t *)arg;
+    profileQueue_t *profileQueue = worker_param->profileQueue;
+    uint32_t numGroups = profileQueue->numGroups;
+
+    recordHandle_t *recordHandle = calloc(1, sizeof(recordHandle_t));
+    if (!recordHandle) {
+        LogError("malloc() error in %s line %d: %s\n", __FILE__, __LINE__, strerror(errno));
+        pthread_exit(NULL);
+    }
+
+    pthread_mutex_lock(&profileQueue->mutex);
+    while (1) {
+        // find an idle group with a block to process - start search at a different group for each worker
+        channelGroup_t *group = NULL;
+        int allDone = 1;
+        for (int i = 0; i < numGroups; i++) {
+            channelGroup_t *g = &profileQueue->groups[(worker_param->self + i) % numGroups];
+            if (g->nextBlock < profileQueue->numBlocks) {
+                allDone = 0;
+                if (!g->busy) {
+                    group = g;
                     break;
-                case LegacyRecordType1:
-                case LegacyRecordType2:
-                case ExporterStatRecordType:
-                    // Silently skip exporter records
-                    break;
-                default: {
-                    LogError("Skip unknown record type %i", record_ptr->type);
                 }
             }
-            // Advance pointer by number of bytes for netflow record
-            record_ptr = (record_header_t *)((pointer_addr_t)record_ptr + record_ptr->size);
+        }
 
-        }  // End of for all umRecords
+        if (group == NULL) {
+            if (allDone && profileQueue->done) break;
+            pthread_cond_wait(&profileQueue->workerCond, &profileQueue->mutex);
+            continue;
+        }
 
-        // Done
-        // wait in barrier for next data record
-        pthread_control_barrier_wait(worker_param->barrier);
+        group->busy = 1;
+        blockSlot_t *slot = &profileQueue->slot[group->nextBlock % NUMBLOCKSLOTS];
+        pthread_mutex_unlock(&profileQueue->mutex);
+
+        dbg_printf("Worker %i working on block %llu, channels %u..%u\n", worker_param->self, (unsigned long long)group->nextBlock,
+                   group->firstChannel, group->firstChannel + group->numChannels - 1);
+        ProcessGroupBlock(profileQueue, group, slot, recordHandle);
+
+        pthread_mutex_lock(&profileQueue->mutex);
+        group->nextBlock++;
+        group->busy = 0;
+        // blocks get released in order, as all groups process the blocks in order
+        if (--slot->pending == 0) {
+            FreeDataBlock(slot->dataBlock);
+            free(slot->ident);
+            slot->dataBlock = NULL;
+            slot->ident = NULL;
+            profileQueue->firstBlock++;
+            pthread_cond_signal(&profileQueue->readerCond);
+        }
+        if (profileQueue->done) {
+            // wake up all workers to check for the end of data
+            pthread_cond_broadcast(&profileQueue->workerCond);
+        } else if (group->nextBlock < profileQueue->numBlocks) {
+            // the group may be picked up by another worker
+            pthread_cond_signal(&profileQueue->workerCond);
+        }
     }
+    pthread_mutex_unlock(&profileQueue->mutex);
 
     dbg_printf("Worker %d done.\n", worker_param->self);
+    free(recordHandle);
     pthread_exit(NULL);
 
     // unreached
 }  // End of worker
 
-static worker_param_t **LauchWorkers(pthread_t *tid, int numWorkers, pthread_control_barrier_t *barrier, profile_channel_info_t *channels,
-                                     uint32_t numChannels) {
+static profileQueue_t *NewProfileQueue(profile_channel_info_t *channels, uint32_t numChannels, int numWorkers, int hasGeoDB) {
+    profileQueue_t *profileQueue = calloc(1, sizeof(profileQueue_t));
+    if (!profileQueue) {
+        LogError("calloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+        return NULL;
+    }
+    pthread_mutex_init(&profileQueue->mutex, NULL);
+    pthread_cond_init(&profileQueue->workerCond, NULL);
+    pthread_cond_init(&profileQueue->readerCond, NULL);
+    profileQueue->channels = channels;
+    profileQueue->hasGeoDB = hasGeoDB;
+
+    // split channels into groups of consecutive channels
+    uint32_t numGroups = numWorkers * GROUPSPERWORKER;
+    if (numGroups > numChannels) numGroups = numChannels;
+    profileQueue->groups = calloc(numGroups, sizeof(channelGroup_t));
+    if (!profileQueue->groups) {
+        LogError("calloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+        return NULL;
+    }
+    profileQueue->numGroups = numGroups;
+
+    uint32_t firstChannel = 0;
+    for (int i = 0; i < numGroups; i++) {
+        channelGroup_t *group = &profileQueue->groups[i];
+        group->firstChannel = firstChannel;
+        group->numChannels = (numChannels - firstChannel) / (numGroups - i);
+        firstChannel += group->numChannels;
+
+        // compile the filters of all channels of this group into one multi filter
+        void *engines[group->numChannels];
+        for (int j = 0; j < group->numChannels; j++) engines[j] = channels[group->firstChannel + j].engine;
+        group->multiFilter = CompileMultiFilter(engines, group->numChannels);
+        group->matchMap = calloc(MULTIFILTERWORDS(group->numChannels), sizeof(uint64_t));
+        if (!group->multiFilter || !group->matchMap) return NULL;
+    }
+
+    return profileQueue;
+
+}  // End of NewProfileQueue
+
+static void DisposeProfileQueue(profileQueue_t *profileQueue) {
+    for (int i = 0; i < profileQueue->numGroups; i++) {
+        DisposeMultiFilter(profileQueue->groups[i].multiFilter);
+        free(profileQueue->groups[i].matchMap);
+    }
+    free(profileQueue->groups);
+    pthread_mutex_destroy(&profileQueue->mutex);
+    pthread_cond_destroy(&profileQueue->workerCond);
+    pthread_cond_destroy(&profileQueue->readerCond);
+    free(profileQueue);
+
+}  // End of DisposeProfileQueue
+
+static worker_param_t **LauchWorkers(pthread_t *tid, int numWorkers, profileQueue_t *profileQueue) {
     if (numWorkers > MAXWORKERS) {
         LogError("LaunchWorkers: number of worker: %u > max workers: %u", numWorkers, MAXWORKERS);
         return NULL;
     }
 
     worker_param_t **workerList = calloc(numWorkers, sizeof(worker_param_t *));
-    if (!workerList) NULL;
+    if (!workerList) return NULL;
 
     for (int i = 0; i < numWorkers; i++) {
         worker_param_t *worker_param = calloc(1, sizeof(worker_param_t));
-        if (!worker_param) NULL;
+        if (!worker_param) return NULL;
 
-        worker_param->barrier = barrier;
         worker_param->self = i;
-        worker_param->dataBlock = NULL;
-        worker_param->numWorkers = numWorkers;
-        worker_param->channels = channels;
-        worker_param->numChannels = numChannels;
+        worker_param->profileQueue = profileQueue;
         workerList[i] = worker_param;
 
         int err = pthread_create(&(tid[i]), NULL, worker, (void *)worker_param);
@@ -261,69 +400,61 @@ static worker_param_t **LauchWorkers(pthread_t *tid, int numWorkers, pthread_con
 
 }  // End of LaunchWorkers
 
-static void process_data(profile_channel_info_t *channels, unsigned int numChannels, time_t tslot, worker_param_t **workerList, int numWorkers,
-                         pthread_control_barrier_t *barrier, int hasGeoDB) {
-    dataBlock_t *nextBlock = NULL;
-    dataBlock_t *dataBlock = NULL;
-    // map datablock for workers - all workers
-    // process the same block but different channels
-    for (int i = 0; i < numWorkers; i++) {
-        // set new datablock for all workers
-        workerList[i]->dataBlock = &dataBlock;
-    }
+// push a block into the block queue. Blocks, if the queue is full
+static void PushBlock(profileQueue_t *profileQueue, dataBlock_t *dataBlock, char *ident) {
+    pthread_mutex_lock(&profileQueue->mutex);
+    while ((profileQueue->numBlocks - profileQueue->firstBlock) >= NUMBLOCKSLOTS)
+        pthread_cond_wait(&profileQueue->readerCond, &profileQueue->mutex);
 
-    nffile_t *nffile = NewFile(NULL);
+    blockSlot_t *slot = &profileQueue->slot[profileQueue->numBlocks % NUMBLOCKSLOTS];
+    slot->dataBlock = dataBlock;
+    slot->ident = strdup(ident ? ident : "none");
+    slot->pending = profileQueue->numGroups;
+    profileQueue->numBlocks++;
 
-    // wait for workers ready to start
-    pthread_controller_wait(barrier);
+    pthread_cond_broadcast(&profileQueue->workerCond);
+    pthread_mutex_unlock(&profileQueue->mutex);
 
-    int done = 0;
-    while (!done) {
-        // get next data block from file
-        dataBlock = nextBlock;
-        if (dataBlock == NULL) {
-            if (GetNextFile(nffile) == NULL) {
-                done = 1;
-                continue;
-            }
-            for (int j = 0; j < numChannels; j++) {
-                // set ident to file engines
-                void *engine = channels[j].engine;
-                FilterSetParam(engine, nffile->ident, hasGeoDB);
-            }
-            // read first block and continue
-            nextBlock = ReadBlock(nffile, NULL);
-            continue;
-        }
+}  // End of PushBlock
 
-        if (dataBlock->type != DATA_BLOCK_TYPE_2 && dataBlock->type != DATA_BLOCK_TYPE_3) {
-            LogError("Can't process block type %u. Skip block", dataBlock->type);
-            nextBlock = ReadBlock(nffile, NULL);
+static void process_data(profileQueue_t *profileQueue) {
+    nffile_t *nffile = NewFile(NULL);
+
+    // no groups - nothing to process
+    int done = profileQueue->numGroups == 0;
+    while (!done) {
+        if (GetNextFile(nffile) == NULL) {
+            done = 1;
             continue;
         }
 
-        dbg_printf("Next block: Records: %u\n", dataBlock->NumRecords);
-        // release workers from barrier
-        pthread_control_barrier_release(barrier);
-
-        // get next block while worker are processing the previous one
-        nextBlock = ReadBlock(nffile, NULL);
-
-        // wait for all workers, work done on this block
-        pthread_controller_wait(barrier);
-        // free processed block
-        FreeDataBlock(dataBlock);
+        dataBlock_t *dataBlock;
+        while ((dataBlock = ReadBlock(nffile, NULL)) != NULL) {
+            if (dataBlock->type != DATA_BLOCK_TYPE_2 && dataBlock->type != DATA_BLOCK_TYPE_3) {
+                LogError("Can't process block type %u. Skip block", dataBlock->type);
+                FreeDataBlock(dataBlock);
+                continue;
+            }
 
+            dbg_printf("Next block: Records: %u\n", dataBlock->NumRecords);
+            // workers process the block, while the next block is read
+            PushBlock(profileQueue, dataBlock, nffile->ident);
+        }
     }  // End of while !done
 
-    // done! - signal all workers to terminate
-    dataBlock = NULL;
-    pthread_control_barrier_release(barrier);
+    // done! - signal all workers to terminate, after all blocks are processed
+    pthread_mutex_lock(&profileQueue->mutex);
+    profileQueue->done = 1;
+    pthread_cond_broadcast(&profileQueue->workerCond);
+    pthread_mutex_unlock(&profileQueue->mutex);
 
     DisposeFile(nffile);
 
+}  // End of process_data
+
+// write all used blocks first, then close the files
+static void CloseChannelFiles(profile_channel_info_t *channels, unsigned int numChannels) {
     // do we need to write data to new file - shadow profiles do not have files.
-    // write all used blocks first, then close the files
     for (int j = 0; j < numChannels; j++) {
         if (channels[j].nffile != NULL) {
             // flush output buffer
@@ -334,7 +465,7 @@ static void process_data(profile_channel_info_t *channels, unsigned int numChann
         }
     }
 
-}  // End of process_data
+}  // End of CloseChannelFiles
 
 static profile_param_info_t *ParseParams(char *profile_datadir) {
     char line[512], path[MAXPATHLEN];
@@ -739,23 +870,23 @@ int main(int argc, char **argv) {
     // check numWorkers depending on cores online
     numWorkers = GetNumWorkers(numWorkers);
 
-    pthread_control_barrier_t *barrier = pthread_control_barrier_init(numWorkers);
-    if (!barrier) exit(255);
-
     profile_channel_info_t *channels = GetChannelInfoList();
+    profileQueue_t *profileQueue = NewProfileQueue(channels, numChannels, numWorkers, hasGeoDB);
+    if (!profileQueue) exit(255);
 
     pthread_t tid[MAXWORKERS] = {0};
     dbg_printf("Launch Workers\n");
-    worker_param_t **workerList = LauchWorkers(tid, numWorkers, barrier, channels, numChannels);
+    worker_param_t **workerList = LauchWorkers(tid, numWorkers, profileQueue);
     if (!workerList) {
         LogError("Failed to launch workers");
         exit(255);
     }
 
-    process_data(channels, numChannels, tslot, workerList, numWorkers, barrier, hasGeoDB);
+    process_data(profileQueue);
 
     WaitWorkersDone(tid, numWorkers);
-    pthread_control_barrier_destroy(barrier);
+    CloseChannelFiles(channels, numChannels);
+    DisposeProfileQueue(profileQueue);
 
     UpdateChannels(tslot);
 #if 0
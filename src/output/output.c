@@ -308,6 +308,25 @@ RecordPrinter_t SetupOutputMode(char *print_format, outputParams_t *outputParams
 
 }  // End of SetupOutputMode
 
+// returns 1, if the output mode formats records thread safe, so blocks of records may be formatted in parallel
+int ParallelOutput(outputParams_t *outputParams) {
+    return outputParams->mode == MODE_CSV || outputParams->mode == MODE_JSON || outputParams->mode == MODE_NDJSON;
+}  // End of ParallelOutput
+
+// set the number of records printed before the next record formatted by the calling thread
+void SetPrintCount(outputParams_t *outputParams, uint64_t count) {
+    switch (outputParams->mode) {
+        case MODE_JSON:
+            json_count(count);
+            break;
+        case MODE_NDJSON:
+            ndjson_count(count);
+            break;
+        default:
+            break;
+    }
+}  // End of SetPrintCount
+
 void PrintProlog(outputParams_t *outputParams) {
     print_prolog(outputParams);
 }  // End of PrintProlog
@@ -61,6 +61,10 @@ typedef void (*EpilogPrinter_t)(outputParams_t *);
 
 RecordPrinter_t SetupOutputMode(char *print_format, outputParams_t *outputParams);
 
+int ParallelOutput(outputParams_t *outputParams);
+
+void SetPrintCount(outputParams_t *outputParams, uint64_t count);
+
 void PrintProlog(outputParams_t *outputParams);
 
 void PrintEpilog(outputParams_t *outputParams);
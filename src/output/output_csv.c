@@ -87,7 +87,8 @@ typedef char *(*string_function_t)(char *, recordHandle_t *);
 #define STREAMLEN(ptr)                                \
     ((ptrdiff_t)STREAMBUFFSIZE - (ptr - streamBuff)); \
     assert((ptr - streamBuff) < STREAMBUFFSIZE)
-static char *streamBuff = NULL;
+// per thread stream buffer - records may be formatted by multiple threads
+static _Thread_local char *streamBuff = NULL;
 
 static struct token_list_s {
     string_function_t string_function;  // function printing result to stream
@@ -100,7 +101,7 @@ static int token_index = 0;
 
 static int max_format_index = 0;
 
-static double duration = 0;
+static _Thread_local double duration = 0;
 
 #define IP_STRING_LEN (INET6_ADDRSTRLEN)
 
@@ -582,6 +583,16 @@ static void ListOutputFormats(void) {
 
 }  // End of ListOutputFormats
 
+static char *NewStreamBuff(void) {
+    char *buff = malloc(STREAMBUFFSIZE);
+    if (!buff) {
+        LogError("malloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    buff[0] = '\0';
+    return buff;
+}  // End of NewStreamBuff
+
 void csv_record(FILE *stream, recordHandle_t *recordHandle, int tag) {
     EXgenericFlow_t *genericFlow = (EXgenericFlow_t *)recordHandle->extensionList[EXgenericFlowID];
     EXtunIPv4_t *tunIPv4 = (EXtunIPv4_t *)recordHandle->extensionList[EXtunIPv4ID];
@@ -619,6 +630,7 @@ void csv_record(FILE *stream, recordHandle_t *recordHandle, int tag) {
         free(p);
     }
 
+    if (unlikely(streamBuff == NULL)) streamBuff = NewStreamBuff();
     streamBuff[0] = '\0';
     char *streamPtr = streamBuff;
     duration = 0;
@@ -650,12 +662,7 @@ void csv_record(FILE *stream, recordHandle_t *recordHandle, int tag) {
 }  // End of csv_record
 
 void csv_prolog(outputParams_t *outputParam) {
-    streamBuff = malloc(STREAMBUFFSIZE);
-    if (!streamBuff) {
-        LogError("malloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
-        exit(EXIT_FAILURE);
-    }
-    streamBuff[0] = '\0';
+    streamBuff = NewStreamBuff();
 
     // header
     printf("%s\n", header_string);
@@ -682,7 +689,7 @@ static inline uint32_t ApplyV4NetMaskBits(uint32_t ip, uint32_t maskBits) {
 }  // End of ApplyV4NetMaskBits
 
 static inline uint64_t *ApplyV6NetMaskBits(uint64_t *ip, uint32_t maskBits) {
-    static uint64_t net[2];
+    static _Thread_local uint64_t net[2];
     uint64_t mask;
     if (maskBits > 64) {
         mask = 0xffffffffffffffffLL << (128 - maskBits);
@@ -783,7 +790,7 @@ int ParseCSVOutputFormat(char *format) {
 
 static char *ICMP_Port_decode(EXgenericFlow_t *genericFlow) {
 #define ICMPSTRLEN 16
-    static char icmpString[ICMPSTRLEN];
+    static _Thread_local char icmpString[ICMPSTRLEN];
     icmpString[0] = '\0';
 
     if (genericFlow == NULL) return "0";
@@ -842,15 +849,7 @@ static char *String_FirstSeen(char *streamPtr, recordHandle_t *recordHandle) {
     uint64_t msecFirst = genericFlow ? genericFlow->msecFirst : 0;
 
     if (msecFirst) {
-        time_t tt = msecFirst / 1000LL;
-        struct tm ts;
-        localtime_r(&tt, &ts);
-        char s[128];
-        strftime(s, 128, "%Y-%m-%d %H:%M:%S", &ts);
-        s[127] = '\0';
-        ptrdiff_t lenStream = STREAMLEN(streamPtr);
-        size_t len = snprintf(streamPtr, lenStream, "%s.%03u", s, (unsigned)(msecFirst % 1000LL));
-        streamPtr += len;
+        streamPtr = MsecDateString(streamPtr, msecFirst, 0, ' ');
     } else {
         AddString("0000-00-00 00:00:00.000");
     }
@@ -864,15 +863,7 @@ static char *String_LastSeen(char *streamPtr, recordHandle_t *recordHandle) {
     uint64_t msecLast = genericFlow ? genericFlow->msecLast : 0;
 
     if (msecLast) {
-        time_t tt = msecLast / 1000LL;
-        struct tm ts;
-        localtime_r(&tt, &ts);
-        char s[128];
-        strftime(s, 128, "%Y-%m-%d %H:%M:%S", &ts);
-        s[127] = '\0';
-        ptrdiff_t lenStream = STREAMLEN(streamPtr);
-        size_t len = snprintf(streamPtr, lenStream, "%s.%03u", s, (unsigned)(msecLast % 1000LL));
-        streamPtr += len;
+        streamPtr = MsecDateString(streamPtr, msecLast, 0, ' ');
     } else {
         AddString("0000-00-00 00:00:00.000");
     }
@@ -886,15 +877,7 @@ static char *String_Received(char *streamPtr, recordHandle_t *recordHandle) {
     uint64_t msecReceived = genericFlow ? genericFlow->msecReceived : 0;
 
     if (msecReceived) {
-        time_t tt = msecReceived / 1000LL;
-        struct tm ts;
-        localtime_r(&tt, &ts);
-        char s[128];
-        strftime(s, 128, "%Y-%m-%d %H:%M:%S", &ts);
-        s[127] = '\0';
-        ptrdiff_t lenStream = STREAMLEN(streamPtr);
-        size_t len = snprintf(streamPtr, lenStream, "%s.%03llu", s, msecReceived % 1000LL);
-        streamPtr += len;
+        streamPtr = MsecDateString(streamPtr, msecReceived, 0, ' ');
     } else {
         AddString("0000-00-00 00:00:00.000");
     }
@@ -941,15 +924,7 @@ static char *String_FirstSeenGMT(char *streamPtr, recordHandle_t *recordHandle)
     uint64_t msecFirst = genericFlow ? genericFlow->msecFirst : 0;
 
     if (msecFirst) {
-        time_t tt = msecFirst / 1000LL;
-        struct tm ts;
-        gmtime_r(&tt, &ts);
-        char s[128];
-        strftime(s, 128, "%Y-%m-%d %H:%M:%S", &ts);
-        s[127] = '\0';
-        ptrdiff_t lenStream = STREAMLEN(streamPtr);
-        size_t len = snprintf(streamPtr, lenStream, "%s.%03u", s, (unsigned)(msecFirst % 1000LL));
-        streamPtr += len;
+        streamPtr = MsecDateString(streamPtr, msecFirst, 1, ' ');
     } else {
         AddString("0000-00-00 00:00:00.000");
     }
@@ -963,15 +938,7 @@ static char *String_LastSeenGMT(char *streamPtr, recordHandle_t *recordHandle) {
     uint64_t msecLast = genericFlow ? genericFlow->msecLast : 0;
 
     if (msecLast) {
-        time_t tt = msecLast / 1000LL;
-        struct tm ts;
-        gmtime_r(&tt, &ts);
-        char s[128];
-        strftime(s, 128, "%Y-%m-%d %H:%M:%S", &ts);
-        s[127] = '\0';
-        ptrdiff_t lenStream = STREAMLEN(streamPtr);
-        size_t len = snprintf(streamPtr, lenStream, "%s.%03u", s, (unsigned)(msecLast % 1000LL));
-        streamPtr += len;
+        streamPtr = MsecDateString(streamPtr, msecLast, 1, ' ');
     } else {
         AddString("0000-00-00 00:00:00.000");
     }
@@ -985,15 +952,7 @@ static char *String_ReceivedGMT(char *streamPtr, recordHandle_t *recordHandle) {
     uint64_t msecReceived = genericFlow ? genericFlow->msecReceived : 0;
 
     if (msecReceived) {
-        time_t tt = msecReceived / 1000LL;
-        struct tm ts;
-        gmtime_r(&tt, &ts);
-        char s[128];
-        strftime(s, 128, "%Y-%m-%d %H:%M:%S", &ts);
-        s[127] = '\0';
-        ptrdiff_t lenStream = STREAMLEN(streamPtr);
-        size_t len = snprintf(streamPtr, lenStream, "%s.%03llu", s, msecReceived % 1000LL);
-        streamPtr += len;
+        streamPtr = MsecDateString(streamPtr, msecReceived, 1, ' ');
     } else {
         AddString("0000-00-00 00:00:00.000");
     }
@@ -1248,14 +1207,7 @@ static char *String_EventTime(char *streamPtr, recordHandle_t *recordHandle) {
         msecEvent = natCommon->msecEvent;
 
     if (msecEvent) {
-        time_t tt = msecEvent / 1000LL;
-        struct tm *ts = localtime(&tt);
-        char s[128];
-        strftime(s, 128, "%Y-%m-%d %H:%M:%S", ts);
-        s[127] = '\0';
-        ptrdiff_t lenStream = STREAMLEN(streamPtr);
-        size_t len = snprintf(streamPtr, lenStream, "%s.%03llu", s, msecEvent % 1000LL);
-        streamPtr += len;
+        streamPtr = MsecDateString(streamPtr, msecEvent, 0, ' ');
     } else {
         AddString("0000-00-00 00:00:00.000");
     }
@@ -1295,12 +1247,12 @@ static char *String_SrcAddr(char *streamPtr, recordHandle_t *recordHandle) {
     tmp_str[0] = 0;
     if (ipv4Flow) {
         uint32_t ip = htonl(ipv4Flow->srcAddr);
-        inet_ntop(AF_INET, &ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET, &ip, tmp_str, sizeof(tmp_str));
     } else if (ipv6Flow) {
         uint64_t ip[2];
         ip[0] = htonll(ipv6Flow->srcAddr[0]);
         ip[1] = htonll(ipv6Flow->srcAddr[1]);
-        inet_ntop(AF_INET6, ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET6, ip, tmp_str, sizeof(tmp_str));
     } else {
         strcpy(tmp_str, "0.0.0.0");
     }
@@ -1319,12 +1271,12 @@ static char *String_DstAddr(char *streamPtr, recordHandle_t *recordHandle) {
     tmp_str[0] = 0;
     if (ipv4Flow) {
         uint32_t ip = htonl(ipv4Flow->dstAddr);
-        inet_ntop(AF_INET, &ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET, &ip, tmp_str, sizeof(tmp_str));
     } else if (ipv6Flow) {
         uint64_t ip[2];
         ip[0] = htonll(ipv6Flow->dstAddr[0]);
         ip[1] = htonll(ipv6Flow->dstAddr[1]);
-        inet_ntop(AF_INET6, ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET6, ip, tmp_str, sizeof(tmp_str));
     } else {
         strcpy(tmp_str, "0.0.0.0");
     }
@@ -1346,12 +1298,12 @@ static char *String_SrcNet(char *streamPtr, recordHandle_t *recordHandle) {
     if (ipv4Flow) {
         uint32_t ip = ApplyV4NetMaskBits(ipv4Flow->srcAddr, srcMask);
         ip = htonl(ip);
-        inet_ntop(AF_INET, &ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET, &ip, tmp_str, sizeof(tmp_str));
     } else if (ipv6Flow) {
         uint64_t *ip = ApplyV6NetMaskBits(ipv6Flow->srcAddr, srcMask);
         ip[0] = htonll(ip[0]);
         ip[1] = htonll(ip[1]);
-        inet_ntop(AF_INET6, ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET6, ip, tmp_str, sizeof(tmp_str));
     } else {
         strcpy(tmp_str, "0.0.0.0");
     }
@@ -1375,12 +1327,12 @@ static char *String_DstNet(char *streamPtr, recordHandle_t *recordHandle) {
     if (ipv4Flow) {
         uint32_t ip = ApplyV4NetMaskBits(ipv4Flow->dstAddr, dstMask);
         ip = htonl(ip);
-        inet_ntop(AF_INET, &ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET, &ip, tmp_str, sizeof(tmp_str));
     } else if (ipv6Flow) {
         uint64_t *ip = ApplyV6NetMaskBits(ipv6Flow->dstAddr, dstMask);
         ip[0] = htonll(ip[0]);
         ip[1] = htonll(ip[1]);
-        inet_ntop(AF_INET6, ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET6, ip, tmp_str, sizeof(tmp_str));
     } else {
         strcpy(tmp_str, "0.0.0.0");
     }
@@ -1565,13 +1517,13 @@ static char *String_NextHop(char *streamPtr, recordHandle_t *recordHandle) {
     tmp_str[0] = 0;
     if (ipNextHopV4) {
         uint32_t ip = htonl(ipNextHopV4->ip);
-        inet_ntop(AF_INET, &ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET, &ip, tmp_str, sizeof(tmp_str));
     } else if (ipNextHopV6) {
         uint64_t ip[2];
 
         ip[0] = htonll(ipNextHopV6->ip[0]);
         ip[1] = htonll(ipNextHopV6->ip[1]);
-        inet_ntop(AF_INET6, ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET6, ip, tmp_str, sizeof(tmp_str));
     } else {
         strcpy(tmp_str, "0.0.0.0");
     }
@@ -1590,13 +1542,13 @@ static char *String_BGPNextHop(char *streamPtr, recordHandle_t *recordHandle) {
     tmp_str[0] = 0;
     if (bgpNextHopV4) {
         uint32_t ip = htonl(bgpNextHopV4->ip);
-        inet_ntop(AF_INET, &ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET, &ip, tmp_str, sizeof(tmp_str));
     } else if (bgpNextHopV6) {
         uint64_t ip[2];
 
         ip[0] = htonll(bgpNextHopV6->ip[0]);
         ip[1] = htonll(bgpNextHopV6->ip[1]);
-        inet_ntop(AF_INET6, ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET6, ip, tmp_str, sizeof(tmp_str));
     } else {
         strcpy(tmp_str, "0.0.0.0");
     }
@@ -1615,13 +1567,13 @@ static char *String_RouterIP(char *streamPtr, recordHandle_t *recordHandle) {
     tmp_str[0] = 0;
     if (ipReceivedV4) {
         uint32_t ip = htonl(ipReceivedV4->ip);
-        inet_ntop(AF_INET, &ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET, &ip, tmp_str, sizeof(tmp_str));
     } else if (ipReceivedV6) {
         uint64_t ip[2];
 
         ip[0] = htonll(ipReceivedV6->ip[0]);
         ip[1] = htonll(ipReceivedV6->ip[1]);
-        inet_ntop(AF_INET6, ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET6, ip, tmp_str, sizeof(tmp_str));
     } else {
         strcpy(tmp_str, "0.0.0.0");
     }
@@ -2309,13 +2261,13 @@ static char *String_xlateSrcAddr(char *streamPtr, recordHandle_t *recordHandle)
     tmp_str[0] = 0;
     if (natXlateIPv4) {
         uint32_t ip = htonl(natXlateIPv4->xlateSrcAddr);
-        inet_ntop(AF_INET, &ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET, &ip, tmp_str, sizeof(tmp_str));
     } else if (natXlateIPv6) {
         uint64_t ip[2];
 
         ip[0] = htonll(natXlateIPv6->xlateSrcAddr[0]);
         ip[1] = htonll(natXlateIPv6->xlateSrcAddr[1]);
-        inet_ntop(AF_INET6, ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET6, ip, tmp_str, sizeof(tmp_str));
     } else {
         strcpy(tmp_str, "0.0.0.0");
     }
@@ -2334,13 +2286,13 @@ static char *String_xlateDstAddr(char *streamPtr, recordHandle_t *recordHandle)
     tmp_str[0] = 0;
     if (natXlateIPv4) {
         uint32_t ip = htonl(natXlateIPv4->xlateDstAddr);
-        inet_ntop(AF_INET, &ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET, &ip, tmp_str, sizeof(tmp_str));
     } else if (natXlateIPv6) {
         uint64_t ip[2];
 
         ip[0] = htonll(natXlateIPv6->xlateDstAddr[0]);
         ip[1] = htonll(natXlateIPv6->xlateDstAddr[1]);
-        inet_ntop(AF_INET6, ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET6, ip, tmp_str, sizeof(tmp_str));
     } else {
         strcpy(tmp_str, "0.0.0.0");
     }
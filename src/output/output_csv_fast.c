@@ -120,8 +120,8 @@ void csv_record_fast(FILE *stream, recordHandle_t *recordHandle, int tag) {
         uint32_t src = htonl(ipv4Flow->srcAddr);
         uint32_t dst = htonl(ipv4Flow->dstAddr);
 
-        inet_ntop(AF_INET, &src, sa, sizeof(sa));
-        inet_ntop(AF_INET, &dst, da, sizeof(da));
+        IPString(AF_INET, &src, sa, sizeof(sa));
+        IPString(AF_INET, &dst, da, sizeof(da));
     }
 
     if (ipv6Flow) {
@@ -132,8 +132,8 @@ void csv_record_fast(FILE *stream, recordHandle_t *recordHandle, int tag) {
         dst[0] = htonll(ipv6Flow->dstAddr[0]);
         dst[1] = htonll(ipv6Flow->dstAddr[1]);
 
-        inet_ntop(AF_INET6, &src, sa, sizeof(sa));
-        inet_ntop(AF_INET6, &dst, da, sizeof(da));
+        IPString(AF_INET6, &src, sa, sizeof(sa));
+        IPString(AF_INET6, &dst, da, sizeof(da));
     }
 
     AddU32(++recordCount);
@@ -886,13 +886,9 @@ static void String_FirstSeen(FILE *stream, recordHandle_t *recordHandle) {
     uint64_t msecFirst = genericFlow ? genericFlow->msecFirst : 0;
 
     if (msecFirst) {
-        time_t tt = msecFirst / 1000LL;
-        struct tm ts;
-        localtime_r(&tt, &ts);
-        char s[128];
-        strftime(s, 128, "%Y-%m-%d %H:%M:%S", &ts);
-        s[127] = '\0';
-        fprintf(stream, "%s.%03u", s, (unsigned)(msecFirst % 1000LL));
+        char s[DATESTRINGLEN];
+        MsecDateString(s, msecFirst, 0, ' ');
+        fputs(s, stream);
     } else {
         fprintf(stream, "%s", "0000-00-00 00:00:00.000");
     }
@@ -905,13 +901,9 @@ static void String_LastSeen(FILE *stream, recordHandle_t *recordHandle) {
     uint64_t msecLast = genericFlow ? genericFlow->msecLast : 0;
 
     if (msecLast) {
-        time_t tt = msecLast / 1000LL;
-        struct tm ts;
-        localtime_r(&tt, &ts);
-        char s[128];
-        strftime(s, 128, "%Y-%m-%d %H:%M:%S", &ts);
-        s[127] = '\0';
-        fprintf(stream, "%s.%03u", s, (unsigned)(msecLast % 1000LL));
+        char s[DATESTRINGLEN];
+        MsecDateString(s, msecLast, 0, ' ');
+        fputs(s, stream);
     } else {
         fprintf(stream, "%s", "0000-00-00 00:00:00.000");
     }
@@ -924,13 +916,9 @@ static void String_Received(FILE *stream, recordHandle_t *recordHandle) {
     uint64_t msecReceived = genericFlow ? genericFlow->msecReceived : 0;
 
     if (msecReceived) {
-        time_t tt = msecReceived / 1000LL;
-        struct tm ts;
-        localtime_r(&tt, &ts);
-        char s[128];
-        strftime(s, 128, "%Y-%m-%d %H:%M:%S", &ts);
-        s[127] = '\0';
-        fprintf(stream, "%s.%03llu", s, msecReceived % 1000LL);
+        char s[DATESTRINGLEN];
+        MsecDateString(s, msecReceived, 0, ' ');
+        fputs(s, stream);
     } else {
         fprintf(stream, "%s", "0000-00-00 00:00:00.000");
     }
@@ -943,13 +931,9 @@ static void String_ReceivedGMT(FILE *stream, recordHandle_t *recordHandle) {
     uint64_t msecReceived = genericFlow ? genericFlow->msecReceived : 0;
 
     if (msecReceived) {
-        time_t tt = msecReceived / 1000LL;
-        struct tm ts;
-        gmtime_r(&tt, &ts);
-        char s[128];
-        strftime(s, 128, "%Y-%m-%d %H:%M:%S", &ts);
-        s[127] = '\0';
-        fprintf(stream, "%s.%03llu", s, msecReceived % 1000LL);
+        char s[DATESTRINGLEN];
+        MsecDateString(s, msecReceived, 1, ' ');
+        fputs(s, stream);
     } else {
         fprintf(stream, "%s", "0000-00-00 00:00:00.000");
     }
@@ -986,13 +970,9 @@ static void String_FirstSeenGMT(FILE *stream, recordHandle_t *recordHandle) {
     uint64_t msecFirst = genericFlow ? genericFlow->msecFirst : 0;
 
     if (msecFirst) {
-        time_t tt = msecFirst / 1000LL;
-        struct tm ts;
-        gmtime_r(&tt, &ts);
-        char s[128];
-        strftime(s, 128, "%Y-%m-%d %H:%M:%S", &ts);
-        s[127] = '\0';
-        fprintf(stream, "%s.%03u", s, (unsigned)(msecFirst % 1000LL));
+        char s[DATESTRINGLEN];
+        MsecDateString(s, msecFirst, 1, ' ');
+        fputs(s, stream);
     } else {
         fprintf(stream, "%s", "0000-00-00 00:00:00.000");
     }
@@ -1005,13 +985,9 @@ static void String_LastSeenGMT(FILE *stream, recordHandle_t *recordHandle) {
     uint64_t msecLast = genericFlow ? genericFlow->msecLast : 0;
 
     if (msecLast) {
-        time_t tt = msecLast / 1000LL;
-        struct tm ts;
-        gmtime_r(&tt, &ts);
-        char s[128];
-        strftime(s, 128, "%Y-%m-%d %H:%M:%S", &ts);
-        s[127] = '\0';
-        fprintf(stream, "%s.%03u", s, (unsigned)(msecLast % 1000LL));
+        char s[DATESTRINGLEN];
+        MsecDateString(s, msecLast, 1, ' ');
+        fputs(s, stream);
     } else {
         fprintf(stream, "%s", "0000-00-00 00:00:00.000");
     }
@@ -1282,13 +1258,9 @@ static void String_EventTime(FILE *stream, recordHandle_t *recordHandle) {
         msecEvent = natCommon->msecEvent;
 
     if (msecEvent) {
-        time_t tt = msecEvent / 1000LL;
-        struct tm ts;
-        localtime_r(&tt, &ts);
-        char s[128];
-        strftime(s, 128, "%Y-%m-%d %H:%M:%S", &ts);
-        s[127] = '\0';
-        fprintf(stream, "%s.%03llu", s, msecEvent % 1000LL);
+        char s[DATESTRINGLEN];
+        MsecDateString(s, msecEvent, 0, ' ');
+        fputs(s, stream);
     } else {
         fprintf(stream, "%s", "0000-00-00 00:00:00.000");
     }
@@ -1322,12 +1294,12 @@ static void String_SrcAddr(FILE *stream, recordHandle_t *recordHandle) {
     tmp_str[0] = 0;
     if (ipv4Flow) {
         uint32_t ip = htonl(ipv4Flow->srcAddr);
-        inet_ntop(AF_INET, &ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET, &ip, tmp_str, sizeof(tmp_str));
     } else if (ipv6Flow) {
         uint64_t ip[2];
         ip[0] = htonll(ipv6Flow->srcAddr[0]);
         ip[1] = htonll(ipv6Flow->srcAddr[1]);
-        inet_ntop(AF_INET6, ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET6, ip, tmp_str, sizeof(tmp_str));
         if (!long_v6) {
             CondenseV6(tmp_str);
         }
@@ -1351,13 +1323,13 @@ static void String_SrcGeoAddr(FILE *stream, recordHandle_t *recordHandle) {
     tmp_str[0] = 0;
     if (ipv4Flow) {
         uint32_t ip = htonl(ipv4Flow->srcAddr);
-        inet_ntop(AF_INET, &ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET, &ip, tmp_str, sizeof(tmp_str));
         if (recordHandle->geo[0] == '\0') LookupV4Country(ipv4Flow->srcAddr, recordHandle->geo);
     } else if (ipv6Flow) {
         uint64_t ip[2];
         ip[0] = htonll(ipv6Flow->srcAddr[0]);
         ip[1] = htonll(ipv6Flow->srcAddr[1]);
-        inet_ntop(AF_INET6, ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET6, ip, tmp_str, sizeof(tmp_str));
         if (recordHandle->geo[0] == '\0') LookupV6Country(ipv6Flow->srcAddr, recordHandle->geo);
         if (!long_v6) {
             CondenseV6(tmp_str);
@@ -1387,13 +1359,13 @@ static void String_SrcAddrPort(FILE *stream, recordHandle_t *recordHandle) {
     tmp_str[0] = 0;
     if (ipv4Flow) {
         uint32_t ip = htonl(ipv4Flow->srcAddr);
-        inet_ntop(AF_INET, &ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET, &ip, tmp_str, sizeof(tmp_str));
         portChar = ':';
     } else if (ipv6Flow) {
         uint64_t ip[2];
         ip[0] = htonll(ipv6Flow->srcAddr[0]);
         ip[1] = htonll(ipv6Flow->srcAddr[1]);
-        inet_ntop(AF_INET6, ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET6, ip, tmp_str, sizeof(tmp_str));
         if (!long_v6) {
             CondenseV6(tmp_str);
         }
@@ -1422,14 +1394,14 @@ static void String_SrcAddrGeoPort(FILE *stream, recordHandle_t *recordHandle) {
     tmp_str[0] = 0;
     if (ipv4Flow) {
         uint32_t ip = htonl(ipv4Flow->srcAddr);
-        inet_ntop(AF_INET, &ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET, &ip, tmp_str, sizeof(tmp_str));
         if (recordHandle->geo[0] == '\0') LookupV4Country(ipv4Flow->srcAddr, recordHandle->geo);
         portChar = ':';
     } else if (ipv6Flow) {
         uint64_t ip[2];
         ip[0] = htonll(ipv6Flow->srcAddr[0]);
         ip[1] = htonll(ipv6Flow->srcAddr[1]);
-        inet_ntop(AF_INET6, ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET6, ip, tmp_str, sizeof(tmp_str));
         if (recordHandle->geo[0] == '\0') LookupV6Country(ipv6Flow->srcAddr, recordHandle->geo);
         if (!long_v6) {
             CondenseV6(tmp_str);
@@ -1458,12 +1430,12 @@ static void String_DstAddr(FILE *stream, recordHandle_t *recordHandle) {
     tmp_str[0] = 0;
     if (ipv4Flow) {
         uint32_t ip = htonl(ipv4Flow->dstAddr);
-        inet_ntop(AF_INET, &ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET, &ip, tmp_str, sizeof(tmp_str));
     } else if (ipv6Flow) {
         uint64_t ip[2];
         ip[0] = htonll(ipv6Flow->dstAddr[0]);
         ip[1] = htonll(ipv6Flow->dstAddr[1]);
-        inet_ntop(AF_INET6, ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET6, ip, tmp_str, sizeof(tmp_str));
         if (!long_v6) {
             CondenseV6(tmp_str);
         }
@@ -1487,13 +1459,13 @@ static void String_DstGeoAddr(FILE *stream, recordHandle_t *recordHandle) {
     tmp_str[0] = 0;
     if (ipv4Flow) {
         uint32_t ip = htonl(ipv4Flow->dstAddr);
-        inet_ntop(AF_INET, &ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET, &ip, tmp_str, sizeof(tmp_str));
         if (recordHandle->geo[2] == '\0') LookupV4Country(ipv4Flow->dstAddr, &recordHandle->geo[2]);
     } else if (ipv6Flow) {
         uint64_t ip[2];
         ip[0] = htonll(ipv6Flow->dstAddr[0]);
         ip[1] = htonll(ipv6Flow->dstAddr[1]);
-        inet_ntop(AF_INET6, ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET6, ip, tmp_str, sizeof(tmp_str));
         if (recordHandle->geo[2] == '\0') LookupV6Country(ipv6Flow->dstAddr, &recordHandle->geo[2]);
         if (!long_v6) {
             CondenseV6(tmp_str);
@@ -1522,13 +1494,13 @@ static void String_DstAddrPort(FILE *stream, recordHandle_t *recordHandle) {
     tmp_str[0] = 0;
     if (ipv4Flow) {
         uint32_t ip = htonl(ipv4Flow->dstAddr);
-        inet_ntop(AF_INET, &ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET, &ip, tmp_str, sizeof(tmp_str));
         portChar = ':';
     } else if (ipv6Flow) {
         uint64_t ip[2];
         ip[0] = htonll(ipv6Flow->dstAddr[0]);
         ip[1] = htonll(ipv6Flow->dstAddr[1]);
-        inet_ntop(AF_INET6, ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET6, ip, tmp_str, sizeof(tmp_str));
         if (!long_v6) {
             CondenseV6(tmp_str);
         }
@@ -1556,14 +1528,14 @@ static void String_DstAddrGeoPort(FILE *stream, recordHandle_t *recordHandle) {
     tmp_str[0] = 0;
     if (ipv4Flow) {
         uint32_t ip = htonl(ipv4Flow->dstAddr);
-        inet_ntop(AF_INET, &ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET, &ip, tmp_str, sizeof(tmp_str));
         if (recordHandle->geo[2] == '\0') LookupV4Country(ipv4Flow->dstAddr, &recordHandle->geo[2]);
         portChar = ':';
     } else if (ipv6Flow) {
         uint64_t ip[2];
         ip[0] = htonll(ipv6Flow->dstAddr[0]);
         ip[1] = htonll(ipv6Flow->dstAddr[1]);
-        inet_ntop(AF_INET6, ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET6, ip, tmp_str, sizeof(tmp_str));
         if (recordHandle->geo[2] == '\0') LookupV6Country(ipv6Flow->dstAddr, &recordHandle->geo[2]);
         if (!long_v6) {
             CondenseV6(tmp_str);
@@ -1597,12 +1569,12 @@ static void String_SrcNet(FILE *stream, recordHandle_t *recordHandle) {
     if (ipv4Flow) {
         uint32_t ip = ApplyV4NetMaskBits(ipv4Flow->srcAddr, srcMask);
         ip = htonl(ip);
-        inet_ntop(AF_INET, &ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET, &ip, tmp_str, sizeof(tmp_str));
     } else if (ipv6Flow) {
         uint64_t *ip = ApplyV6NetMaskBits(ipv6Flow->srcAddr, srcMask);
         ip[0] = htonll(ip[0]);
         ip[1] = htonll(ip[1]);
-        inet_ntop(AF_INET6, ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET6, ip, tmp_str, sizeof(tmp_str));
         if (!long_v6) {
             CondenseV6(tmp_str);
         }
@@ -1629,12 +1601,12 @@ static void String_DstNet(FILE *stream, recordHandle_t *recordHandle) {
     if (ipv4Flow) {
         uint32_t ip = ApplyV4NetMaskBits(ipv4Flow->dstAddr, dstMask);
         ip = htonl(ip);
-        inet_ntop(AF_INET, &ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET, &ip, tmp_str, sizeof(tmp_str));
     } else if (ipv6Flow) {
         uint64_t *ip = ApplyV6NetMaskBits(ipv6Flow->dstAddr, dstMask);
         ip[0] = htonll(ip[0]);
         ip[1] = htonll(ip[1]);
-        inet_ntop(AF_INET6, ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET6, ip, tmp_str, sizeof(tmp_str));
         if (!long_v6) {
             CondenseV6(tmp_str);
         }
@@ -1802,13 +1774,13 @@ static void String_NextHop(FILE *stream, recordHandle_t *recordHandle) {
     tmp_str[0] = 0;
     if (ipNextHopV4) {
         uint32_t ip = htonl(ipNextHopV4->ip);
-        inet_ntop(AF_INET, &ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET, &ip, tmp_str, sizeof(tmp_str));
     } else if (ipNextHopV6) {
         uint64_t ip[2];
 
         ip[0] = htonll(ipNextHopV6->ip[0]);
         ip[1] = htonll(ipNextHopV6->ip[1]);
-        inet_ntop(AF_INET6, ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET6, ip, tmp_str, sizeof(tmp_str));
         if (!long_v6) {
             CondenseV6(tmp_str);
         }
@@ -1832,13 +1804,13 @@ static void String_BGPNextHop(FILE *stream, recordHandle_t *recordHandle) {
     tmp_str[0] = 0;
     if (bgpNextHopV4) {
         uint32_t ip = htonl(bgpNextHopV4->ip);
-        inet_ntop(AF_INET, &ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET, &ip, tmp_str, sizeof(tmp_str));
     } else if (bgpNextHopV6) {
         uint64_t ip[2];
 
         ip[0] = htonll(bgpNextHopV6->ip[0]);
         ip[1] = htonll(bgpNextHopV6->ip[1]);
-        inet_ntop(AF_INET6, ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET6, ip, tmp_str, sizeof(tmp_str));
         if (!long_v6) {
             CondenseV6(tmp_str);
         }
@@ -1862,13 +1834,13 @@ static void String_RouterIP(FILE *stream, recordHandle_t *recordHandle) {
     tmp_str[0] = 0;
     if (ipReceivedV4) {
         uint32_t ip = htonl(ipReceivedV4->ip);
-        inet_ntop(AF_INET, &ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET, &ip, tmp_str, sizeof(tmp_str));
     } else if (ipReceivedV6) {
         uint64_t ip[2];
 
         ip[0] = htonll(ipReceivedV6->ip[0]);
         ip[1] = htonll(ipReceivedV6->ip[1]);
-        inet_ntop(AF_INET6, ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET6, ip, tmp_str, sizeof(tmp_str));
         if (!long_v6) {
             CondenseV6(tmp_str);
         }
@@ -2476,13 +2448,13 @@ static void String_xlateSrcAddr(FILE *stream, recordHandle_t *recordHandle) {
     tmp_str[0] = 0;
     if (natXlateIPv4) {
         uint32_t ip = htonl(natXlateIPv4->xlateSrcAddr);
-        inet_ntop(AF_INET, &ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET, &ip, tmp_str, sizeof(tmp_str));
     } else if (natXlateIPv6) {
         uint64_t ip[2];
 
         ip[0] = htonll(natXlateIPv6->xlateSrcAddr[0]);
         ip[1] = htonll(natXlateIPv6->xlateSrcAddr[1]);
-        inet_ntop(AF_INET6, ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET6, ip, tmp_str, sizeof(tmp_str));
         if (!long_v6) {
             CondenseV6(tmp_str);
         }
@@ -2506,13 +2478,13 @@ static void String_xlateDstAddr(FILE *stream, recordHandle_t *recordHandle) {
     tmp_str[0] = 0;
     if (natXlateIPv4) {
         uint32_t ip = htonl(natXlateIPv4->xlateDstAddr);
-        inet_ntop(AF_INET, &ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET, &ip, tmp_str, sizeof(tmp_str));
     } else if (natXlateIPv6) {
         uint64_t ip[2];
 
         ip[0] = htonll(natXlateIPv6->xlateDstAddr[0]);
         ip[1] = htonll(natXlateIPv6->xlateDstAddr[1]);
-        inet_ntop(AF_INET6, ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET6, ip, tmp_str, sizeof(tmp_str));
         if (!long_v6) {
             CondenseV6(tmp_str);
         }
@@ -2552,14 +2524,14 @@ static void String_xlateSrcAddrPort(FILE *stream, recordHandle_t *recordHandle)
     tmp_str[0] = 0;
     if (natXlateIPv4) {
         uint32_t ip = htonl(natXlateIPv4->xlateSrcAddr);
-        inet_ntop(AF_INET, &ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET, &ip, tmp_str, sizeof(tmp_str));
         portChar = ':';
     } else if (natXlateIPv6) {
         uint64_t ip[2];
 
         ip[0] = htonll(natXlateIPv6->xlateSrcAddr[0]);
         ip[1] = htonll(natXlateIPv6->xlateSrcAddr[1]);
-        inet_ntop(AF_INET6, ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET6, ip, tmp_str, sizeof(tmp_str));
         if (!long_v6) {
             CondenseV6(tmp_str);
         }
@@ -2588,14 +2560,14 @@ static void String_xlateDstAddrPort(FILE *stream, recordHandle_t *recordHandle)
     tmp_str[0] = 0;
     if (natXlateIPv4) {
         uint32_t ip = htonl(natXlateIPv4->xlateDstAddr);
-        inet_ntop(AF_INET, &ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET, &ip, tmp_str, sizeof(tmp_str));
         portChar = ':';
     } else if (natXlateIPv6) {
         uint64_t ip[2];
 
         ip[0] = htonll(natXlateIPv6->xlateDstAddr[0]);
         ip[1] = htonll(natXlateIPv6->xlateDstAddr[1]);
-        inet_ntop(AF_INET6, ip, tmp_str, sizeof(tmp_str));
+        IPString(AF_INET6, ip, tmp_str, sizeof(tmp_str));
         if (!long_v6) {
             CondenseV6(tmp_str);
         }
@@ -57,8 +57,8 @@
 
 #define IP_STRING_LEN (INET6_ADDRSTRLEN)
 
-// record counter
-static uint32_t recordCount = 0;
+// record counter - records may be formatted by multiple threads
+static _Thread_local uint32_t recordCount = 0;
 
 #include "itoa.c"
 
@@ -118,35 +118,18 @@ static uint32_t recordCount = 0;
 #define STREAMLEN(ptr)                                \
     ((ptrdiff_t)STREAMBUFFSIZE - (ptr - streamBuff)); \
     assert((ptr - streamBuff) < STREAMBUFFSIZE)
-static char *streamBuff = NULL;
+static _Thread_local char *streamBuff = NULL;
 
 static char *stringEXgenericFlow(char *streamPtr, void *extensionRecord) {
     EXgenericFlow_t *genericFlow = (EXgenericFlow_t *)extensionRecord;
 
-    time_t when = (genericFlow->msecFirst / 1000LL);
-    struct tm ts = {0};
-    localtime_r(&when, &ts);
-    char dateBuff1[64];
-    strftime(dateBuff1, 63, "%Y-%m-%dT%H:%M:%S", &ts);
-
-    when = (genericFlow->msecLast / 1000LL);
-    localtime_r(&when, &ts);
-    char dateBuff2[64];
-    strftime(dateBuff2, 63, "%Y-%m-%dT%H:%M:%S", &ts);
-
-    when = (genericFlow->msecReceived / 1000LL);
-    localtime_r(&when, &ts);
-    char dateBuff3[64];
-    strftime(dateBuff3, 63, "%Y-%m-%dT%H:%M:%S", &ts);
-
-    ptrdiff_t lenStream = STREAMLEN(streamPtr);
-    int len = snprintf(streamPtr, lenStream,
-                       "  \"first\" : \"%s.%03u\",\n"
-                       "  \"last\" : \"%s.%03u\",\n"
-                       "  \"received\" : \"%s.%03u\",\n",
-                       dateBuff1, (unsigned)(genericFlow->msecFirst % 1000LL), dateBuff2, (unsigned)(genericFlow->msecLast % 1000LL), dateBuff3,
-                       (unsigned)(genericFlow->msecReceived % 1000LL));
-    streamPtr += len;
+    char dateBuff[DATESTRINGLEN];
+    MsecDateString(dateBuff, genericFlow->msecFirst, 0, 'T');
+    AddElementString("first", dateBuff);
+    MsecDateString(dateBuff, genericFlow->msecLast, 0, 'T');
+    AddElementString("last", dateBuff);
+    MsecDateString(dateBuff, genericFlow->msecReceived, 0, 'T');
+    AddElementString("received", dateBuff);
 
     AddElementU64("in_packets", genericFlow->inPackets);
     AddElementU64("in_bytes", genericFlow->inBytes);
@@ -175,8 +158,8 @@ static char *stringEXipv4Flow(char *streamPtr, void *extensionRecord) {
     uint32_t src = htonl(ipv4Flow->srcAddr);
     uint32_t dst = htonl(ipv4Flow->dstAddr);
     char sa[IP_STRING_LEN], da[IP_STRING_LEN];
-    inet_ntop(AF_INET, &src, sa, sizeof(sa));
-    inet_ntop(AF_INET, &dst, da, sizeof(da));
+    IPString(AF_INET, &src, sa, sizeof(sa));
+    IPString(AF_INET, &dst, da, sizeof(da));
 
     char sloc[128], dloc[128];
     LookupV4Location(ipv4Flow->srcAddr, sloc, 128);
@@ -199,8 +182,8 @@ static char *stringEXipv6Flow(char *streamPtr, void *extensionRecord) {
     dst[0] = htonll(ipv6Flow->dstAddr[0]);
     dst[1] = htonll(ipv6Flow->dstAddr[1]);
     char sa[IP_STRING_LEN], da[IP_STRING_LEN];
-    inet_ntop(AF_INET6, &src, sa, sizeof(sa));
-    inet_ntop(AF_INET6, &dst, da, sizeof(da));
+    IPString(AF_INET6, &src, sa, sizeof(sa));
+    IPString(AF_INET6, &dst, da, sizeof(da));
 
     char sloc[128], dloc[128];
     LookupV6Location(ipv6Flow->srcAddr, sloc, 128);
@@ -235,7 +218,7 @@ static char *stringEXflowMisc(char *streamPtr, recordHandle_t *recordHandle, voi
             }
             src[0] = htonll(src[0]);
             src[1] = htonll(src[1]);
-            inet_ntop(AF_INET6, &src, snet, sizeof(snet));
+            IPString(AF_INET6, &src, snet, sizeof(snet));
 
             if (flowMisc->dstMask >= 64) {
                 dst[0] = ipv6Flow->dstAddr[0] & (0xffffffffffffffffLL << (flowMisc->dstMask - 64));
@@ -246,7 +229,7 @@ static char *stringEXflowMisc(char *streamPtr, recordHandle_t *recordHandle, voi
             }
             dst[0] = htonll(dst[0]);
             dst[1] = htonll(dst[1]);
-            inet_ntop(AF_INET6, &dst, dnet, sizeof(dnet));
+            IPString(AF_INET6, &dst, dnet, sizeof(dnet));
 
         } else {
             snet[0] = '\0';
@@ -258,11 +241,11 @@ static char *stringEXflowMisc(char *streamPtr, recordHandle_t *recordHandle, voi
         if (flowMisc->srcMask || flowMisc->dstMask) {
             uint32_t src = ipv4Flow->srcAddr & (0xffffffffL << (32 - flowMisc->srcMask));
             src = htonl(src);
-            inet_ntop(AF_INET, &src, snet, sizeof(snet));
+            IPString(AF_INET, &src, snet, sizeof(snet));
 
             uint32_t dst = ipv4Flow->dstAddr & (0xffffffffL << (32 - flowMisc->dstMask));
             dst = htonl(dst);
-            inet_ntop(AF_INET, &dst, dnet, sizeof(dnet));
+            IPString(AF_INET, &dst, dnet, sizeof(dnet));
         } else {
             snet[0] = '\0';
             dnet[0] = '\0';
@@ -340,7 +323,7 @@ static char *stringEXbgpNextHopV4(char *streamPtr, void *extensionRecord) {
     uint32_t i = htonl(bgpNextHopV4->ip);
     char ip[IP_STRING_LEN];
     ip[0] = 0;
-    inet_ntop(AF_INET, &i, ip, sizeof(ip));
+    IPString(AF_INET, &i, ip, sizeof(ip));
     ip[IP_STRING_LEN - 1] = 0;
 
     AddElementString("bgp4_next_hop", ip);
@@ -357,7 +340,7 @@ static char *stringEXbgpNextHopV6(char *streamPtr, void *extensionRecord) {
 
     char ip[IP_STRING_LEN];
     ip[0] = 0;
-    inet_ntop(AF_INET6, i, ip, sizeof(ip));
+    IPString(AF_INET6, i, ip, sizeof(ip));
     ip[IP_STRING_LEN - 1] = 0;
 
     AddElementString("bgp6_next_hop", ip);
@@ -371,7 +354,7 @@ static char *stringEXipNextHopV4(char *streamPtr, void *extensionRecord) {
     uint32_t i = htonl(ipNextHopV4->ip);
     char ip[IP_STRING_LEN];
     ip[0] = 0;
-    inet_ntop(AF_INET, &i, ip, sizeof(ip));
+    IPString(AF_INET, &i, ip, sizeof(ip));
     ip[IP_STRING_LEN - 1] = 0;
 
     AddElementString("ip4_next_hop", ip);
@@ -388,7 +371,7 @@ static char *stringEXipNextHopV6(char *streamPtr, void *extensionRecord) {
 
     char ip[IP_STRING_LEN];
     ip[0] = 0;
-    inet_ntop(AF_INET6, i, ip, sizeof(ip));
+    IPString(AF_INET6, i, ip, sizeof(ip));
     ip[IP_STRING_LEN - 1] = 0;
 
     AddElementString("ip6_next_hop", ip);
@@ -402,7 +385,7 @@ static char *stringEXipReceivedV4(char *streamPtr, void *extensionRecord) {
     uint32_t i = htonl(ipReceivedV4->ip);
     char ip[IP_STRING_LEN];
     ip[0] = 0;
-    inet_ntop(AF_INET, &i, ip, sizeof(ip));
+    IPString(AF_INET, &i, ip, sizeof(ip));
     ip[IP_STRING_LEN - 1] = 0;
 
     AddElementString("ip4_router", ip);
@@ -418,7 +401,7 @@ static char *stringEXipReceivedV6(char *streamPtr, void *extensionRecord) {
     i[1] = htonll(ipReceivedV6->ip[1]);
     char ip[IP_STRING_LEN];
     ip[0] = 0;
-    inet_ntop(AF_INET6, i, ip, sizeof(ip));
+    IPString(AF_INET6, i, ip, sizeof(ip));
     ip[IP_STRING_LEN - 1] = 0;
 
     AddElementString("ip6_router", ip);
@@ -569,8 +552,8 @@ static char *stringEXtunIPv4(char *streamPtr, void *extensionRecord) {
     uint32_t src = htonl(tunIPv4->tunSrcAddr);
     uint32_t dst = htonl(tunIPv4->tunDstAddr);
     char as[IP_STRING_LEN], ds[IP_STRING_LEN];
-    inet_ntop(AF_INET, &src, as, sizeof(as));
-    inet_ntop(AF_INET, &dst, ds, sizeof(ds));
+    IPString(AF_INET, &src, as, sizeof(as));
+    IPString(AF_INET, &dst, ds, sizeof(ds));
 
     AddElementU32("tun_proto", tunIPv4->tunProto);
     AddElementString("src4_tun_ip", as);
@@ -589,8 +572,8 @@ static char *stringEXtunIPv6(char *streamPtr, void *extensionRecord) {
     dst[0] = htonll(tunIPv6->tunDstAddr[0]);
     dst[1] = htonll(tunIPv6->tunDstAddr[1]);
     char as[IP_STRING_LEN], ds[IP_STRING_LEN];
-    inet_ntop(AF_INET6, &src, as, sizeof(as));
-    inet_ntop(AF_INET6, &dst, ds, sizeof(ds));
+    IPString(AF_INET6, &src, as, sizeof(as));
+    IPString(AF_INET6, &dst, ds, sizeof(ds));
 
     AddElementU32("tun_proto", tunIPv6->tunProto);
     AddElementString("src6_tun_ip", as);
@@ -640,8 +623,7 @@ static char *stringEXnselCommon(char *streamPtr, void *extensionRecord) {
     if (when == 0) {
         strncpy(datestr, "<unknown>", 63);
     } else {
-        struct tm *ts = localtime(&when);
-        strftime(datestr, 63, "%Y-%m-%dT%H:%M:%S", ts);
+        DateString(datestr, when, 0, 'T');
     }
 
     AddElementU32("connect_id", nselCommon->connID);
@@ -662,8 +644,8 @@ static char *stringEXnatXlateIPv4(char *streamPtr, void *extensionRecord) {
     uint32_t src = htonl(natXlateIPv4->xlateSrcAddr);
     uint32_t dst = htonl(natXlateIPv4->xlateDstAddr);
     char as[IP_STRING_LEN], ds[IP_STRING_LEN];
-    inet_ntop(AF_INET, &src, as, sizeof(as));
-    inet_ntop(AF_INET, &dst, ds, sizeof(ds));
+    IPString(AF_INET, &src, as, sizeof(as));
+    IPString(AF_INET, &dst, ds, sizeof(ds));
 
     AddElementString("src4_xlt_ip", as);
     AddElementString("dst4_xlt_ip", ds);
@@ -681,8 +663,8 @@ static char *stringEXnatXlateIPv6(char *streamPtr, void *extensionRecord) {
     dst[0] = htonll(natXlateIPv6->xlateDstAddr[0]);
     dst[1] = htonll(natXlateIPv6->xlateDstAddr[1]);
     char as[IP_STRING_LEN], ds[IP_STRING_LEN];
-    inet_ntop(AF_INET6, &src, as, sizeof(as));
-    inet_ntop(AF_INET6, &dst, ds, sizeof(ds));
+    IPString(AF_INET6, &src, as, sizeof(as));
+    IPString(AF_INET6, &dst, ds, sizeof(ds));
 
     AddElementString("src6_xlt_ip", as);
     AddElementString("dst6_xlt_ip", ds);
@@ -729,8 +711,7 @@ static char *stringEXnatCommon(char *streamPtr, void *extensionRecord) {
     if (when == 0) {
         strncpy(datestr, "<unknown>", 63);
     } else {
-        struct tm *ts = localtime(&when);
-        strftime(datestr, 63, "%Y-%m-%dT%H:%M:%S", ts);
+        DateString(datestr, when, 0, 'T');
     }
 
     AddElementU32("nat_event_id", natCommon->natEvent);
@@ -781,13 +762,18 @@ static char *stringEXnokiaNatString(char *streamPtr, void *extensionRecord) {
     return streamPtr;
 }  // End of String_natString
 
-void json_prolog(outputParams_t *outputParam) {
-    streamBuff = malloc(STREAMBUFFSIZE);
-    if (!streamBuff) {
+static char *NewStreamBuff(void) {
+    char *buff = malloc(STREAMBUFFSIZE);
+    if (!buff) {
         LogError("malloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
         exit(EXIT_FAILURE);
     }
-    streamBuff[0] = '\0';
+    buff[0] = '\0';
+    return buff;
+}  // End of NewStreamBuff
+
+void json_prolog(outputParams_t *outputParam) {
+    streamBuff = NewStreamBuff();
 
     // open json array
     printf("[\n");
@@ -800,6 +786,9 @@ void json_epilog(outputParams_t *outputParam) {
     streamBuff = NULL;
 }  // End of json_epilog
 
+// set the number of records printed before the next record of the calling thread
+void json_count(uint32_t count) { recordCount = count; }
+
 void flow_record_to_json(FILE *stream, recordHandle_t *recordHandle, int tag) {
     // ws is whitespace after object opening and before object closing {WS  WS}
     // ' ' is printed before each record for clarity if needed
@@ -808,6 +797,7 @@ void flow_record_to_json(FILE *stream, recordHandle_t *recordHandle, int tag) {
 
     recordHeaderV3_t *recordHeaderV3 = recordHandle->recordHeaderV3;
 
+    if (unlikely(streamBuff == NULL)) streamBuff = NewStreamBuff();
     streamBuff[0] = '\0';
     char *streamPtr = streamBuff;
 
@@ -38,6 +38,8 @@ void json_prolog(outputParams_t *outputParam);
 
 void json_epilog(outputParams_t *outputParam);
 
+void json_count(uint32_t count);
+
 void flow_record_to_json(FILE *stream, recordHandle_t *recordHandle, int tag);
 
 #endif  // _OUTPUT_JSON_H
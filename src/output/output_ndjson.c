@@ -57,8 +57,8 @@
 
 #define IP_STRING_LEN (INET6_ADDRSTRLEN)
 
-// record counter
-static uint32_t recordCount = 0;
+// record counter - records may be formatted by multiple threads
+static _Thread_local uint32_t recordCount = 0;
 
 #include "itoa.c"
 
@@ -106,35 +106,18 @@ static uint32_t recordCount = 0;
 #define STREAMLEN(ptr)                                \
     ((ptrdiff_t)STREAMBUFFSIZE - (ptr - streamBuff)); \
     assert((ptr - streamBuff) < STREAMBUFFSIZE)
-static char *streamBuff = NULL;
+static _Thread_local char *streamBuff = NULL;
 
 static char *stringEXgenericFlow(char *streamPtr, void *extensionRecord) {
     EXgenericFlow_t *genericFlow = (EXgenericFlow_t *)extensionRecord;
 
-    time_t when = (genericFlow->msecFirst / 1000LL);
-    struct tm ts = {0};
-    localtime_r(&when, &ts);
-    char dateBuff1[64];
-    strftime(dateBuff1, 63, "%Y-%m-%dT%H:%M:%S", &ts);
-
-    when = (genericFlow->msecLast / 1000LL);
-    localtime_r(&when, &ts);
-    char dateBuff2[64];
-    strftime(dateBuff2, 63, "%Y-%m-%dT%H:%M:%S", &ts);
-
-    when = (genericFlow->msecReceived / 1000LL);
-    localtime_r(&when, &ts);
-    char dateBuff3[64];
-    strftime(dateBuff3, 63, "%Y-%m-%dT%H:%M:%S", &ts);
-
-    ptrdiff_t lenStream = STREAMLEN(streamPtr);
-    int len = snprintf(streamPtr, lenStream,
-                       "\"first\":\"%s.%03u\","
-                       "\"last\":\"%s.%03u\","
-                       "\"received\":\"%s.%03u\",",
-                       dateBuff1, (unsigned)(genericFlow->msecFirst % 1000LL), dateBuff2, (unsigned)(genericFlow->msecLast % 1000LL), dateBuff3,
-                       (unsigned)(genericFlow->msecReceived % 1000LL));
-    streamPtr += len;
+    char dateBuff[DATESTRINGLEN];
+    MsecDateString(dateBuff, genericFlow->msecFirst, 0, 'T');
+    AddElementString("first", dateBuff);
+    MsecDateString(dateBuff, genericFlow->msecLast, 0, 'T');
+    AddElementString("last", dateBuff);
+    MsecDateString(dateBuff, genericFlow->msecReceived, 0, 'T');
+    AddElementString("received", dateBuff);
 
     AddElementU64("in_packets", genericFlow->inPackets);
     AddElementU64("in_bytes", genericFlow->inBytes);
@@ -163,8 +146,8 @@ static char *stringEXipv4Flow(char *streamPtr, void *extensionRecord) {
     uint32_t src = htonl(ipv4Flow->srcAddr);
     uint32_t dst = htonl(ipv4Flow->dstAddr);
     char sa[IP_STRING_LEN], da[IP_STRING_LEN];
-    inet_ntop(AF_INET, &src, sa, sizeof(sa));
-    inet_ntop(AF_INET, &dst, da, sizeof(da));
+    IPString(AF_INET, &src, sa, sizeof(sa));
+    IPString(AF_INET, &dst, da, sizeof(da));
 
     char sloc[128], dloc[128];
     LookupV4Location(ipv4Flow->srcAddr, sloc, 128);
@@ -187,8 +170,8 @@ static char *stringEXipv6Flow(char *streamPtr, void *extensionRecord) {
     dst[0] = htonll(ipv6Flow->dstAddr[0]);
     dst[1] = htonll(ipv6Flow->dstAddr[1]);
     char sa[IP_STRING_LEN], da[IP_STRING_LEN];
-    inet_ntop(AF_INET6, &src, sa, sizeof(sa));
-    inet_ntop(AF_INET6, &dst, da, sizeof(da));
+    IPString(AF_INET6, &src, sa, sizeof(sa));
+    IPString(AF_INET6, &dst, da, sizeof(da));
 
     char sloc[128], dloc[128];
     LookupV6Location(ipv6Flow->srcAddr, sloc, 128);
@@ -223,7 +206,7 @@ static char *stringEXflowMisc(char *streamPtr, recordHandle_t *recordHandle, voi
             }
             src[0] = htonll(src[0]);
             src[1] = htonll(src[1]);
-            inet_ntop(AF_INET6, &src, snet, sizeof(snet));
+            IPString(AF_INET6, &src, snet, sizeof(snet));
 
             if (flowMisc->dstMask >= 64) {
                 dst[0] = ipv6Flow->dstAddr[0] & (0xffffffffffffffffLL << (flowMisc->dstMask - 64));
@@ -234,7 +217,7 @@ static char *stringEXflowMisc(char *streamPtr, recordHandle_t *recordHandle, voi
             }
             dst[0] = htonll(dst[0]);
             dst[1] = htonll(dst[1]);
-            inet_ntop(AF_INET6, &dst, dnet, sizeof(dnet));
+            IPString(AF_INET6, &dst, dnet, sizeof(dnet));
 
         } else {
             snet[0] = '\0';
@@ -246,11 +229,11 @@ static char *stringEXflowMisc(char *streamPtr, recordHandle_t *recordHandle, voi
         if (flowMisc->srcMask || flowMisc->dstMask) {
             uint32_t src = ipv4Flow->srcAddr & (0xffffffffL << (32 - flowMisc->srcMask));
             src = htonl(src);
-            inet_ntop(AF_INET, &src, snet, sizeof(snet));
+            IPString(AF_INET, &src, snet, sizeof(snet));
 
             uint32_t dst = ipv4Flow->dstAddr & (0xffffffffL << (32 - flowMisc->dstMask));
             dst = htonl(dst);
-            inet_ntop(AF_INET, &dst, dnet, sizeof(dnet));
+            IPString(AF_INET, &dst, dnet, sizeof(dnet));
         } else {
             snet[0] = '\0';
             dnet[0] = '\0';
@@ -328,7 +311,7 @@ static char *stringEXbgpNextHopV4(char *streamPtr, void *extensionRecord) {
     uint32_t i = htonl(bgpNextHopV4->ip);
     char ip[IP_STRING_LEN];
     ip[0] = 0;
-    inet_ntop(AF_INET, &i, ip, sizeof(ip));
+    IPString(AF_INET, &i, ip, sizeof(ip));
     ip[IP_STRING_LEN - 1] = 0;
 
     AddElementString("bgp4_next_hop", ip);
@@ -345,7 +328,7 @@ static char *stringEXbgpNextHopV6(char *streamPtr, void *extensionRecord) {
 
     char ip[IP_STRING_LEN];
     ip[0] = 0;
-    inet_ntop(AF_INET6, i, ip, sizeof(ip));
+    IPString(AF_INET6, i, ip, sizeof(ip));
     ip[IP_STRING_LEN - 1] = 0;
 
     AddElementString("bgp6_next_hop", ip);
@@ -359,7 +342,7 @@ static char *stringEXipNextHopV4(char *streamPtr, void *extensionRecord) {
     uint32_t i = htonl(ipNextHopV4->ip);
     char ip[IP_STRING_LEN];
     ip[0] = 0;
-    inet_ntop(AF_INET, &i, ip, sizeof(ip));
+    IPString(AF_INET, &i, ip, sizeof(ip));
     ip[IP_STRING_LEN - 1] = 0;
 
     AddElementString("ip4_next_hop", ip);
@@ -376,7 +359,7 @@ static char *stringEXipNextHopV6(char *streamPtr, void *extensionRecord) {
 
     char ip[IP_STRING_LEN];
     ip[0] = 0;
-    inet_ntop(AF_INET6, i, ip, sizeof(ip));
+    IPString(AF_INET6, i, ip, sizeof(ip));
     ip[IP_STRING_LEN - 1] = 0;
 
     AddElementString("ip6_next_hop", ip);
@@ -390,7 +373,7 @@ static char *stringEXipReceivedV4(char *streamPtr, void *extensionRecord) {
     uint32_t i = htonl(ipReceivedV4->ip);
     char ip[IP_STRING_LEN];
     ip[0] = 0;
-    inet_ntop(AF_INET, &i, ip, sizeof(ip));
+    IPString(AF_INET, &i, ip, sizeof(ip));
     ip[IP_STRING_LEN - 1] = 0;
 
     AddElementString("ip4_router", ip);
@@ -406,7 +389,7 @@ static char *stringEXipReceivedV6(char *streamPtr, void *extensionRecord) {
     i[1] = htonll(ipReceivedV6->ip[1]);
     char ip[IP_STRING_LEN];
     ip[0] = 0;
-    inet_ntop(AF_INET6, i, ip, sizeof(ip));
+    IPString(AF_INET6, i, ip, sizeof(ip));
     ip[IP_STRING_LEN - 1] = 0;
 
     AddElementString("ip6_router", ip);
@@ -557,8 +540,8 @@ static char *stringEXtunIPv4(char *streamPtr, void *extensionRecord) {
     uint32_t src = htonl(tunIPv4->tunSrcAddr);
     uint32_t dst = htonl(tunIPv4->tunDstAddr);
     char as[IP_STRING_LEN], ds[IP_STRING_LEN];
-    inet_ntop(AF_INET, &src, as, sizeof(as));
-    inet_ntop(AF_INET, &dst, ds, sizeof(ds));
+    IPString(AF_INET, &src, as, sizeof(as));
+    IPString(AF_INET, &dst, ds, sizeof(ds));
 
     AddElementU32("tun_proto", tunIPv4->tunProto);
     AddElementString("src4_tun_ip", as);
@@ -577,8 +560,8 @@ static char *stringEXtunIPv6(char *streamPtr, void *extensionRecord) {
     dst[0] = htonll(tunIPv6->tunDstAddr[0]);
     dst[1] = htonll(tunIPv6->tunDstAddr[1]);
     char as[IP_STRING_LEN], ds[IP_STRING_LEN];
-    inet_ntop(AF_INET6, &src, as, sizeof(as));
-    inet_ntop(AF_INET6, &dst, ds, sizeof(ds));
+    IPString(AF_INET6, &src, as, sizeof(as));
+    IPString(AF_INET6, &dst, ds, sizeof(ds));
 
     AddElementU32("tun_proto", tunIPv6->tunProto);
     AddElementString("src6_tun_ip", as);
@@ -628,8 +611,7 @@ static char *stringEXnselCommon(char *streamPtr, void *extensionRecord) {
     if (when == 0) {
         strncpy(datestr, "<unknown>", 63);
     } else {
-        struct tm *ts = localtime(&when);
-        strftime(datestr, 63, "%Y-%m-%dT%H:%M:%S", ts);
+        DateString(datestr, when, 0, 'T');
     }
 
     AddElementU32("connect_id", nselCommon->connID);
@@ -650,8 +632,8 @@ static char *stringEXnatXlateIPv4(char *streamPtr, void *extensionRecord) {
     uint32_t src = htonl(natXlateIPv4->xlateSrcAddr);
     uint32_t dst = htonl(natXlateIPv4->xlateDstAddr);
     char as[IP_STRING_LEN], ds[IP_STRING_LEN];
-    inet_ntop(AF_INET, &src, as, sizeof(as));
-    inet_ntop(AF_INET, &dst, ds, sizeof(ds));
+    IPString(AF_INET, &src, as, sizeof(as));
+    IPString(AF_INET, &dst, ds, sizeof(ds));
 
     AddElementString("src4_xlt_ip", as);
     AddElementString("dst4_xlt_ip", ds);
@@ -669,8 +651,8 @@ static char *stringEXnatXlateIPv6(char *streamPtr, void *extensionRecord) {
     dst[0] = htonll(natXlateIPv6->xlateDstAddr[0]);
     dst[1] = htonll(natXlateIPv6->xlateDstAddr[1]);
     char as[IP_STRING_LEN], ds[IP_STRING_LEN];
-    inet_ntop(AF_INET6, &src, as, sizeof(as));
-    inet_ntop(AF_INET6, &dst, ds, sizeof(ds));
+    IPString(AF_INET6, &src, as, sizeof(as));
+    IPString(AF_INET6, &dst, ds, sizeof(ds));
 
     AddElementString("src6_xlt_ip", as);
     AddElementString("dst6_xlt_ip", ds);
@@ -717,8 +699,7 @@ static char *stringEXnatCommon(char *streamPtr, void *extensionRecord) {
     if (when == 0) {
         strncpy(datestr, "<unknown>", 63);
     } else {
-        struct tm *ts = localtime(&when);
-        strftime(datestr, 63, "%Y-%m-%dT%H:%M:%S", ts);
+        DateString(datestr, when, 0, 'T');
     }
 
     AddElementU32("nat_event_id", natCommon->natEvent);
@@ -769,13 +750,18 @@ static char *stringEXnokiaNatString(char *streamPtr, void *extensionRecord) {
     return streamPtr;
 }  // End of String_natString
 
-void ndjson_prolog(outputParams_t *outputParam) {
-    streamBuff = malloc(STREAMBUFFSIZE);
-    if (!streamBuff) {
+static char *NewStreamBuff(void) {
+    char *buff = malloc(STREAMBUFFSIZE);
+    if (!buff) {
         LogError("malloc() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
         exit(EXIT_FAILURE);
     }
-    streamBuff[0] = '\0';
+    buff[0] = '\0';
+    return buff;
+}  // End of NewStreamBuff
+
+void ndjson_prolog(outputParams_t *outputParam) {
+    streamBuff = NewStreamBuff();
 
 }  // End of ndjson_prolog
 
@@ -786,6 +772,9 @@ void ndjson_epilog(outputParams_t *outputParam) {
 
 enum { FORMAT_NDJSON = 0, FORMAT_JSON };
 
+// set the number of records printed before the next record of the calling thread
+void ndjson_count(uint32_t count) { recordCount = count; }
+
 void flow_record_to_ndjson(FILE *stream, recordHandle_t *recordHandle, int tag) {
     // ws is whitespace after object opening and before object closing {WS  WS}
     // indent is printed before each record for clarity if needed
@@ -794,6 +783,7 @@ void flow_record_to_ndjson(FILE *stream, recordHandle_t *recordHandle, int tag)
 
     recordHeaderV3_t *recordHeaderV3 = recordHandle->recordHeaderV3;
 
+    if (unlikely(streamBuff == NULL)) streamBuff = NewStreamBuff();
     streamBuff[0] = '\0';
     char *streamPtr = streamBuff;
 
@@ -38,6 +38,8 @@ void ndjson_prolog(outputParams_t *outputParam);
 
 void ndjson_epilog(outputParams_t *outputParam);
 
+void ndjson_count(uint32_t count);
+
 void flow_record_to_ndjson(FILE *stream, recordHandle_t *recordHandle, int tag);
 
 #endif  // _OUTPUT_NDJSON_H
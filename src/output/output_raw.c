@@ -79,8 +79,7 @@ static void stringEXgenericFlow(FILE *stream, recordHandle_t *recordHandle, void
         if (when == 0) {
             strncpy(datestr1, "0000-00-00 00:00:00", 63);
         } else {
-            struct tm *ts = localtime(&when);
-            strftime(datestr1, 63, "%Y-%m-%d %H:%M:%S", ts);
+            DateString(datestr1, when, 0, ' ');
         }
         fprintf(stream, "  Event time   =      %13llu [%s.%03llu]\n", (long long unsigned)eventTime, datestr1, eventTime % 1000LL);
 
@@ -89,16 +88,14 @@ static void stringEXgenericFlow(FILE *stream, recordHandle_t *recordHandle, void
         if (when == 0) {
             strncpy(datestr1, "0000-00-00 00:00:00", 63);
         } else {
-            struct tm *ts = localtime(&when);
-            strftime(datestr1, 63, "%Y-%m-%d %H:%M:%S", ts);
+            DateString(datestr1, when, 0, ' ');
         }
 
         when = genericFlow->msecLast / 1000LL;
         if (when == 0) {
             strncpy(datestr2, "0000-00-00 00:00:00", 63);
         } else {
-            struct tm *ts = localtime(&when);
-            strftime(datestr2, 63, "%Y-%m-%d %H:%M:%S", ts);
+            DateString(datestr2, when, 0, ' ');
         }
 
         fprintf(stream,
@@ -110,8 +107,7 @@ static void stringEXgenericFlow(FILE *stream, recordHandle_t *recordHandle, void
 
     if (genericFlow->msecReceived) {
         time_t when = genericFlow->msecReceived / 1000LL;
-        struct tm *ts = localtime(&when);
-        strftime(datestr3, 63, "%Y-%m-%d %H:%M:%S", ts);
+        DateString(datestr3, when, 0, ' ');
     } else {
         datestr3[0] = '0';
         datestr3[1] = '\0';
@@ -148,8 +144,8 @@ static void stringEXtunIPv4(FILE *stream, EXtunIPv4_t *tunIPv4, EXgenericFlow_t
 
     uint32_t src = htonl(tunIPv4->tunSrcAddr);
     uint32_t dst = htonl(tunIPv4->tunDstAddr);
-    inet_ntop(AF_INET, &src, as, sizeof(as));
-    inet_ntop(AF_INET, &dst, ds, sizeof(ds));
+    IPString(AF_INET, &src, as, sizeof(as));
+    IPString(AF_INET, &dst, ds, sizeof(ds));
 
     char sloc[128], dloc[128], stor[4], dtor[4];
     stor[0] = dtor[0] = '\0';
@@ -175,8 +171,8 @@ static void stringEXtunIPv6(FILE *stream, EXtunIPv6_t *tunIPv6, EXgenericFlow_t
     src[1] = htonll(tunIPv6->tunSrcAddr[1]);
     dst[0] = htonll(tunIPv6->tunDstAddr[0]);
     dst[1] = htonll(tunIPv6->tunDstAddr[1]);
-    inet_ntop(AF_INET6, &src, as, sizeof(as));
-    inet_ntop(AF_INET6, &dst, ds, sizeof(ds));
+    IPString(AF_INET6, &src, as, sizeof(as));
+    IPString(AF_INET6, &dst, ds, sizeof(ds));
 
     char sloc[128], dloc[128], stor[4], dtor[4];
     stor[0] = dtor[0] = '\0';
@@ -209,8 +205,8 @@ static void stringsEXipv4Flow(FILE *stream, recordHandle_t *recordHandle, void *
     uint32_t dst = htonl(ipv4Flow->dstAddr);
 
     char as[IP_STRING_LEN], ds[IP_STRING_LEN];
-    inet_ntop(AF_INET, &src, as, sizeof(as));
-    inet_ntop(AF_INET, &dst, ds, sizeof(ds));
+    IPString(AF_INET, &src, as, sizeof(as));
+    IPString(AF_INET, &dst, ds, sizeof(ds));
 
     char sloc[128], dloc[128], stor[4], dtor[4];
     stor[0] = dtor[0] = '\0';
@@ -245,8 +241,8 @@ static void stringsEXipv6Flow(FILE *stream, recordHandle_t *recordHandle, void *
     dst[1] = htonll(ipv6Flow->dstAddr[1]);
 
     char as[IP_STRING_LEN], ds[IP_STRING_LEN];
-    inet_ntop(AF_INET6, &src, as, sizeof(as));
-    inet_ntop(AF_INET6, &dst, ds, sizeof(ds));
+    IPString(AF_INET6, &src, as, sizeof(as));
+    IPString(AF_INET6, &dst, ds, sizeof(ds));
 
     char sloc[128], dloc[128], stor[4], dtor[4];
     stor[0] = dtor[0] = '\0';
@@ -354,7 +350,7 @@ static void stringsEXbgpNextHopV4(FILE *stream, void *extensionRecord) {
     uint32_t i = htonl(bgpNextHopV4->ip);
     char ip[IP_STRING_LEN];
     ip[0] = 0;
-    inet_ntop(AF_INET, &i, ip, sizeof(ip));
+    IPString(AF_INET, &i, ip, sizeof(ip));
     ip[IP_STRING_LEN - 1] = 0;
 
     fprintf(stream, "  bgp next hop =   %16s\n", ip);
@@ -370,7 +366,7 @@ static void stringsEXbgpNextHopV6(FILE *stream, void *extensionRecord) {
 
     char ip[IP_STRING_LEN];
     ip[0] = 0;
-    inet_ntop(AF_INET6, i, ip, sizeof(ip));
+    IPString(AF_INET6, i, ip, sizeof(ip));
     ip[IP_STRING_LEN - 1] = 0;
 
     fprintf(stream, "  bgp next hop =   %16s\n", ip);
@@ -384,7 +380,7 @@ static void stringsEXipNextHopV4(FILE *stream, void *extensionRecord) {
 
     char ip[IP_STRING_LEN];
     ip[0] = 0;
-    inet_ntop(AF_INET, &i, ip, sizeof(ip));
+    IPString(AF_INET, &i, ip, sizeof(ip));
     ip[IP_STRING_LEN - 1] = 0;
 
     fprintf(stream, "  ip next hop  =   %16s\n", ip);
@@ -399,7 +395,7 @@ static void stringsEXipNextHopV6(FILE *stream, void *extensionRecord) {
     i[1] = htonll(ipNextHopV6->ip[1]);
 
     char ip[IP_STRING_LEN];
-    inet_ntop(AF_INET6, i, ip, sizeof(ip));
+    IPString(AF_INET6, i, ip, sizeof(ip));
     ip[IP_STRING_LEN - 1] = 0;
 
     fprintf(stream, "  ip next hop  =   %16s\n", ip);
@@ -413,7 +409,7 @@ static void stringsEXipReceivedV4(FILE *stream, void *extensionRecord) {
 
     char ip[IP_STRING_LEN];
     ip[0] = 0;
-    inet_ntop(AF_INET, &i, ip, sizeof(ip));
+    IPString(AF_INET, &i, ip, sizeof(ip));
     ip[IP_STRING_LEN - 1] = 0;
 
     fprintf(stream, "  ip exporter  =   %16s\n", ip);
@@ -428,7 +424,7 @@ static void stringsEXipReceivedV6(FILE *stream, void *extensionRecord) {
     i[1] = htonll(ipReceivedV6->ip[1]);
 
     char ip[IP_STRING_LEN];
-    inet_ntop(AF_INET6, i, ip, sizeof(ip));
+    IPString(AF_INET6, i, ip, sizeof(ip));
     ip[IP_STRING_LEN - 1] = 0;
 
     fprintf(stream, "  ip exporter  =   %16s\n", ip);
@@ -569,8 +565,7 @@ static void stringsEXnselCommon(FILE *stream, void *extensionRecord) {
     if (when == 0) {
         strncpy(datestr, "0000-00-00 00:00:00", 63);
     } else {
-        struct tm *ts = localtime(&when);
-        strftime(datestr, 63, "%Y-%m-%d %H:%M:%S", ts);
+        DateString(datestr, when, 0, ' ');
     }
     fprintf(stream,
             "  connect ID   =         %10u\n"
@@ -588,8 +583,8 @@ static void stringsEXnatXlateIPv4(FILE *stream, void *extensionRecord) {
     uint32_t src = htonl(natXlateIPv4->xlateSrcAddr);
     uint32_t dst = htonl(natXlateIPv4->xlateDstAddr);
     char as[IP_STRING_LEN], ds[IP_STRING_LEN];
-    inet_ntop(AF_INET, &src, as, sizeof(as));
-    inet_ntop(AF_INET, &dst, ds, sizeof(ds));
+    IPString(AF_INET, &src, as, sizeof(as));
+    IPString(AF_INET, &dst, ds, sizeof(ds));
 
     fprintf(stream,
             "  src xlt ip   =   %16s\n"
@@ -609,8 +604,8 @@ static void stringsEXnatXlateIPv6(FILE *stream, void *extensionRecord) {
     dst[1] = htonll(natXlateIPv6->xlateDstAddr[1]);
 
     char as[IP_STRING_LEN], ds[IP_STRING_LEN];
-    inet_ntop(AF_INET6, &src, as, sizeof(as));
-    inet_ntop(AF_INET6, &dst, ds, sizeof(ds));
+    IPString(AF_INET6, &src, as, sizeof(as));
+    IPString(AF_INET6, &dst, ds, sizeof(ds));
 
     fprintf(stream,
             "  src xlt ip   =   %16s\n"
@@ -30,18 +30,217 @@
 
 #include "output_util.h"
 
+#include <arpa/inet.h>
+#include <errno.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/socket.h>
 #include <sys/types.h>
+#include <time.h>
 
 #include "config.h"
 #include "nfdump.h"
 #include "nffile.h"
 
+// decimal digits of a byte - 3 chars and length
+static const struct decimalByte_s {
+    char digits[3];
+    uint8_t len;
+} decimalByte[256] = {
+#define D1(n) {{'0' + (n), 0, 0}, 1}
+#define D2(n) {{'0' + (n) / 10, '0' + (n) % 10, 0}, 2}
+#define D3(n) {{'0' + (n) / 100, '0' + ((n) / 10) % 10, '0' + (n) % 10}, 3}
+#define D1x10(n) D1(n), D1(n + 1), D1(n + 2), D1(n + 3), D1(n + 4), D1(n + 5), D1(n + 6), D1(n + 7), D1(n + 8), D1(n + 9)
+#define D2x10(n) D2(n), D2(n + 1), D2(n + 2), D2(n + 3), D2(n + 4), D2(n + 5), D2(n + 6), D2(n + 7), D2(n + 8), D2(n + 9)
+#define D3x10(n) D3(n), D3(n + 1), D3(n + 2), D3(n + 3), D3(n + 4), D3(n + 5), D3(n + 6), D3(n + 7), D3(n + 8), D3(n + 9)
+#define D3x100(n) D3x10(n), D3x10(n + 10), D3x10(n + 20), D3x10(n + 30), D3x10(n + 40), D3x10(n + 50), D3x10(n + 60), D3x10(n + 70), D3x10(n + 80), D3x10(n + 90)
+    D1x10(0),
+    D2x10(10),
+    D2x10(20),
+    D2x10(30),
+    D2x10(40),
+    D2x10(50),
+    D2x10(60),
+    D2x10(70),
+    D2x10(80),
+    D2x10(90),
+    D3x100(100),
+    D3x10(200),
+    D3x10(210),
+    D3x10(220),
+    D3x10(230),
+    D3x10(240),
+    D3(250),
+    D3(251),
+    D3(252),
+    D3(253),
+    D3(254),
+    D3(255),
+#undef D1
+#undef D2
+#undef D3
+#undef D1x10
+#undef D2x10
+#undef D3x10
+#undef D3x100
+};
+
+static const char hexDigits[16] = "0123456789abcdef";
+
+// IPv4 address of 4 bytes in network byte order - returns end of string
+static inline char *ip4String(char *s, const uint8_t *ip) {
+    for (int i = 0; i < 4; i++) {
+        const struct decimalByte_s *d = &decimalByte[ip[i]];
+        memcpy(s, d->digits, 3);
+        s += d->len;
+        *s++ = '.';
+    }
+    s[-1] = '\0';
+    return s - 1;
+}  // End of ip4String
+
+// IPv6 address of 16 bytes in network byte order - returns end of string
+// same canonical format as inet_ntop: longest, first run of >= 2 zero words compressed
+// and IPv4 compatible/mapped addresses rendered with an IPv4 tail
+static inline char *ip6String(char *s, const uint8_t *ip) {
+    uint32_t words[8];
+    for (int i = 0; i < 8; i++) words[i] = ((uint32_t)ip[2 * i] << 8) | ip[2 * i + 1];
+
+    int bestBase = -1, bestLen = 0;
+    int curBase = -1, curLen = 0;
+    for (int i = 0; i < 8; i++) {
+        if (words[i] == 0) {
+            if (curBase == -1) {
+                curBase = i;
+                curLen = 1;
+            } else {
+                curLen++;
+            }
+        } else if (curBase != -1) {
+            if (curLen > bestLen) {
+                bestBase = curBase;
+                bestLen = curLen;
+            }
+            curBase = -1;
+        }
+    }
+    if (curBase != -1 && curLen > bestLen) {
+        bestBase = curBase;
+        bestLen = curLen;
+    }
+    if (bestLen < 2) bestBase = -1;
+
+    for (int i = 0; i < 8; i++) {
+        if (bestBase != -1 && i >= bestBase && i < (bestBase + bestLen)) {
+            if (i == bestBase) *s++ = ':';
+            continue;
+        }
+        if (i != 0) *s++ = ':';
+        if (i == 6 && bestBase == 0 && (bestLen == 6 || (bestLen == 5 && words[5] == 0xffff))) {
+            return ip4String(s, ip + 12);
+        }
+        uint32_t word = words[i];
+        if (word >= 0x1000) *s++ = hexDigits[word >> 12];
+        if (word >= 0x100) *s++ = hexDigits[(word >> 8) & 0xF];
+        if (word >= 0x10) *s++ = hexDigits[(word >> 4) & 0xF];
+        *s++ = hexDigits[word & 0xF];
+    }
+    if (bestBase != -1 && (bestBase + bestLen) == 8) *s++ = ':';
+    *s = '\0';
+
+    return s;
+}  // End of ip6String
+
+/*
+ * table driven replacement of inet_ntop() for the output modules
+ * same arguments and result
+ */
+const char *IPString(int af, const void *src, char *dst, size_t size) {
+    char tmp[INET6_ADDRSTRLEN];
+    char *s = size >= INET6_ADDRSTRLEN ? dst : tmp;
+
+    char *end;
+    if (af == AF_INET) {
+        end = ip4String(s, (const uint8_t *)src);
+    } else if (af == AF_INET6) {
+        end = ip6String(s, (const uint8_t *)src);
+    } else {
+        errno = EAFNOSUPPORT;
+        return NULL;
+    }
+
+    if (s == tmp) {
+        size_t len = end - tmp + 1;
+        if (len > size) {
+            errno = ENOSPC;
+            return NULL;
+        }
+        memcpy(dst, tmp, len);
+    }
+
+    return dst;
+}  // End of IPString
+
+// cache of rendered "YYYY-MM-DD HH:MM:SS" strings per second, local and utc time
+#define DATECACHESIZE 4
+static _Thread_local struct dateCache_s {
+    time_t tt;
+    int valid;
+    char string[20];
+} dateCache[2][DATECACHESIZE];
+
+/*
+ * render time tt as "YYYY-MM-DD HH:MM:SS" into s, sep separates date and time
+ * the date string is rendered once per second and cached
+ * returns the end of the string
+ */
+char *DateString(char *s, time_t tt, int utc, char sep) {
+    struct dateCache_s *cache = &dateCache[utc ? 1 : 0][tt & (DATECACHESIZE - 1)];
+    if (!cache->valid || cache->tt != tt) {
+        struct tm ts;
+        if (utc)
+            gmtime_r(&tt, &ts);
+        else
+            localtime_r(&tt, &ts);
+        char date[64];
+        if (strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", &ts) != 19) {
+            // out of range year - do not cache
+            strncpy(s, date, 19);
+            s[19] = '\0';
+            return s + strlen(s);
+        }
+        memcpy(cache->string, date, 19);
+        cache->tt = tt;
+        cache->valid = 1;
+    }
+    memcpy(s, cache->string, 19);
+    s[10] = sep;
+    s[19] = '\0';
+
+    return s + 19;
+}  // End of DateString
+
+/*
+ * render msec time as "YYYY-MM-DD HH:MM:SS.mmm" into s, sep separates date and time
+ * s must hold DATESTRINGLEN bytes
+ * returns the end of the string
+ */
+char *MsecDateString(char *s, uint64_t msec, int utc, char sep) {
+    s = DateString(s, (time_t)(msec / 1000LL), utc, sep);
+    uint32_t ms = msec % 1000LL;
+    s[0] = '.';
+    s[1] = '0' + ms / 100;
+    s[2] = '0' + (ms / 10) % 10;
+    s[3] = '0' + ms % 10;
+    s[4] = '\0';
+
+    return s + 4;
+}  // End of MsecDateString
+
 char *FlagsString(uint16_t flags) {
-    static char string[16];
+    static _Thread_local char string[16];
 
     string[0] = flags & 128 ? 'C' : '.';  // Congestion window reduced -  CWR
     string[1] = flags & 64 ? 'E' : '.';   // ECN-Echo
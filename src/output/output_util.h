@@ -31,7 +31,12 @@
 #ifndef _OUTPUT_UTIL_H
 #define _OUTPUT_UTIL_H 1
 
+#include <stddef.h>
 #include <stdint.h>
+#include <time.h>
+
+// "YYYY-MM-DD HH:MM:SS.mmm" + '\0'
+#define DATESTRINGLEN 24
 
 char *FlagsString(uint16_t flags);
 
@@ -39,4 +44,10 @@ char *biFlowString(uint8_t biFlow);
 
 char *FlowEndString(uint8_t biFlow);
 
+const char *IPString(int af, const void *src, char *dst, size_t size);
+
+char *DateString(char *s, time_t tt, int utc, char sep);
+
+char *MsecDateString(char *s, uint64_t msec, int utc, char sep);
+
 #endif
\ No newline at end of file
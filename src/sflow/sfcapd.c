@@ -150,6 +150,7 @@ static void usage(char *name) {
         "-z=bz2\t\tBZIP2 compress flows in output file.\n"
         "-z=lz4[:level]\tLZ4 compress flows in output file.\n"
         "-z=zstd[:level]\tZSTD compress flows in output file.\n"
+        "-z=auto[:level]\tSelect LZ4 or strong compression per block.\n"
         "-B bufflen\tSet socket buffer to bufflen bytes\n"
         "-e\t\tExpire data at each cycle.\n"
         "-D\t\tFork to background\n"
@@ -837,7 +838,7 @@ int main(int argc, char **argv) {
         if (mcastgroup)
         sock = Multicast_receive_socket(mcastgroup, listenport, family, bufflen);
     else
-        sock = Unicast_receive_socket(bindhost, listenport, family, bufflen);
+        sock = Unicast_receive_socket(bindhost, listenport, family, bufflen, 0);
 
     if (sock == -1) {
         LogError("Terminated due to errors");
@@ -921,6 +922,8 @@ int main(int argc, char **argv) {
 
     LogInfo("Startup sfcapd.");
     run(receive_packet, sock, pfd, rfd, twin, t_start, time_extension, compress, parse_gre);
+    // finish rotated files, which may still be pending after a fatal error
+    StopFinisher();
 
     // shutdown
     close(sock);
@@ -50,6 +50,13 @@
 #include "util.h"
 
 static time_t when;
+
+// payload size of the record in random_flows.nf
+#define RANDOMPAYLOAD 60000
+
+// flows and max packets per flow in dummy.pcap
+#define PCAPFLOWS 64
+#define PCAPPACKETS 8
 time_t offset = 10;
 uint64_t msecs = 10;
 
@@ -226,11 +233,163 @@ static void RemoveExtension(recordHandle_t *recordHandle, int extID) {
 
 }  // end of RemoveExtension
 
+// write a single record with a random payload, which does not compress
+static int WriteRandomFlows(void) {
+    nffile_t *nffile = OpenNewFile("random_flows.nf", NULL, CREATOR_UNKNOWN, NOT_COMPRESSED, 0);
+    if (!nffile) {
+        return 255;
+    }
+    dataBlock_t *dataBlock = WriteBlock(nffile, NULL);
+
+    recordHeaderV3_t *record = (recordHeaderV3_t *)calloc(1, 65536);
+    recordHandle_t *recordHandle = (recordHandle_t *)calloc(1, sizeof(recordHandle_t));
+    if (!record || !recordHandle) {
+        perror("calloc() failed:");
+        return 255;
+    }
+
+    AddV3Header(record, v3Record);
+    v3Record->nfversion = 10;
+
+    PushExtension(v3Record, EXgenericFlow, genericFlow);
+    genericFlow->msecFirst = 1000LL * when;
+    genericFlow->msecLast = genericFlow->msecFirst + 1000LL;
+    genericFlow->inPackets = 1;
+    genericFlow->inBytes = RANDOMPAYLOAD;
+    genericFlow->proto = IPPROTO_UDP;
+
+    PushVarLengthPointer(v3Record, EXinPayload, payload, RANDOMPAYLOAD);
+    uint8_t *p = (uint8_t *)payload;
+    srandom(1);
+    for (int i = 0; i < RANDOMPAYLOAD; i++) p[i] = random() & 0xFF;
+    AssertMapRecordHandle(recordHandle, v3Record, 0);
+    dataBlock = StoreRecord(recordHandle, nffile, dataBlock);
+
+    FlushBlock(nffile, dataBlock);
+    CloseUpdateFile(nffile);
+    return 0;
+
+}  // End of WriteRandomFlows
+
+// append an ethernet packet of a TCP or UDP flow to a pcap file
+static void WritePacket(FILE *pcap, int flow, int packet, int numPackets, int reply) {
+    uint8_t frame[256] = {0};
+    int ipv6 = (flow & 3) == 3;
+    int tcp = (flow & 1) == 0;
+    int payload = 10 + 7 * packet + flow;
+
+    // ethernet header
+    frame[5] = reply ? 2 : 1;
+    frame[11] = reply ? 1 : 2;
+    frame[12] = ipv6 ? 0x86 : 0x08;
+    frame[13] = ipv6 ? 0xdd : 0x00;
+    uint8_t *ip = frame + 14;
+
+    uint8_t src[16] = {0}, dst[16] = {0};
+    int ipLen = 0;
+    if (ipv6) {
+        src[0] = dst[0] = 0x20;
+        src[1] = dst[1] = 0x01;
+        src[13] = dst[13] = 1;
+        src[14] = flow;
+        src[15] = 1;
+        dst[15] = 2;
+        ipLen = 40;
+    } else {
+        src[0] = dst[0] = 10;
+        // client address differs per flow to spread the flows over the packet workers
+        src[2] = dst[2] = 1;
+        src[3] = 10 + flow;
+        dst[3] = 2;
+        ipLen = 20;
+    }
+    int l4Len = tcp ? 20 : 8;
+    uint16_t srcPort = 1024 + flow;
+    uint16_t dstPort = tcp ? 80 : 53;
+    if (reply) {
+        uint8_t tmp[16];
+        memcpy(tmp, src, 16);
+        memcpy(src, dst, 16);
+        memcpy(dst, tmp, 16);
+        uint16_t port = srcPort;
+        srcPort = dstPort;
+        dstPort = port;
+    }
+
+    if (ipv6) {
+        ip[0] = 0x60;
+        ip[4] = (l4Len + payload) >> 8;
+        ip[5] = (l4Len + payload) & 0xFF;
+        ip[6] = tcp ? IPPROTO_TCP : IPPROTO_UDP;
+        ip[7] = 64;
+        memcpy(ip + 8, src, 16);
+        memcpy(ip + 24, dst, 16);
+    } else {
+        ip[0] = 0x45;
+        ip[2] = (ipLen + l4Len + payload) >> 8;
+        ip[3] = (ipLen + l4Len + payload) & 0xFF;
+        ip[8] = 64;
+        ip[9] = tcp ? IPPROTO_TCP : IPPROTO_UDP;
+        memcpy(ip + 12, src, 4);
+        memcpy(ip + 16, dst, 4);
+    }
+
+    uint8_t *l4 = ip + ipLen;
+    l4[0] = srcPort >> 8;
+    l4[1] = srcPort & 0xFF;
+    l4[2] = dstPort >> 8;
+    l4[3] = dstPort & 0xFF;
+    if (tcp) {
+        l4[12] = 0x50;
+        // SYN, ACK .. FIN/ACK
+        l4[13] = packet == 0 ? 0x02 : (packet == numPackets - 1 ? 0x11 : 0x10);
+    } else {
+        l4[4] = (l4Len + payload) >> 8;
+        l4[5] = (l4Len + payload) & 0xFF;
+    }
+    memset(l4 + l4Len, flow, payload);
+
+    uint32_t frameLen = 14 + ipLen + l4Len + payload;
+    // packets are one second apart, flows one millisecond
+    uint32_t pktHeader[4] = {when + packet, 1000 * flow, frameLen, frameLen};
+    fwrite(pktHeader, sizeof(pktHeader), 1, pcap);
+    fwrite(frame, frameLen, 1, pcap);
+
+}  // End of WritePacket
+
+// write dummy.pcap with TCP and UDP flows in both directions for the nfpcapd tests
+static int WritePcapFile(void) {
+    FILE *pcap = fopen("dummy.pcap", "wb");
+    if (!pcap) {
+        LogError("fopen() error in %s line %d: %s", __FILE__, __LINE__, strerror(errno));
+        return 255;
+    }
+
+    // pcap file header: magic, version 2.4, zone, sigfigs, snaplen, ethernet
+    uint32_t fileHeader[6] = {0xa1b2c3d4, 2 | (4 << 16), 0, 0, 65535, 1};
+    fwrite(fileHeader, sizeof(fileHeader), 1, pcap);
+
+    for (int packet = 0; packet < PCAPPACKETS; packet++) {
+        for (int flow = 0; flow < PCAPFLOWS; flow++) {
+            int numPackets = 3 + flow % (PCAPPACKETS - 2);
+            if (packet < numPackets) WritePacket(pcap, flow, packet, numPackets, packet & 1);
+        }
+    }
+    fclose(pcap);
+    return 0;
+
+}  // End of WritePcapFile
+
 int main(int argc, char **argv) {
     when = ISO2UNIX(strdup("201907111030"));
 
     if (!Init_nffile(1, NULL)) exit(254);
 
+    // -p: write random_flows.nf for the compression tests
+    if (argc > 1 && strcmp(argv[1], "-p") == 0) return WriteRandomFlows();
+    // -c: write dummy.pcap for the nfpcapd tests
+    if (argc > 1 && strcmp(argv[1], "-c") == 0) return WritePcapFile();
+
     nffile_t *nffile = OpenNewFile("dummy_flows.nf", NULL, CREATOR_UNKNOWN, NOT_COMPRESSED, 0);
     if (!nffile) {
         exit(255);
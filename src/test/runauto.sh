@@ -0,0 +1,77 @@
+#!/bin/sh
+#  This file is part of the nfdump project.
+#
+#  Copyright (c) 2023-2024, Peter Haag
+#  All rights reserved.
+#
+#  Redistribution and use in source and binary forms, with or without
+#  modification, are permitted provided that the following conditions are met:
+#
+#   * Redistributions of source code must retain the above copyright notice,
+#     this list of conditions and the following disclaimer.
+#   * Redistributions in binary form must reproduce the above copyright notice,
+#     this list of conditions and the following disclaimer in the documentation
+#     and/or other materials provided with the distribution.
+#   * Neither the name of Peter Haag nor the names of its contributors may be
+#     used to endorse or promote products derived from this software without
+#     specific prior written permission.
+#
+#  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+#  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+#  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+#  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+#  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+#  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+#  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+#  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+#  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+#  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+#  POSSIBILITY OF SUCH DAMAGE.
+
+set -e
+TZ=MET
+export TZ
+
+# prevent any default goelookup for testing
+NFDUMP="../nfdump/nfdump -G none"
+
+# adaptive compression tests
+rm -f test.auto.nf
+$NFDUMP -r dummy_flows.nf -z=auto -w test.auto.nf
+$NFDUMP -v test.auto.nf >/dev/null
+$NFDUMP -r test.auto.nf -q -o raw >test.auto.out
+diff -u test.auto.out nftest.1.out
+
+# a small block is lz4 compressed
+$NFDUMP -r dummy_flows.nf -c 5 -q -o raw >test.small.out
+rm -f test.auto.nf
+$NFDUMP -r dummy_flows.nf -c 5 -z=auto -w test.auto.nf
+$NFDUMP -X -v test.auto.nf | grep -q "Block codec: 3, level: 0"
+$NFDUMP -r test.auto.nf -q -o raw >test.auto.out
+diff -u test.auto.out test.small.out
+
+$NFDUMP -J 5 -r dummy_flows.nf && $NFDUMP -v dummy_flows.nf >/dev/null
+$NFDUMP -r dummy_flows.nf -q -o raw >test.auto.out
+diff -u test.auto.out nftest.1.out
+$NFDUMP -J auto:9 -r dummy_flows.nf && $NFDUMP -v dummy_flows.nf >/dev/null
+$NFDUMP -J 3 -r dummy_flows.nf && $NFDUMP -v dummy_flows.nf >/dev/null
+$NFDUMP -J 0 -r dummy_flows.nf && $NFDUMP -v dummy_flows.nf >/dev/null
+$NFDUMP -r dummy_flows.nf -q -o raw >test.auto.out
+diff -u test.auto.out nftest.1.out
+
+# the random payload block does not compress and is stored uncompressed
+./nfgen -p
+$NFDUMP -r random_flows.nf -q -o raw >test.random.out
+rm -f test.auto.nf
+$NFDUMP -r random_flows.nf -z=auto -w test.auto.nf
+$NFDUMP -X -v test.auto.nf | grep -q "Block codec: 0, level: 0"
+$NFDUMP -r test.auto.nf -q -o raw >test.auto.out
+diff -u test.auto.out test.random.out
+
+$NFDUMP -J 5 -r random_flows.nf && $NFDUMP -v random_flows.nf >/dev/null
+$NFDUMP -X -v random_flows.nf | grep -q "Block codec: 0, level: 0"
+$NFDUMP -J 0 -r random_flows.nf && $NFDUMP -v random_flows.nf >/dev/null
+$NFDUMP -r random_flows.nf -q -o raw >test.auto.out
+diff -u test.auto.out test.random.out
+
+rm -f test.auto.nf test.auto.out test.small.out test.random.out random_flows.nf
@@ -0,0 +1,117 @@
+#!/bin/sh
+#  This file is part of the nfdump project.
+#
+#  Copyright (c) 2024, Peter Haag
+#  All rights reserved.
+#
+#  Redistribution and use in source and binary forms, with or without
+#  modification, are permitted provided that the following conditions are met:
+#
+#   * Redistributions of source code must retain the above copyright notice,
+#     this list of conditions and the following disclaimer.
+#   * Redistributions in binary form must reproduce the above copyright notice,
+#     this list of conditions and the following disclaimer in the documentation
+#     and/or other materials provided with the distribution.
+#   * Neither the name of Peter Haag nor the names of its contributors may be
+#     used to endorse or promote products derived from this software without
+#     specific prior written permission.
+#
+#  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+#  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+#  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+#  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+#  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+#  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+#  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+#  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+#  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+#  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+#  POSSIBILITY OF SUCH DAMAGE.
+
+
+set -e
+TZ=MET
+export TZ
+
+# prevent any default goelookup for testing
+NFDUMP="../nfdump/nfdump -G none"
+
+# write test.column.nf in columnar layout with the compression $1 and compare it with the reference output
+ColumnTest() {
+	rm -f test.column.nf
+	$NFDUMP -r dummy_flows.nf -Y -z=$1 -w test.column.nf
+	$NFDUMP -v test.column.nf | grep -q "Type 5 blocks"
+	$NFDUMP -r test.column.nf -q -o raw >test.column.out
+	diff -u test.column.out nftest.1.out
+}
+
+# columnar layout tests
+ColumnTest lz4
+ColumnTest lzo
+if [ "$TEST_ZSTD" = "yes" ]; then
+	ColumnTest zstd
+fi
+
+# filters on columnar blocks
+$NFDUMP -r dummy_flows.nf -q -o raw 'proto tcp and src port > 1024' >test.row.out
+$NFDUMP -r test.column.nf -q -o raw 'proto tcp and src port > 1024' >test.column.out
+diff -u test.column.out test.row.out
+# records, which are not restored, keep their flow count
+$NFDUMP -r dummy_flows.nf -q -o 'fmt:%cnt %ts %sa %da %pr %byt %evt' 'not proto udp and (nat event add or packets > 1000)' >test.row.out
+$NFDUMP -r test.column.nf -q -o 'fmt:%cnt %ts %sa %da %pr %byt %evt' 'not proto udp and (nat event add or packets > 1000)' >test.column.out
+diff -u test.column.out test.row.out
+$NFDUMP -r dummy_flows.nf -q -o csv -A srcip,proto 'src port > 1024' >test.row.out
+$NFDUMP -r test.column.nf -q -o csv -A srcip,proto 'src port > 1024' >test.column.out
+diff -u test.column.out test.row.out
+
+# convert a file into columnar layout and back
+cp dummy_flows.nf test.column.nf
+$NFDUMP -J 3 -Y -r test.column.nf
+$NFDUMP -v test.column.nf | grep -q "Type 5 blocks"
+$NFDUMP -r test.column.nf -q -o raw >test.column.out
+diff -u test.column.out nftest.1.out
+$NFDUMP -J 0 -r test.column.nf
+$NFDUMP -v test.column.nf | grep -q "Type 5 blocks" && exit 1
+$NFDUMP -r test.column.nf -q -o raw >test.column.out
+diff -u test.column.out nftest.1.out
+
+# write test.big.nf in columnar layout with the compression $1 and compare it with the row layout
+BigColumnTest() {
+	rm -f test.column.nf
+	$NFDUMP -r test.big.nf -Y -z=$1 -w test.column.nf
+	$NFDUMP -v test.column.nf | grep -q "Type 5 blocks"
+	test "$($NFDUMP -v test.column.nf | grep Records)" = "$($NFDUMP -v test.big.nf | grep Records)"
+	$NFDUMP -r test.column.nf -q -o raw >test.column.out
+	cmp test.column.out test.row.out
+}
+
+# full size columnar blocks of a file with 600 copies of the dummy flows
+rm -rf columndir
+mkdir columndir
+i=0
+while [ $i -lt 20 ]; do
+	cp dummy_flows.nf columndir/nf.$i
+	i=$((i + 1))
+done
+$NFDUMP -R columndir -w test.big.nf
+i=0
+while [ $i -lt 30 ]; do
+	cp test.big.nf columndir/big.$i
+	i=$((i + 1))
+done
+rm -f columndir/nf.*
+$NFDUMP -R columndir -w test.big.nf
+$NFDUMP -r test.big.nf -q -o raw >test.row.out
+
+BigColumnTest lz4
+BigColumnTest lzo
+BigColumnTest auto
+if [ "$TEST_BZIP2" = "yes" ]; then
+	BigColumnTest bz2
+fi
+if [ "$TEST_ZSTD" = "yes" ]; then
+	BigColumnTest zstd
+fi
+
+rm -rf columndir test.big.nf
+rm -f test.column.nf test.column.out test.row.out
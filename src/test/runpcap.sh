@@ -0,0 +1,53 @@
+#!/bin/sh
+#  This file is part of the nfdump project.
+#
+#  Copyright (c) 2024, Peter Haag
+#  All rights reserved.
+#
+#  Redistribution and use in source and binary forms, with or without
+#  modification, are permitted provided that the following conditions are met:
+#
+#   * Redistributions of source code must retain the above copyright notice,
+#     this list of conditions and the following disclaimer.
+#   * Redistributions in binary form must reproduce the above copyright notice,
+#     this list of conditions and the following disclaimer in the documentation
+#     and/or other materials provided with the distribution.
+#   * Neither the name of Peter Haag nor the names of its contributors may be
+#     used to endorse or promote products derived from this software without
+#     specific prior written permission.
+#
+#  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+#  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+#  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+#  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+#  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+#  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+#  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+#  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+#  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+#  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+#  POSSIBILITY OF SUCH DAMAGE.
+
+
+set -e
+TZ=MET
+export TZ
+
+# prevent any default goelookup for testing
+NFDUMP="../nfdump/nfdump -G none"
+FMT="fmt:%ts %te %pr %sap -> %dap %flg %pkt %byt %fl"
+
+# replay the same pcap with one and with several packet workers
+rm -rf pcap.1 pcap.4
+mkdir pcap.1 pcap.4
+./nfgen -c
+../nfpcapd/nfpcapd -r dummy.pcap -w pcap.1
+../nfpcapd/nfpcapd -r dummy.pcap -w pcap.4 -N 4
+
+# the workers must create the same flow records
+$NFDUMP -R pcap.1 -q -o "$FMT" | sort >test.pcap.1.out
+$NFDUMP -R pcap.4 -q -o "$FMT" | sort >test.pcap.4.out
+test -s test.pcap.1.out
+diff -u test.pcap.1.out test.pcap.4.out
+
+rm -rf pcap.1 pcap.4 dummy.pcap test.pcap.1.out test.pcap.4.out